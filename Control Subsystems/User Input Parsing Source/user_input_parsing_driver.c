@@ -4,11 +4,8 @@
 */
 
 #include "mcc_generated_files/mcc.h"
-
-//FCY is based off _XTAL_FREQ, the current system clock
-//(see system_configuration.h)
-#define XTAL_PERIOD ((double)1.0 / _XTAL_FREQ)
-#define FCY (_XTAL_FREQ / 2)
+#include "ClockConfiguration.h"
+#define XTAL_PERIOD ((double)1.0 / CLOCK_FOSC)
 
 #include <stdlib.h>
 #include <stdio.h>
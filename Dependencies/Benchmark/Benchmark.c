@@ -0,0 +1,309 @@
+/*
+ * File:    Benchmark.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+#include "Timebase.h"
+#include "Benchmark.h"
+
+#define true 1
+#define false 0
+
+//timer5 counts Fcy and rolls over every 65536 cycles
+#define BENCHMARK_TIMER 5
+#define BENCHMARK_TIMER_TICKS 65536UL
+
+//how many times an empty run is timed to find the cost of timing
+#define BENCHMARK_CALIBRATION_RUNS 8
+
+static const Timebase* Benchmark_Timebase;
+static uint16_t Benchmark_Overhead;
+
+int Benchmark_Initialize(void)
+{
+    unsigned int i;
+
+    Benchmark_Timebase = Timebase_Request_Dedicated(BENCHMARK_TIMER, CLOCK_FCY, BENCHMARK_TIMER_TICKS);
+    if (Benchmark_Timebase == 0)
+    {
+        return false;
+    }
+
+    //the smallest time two reads of the timer in a row can be apart
+    Benchmark_Overhead = 0xFFFF;
+    for (i = 0; i < BENCHMARK_CALIBRATION_RUNS; ++i)
+    {
+        uint16_t start = *Benchmark_Timebase->counter;
+        uint16_t elapsed = *Benchmark_Timebase->counter - start;
+
+        if (elapsed < Benchmark_Overhead)
+        {
+            Benchmark_Overhead = elapsed;
+        }
+    }
+
+    return true;
+}
+
+void Benchmark_Clear(Benchmark_Case* benchmarkCase)
+{
+    benchmarkCase->runs = 0;
+    benchmarkCase->operations = 0;
+    benchmarkCase->totalCycles = 0;
+    benchmarkCase->minimumCycles = 0;
+    benchmarkCase->maximumCycles = 0;
+    benchmarkCase->totalInstructions = 0;
+}
+
+void Benchmark_Record(Benchmark_Case* benchmarkCase, uint32_t cycles, uint32_t instructions)
+{
+    if (benchmarkCase->runs == 0 || cycles < benchmarkCase->minimumCycles)
+    {
+        benchmarkCase->minimumCycles = cycles;
+    }
+    if (cycles > benchmarkCase->maximumCycles)
+    {
+        benchmarkCase->maximumCycles = cycles;
+    }
+
+    ++benchmarkCase->runs;
+    benchmarkCase->operations += benchmarkCase->operationsPerRun;
+    benchmarkCase->totalCycles += cycles;
+    benchmarkCase->totalInstructions += instructions;
+}
+
+void Benchmark_Run_Case(Benchmark_Case* benchmarkCase, unsigned int runs)
+{
+    unsigned int i;
+
+    if (benchmarkCase->Setup != 0)
+    {
+        benchmarkCase->Setup();
+    }
+
+    for (i = 0; i < runs; ++i)
+    {
+        //the timer's 16-bit count is subtracted as unsigned, so a roll over in the middle
+        //of a run is still timed correctly
+        uint16_t start = *Benchmark_Timebase->counter;
+        uint16_t elapsed;
+
+        benchmarkCase->Run();
+        elapsed = *Benchmark_Timebase->counter - start;
+
+        Benchmark_Record(benchmarkCase, elapsed > Benchmark_Overhead ? elapsed - Benchmark_Overhead : 0, 0);
+    }
+}
+
+//returns how many times the loop ran in windowCycles
+static uint32_t Benchmark_Busy_Loop(uint32_t windowCycles)
+{
+    uint32_t elapsed = 0;
+    uint32_t loops = 0;
+    uint16_t last = *Benchmark_Timebase->counter;
+
+    while (elapsed < windowCycles)
+    {
+        uint16_t now = *Benchmark_Timebase->counter;
+
+        elapsed += (uint16_t)(now - last);
+        last = now;
+        ++loops;
+    }
+
+    return loops;
+}
+
+void Benchmark_Measure_Interrupt(Benchmark_Case* benchmarkCase, volatile uint16_t* interruptEnable, uint16_t mask, uint32_t eventsPerSecond, uint32_t windowCycles)
+{
+    uint16_t enabled = *interruptEnable & mask;
+    uint32_t quietLoops;
+    uint32_t loadedLoops;
+    uint32_t cycles = 0;
+
+    *interruptEnable &= ~mask;
+    quietLoops = Benchmark_Busy_Loop(windowCycles);
+    *interruptEnable |= mask;
+    loadedLoops = Benchmark_Busy_Loop(windowCycles);
+
+    //puts the interrupt back the way it was
+    *interruptEnable = (*interruptEnable & ~mask) | enabled;
+
+    if (loadedLoops < quietLoops)
+    {
+        cycles = (uint32_t)((uint64_t)(quietLoops - loadedLoops) * windowCycles / quietLoops);
+    }
+
+    benchmarkCase->operationsPerRun = (unsigned int)((uint64_t)eventsPerSecond * windowCycles / CLOCK_FCY);
+    Benchmark_Record(benchmarkCase, cycles, 0);
+}
+
+static void Benchmark_Put_String(const char* string, void (*Put)(char))
+{
+    while (*string != '\0')
+    {
+        Put(*string++);
+    }
+}
+
+static void Benchmark_Put_Number(uint32_t value, void (*Put)(char))
+{
+    char digits[10];
+    unsigned int length = 0;
+
+    do
+    {
+        digits[length++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (length > 0)
+    {
+        Put(digits[--length]);
+    }
+}
+
+//numerator / denominator with one decimal place (0 if denominator is 0)
+static void Benchmark_Put_Decimal(uint32_t numerator, uint32_t denominator, void (*Put)(char))
+{
+    uint32_t tenths = denominator ? (uint32_t)(((uint64_t)numerator * 10 + denominator / 2) / denominator) : 0;
+
+    Benchmark_Put_Number(tenths / 10, Put);
+    Put('.');
+    Put('0' + (char)(tenths % 10));
+}
+
+//how many operations would fit in a second at Fcy
+static uint32_t Benchmark_Operations_Per_Second(const Benchmark_Case* benchmarkCase)
+{
+    if (benchmarkCase->totalCycles == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t)CLOCK_FCY * benchmarkCase->operations / benchmarkCase->totalCycles);
+}
+
+void Benchmark_Write_CSV(const Benchmark_Case* cases, unsigned int numberOfCases, const char* revision, const char* platform, void (*Put)(char))
+{
+    unsigned int i;
+
+    Benchmark_Put_String("revision,platform,fcy,case,operation,runs,operations,cycles_per_operation,minimum_cycles_per_run,maximum_cycles_per_run,instructions_per_operation,operations_per_second\n", Put);
+
+    for (i = 0; i < numberOfCases; ++i)
+    {
+        const Benchmark_Case* benchmarkCase = &cases[i];
+
+        Benchmark_Put_String(revision, Put);
+        Put(',');
+        Benchmark_Put_String(platform, Put);
+        Put(',');
+        Benchmark_Put_Number(CLOCK_FCY, Put);
+        Put(',');
+        Benchmark_Put_String(benchmarkCase->name, Put);
+        Put(',');
+        Benchmark_Put_String(benchmarkCase->operation, Put);
+        Put(',');
+        Benchmark_Put_Number(benchmarkCase->runs, Put);
+        Put(',');
+        Benchmark_Put_Number(benchmarkCase->operations, Put);
+        Put(',');
+        Benchmark_Put_Decimal(benchmarkCase->totalCycles, benchmarkCase->operations, Put);
+        Put(',');
+        Benchmark_Put_Number(benchmarkCase->minimumCycles, Put);
+        Put(',');
+        Benchmark_Put_Number(benchmarkCase->maximumCycles, Put);
+        Put(',');
+        //left empty if they were not counted
+        if (benchmarkCase->totalInstructions != 0)
+        {
+            Benchmark_Put_Decimal(benchmarkCase->totalInstructions, benchmarkCase->operations, Put);
+        }
+        Put(',');
+        Benchmark_Put_Number(Benchmark_Operations_Per_Second(benchmarkCase), Put);
+        Put('\n');
+    }
+}
+
+static void Benchmark_Put_Field(const char* name, void (*Put)(char))
+{
+    Put('"');
+    Benchmark_Put_String(name, Put);
+    Benchmark_Put_String("\":", Put);
+}
+
+static void Benchmark_Put_Quoted(const char* string, void (*Put)(char))
+{
+    Put('"');
+    Benchmark_Put_String(string, Put);
+    Put('"');
+}
+
+void Benchmark_Write_JSON(const Benchmark_Case* cases, unsigned int numberOfCases, const char* revision, const char* platform, void (*Put)(char))
+{
+    unsigned int i;
+
+    Put('{');
+    Benchmark_Put_Field("revision", Put);
+    Benchmark_Put_Quoted(revision, Put);
+    Put(',');
+    Benchmark_Put_Field("platform", Put);
+    Benchmark_Put_Quoted(platform, Put);
+    Put(',');
+    Benchmark_Put_Field("fcy", Put);
+    Benchmark_Put_Number(CLOCK_FCY, Put);
+    Put(',');
+    Benchmark_Put_Field("cases", Put);
+    Benchmark_Put_String("[\n", Put);
+
+    for (i = 0; i < numberOfCases; ++i)
+    {
+        const Benchmark_Case* benchmarkCase = &cases[i];
+
+        Put('{');
+        Benchmark_Put_Field("case", Put);
+        Benchmark_Put_Quoted(benchmarkCase->name, Put);
+        Put(',');
+        Benchmark_Put_Field("operation", Put);
+        Benchmark_Put_Quoted(benchmarkCase->operation, Put);
+        Put(',');
+        Benchmark_Put_Field("runs", Put);
+        Benchmark_Put_Number(benchmarkCase->runs, Put);
+        Put(',');
+        Benchmark_Put_Field("operations", Put);
+        Benchmark_Put_Number(benchmarkCase->operations, Put);
+        Put(',');
+        Benchmark_Put_Field("cycles_per_operation", Put);
+        Benchmark_Put_Decimal(benchmarkCase->totalCycles, benchmarkCase->operations, Put);
+        Put(',');
+        Benchmark_Put_Field("minimum_cycles_per_run", Put);
+        Benchmark_Put_Number(benchmarkCase->minimumCycles, Put);
+        Put(',');
+        Benchmark_Put_Field("maximum_cycles_per_run", Put);
+        Benchmark_Put_Number(benchmarkCase->maximumCycles, Put);
+        Put(',');
+        //null if they were not counted
+        Benchmark_Put_Field("instructions_per_operation", Put);
+        if (benchmarkCase->totalInstructions != 0)
+        {
+            Benchmark_Put_Decimal(benchmarkCase->totalInstructions, benchmarkCase->operations, Put);
+        }
+        else
+        {
+            Benchmark_Put_String("null", Put);
+        }
+        Put(',');
+        Benchmark_Put_Field("operations_per_second", Put);
+        Benchmark_Put_Number(Benchmark_Operations_Per_Second(benchmarkCase), Put);
+        Put('}');
+        if (i + 1 < numberOfCases)
+        {
+            Put(',');
+        }
+        Put('\n');
+    }
+
+    Benchmark_Put_String("]}\n", Put);
+}
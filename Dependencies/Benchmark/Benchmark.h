@@ -0,0 +1,82 @@
+/*
+ * File:    Benchmark.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//Collects how many instruction cycles each benchmark case takes, and writes every case as
+//CSV or JSON so the numbers can be kept and compared from one revision to the next.
+//
+//On the PIC, Benchmark_Run_Case times a case with timer5, free running at Fcy, so each run
+//of a case has to take less than 65536 cycles (16ms at 4MHz).  The cost of reading the
+//timer is measured once by Benchmark_Initialize and taken back out of every run.  Cases
+//that cannot be run on their own (e.g. interrupts) are measured some other way by the
+//driver and handed over with Benchmark_Record.
+//On the Host Simulator, the cycles are the Cycle_Counter's estimates and the instructions
+//are the host instructions it stepped through, recorded with Benchmark_Record (see
+//firmware_benchmark.c).  The PIC has no instruction counter, so instructions are left out
+//of the PIC's results.
+//
+//Cases with the same name measure the same thing on the PIC and on the Host Simulator (see
+//"Readme for Benchmark Dependency.txt" for the list).
+
+typedef struct Benchmark_Case Benchmark_Case;
+
+struct Benchmark_Case
+{
+    //These have to be set before the case is run
+    const char* name;
+    //what one operation is (e.g. "call", "edge", "iteration")
+    const char* operation;
+    //Setup is called once before the runs (it can be 0 (NULL)), and Run once for every run
+    void (*Setup)(void);
+    void (*Run)(void);
+    //how many operations one run does
+    unsigned int operationsPerRun;
+
+    //the results (READ-ONLY), in instruction cycles (Fcy)
+    uint32_t runs;
+    uint32_t operations;
+    uint32_t totalCycles;
+    uint32_t minimumCycles;
+    uint32_t maximumCycles;
+    //0 if the instructions were not counted
+    uint32_t totalInstructions;
+};
+
+//A Benchmark_Case with a name, the operation it measures and its functions, e.g.
+//    Benchmark_Case update = BENCHMARK_CASE("IC1_Update", "call", 0, Update_IC1, 1);
+#define BENCHMARK_CASE(name, operation, setup, run, operationsPerRun) { name, operation, setup, run, operationsPerRun, 0, 0, 0, 0, 0, 0 }
+
+//starts timer5 for Benchmark_Run_Case and measures what timing a run costs by itself
+//returns 0 if timer5 is already in use
+int Benchmark_Initialize(void);
+
+//runs the case runs times (after its Setup) and records how long each run took
+void Benchmark_Run_Case(Benchmark_Case* benchmarkCase, unsigned int runs);
+
+//(PIC only) measures an interrupt by how much it slows down a busy loop, for interrupts that
+//cannot be called on their own:  the loop runs for windowCycles with the interrupt turned off
+//(mask in *interruptEnable) and then again with it on, and the cycles the interrupt took
+//away are recorded as one run.  operationsPerRun is set to the number of interrupts (or
+//edges) in the window, eventsPerSecond * windowCycles / Fcy.  Any other interrupt that is
+//on takes the same time from both loops, so it is not counted.
+void Benchmark_Measure_Interrupt(Benchmark_Case* benchmarkCase, volatile uint16_t* interruptEnable, uint16_t mask, uint32_t eventsPerSecond, uint32_t windowCycles);
+
+//adds one run of operationsPerRun operations that took cycles (and instructions, or 0 if
+//they were not counted)
+void Benchmark_Record(Benchmark_Case* benchmarkCase, uint32_t cycles, uint32_t instructions);
+
+//clears the case's results
+void Benchmark_Clear(Benchmark_Case* benchmarkCase);
+
+//write every case's results one character at a time through Put (e.g. to a UART, or a
+//file on the host), labeled with revision and platform ("pic24" or "host", say)
+//CSV:   a header line, then one line per case
+//JSON:  {"revision":..., "platform":..., "fcy":..., "cases":[{...}, ...]}
+//Per operation numbers have one decimal place, and the operations per second are at Fcy.
+void Benchmark_Write_CSV(const Benchmark_Case* cases, unsigned int numberOfCases, const char* revision, const char* platform, void (*Put)(char));
+void Benchmark_Write_JSON(const Benchmark_Case* cases, unsigned int numberOfCases, const char* revision, const char* platform, void (*Put)(char));
@@ -0,0 +1,154 @@
+/*
+ * File:    FirmwareBenchmark.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+#include "InputCapture.h"
+#include "PWM.h"
+#include "FirmwareBenchmark.h"
+
+//every PWM case sweeps its output through this many different values, so the numbers are
+//an average over the whole range instead of one value's best or worst case
+#define FIRMWARE_BENCHMARK_SWEEP_STEPS 16
+
+//OC3's frequency sweeps 1kHz - 16kHz (in range for an Fcy-clocked module in both profiles)
+#define FIRMWARE_BENCHMARK_PWM_FREQUENCY 1000
+#define FIRMWARE_BENCHMARK_SERVO_FRAME_RATE 50
+
+static IC_Module Receiver_Input;
+static IC_Fixed_Module Fixed_Receiver_Input;
+static IC_Fixed_Module Fast_Input;
+static IC_Latest_Period Latest_Period;
+static Count_Monitor Stepper_Counter;
+
+static PWM_Module Output = PWM_MODULE(3);
+static PWM_Fixed_Module Fixed_Output = PWM_FIXED_MODULE(3);
+static PWM_Output Handle_Output;
+static PWM_Fixed_Module Servo_Output = PWM_FIXED_MODULE(5);
+static PWM_Servo Servo;
+
+static unsigned int Sweep;
+
+//the next step of the sweep, 0 - FIRMWARE_BENCHMARK_SWEEP_STEPS - 1
+static unsigned int Firmware_Benchmark_Next_Step(void)
+{
+    Sweep = (Sweep + 1) % FIRMWARE_BENCHMARK_SWEEP_STEPS;
+
+    return Sweep;
+}
+
+static void Update_IC1(void)
+{
+    IC1_Update(&Receiver_Input);
+}
+
+static void Fixed_Update_IC2(void)
+{
+    IC2_Fixed_Update(&Fixed_Receiver_Input);
+}
+
+static void Read_IC1_Latest_Period(void)
+{
+    (void)IC1_Read_Latest_Period(&Latest_Period);
+}
+
+static void Update_IC4(void)
+{
+    IC4_Update(&Stepper_Counter);
+}
+
+//5% - 95%
+static void Update_PWM_Duty_Cycle(void)
+{
+    Output.dutyCyclePercentage = 5.0 + 6.0 * Firmware_Benchmark_Next_Step();
+    PWM_Update_OC3_DutyCycle(&Output);
+}
+
+static void Update_PWM_Frequency(void)
+{
+    Output.frequency = FIRMWARE_BENCHMARK_PWM_FREQUENCY * (1 + Firmware_Benchmark_Next_Step());
+    PWM_Update_OC3_Frequency(&Output);
+}
+
+static void Update_Fixed_PWM_Duty_Cycle(void)
+{
+    Fixed_Output.dutyCycle = Q15_FROM_PERCENTAGE(5) + Firmware_Benchmark_Next_Step() * Q15_FROM_PERCENTAGE(6);
+    PWM_Update_OC3_Fixed_DutyCycle(&Fixed_Output);
+}
+
+static void Update_Fixed_PWM_Frequency(void)
+{
+    Fixed_Output.frequency = FIRMWARE_BENCHMARK_PWM_FREQUENCY * (1 + Firmware_Benchmark_Next_Step());
+    PWM_Update_OC3_Fixed_Frequency(&Fixed_Output);
+}
+
+static void Set_PWM_Output_Duty_Cycle(void)
+{
+    PWM_Output_Set_DutyCycle(&Handle_Output, Q15_FROM_PERCENTAGE(5) + Firmware_Benchmark_Next_Step() * Q15_FROM_PERCENTAGE(6));
+}
+
+//1000us - 2000us
+static void Set_Servo_Pulse_Width(void)
+{
+    PWM_Servo_Set_Pulse_Width(&Servo, 1000 + 1000 / (FIRMWARE_BENCHMARK_SWEEP_STEPS - 1) * Firmware_Benchmark_Next_Step());
+}
+
+Benchmark_Case Firmware_Benchmark_Cases[FIRMWARE_BENCHMARK_NUMBER_OF_CASES] =
+{
+    BENCHMARK_CASE("IC1_Update", "call", 0, Update_IC1, 1),
+    BENCHMARK_CASE("IC2_Fixed_Update", "call", 0, Fixed_Update_IC2, 1),
+    BENCHMARK_CASE("IC1_Read_Latest_Period", "call", 0, Read_IC1_Latest_Period, 1),
+    BENCHMARK_CASE("IC4_Update", "call", 0, Update_IC4, 1),
+    BENCHMARK_CASE("PWM_Update_OC3_DutyCycle", "call", 0, Update_PWM_Duty_Cycle, 1),
+    BENCHMARK_CASE("PWM_Update_OC3_Frequency", "call", 0, Update_PWM_Frequency, 1),
+    BENCHMARK_CASE("PWM_Update_OC3_Fixed_DutyCycle", "call", 0, Update_Fixed_PWM_Duty_Cycle, 1),
+    BENCHMARK_CASE("PWM_Update_OC3_Fixed_Frequency", "call", 0, Update_Fixed_PWM_Frequency, 1),
+    BENCHMARK_CASE("PWM_Output_Set_DutyCycle", "call", 0, Set_PWM_Output_Duty_Cycle, 1),
+    BENCHMARK_CASE("PWM_Servo_Set_Pulse_Width", "call", 0, Set_Servo_Pulse_Width, 1),
+    BENCHMARK_CASE("IC1_Interrupt_50Hz", "edge", 0, 0, 1),
+    BENCHMARK_CASE("IC6_Interrupt_6kHz", "edge", 0, 0, 1),
+    BENCHMARK_CASE("control_iteration", "iteration", 0, 0, 1),
+    BENCHMARK_CASE("stepper_tick", "iteration", 0, 0, 1),
+};
+
+void Firmware_Benchmark_Initialize(void)
+{
+    unsigned int i;
+
+    IC1_Initialize(&Receiver_Input);
+    IC2_Fixed_Initialize(&Fixed_Receiver_Input);
+    IC4_Initialize(&Stepper_Counter);
+    IC6_Fixed_Initialize(&Fast_Input);
+
+    PWM_OC3_Initialize(&Output);
+    Output.frequency = FIRMWARE_BENCHMARK_PWM_FREQUENCY;
+    Output.dutyCyclePercentage = 50;
+    PWM_Update_OC3_Frequency(&Output);
+
+    PWM_OC3_Fixed_Initialize(&Fixed_Output);
+    Fixed_Output.frequency = FIRMWARE_BENCHMARK_PWM_FREQUENCY;
+    Fixed_Output.dutyCycle = Q15_FROM_PERCENTAGE(50);
+    PWM_Update_OC3_Fixed_Frequency(&Fixed_Output);
+
+    PWM_Output_Initialize(&Handle_Output, 4, FIRMWARE_BENCHMARK_PWM_FREQUENCY);
+
+    Servo_Output.Initialize(&Servo_Output);
+    Servo_Output.frequency = FIRMWARE_BENCHMARK_SERVO_FRAME_RATE;
+    Servo_Output.UpdateFrequency(&Servo_Output);
+    Servo.output = &Servo_Output;
+    Servo.frameRate = FIRMWARE_BENCHMARK_SERVO_FRAME_RATE;
+    PWM_Servo_Initialize(&Servo);
+
+    Sweep = 0;
+    for (i = 0; i < FIRMWARE_BENCHMARK_NUMBER_OF_CASES; ++i)
+    {
+        Benchmark_Clear(&Firmware_Benchmark_Cases[i]);
+    }
+}
+
+void Firmware_Benchmark_Drain_Fast_Input(void)
+{
+    IC6_Fixed_Update(&Fast_Input);
+}
@@ -0,0 +1,59 @@
+/*
+ * File:    FirmwareBenchmark.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include "Benchmark.h"
+
+//The benchmark cases for the firmware's hot paths, shared by the Host Simulator's
+//firmware_benchmark and the PIC's firmware_benchmark_driver.c so both measure the same code
+//under the same names.  Firmware_Benchmark_Initialize sets up the modules the cases use:
+//    IC1 (IC_Module), IC2 (IC_Fixed_Module)    50Hz receiver-style inputs on RP4 and RP5
+//    IC4 (Count_Monitor)                       the stepper motor's count on RP7
+//    IC6 (IC_Fixed_Module)                     a 6kHz input on RP11
+//    OC3 (PWM_Module and PWM_Fixed_Module), OC4 (PWM_Output), OC5 (PWM_Servo at 50Hz)
+//The driver has to feed the inputs (OC1 and OC2 are left free for the PIC's driver to
+//make them with).
+
+//Cases that read an input, which the driver runs once per 20ms frame (with
+//Benchmark_Run_Case(case, 1)) so each one has a frame's worth of new periods to handle
+#define FIRMWARE_BENCHMARK_IC1_UPDATE 0
+#define FIRMWARE_BENCHMARK_IC2_FIXED_UPDATE 1
+#define FIRMWARE_BENCHMARK_IC1_READ_LATEST_PERIOD 2
+#define FIRMWARE_BENCHMARK_IC4_UPDATE 3
+#define FIRMWARE_BENCHMARK_FRAME_CASES 4
+
+//Cases that can run back to back (with Benchmark_Run_Case(case, runs))
+#define FIRMWARE_BENCHMARK_PWM_UPDATE_DUTY_CYCLE 4
+#define FIRMWARE_BENCHMARK_PWM_UPDATE_FREQUENCY 5
+#define FIRMWARE_BENCHMARK_PWM_UPDATE_FIXED_DUTY_CYCLE 6
+#define FIRMWARE_BENCHMARK_PWM_UPDATE_FIXED_FREQUENCY 7
+#define FIRMWARE_BENCHMARK_PWM_OUTPUT_SET_DUTY_CYCLE 8
+#define FIRMWARE_BENCHMARK_PWM_SERVO_SET_PULSE_WIDTH 9
+#define FIRMWARE_BENCHMARK_FIRST_REPEATED_CASE FIRMWARE_BENCHMARK_PWM_UPDATE_DUTY_CYCLE
+#define FIRMWARE_BENCHMARK_REPEATED_CASES 6
+
+//Cases the driver measures itself and hands over with Benchmark_Record (Run is 0 (NULL))
+//the IC1 and IC6 interrupts, per edge
+#define FIRMWARE_BENCHMARK_IC1_INTERRUPT_50HZ 10
+#define FIRMWARE_BENCHMARK_IC6_INTERRUPT_6KHZ 11
+//main_driver.c's scheduler:  the tick every 20ms that runs the receiver, kill switch and
+//mixing tasks (and the stepper task), and a tick that only runs the stepper task
+#define FIRMWARE_BENCHMARK_CONTROL_ITERATION 12
+#define FIRMWARE_BENCHMARK_STEPPER_TICK 13
+
+#define FIRMWARE_BENCHMARK_NUMBER_OF_CASES 14
+
+//the inputs' rates, for the driver's signals (and for counting the interrupt cases' edges)
+#define FIRMWARE_BENCHMARK_RECEIVER_HZ 50
+#define FIRMWARE_BENCHMARK_FAST_INPUT_HZ 6000
+
+extern Benchmark_Case Firmware_Benchmark_Cases[FIRMWARE_BENCHMARK_NUMBER_OF_CASES];
+
+//initializes the modules the cases use (see above) and clears every case's results
+void Firmware_Benchmark_Initialize(void);
+
+//reads IC6's 6kHz input so its ring does not overrun (not measured, call it every frame)
+void Firmware_Benchmark_Drain_Fast_Input(void);
@@ -0,0 +1,53 @@
+/*
+ * File:    ClockConfiguration.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#define true 1
+#define false 0
+
+//how many times the switch and the PLL lock are checked before giving up (each check is a
+//few instruction cycles, so this is several milliseconds even at 4MHz, and the PLL locks
+//in under 2ms)
+#define CLOCK_SWITCH_TIMEOUT_CHECKS 20000
+
+//OSWEN, the bit in OSCCON's low byte that starts a switch to NOSC
+#define CLOCK_SWITCH_ENABLE 0x01
+
+int Clock_Initialize(void)
+{
+    unsigned int checks;
+
+    //the FRC postscaler is 1:1 (8MHz), and the instruction clock is not slowed down by DOZE
+    CLKDIVbits.RCDIV = 0b000;
+    CLKDIVbits.DOZEN = 0;
+
+    if (OSCCONbits.COSC != CLOCK_OSCILLATOR_SETTING)
+    {
+        //NOSC and OSWEN are locked, so they can only be written with these unlock sequences
+        //(for FRCPLL, the PLLDIV configuration bits have to select the 4x PLL)
+        __builtin_write_OSCCONH(CLOCK_OSCILLATOR_SETTING);
+        __builtin_write_OSCCONL(OSCCON | CLOCK_SWITCH_ENABLE);
+
+        //OSWEN is cleared by the hardware once the new oscillator is running
+        for (checks = 0; OSCCONbits.OSWEN && checks < CLOCK_SWITCH_TIMEOUT_CHECKS; ++checks)
+        {
+        }
+    }
+
+#if CLOCK_USES_PLL
+    for (checks = 0; !OSCCONbits.LOCK && checks < CLOCK_SWITCH_TIMEOUT_CHECKS; ++checks)
+    {
+    }
+
+    if (!OSCCONbits.LOCK)
+    {
+        return false;
+    }
+#endif
+
+    return OSCCONbits.COSC == CLOCK_OSCILLATOR_SETTING;
+}
@@ -0,0 +1,98 @@
+/*
+ * File:    ClockConfiguration.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//Every clock rate, prescaler and tick constant the other dependencies use is worked out
+//from CLOCK_PROFILE here, when the program is compiled.  Define one of these (here, or in
+//the project's compiler options) to pick the speed the PIC runs at:
+//
+//  CLOCK_PROFILE_FRC_8MHZ        the internal FRC oscillator with a 1:1 postscaler
+//                                Fosc = 8MHz, Fcy = 4MHz (the default, and what the
+//                                project was first tested at)
+//  CLOCK_PROFILE_FRC_PLL_32MHZ   the FRC oscillator through the 4x PLL (FRCPLL)
+//                                Fosc = 32MHz, Fcy = 16MHz (the fastest this PIC runs)
+//
+//Everything that counts instruction cycles (the scheduler's tick, OC3 - OC6, PWM_Servo and
+//IC_32_BIT_TIMESTAMPS) gets 4x as many of them at 32MHz.  The timer shared by OC1, OC2 and
+//the IC modules ticks at 62.5kHz in both profiles, so they keep the same ranges (see
+//CLOCK_TIMER1_MAXIMUM_TICKS_PER_SECOND).
+//Call Clock_Initialize right after SYSTEM_Initialize to switch to the profile's oscillator.
+#define CLOCK_PROFILE_FRC_8MHZ 1
+#define CLOCK_PROFILE_FRC_PLL_32MHZ 2
+
+#ifndef CLOCK_PROFILE
+#define CLOCK_PROFILE CLOCK_PROFILE_FRC_8MHZ
+#endif
+
+#define CLOCK_FRC_FREQUENCY 8000000UL
+
+//the NOSC/COSC codes in OSCCON for the oscillators the profiles use
+#define CLOCK_FRC_DIVIDED_SETTING 0b111
+#define CLOCK_FRC_PLL_SETTING 0b001
+
+#if CLOCK_PROFILE == CLOCK_PROFILE_FRC_8MHZ
+#define CLOCK_FOSC CLOCK_FRC_FREQUENCY
+#define CLOCK_OSCILLATOR_SETTING CLOCK_FRC_DIVIDED_SETTING
+#define CLOCK_USES_PLL 0
+#elif CLOCK_PROFILE == CLOCK_PROFILE_FRC_PLL_32MHZ
+#define CLOCK_FOSC (CLOCK_FRC_FREQUENCY * 4)
+#define CLOCK_OSCILLATOR_SETTING CLOCK_FRC_PLL_SETTING
+#define CLOCK_USES_PLL 1
+#else
+#error "CLOCK_PROFILE has to be CLOCK_PROFILE_FRC_8MHZ or CLOCK_PROFILE_FRC_PLL_32MHZ"
+#endif
+
+//one instruction cycle is 2 oscillator cycles
+#define CLOCK_FCY (CLOCK_FOSC / 2)
+//the length of an instruction cycle in seconds (only for the double-based PWM functions)
+#define CLOCK_TCY ((double)1.0 / CLOCK_FCY)
+#define CLOCK_FCY_TICKS_PER_MICROSECOND (CLOCK_FCY / 1000000)
+
+//Programs never define FCY (or any other clock constant) themselves; they all include this
+//file, so the whole build follows CLOCK_PROFILE.  The XC16 delay library needs FCY too, so
+//include this file before libpic30.h
+#ifndef FCY
+#define FCY CLOCK_FCY
+#endif
+
+#if CLOCK_FCY > 16000000UL
+#error "the PIC24FJ128GA202 runs at most 16 MIPS (Fosc = 32MHz)"
+#endif
+#if CLOCK_FCY % 1000000 != 0
+#error "Fcy has to be a whole number of MHz (PWM_Servo converts microseconds to Fcy ticks)"
+#endif
+
+//OC1, OC2 and the IC modules share one timer (timer1 in main_driver.c, started by the
+//Timebase dependency), and their ranges (e.g. the 500mHz - 6kHz the Input Capture
+//dependency measures) are for a 62.5kHz timer.  Its prescaler is the smallest one that
+//brings it down to this rate or below.
+#define CLOCK_TIMER1_MAXIMUM_TICKS_PER_SECOND 62500UL
+
+//the prescaler as the number of bits it shifts Fcy right by
+#if CLOCK_FCY <= CLOCK_TIMER1_MAXIMUM_TICKS_PER_SECOND
+#define CLOCK_TIMER1_PRESCALER_SHIFT 0
+#elif (CLOCK_FCY >> 3) <= CLOCK_TIMER1_MAXIMUM_TICKS_PER_SECOND
+#define CLOCK_TIMER1_PRESCALER_SHIFT 3
+#elif (CLOCK_FCY >> 6) <= CLOCK_TIMER1_MAXIMUM_TICKS_PER_SECOND
+#define CLOCK_TIMER1_PRESCALER_SHIFT 6
+#elif (CLOCK_FCY >> 8) <= CLOCK_TIMER1_MAXIMUM_TICKS_PER_SECOND
+#define CLOCK_TIMER1_PRESCALER_SHIFT 8
+#else
+#error "no timer1 prescaler brings Fcy down to CLOCK_TIMER1_MAXIMUM_TICKS_PER_SECOND"
+#endif
+
+//1, 8, 64 or 256
+#define CLOCK_TIMER1_PRESCALER (1U << CLOCK_TIMER1_PRESCALER_SHIFT)
+#define CLOCK_TIMER1_TICKS_PER_SECOND (CLOCK_FCY >> CLOCK_TIMER1_PRESCALER_SHIFT)
+
+//switches to the profile's oscillator (and waits for the PLL to lock, if it uses it)
+//The configuration bits (system_configuration.h) have to allow clock switching
+//(FCKSM = CSECMD) for CLOCK_PROFILE_FRC_PLL_32MHZ.
+//returns 1 if the PIC is running from the profile's oscillator afterwards, or 0 if it did
+//not switch, in which case every timing constant above is wrong and nothing should be started
+int Clock_Initialize(void);
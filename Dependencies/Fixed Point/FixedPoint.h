@@ -0,0 +1,59 @@
+/*
+ * File:    FixedPoint.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//The PIC24 has no floating point hardware, so every operation on a double is a call
+//into the compiler's floating point library (hundreds of instruction cycles each).
+//These helpers let the dependencies do the same calculations with integers instead.
+
+//A Q15 value is a fraction stored in 16 bits, where Q15_ONE (32768) represents 1.0
+//e.g. a 12.5% duty cycle is stored as 4096.  Each step is 1/32768, or about 0.003%
+typedef uint16_t Q15;
+
+#define Q15_ONE 32768U
+
+//ONLY use this with constants, the floating point math is then done by the compiler
+//instead of the PIC
+#define Q15_FROM_PERCENTAGE(percentage) ((Q15)((percentage) * (Q15_ONE / 100.0) + 0.5))
+
+//converts a Q15 value to the percentage used by frameworks that still use doubles
+//(e.g. 4096 becomes 12.5)
+#define Q15_TO_PERCENTAGE(value) ((double)(value) * (100.0 / Q15_ONE))
+
+//divides a 32 bit number by a 16 bit number
+//the quotient MUST fit in 16 bits, in exchange this is a single DIV.UD instruction
+//(18 cycles) on the PIC24 instead of the 32 bit division library routine
+static inline uint16_t FixedPoint_Divide(uint32_t numerator, uint16_t denominator)
+{
+#ifdef __XC16__
+    return __builtin_divud(numerator, denominator);
+#else
+    return (uint16_t)(numerator / denominator);
+#endif
+}
+
+//returns part / whole as a Q15 fraction (limited to 0 - Q15_ONE)
+static inline Q15 Q15_Ratio(uint16_t part, uint16_t whole)
+{
+    if (whole == 0)
+    {
+        return 0;
+    }
+    else if (part >= whole)
+    {
+        return Q15_ONE;
+    }
+    
+    return FixedPoint_Divide((uint32_t)part << 15, whole);
+}
+
+//returns value * fraction (e.g. the number of timer ticks in a given duty cycle)
+static inline uint16_t Q15_Multiply(uint16_t value, Q15 fraction)
+{
+    return (uint16_t)(((uint32_t)value * fraction) >> 15);
+}
@@ -1,374 +1,1093 @@
 /*
-* File:    InputCapture.h
+* File:    InputCapture.c
 * Author:  Zachary Downum
 */
 
 #include "mcc_generated_files/mcc.h"
-#include "InputCapture.h"
+#include "ClockConfiguration.h"
+#include "Timebase.h"
 
-//FCY is based off _XTAL_FREQ, the current system clock
-//(see system_configuration.h)
-#define FCY ((double)_XTAL_FREQ / 2)
+#include <stdlib.h>
+#include "InputCapture.h"
+#include "FixedPoint.h"
+#include "Profiler.h"
 
-#define TIMER_PRESCALER 64
-#define TIMER_FREQUENCY ((double)FCY / TIMER_PRESCALER)
+#define TIMER_TICKS_PER_SECOND ((uint32_t)CLOCK_TIMER1_TICKS_PER_SECOND)
+#define FCY_TICKS_PER_SECOND ((uint32_t)CLOCK_FCY)
 
 #define true 1
 #define false 0
 
 #define RISING_EDGE_TRIGGER_SETTING 0b011
 #define FALLING_EDGE_TRIGGER_SETTING 0b010
+#define EVERY_EDGE_TRIGGER_SETTING 0b001
+
+//the timer a module is timed by, if it has to be timer3 (the 32-bit timestamps), or
+//SHARED_CLOCK_TIMER for the shared clock Timebase_Request gives the module
+#define SHARED_CLOCK_TIMER 0
+#define TIMESTAMP_TIMER 3
+
+//SYNCSEL value that restarts ICxTMR along with timer3, so it always reads the same
+//count as TMR3 (0 lets ICxTMR run freely)
+#define TIMER3_SYNC_SETTING 0b01101
+
+//The shared 62.5kHz clock is also used by the PWM dependency, and its timer is never
+//restarted, so the 32-bit timestamps use a timer of their own (timer3)
+//Every capture is extended to 32 bits when it is read (see IC_Read_Capture), which only
+//works if it is read less than one timer3 rollover (65536 ticks, 16ms) after it happened.
+//A rising time left in the FIFO until its falling edge (or a batch of captures left
+//until the 2nd one) could be older than that for a slow signal, so with 32-bit
+//timestamps every PWM-type module captures every edge with an interrupt on each one.
+#ifdef IC_32_BIT_TIMESTAMPS
+#define CAPTURE_TIMER TIMESTAMP_TIMER
+#define CAPTURE_TICKS_PER_SECOND FCY_TICKS_PER_SECOND
+#define RECEIVER_CAPTURES_PER_INTERRUPT 1
+#define SPARE_CAPTURES_PER_INTERRUPT 1
+#define ALWAYS_CAPTURE_EVERY_EDGE true
+#else
+#define CAPTURE_TIMER SHARED_CLOCK_TIMER
+#define CAPTURE_TICKS_PER_SECOND TIMER_TICKS_PER_SECOND
+#define RECEIVER_CAPTURES_PER_INTERRUPT IC_RECEIVER_CAPTURES_PER_INTERRUPT
+#define SPARE_CAPTURES_PER_INTERRUPT IC_SPARE_CAPTURES_PER_INTERRUPT
+#define ALWAYS_CAPTURE_EVERY_EDGE false
+#endif
+
+//The PPM module captures only rising edges, and with 16 bit captures it interrupts once 4 are
+//in the FIFO.  A frame is then published up to 3 channels (about 6ms) after its sync gap ends,
+//for about 2 interrupts per frame of 8 channels.  With IC_32_BIT_TIMESTAMPS, a capture left
+//in the FIFO across the sync gap could be older than a timer3 rollover, so it interrupts on
+//every edge.
+#ifdef IC_32_BIT_TIMESTAMPS
+#define PPM_CAPTURES_PER_INTERRUPT 1
+#else
+#define PPM_CAPTURES_PER_INTERRUPT 4
+#endif
+//pendingChannels while the PPM module waits for a sync gap
+#define PPM_NOT_SYNCHRONIZED 0xFFFF
+
+#define ABSOLUTE_MIN_COUNTS IC4_MINIMUM_COUNT
+#define ABSOLUTE_MAX_COUNTS IC4_MAXIMUM_COUNT
+
+
+//every IC module's control registers have the same layout, so IC1's bit definitions
+//are used to access all of them
+typedef __typeof__(IC1CON1bits) IC_Control1_Bits;
+typedef __typeof__(IC1CON2bits) IC_Control2_Bits;
+
+typedef struct IC_Channel IC_Channel;
+
+//The six IC modules only differ in which registers and bits they use, so everything
+//that is different about a module is stored in its entry of IC_Channels below and
+//all of the modules share the same code.
+struct IC_Channel
+{
+	IC_Control1_Bits* control1;
+	IC_Control2_Bits* control2;
+	//1-6, used to read the right ICxBUF (see IC_Read_Buffer)
+	unsigned int moduleNumber;
 
-#define ABSOLUTE_MIN_COUNTS -1412
-#define ABSOLUTE_MAX_COUNTS 1412
+	//the remappable pin the signal comes in on (RPn is also pin RBn on this PIC)
+	unsigned int remappablePin;
+	//the peripheral pin select register for this module, and where its 6 bit field starts
+	volatile uint16_t* pinSelect;
+	unsigned int pinSelectShift;
 
+	//this module's bit in the interrupt flag and enable registers
+	volatile uint16_t* interruptFlag;
+	volatile uint16_t* interruptEnable;
+	uint16_t interruptMask;
+	//the interrupt priority register, and where this module's 3 bit field starts
+	volatile uint16_t* interruptPriority;
+	unsigned int interruptPriorityShift;
 
-//this buffer will be used by the interrupt to store values used to
-//calculate duty cycle % and frequency.
+	//the timer that times the captures (TIMESTAMP_TIMER, or SHARED_CLOCK_TIMER for the
+	//shared clock from the Timebase dependency), and how fast it ticks
+	//A shared clock is requested at exactly ticksPerSecond, which has to be a rate a timer
+	//can run at (see Timebase.h), or the calculated frequency would be wrong.
+	unsigned int timer;
+	uint32_t ticksPerSecond;
+
+	//1 captures one edge per interrupt.  With 16 bit timestamps the interrupt switches
+	//between rising and falling edge mode (see IC_Handle_Edge), and with
+	//IC_32_BIT_TIMESTAMPS the module captures every edge instead, reading each one out
+	//as soon as it arrives (see IC_Handle_Edge_Batch).
+	//2 or 4 captures every edge and only interrupts once that many captures are in the
+	//FIFO, which are all read out at once (see IC_Handle_Edge_Batch).  2 gives one
+	//interrupt per period instead of two, 4 gives one every 2 periods.
+	unsigned int capturesPerInterrupt;
+
+	//where the interrupt stores the capture times (IC_Ring, or Count_Monitor_Buffer for IC4)
+	void* buffer;
+	//a switch the interrupt checks every period against, or NULL (see IC_Switch_Check)
+	IC_Switch_Buffer* pulseSwitch;
+};
+
+//this ring will be used by the interrupt to store every period it measures
 //It will also be used by the Update function to calculate the duty
 //cycle and frequency and store those into the IC_Module's variables
-//this is true of all buffers initialized in this file
-IC_Buffer IC1_Buffer;
-IC_Buffer IC2_Buffer;
-IC_Buffer IC3_Buffer;
+//this is true of all rings initialized in this file
+IC_Ring IC1_Ring;
+IC_Switch_Buffer IC1_Switch;
+IC_Ring IC2_Ring;
+IC_Ring IC3_Ring;
 Count_Monitor_Buffer IC4_Buffer;
-IC_Buffer IC5_Buffer;
-IC_Buffer IC6_Buffer;
+IC_Ring IC5_Ring;
+IC_Ring IC6_Ring;
+//used instead of IC_PPM_MODULE's ring (see IC_Handle_PPM)
+IC_PPM_Buffer IC_PPM_State;
+
+#define IC1_CHANNEL 0
+#define IC2_CHANNEL 1
+#define IC3_CHANNEL 2
+#define IC4_CHANNEL 3
+#define IC5_CHANNEL 4
+#define IC6_CHANNEL 5
+
+//See page 174 in the PIC24FJ128GA204 family documentation for the peripheral pin select
+//registers, and page 89 in the PIC24FJ128GA202 documentation for the interrupt registers
+//All of the modules are timed by the shared 62.5kHz clock (timer1 in main_driver.c, see
+//IC_Channel_Configure), except that the PWM-type modules use timer3 (no prescaler) with
+//IC_32_BIT_TIMESTAMPS
+//By default the receiver inputs interrupt once per period, IC6 (the spare, which is tested
+//up to 6kHz) once every 2 periods (see IC_RECEIVER_CAPTURES_PER_INTERRUPT in InputCapture.h),
+//and IC4 on every stepper pulse so the count is never behind
+//(with IC_32_BIT_TIMESTAMPS the receiver inputs and IC6 interrupt on every edge instead)
+//Only IC1 (the kill switch in main_driver.c) has a switch checked in its interrupt
+static const IC_Channel IC_Channels[] =
+{
+	{ (IC_Control1_Bits*)&IC1CON1, (IC_Control2_Bits*)&IC1CON2, 1, 4, &RPINR7, 0, &IFS0, &IEC0, 1 << 1, &IPC0, 4, CAPTURE_TIMER, CAPTURE_TICKS_PER_SECOND, RECEIVER_CAPTURES_PER_INTERRUPT, &IC1_Ring, &IC1_Switch },
+	{ (IC_Control1_Bits*)&IC2CON1, (IC_Control2_Bits*)&IC2CON2, 2, 5, &RPINR7, 8, &IFS0, &IEC0, 1 << 5, &IPC1, 4, CAPTURE_TIMER, CAPTURE_TICKS_PER_SECOND, RECEIVER_CAPTURES_PER_INTERRUPT, &IC2_Ring, NULL },
+	{ (IC_Control1_Bits*)&IC3CON1, (IC_Control2_Bits*)&IC3CON2, 3, 6, &RPINR8, 0, &IFS2, &IEC2, 1 << 5, &IPC9, 4, CAPTURE_TIMER, CAPTURE_TICKS_PER_SECOND, RECEIVER_CAPTURES_PER_INTERRUPT, &IC3_Ring, NULL },
+	{ (IC_Control1_Bits*)&IC4CON1, (IC_Control2_Bits*)&IC4CON2, 4, 7, &RPINR8, 8, &IFS2, &IEC2, 1 << 6, &IPC9, 8, SHARED_CLOCK_TIMER, TIMER_TICKS_PER_SECOND, 1, &IC4_Buffer, NULL },
+	{ (IC_Control1_Bits*)&IC5CON1, (IC_Control2_Bits*)&IC5CON2, 5, 8, &RPINR9, 0, &IFS2, &IEC2, 1 << 7, &IPC9, 12, CAPTURE_TIMER, CAPTURE_TICKS_PER_SECOND, RECEIVER_CAPTURES_PER_INTERRUPT, &IC5_Ring, NULL },
+	{ (IC_Control1_Bits*)&IC6CON1, (IC_Control2_Bits*)&IC6CON2, 6, 11, &RPINR9, 8, &IFS2, &IEC2, 1 << 8, &IPC10, 0, CAPTURE_TIMER, CAPTURE_TICKS_PER_SECOND, SPARE_CAPTURES_PER_INTERRUPT, &IC6_Ring, NULL },
+};
 
-//One issue with storing the rising and falling times
-//is that it is unknown when the user will call the Update function
-//on an IC module.  If they call Update when the rising and falling
-//times are mismatched (the rising time is from period 2, but the
-//falling time is still from period 1), then the calculations performed
-//using those values will be incorrect.
 
-//Fortunately, each IC module has a built in buffer that can store up to
-//4 values in a FIFO pipeline.  This can be used to ensure the three
-//variables are updated atomically before they are used again by the
-//main program.
+//ICxBUF is read through this switch instead of a pointer in IC_Channels (the host
+//simulator's ICxBUF is not a memory location).  The interrupts always pass a constant
+//module number, so the switch is removed by the compiler and only the read of the
+//right ICxBUF is left.
+static inline __attribute__((always_inline)) unsigned int IC_Read_Buffer(unsigned int moduleNumber)
+{
+	switch (moduleNumber)
+	{
+		case 1: return IC1BUF;
+		case 2: return IC2BUF;
+		case 3: return IC3BUF;
+		case 4: return IC4BUF;
+		case 5: return IC5BUF;
+		default: return IC6BUF;
+	}
+}
+
+#ifdef IC_32_BIT_TIMESTAMPS
+//the upper 16 bits of timer3, counted up by _T3Interrupt every time it rolls over
+static volatile uint16_t IC_Timer3_Overflows;
 
-//This interrupt stores all 3 major values (current rising and falling times,
-//as well as the prior rising time) in one atomic operation (the same interrupt phase)
-//so that there is never a race condition.  
+//returns the current 32-bit time (timer3 and its overflow count)
+static inline __attribute__((always_inline)) uint32_t IC_Timer3_Now(void)
+{
+	uint16_t overflows;
+	uint16_t ticks;
+	int rolledOver;
 
-//right after fallingTime is collected, a function will be called to move all
-//of the data from the "buffering" variables into the 3 regular variables
+	//_T3Interrupt has a higher priority than the IC interrupts, so it can run in the
+	//middle of this, and then all three have to be read again
+	do
+	{
+		overflows = IC_Timer3_Overflows;
+		ticks = TMR3;
+		rolledOver = IFS0bits.T3IF;
+	} while (overflows != IC_Timer3_Overflows);
 
-//these regular variables are the ones that will be used by all of the IC functions
+	//timer3 has rolled over, but _T3Interrupt has not had the chance to count it yet
+	if (rolledOver && ticks < 0x8000)
+	{
+		++overflows;
+	}
 
-//in this way, all 3 variables are guaranteed to be taken from the same period
-//(even if it is delayed by a period), which will mitigate race conditions
-void __attribute__ ((__interrupt__, auto_psv)) _IC1Interrupt(void)
+	return ((uint32_t)overflows << 16) | ticks;
+}
+#endif
+
+//the shared clock the modules are timed by, from the first IC_Channel_Configure (every
+//module asks for the same rate, so they all get the same clock)
+static const Timebase* IC_Shared_Timebase;
+
+//the current time of the clock the PWM-type modules capture with
+static inline __attribute__((always_inline)) IC_Ticks IC_Capture_Clock_Now(void)
+{
+#ifdef IC_32_BIT_TIMESTAMPS
+	return IC_Timer3_Now();
+#else
+	return *IC_Shared_Timebase->counter;
+#endif
+}
+
+//turns a 16 bit capture time read from ICxBUF into an IC_Ticks time
+//with IC_32_BIT_TIMESTAMPS, the capture is placed just before the current time,
+//which is only right if it happened less than 65536 ticks ago
+static inline __attribute__((always_inline)) IC_Ticks IC_Read_Capture(unsigned int moduleNumber)
+{
+	unsigned int captureTime = IC_Read_Buffer(moduleNumber);
+
+#ifdef IC_32_BIT_TIMESTAMPS
+	uint32_t now = IC_Timer3_Now();
+
+	return now - (uint16_t)(now - captureTime);
+#else
+	return captureTime;
+#endif
+}
+
+//divides the sum of several periods by the number of periods
+static IC_Ticks Average_Ticks(uint32_t totalTicks, unsigned int count)
+{
+#ifdef IC_32_BIT_TIMESTAMPS
+	return totalTicks / count;
+#else
+	//the average of 16 bit periods always fits in 16 bits
+	return FixedPoint_Divide(totalTicks, count);
+#endif
+}
+
+//converts the length of a period (in ticks of a clock running at ticksPerSecond)
+//to a frequency rounded to the nearest Hz
+//returns 0 until a full period has been measured, and 65535 if the frequency is too
+//high to fit in 16 bits
+static uint16_t Calculate_Frequency(uint32_t ticksPerSecond, IC_Ticks periodTicks)
+{
+    uint32_t roundedTicksPerSecond = ticksPerSecond + periodTicks / 2;
+
+    if (periodTicks == 0)
+    {
+        return 0;
+    }
+    else if ((roundedTicksPerSecond >> 16) >= periodTicks)
+    {
+        return UINT16_MAX;
+    }
+#ifdef IC_32_BIT_TIMESTAMPS
+    else if (periodTicks > UINT16_MAX)
+    {
+        //too long for the 32 / 16 bit division (and always less than 65535Hz)
+        return roundedTicksPerSecond / periodTicks;
+    }
+#endif
+
+    return FixedPoint_Divide(roundedTicksPerSecond, periodTicks);
+}
+
+
+//replaces the ring's latest period (see IC_Ring in InputCapture.h)
+//the sequence is odd from the first change to the last, and the volatile writes are
+//never reordered by the compiler, so a reader can tell when it was interrupted
+static inline __attribute__((always_inline)) void IC_Ring_Publish_Latest(IC_Ring* ring, IC_Ticks risingTime, IC_Ticks fallingTime)
+{
+	++ring->latestSequence;
+
+	ring->latest.priorRisingTime = ring->latest.risingTime;
+	ring->latest.hasPriorRisingTime = ring->latestIsContinuous;
+	ring->latest.risingTime = risingTime;
+	ring->latest.fallingTime = fallingTime;
+
+	++ring->latestSequence;
+
+	ring->latestIsContinuous = true;
+}
+
+//stores one period's capture times in the ring, or counts it as lost if Update has
+//not made room for it yet (the oldest records are never overwritten, because Update
+//may be reading them right now)
+static inline __attribute__((always_inline)) void IC_Ring_Store(IC_Ring* ring, IC_Ticks risingTime, IC_Ticks fallingTime)
+{
+	unsigned int head = ring->head;
+
+	IC_Ring_Publish_Latest(ring, risingTime, fallingTime);
+
+	if ((unsigned int)(head - ring->tail) >= IC_RING_SIZE)
+	{
+		++ring->overruns;
+		++ring->periodsLost;
+		return;
+	}
+
+	ring->records[head & (IC_RING_SIZE - 1)].risingTime = risingTime;
+	ring->records[head & (IC_RING_SIZE - 1)].fallingTime = fallingTime;
+	ring->records[head & (IC_RING_SIZE - 1)].periodsLostBefore = ring->periodsLost;
+	ring->periodsLost = 0;
+
+	//head is only moved once the record is complete, so Update never sees half of one
+	ring->head = head + 1;
+}
+
+//Checks one period's pulse against the module's switch, and changes the switch once
+//debouncePeriods pulses in a row disagree with it.  Only integer comparisons are used, so
+//it adds a few instructions to the interrupt.
+static inline __attribute__((always_inline)) void IC_Switch_Check(IC_Switch_Buffer* pulseSwitch, IC_Ticks risingTime, IC_Ticks fallingTime)
+{
+	IC_Ticks pulseTicks = (IC_Ticks)(fallingTime - risingTime);
+	int pulseIsOn = pulseTicks >= pulseSwitch->onMinimumTicks && pulseTicks <= pulseSwitch->onMaximumTicks;
+
+	if (!pulseSwitch->enabled)
+	{
+		return;
+	}
+
+	if (pulseIsOn == pulseSwitch->isOn)
+	{
+		pulseSwitch->disagreeingPeriods = 0;
+	}
+	else if (++pulseSwitch->disagreeingPeriods >= pulseSwitch->debouncePeriods)
+	{
+		pulseSwitch->disagreeingPeriods = 0;
+		pulseSwitch->isOn = pulseIsOn;
+
+		if (pulseIsOn)
+		{
+			++pulseSwitch->timesSwitchedOn;
+			pulseSwitch->SwitchedOn();
+		}
+	}
+}
+
+//stores a period in the channel's ring, and checks it against the channel's switch (the
+//compiler leaves the check out of every interrupt without one)
+static inline __attribute__((always_inline)) void IC_Store_Period(const IC_Channel* channel, IC_Ticks risingTime, IC_Ticks fallingTime)
+{
+	IC_Ring_Store(channel->buffer, risingTime, fallingTime);
+
+	if (channel->pulseSwitch != NULL)
+	{
+		IC_Switch_Check(channel->pulseSwitch, risingTime, fallingTime);
+	}
+}
+
+//Reads every record the interrupt has stored since the last call, and adds up the
+//logic high time and the length of every complete period in them.
+//A period is measured from the previous record's rising time, so the first record
+//after a reset (or after periods were lost) only gives a starting point.
+//returns the number of periods that were added up
+static unsigned int IC_Ring_Drain(IC_Ring* ring, uint32_t* logicHighSum, uint32_t* periodSum)
+{
+	unsigned int tail = ring->tail;
+	unsigned int head = ring->head;
+	unsigned int periods = 0;
+
+	*logicHighSum = 0;
+	*periodSum = 0;
+
+	for (; tail != head; ++tail)
+	{
+		const volatile IC_Edge_Record* record = &ring->records[tail & (IC_RING_SIZE - 1)];
+		IC_Ticks risingTime = record->risingTime;
+
+		if (ring->hasLastRisingTime && record->periodsLostBefore == 0)
+		{
+			//kept to the size of IC_Ticks so that it still works when the timer rolls over
+			*logicHighSum += (IC_Ticks)(record->fallingTime - risingTime);
+			*periodSum += (IC_Ticks)(risingTime - ring->lastRisingTime);
+			++periods;
+		}
+
+		ring->lastRisingTime = risingTime;
+		ring->hasLastRisingTime = true;
+	}
+
+	//gives the records back to the interrupt only after they have been read
+	ring->tail = tail;
+
+	return periods;
+}
+
+//Copies the ring's latest period.  If the interrupt changed it during the copy, the
+//sequence will have changed (or been odd, if this somehow ran while the interrupt was
+//in the middle of it), and it is copied again.  The interrupt never waits for this,
+//and an interrupt can only make this take one more pass.
+//returns 0, or -1 if there has not been a period yet
+static int IC_Ring_Read_Latest(const IC_Ring* ring, IC_Latest_Period* period)
+{
+	unsigned int sequence;
+
+	do
+	{
+		sequence = ring->latestSequence;
+
+		period->risingTime = ring->latest.risingTime;
+		period->fallingTime = ring->latest.fallingTime;
+		period->priorRisingTime = ring->latest.priorRisingTime;
+		period->hasPriorRisingTime = ring->latest.hasPriorRisingTime;
+	} while ((sequence & 1) || sequence != ring->latestSequence);
+
+	period->periodNumber = sequence >> 1;
+
+	return (sequence == 0) ? -1 : 0;
+}
+
+//Decides whether a module's input signal is still there, after Update has drained its
+//ring (periods is what IC_Ring_Drain returned).  The signal is lost once timeoutTicks
+//have passed since the falling edge of the last period.  The age is kept to the size
+//of IC_Ticks, so it goes back to 0 if the signal stays lost for a whole rollover of the
+//capture clock, which is why only a new period can make a lost signal valid again.
+static void IC_Ring_Check_Signal(const IC_Ring* ring, unsigned int periods, IC_Ticks timeoutTicks, IC_Ticks* lastEdgeTime, int* signalValid)
+{
+	IC_Latest_Period latest;
+	IC_Ticks age;
+
+	if (IC_Ring_Read_Latest(ring, &latest) != 0)
+	{
+		*signalValid = false;
+		return;
+	}
+
+	*lastEdgeTime = latest.fallingTime;
+
+	if (timeoutTicks == 0)
+	{
+		*signalValid = true;
+		return;
+	}
+
+	//the clock is read after the last period, so the age can never be negative
+	age = IC_Capture_Clock_Now() - latest.fallingTime;
+
+	*signalValid = (periods > 0 || *signalValid) && age <= timeoutTicks;
+}
+
+static void IC_Ring_Reset(IC_Ring* ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->overruns = 0;
+	ring->periodsLost = 0;
+	ring->hasLastRisingTime = false;
+	ring->hasPendingRisingTime = false;
+	ring->latestSequence = 0;
+	ring->latestIsContinuous = false;
+}
+
+//For modules that capture every edge, the only way to tell a rising capture from a
+//falling one is to count them, so the count has to start from the pin's level:
+//if the pin is low, the next edge will be a rising edge.
+//This is done when the module is started, and again if the FIFO ever overflows
+//(a capture was lost, so the count is no longer right)
+static void IC_Ring_Synchronize(const IC_Channel* channel)
+{
+	IC_Ring* ring = channel->buffer;
+
+	ring->nextCaptureIsRising = ((PORTB >> channel->remappablePin) & 1) == 0;
+	ring->hasPendingRisingTime = false;
+	ring->latestIsContinuous = false;
+}
+
+
+//The rising and falling times of a period are both read out of the IC module's
+//4 value FIFO on the falling edge, so they are always from the same period, and
+//they are stored together as one record in the channel's ring.  Update reads every
+//record that has been stored since it was last called, so no period is lost unless
+//the ring fills up (and then it is counted in overruns).
+
+//This is the code for every PWM-type module's interrupt when it captures one edge at
+//a time.  It is always inlined, and
+//because each interrupt passes its own constant entry of IC_Channels, the compiler
+//turns every table lookup into a direct access of that module's registers.
+static inline __attribute__((always_inline)) void IC_Handle_Edge(const IC_Channel* channel)
 {
     //On a rising edge, the buffer is not read from (but the data is still kept in
 	//the buffer for later).  The only change is that it changes to falling-edge-trigger mode
-    if (IC1CON1bits.ICM == RISING_EDGE_TRIGGER_SETTING)
+    if (channel->control1->ICM == RISING_EDGE_TRIGGER_SETTING)
     {
-        IC1CON1bits.ICM = FALLING_EDGE_TRIGGER_SETTING;
+        channel->control1->ICM = FALLING_EDGE_TRIGGER_SETTING;
     }
-    else if (IC1CON1bits.ICM == FALLING_EDGE_TRIGGER_SETTING)
+    else if (channel->control1->ICM == FALLING_EDGE_TRIGGER_SETTING)
     {
 		//because each input compare module has a built-in 4 value FIFO buffer,
 		//the risingTime persists in the buffer even after the rising edge was triggered
-		//we now pull this value out and put it in risingTime, and store the previous
-		//risingTime value to estimate the input signal's frequency
-		IC1_Buffer.priorRisingTime = IC1_Buffer.risingTime;
-        IC1_Buffer.risingTime = IC1BUF;
-		
-		//the falling edge is the other piece of the puzzle that allows
-		//the frequency and period to be measured
+		//we now pull this value out first
+        IC_Ticks risingTime = IC_Read_Capture(channel->moduleNumber);
+
 		//fallingTime - risingTime = number of clock cycles the pwm is "on"
-		//("on" time) / (period time) = duty cycle %
 		//because this was the last value stored in the buffer, it must be the last value
 		//to be retrieved from the buffer
-        IC1_Buffer.fallingTime = IC1BUF;
-        
-        IC1CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
+        IC_Ticks fallingTime = IC_Read_Capture(channel->moduleNumber);
+
+        IC_Store_Period(channel, risingTime, fallingTime);
+
+        channel->control1->ICM = RISING_EDGE_TRIGGER_SETTING;
     }
-    
-    IFS0bits.IC1IF = 0;
+
+    *channel->interruptFlag &= ~channel->interruptMask;
 }
 
-void IC1_Initialize(IC_Module* IC1_Module)
-{   
-    //disables the IC1 module while it is configured
-    IC1CON1 = 0x0000;
-    
-    IC1_Module->dutyCyclePercentage = 0;
-    IC1_Module->frequency = 0;
-    
-    //configures pin B4/RP4 as an input (unnecessary in this case, as RPI4
-    //is only ever an input pin anyway)
-	TRISBbits.TRISB4 = 1;
+//This is the code for every PWM-type module's interrupt when it captures every edge
+//(capturesPerInterrupt of 2 or 4).  There is no capture mode to switch, every capture
+//in the FIFO is read out in one pass, and each rising time is paired with the falling
+//time after it.
+static inline __attribute__((always_inline)) void IC_Handle_Edge_Batch(const IC_Channel* channel)
+{
+	IC_Ring* ring = channel->buffer;
+
+	//if the FIFO overflowed, a capture was lost and there is no way to tell which
+	//edge it was, so everything in the FIFO is thrown out and the count starts over
+	if (channel->control1->ICOV)
+	{
+		while (channel->control1->ICBNE)
+		{
+			(void)IC_Read_Buffer(channel->moduleNumber);
+		}
+
+		++ring->overruns;
+		++ring->periodsLost;
+		IC_Ring_Synchronize(channel);
+	}
+
+	while (channel->control1->ICBNE)
+	{
+		IC_Ticks captureTime = IC_Read_Capture(channel->moduleNumber);
+
+		if (ring->nextCaptureIsRising)
+		{
+			ring->pendingRisingTime = captureTime;
+			ring->hasPendingRisingTime = true;
+		}
+		//(the first falling edge after the module starts has no rising edge to go with it)
+		else if (ring->hasPendingRisingTime)
+		{
+			IC_Store_Period(channel, ring->pendingRisingTime, captureTime);
+			ring->hasPendingRisingTime = false;
+		}
+
+		ring->nextCaptureIsRising = !ring->nextCaptureIsRising;
+	}
+
+	*channel->interruptFlag &= ~channel->interruptMask;
+}
+
+//copies the frame the PPM module just finished to the published one, under the sequence
+//(see IC_PPM_Update)
+static inline __attribute__((always_inline)) void IC_PPM_Publish(IC_PPM_Buffer* buffer, unsigned int numberOfChannels)
+{
+	unsigned int i;
+
+	++buffer->sequence;
+
+	for (i = 0; i < numberOfChannels; ++i)
+	{
+		buffer->channelTicks[i] = buffer->pendingTicks[i];
+	}
+	buffer->numberOfChannels = numberOfChannels;
+	buffer->frameEndTime = buffer->lastEdgeTime;
+
+	++buffer->sequence;
+}
+
+//This is the code for the IC_PPM_MODULE's interrupt.  Every rising edge in the FIFO is one
+//channel's end and the next one's start, so each is measured from the edge before it.  A
+//length longer than the sync gap ends the frame, which is published if it is whole, and a
+//length that cannot be a channel throws the frame out until the next sync gap.
+static inline __attribute__((always_inline)) void IC_Handle_PPM(const IC_Channel* channel)
+{
+	IC_PPM_Buffer* buffer = &IC_PPM_State;
+
+	//a lost capture is a lost channel, so everything waits for the next sync gap
+	if (channel->control1->ICOV || buffer->restart)
+	{
+		if (channel->control1->ICOV)
+		{
+			while (channel->control1->ICBNE)
+			{
+				(void)IC_Read_Buffer(channel->moduleNumber);
+			}
+			++buffer->overruns;
+		}
+
+		buffer->restart = false;
+		buffer->pendingChannels = PPM_NOT_SYNCHRONIZED;
+		buffer->hasLastEdgeTime = false;
+	}
+
+	while (channel->control1->ICBNE)
+	{
+		IC_Ticks edgeTime = IC_Read_Capture(channel->moduleNumber);
+		//kept to the size of IC_Ticks so that it still works when the timer rolls over
+		IC_Ticks length = edgeTime - buffer->lastEdgeTime;
+		unsigned int pending = buffer->pendingChannels;
+
+		if (!buffer->hasLastEdgeTime)
+		{
+			//the first edge only gives a starting point
+		}
+		else if (length > IC_MICROSECONDS_TO_TICKS(IC_PPM_SYNC_MICROSECONDS))
+		{
+			if (pending != PPM_NOT_SYNCHRONIZED)
+			{
+				if (pending >= IC_PPM_MINIMUM_CHANNELS && (pending == buffer->numberOfChannels || pending == buffer->previousChannels))
+				{
+					IC_PPM_Publish(buffer, pending);
+				}
+				else if (buffer->previousChannels != 0)
+				{
+					++buffer->badFrames;
+				}
+				//(the first whole frame only gives the number of channels)
+				buffer->previousChannels = pending;
+			}
+			buffer->pendingChannels = 0;
+		}
+		else if (pending != PPM_NOT_SYNCHRONIZED)
+		{
+			if (pending < IC_PPM_MAX_CHANNELS && length >= IC_MICROSECONDS_TO_TICKS(IC_PPM_MINIMUM_CHANNEL_MICROSECONDS) && length <= IC_MICROSECONDS_TO_TICKS(IC_PPM_MAXIMUM_CHANNEL_MICROSECONDS))
+			{
+				buffer->pendingTicks[pending] = length;
+				buffer->pendingChannels = pending + 1;
+			}
+			else
+			{
+				++buffer->badFrames;
+				buffer->pendingChannels = PPM_NOT_SYNCHRONIZED;
+			}
+		}
+
+		buffer->lastEdgeTime = edgeTime;
+		buffer->hasLastEdgeTime = true;
+	}
+
+	*channel->interruptFlag &= ~channel->interruptMask;
+}
+
+//the interrupt for every PWM-type module, the choice between them is made by the
+//compiler since every interrupt passes a constant entry of IC_Channels
+static inline __attribute__((always_inline)) void IC_Handle_Period(const IC_Channel* channel)
+{
+	if (IC_PPM_MODULE != 0 && channel->moduleNumber == IC_PPM_MODULE)
+	{
+		IC_Handle_PPM(channel);
+	}
+	else if (channel->capturesPerInterrupt > 1 || ALWAYS_CAPTURE_EVERY_EDGE)
+	{
+		IC_Handle_Edge_Batch(channel);
+	}
+	else
+	{
+		IC_Handle_Edge(channel);
+	}
+}
+
+//this interrupt will be different because it is tied to monitoring
+//the number of pulses sent to the stepper motor
+//it triggers only on falling edges, counts the number of pulses,
+//and prevents further motion by setting a flag to notify
+//the main process if the stepper is too far to the left or right
+//This flag is updated automatically and usable any time
+static inline __attribute__((always_inline)) void IC_Handle_Count(const IC_Channel* channel)
+{
+	Count_Monitor_Buffer* buffer = channel->buffer;
+
+	//odd until the count and stopCountReached are both up to date (see IC4_Update)
+	++buffer->sequence;
+
+	//every capture in the FIFO is one pulse, and they all have to be read out, otherwise
+	//the FIFO fills up after 4 pulses and the module stops capturing
+	while (channel->control1->ICBNE)
+	{
+		(void)IC_Read_Buffer(channel->moduleNumber);
+
+	    if (LATAbits.LATA2 == 0)
+	    {
+	        if (buffer->numberOfCounts > ABSOLUTE_MIN_COUNTS)
+	        {
+	            --buffer->numberOfCounts;
+	        }
+	    }
+	    else if (buffer->numberOfCounts < ABSOLUTE_MAX_COUNTS)
+	    {
+	        ++buffer->numberOfCounts;
+	    }
+
+		//stops the motor on the exact pulse that reaches the stop count
+		if (buffer->stopCountEnabled && buffer->numberOfCounts == buffer->stopCount)
+		{
+			buffer->stopCountEnabled = false;
+			buffer->stopCountReached = true;
+			buffer->Stop();
+		}
+	}
+
+	++buffer->sequence;
+
+    *channel->interruptFlag &= ~channel->interruptMask;
+}
+
+#ifdef IC_32_BIT_TIMESTAMPS
+//timer3 is only set up once, since restarting it would lose the time (and the other
+//modules' captures would no longer line up with it)
+static const Timebase* IC_Timer3_Initialize(void)
+{
+    if (!T3CONbits.TON)
+    {
+        IC_Timer3_Overflows = 0;
+
+        //a higher priority (2) than the IC interrupts, so that an overflow is counted
+        //even while an IC interrupt is running
+        IPC2bits.T3IP = 2;
+        IFS0bits.T3IF = 0;
+        IEC0bits.T3IE = 1;
+    }
+
+    //no prescaler, so the timer counts at Fcy, and it rolls over at 0xFFFF
+    return Timebase_Request_Dedicated(TIMESTAMP_TIMER, FCY_TICKS_PER_SECOND, 65536);
+}
+
+void __attribute__ ((__interrupt__, auto_psv)) _T3Interrupt(void)
+{
+    ++IC_Timer3_Overflows;
+
+    IFS0bits.T3IF = 0;
+}
+#endif
+
+static void IC_Channel_Configure(const IC_Channel* channel, unsigned int captureMode, unsigned int capturesPerInterrupt)
+{
+    const Timebase* timebase;
+
+    //disables the IC module while it is configured
+    *(volatile uint16_t*)channel->control1 = 0x0000;
+
+    //configures the pin as an input
+	TRISB |= 1 << channel->remappablePin;
 	Nop();
-    
-    //See page 174 in the PIC24FJ128GA204 family documentation to find the list
-    //of all values that can be mapped to the remappable pins
-    //RPINR7 is the register that maps IC1 module functionality to a particular
-    //remappable pin, and 4 is RPI4's remappable pin number
-    RPINR7bits.IC1R = 0b100;
-    
+
+    //maps the IC module's input to its remappable pin
+    *channel->pinSelect = (*channel->pinSelect & ~(0x3F << channel->pinSelectShift)) | (channel->remappablePin << channel->pinSelectShift);
+
     //clears the IC module's buffer of any previous data
     //ICxBUF contains the value of its associated timer at the point when the
     //input capture event occurred
-    while (IC1CON1bits.ICBNE)
+    while (channel->control1->ICBNE)
+    {
+        (void)IC_Read_Buffer(channel->moduleNumber);
+    }
+
+#ifdef IC_32_BIT_TIMESTAMPS
+    if (channel->timer == TIMESTAMP_TIMER)
+    {
+        timebase = IC_Timer3_Initialize();
+
+        //the captures have to match TMR3 for IC_Timer3_Now to extend them
+        channel->control2->SYNCSEL = TIMER3_SYNC_SETTING;
+    }
+    else
+#endif
     {
-        int junk = IC1BUF;
+        //the timer is only started by the first module that asks for this rate, so the
+        //other modules (and the PWM dependency) keep counting without a jump
+        timebase = Timebase_Request(channel->ticksPerSecond);
+        IC_Shared_Timebase = timebase;
+
+        //desyncs the IC module from any other module as we do not want it to
+        //operate in tandem with any other module
+        channel->control2->SYNCSEL = 0b00000;
     }
-    
-    //turns timer1 off to configure it
-    T1CON = 0b0000000000000000;
-    //sets a 1:64 input clock prescaler, which increments the timer every
-    //8th clock cycle (from Fcy by default)
-    T1CONbits.TCKPS = 0b10;
-    //sets this timer's clock source to Fcy
-    T1CONbits.TCS = 0b0;
-    //turns timer1 back on after it is configured
-    T1CONbits.TON = 1;
-    
-    //desyncs the IC module from any other module as we do not want it to
-    //operate in tandem with any other module
-    IC1CON2bits.SYNCSEL = 0b00000;
-    
-    //the module uses timer1 (prescaler 1:8 based on Fcy) as its timing source
-    IC1CON1bits.ICTSEL = 0b100;
-    
-    //sets the IC module to generate an interrupt on every capture event
-    IC1CON1bits.ICI = 0b00;
-    
-    //configures the IC module to capture events on each rising edge
-    //this is the IC module's initial configuration, which will not always be
-    //the case
-    IC1CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-    
-    //sets the IC1 module interrupt to a priority of 1 (lowest)
-	//see page 89 in the PIC24FJ128GA202 documentation for the list of interrupt
-	//vector registers
-    IPC0bits.IC1IP = 1;
-    
+
+    channel->control1->ICTSEL = timebase->inputCaptureClockSetting;
+
+    //sets how many capture events there are per interrupt (0b00 is every capture,
+    //0b01 every 2nd, up to 0b11 every 4th)
+    channel->control1->ICI = capturesPerInterrupt - 1;
+
+    if (captureMode == EVERY_EDGE_TRIGGER_SETTING)
+    {
+        IC_Ring_Synchronize(channel);
+    }
+
+    channel->control1->ICM = captureMode;
+
+    //sets the interrupt to a priority of 1 (lowest)
+    *channel->interruptPriority = (*channel->interruptPriority & ~(0b111 << channel->interruptPriorityShift)) | (1 << channel->interruptPriorityShift);
+
     //turns the flag off that is used to notify the PIC that the interrupt
     //has occurred and the interrupt service routine needs to be called
-    IFS0bits.IC1IF = false;
-    
+    *channel->interruptFlag &= ~channel->interruptMask;
+
     //enables the interrupt
-    IEC0bits.IC1IE = true;
+    *channel->interruptEnable |= channel->interruptMask;
 }
 
-void IC1_Update(IC_Module* IC1_Module)
+//resets the channel's ring and starts capturing the PWM-type signal
+static void IC_Channel_Start(const IC_Channel* channel)
 {
-	//these are the basic properties of a standard PWM square wave signal
-	int logicHighClockCycles = IC1_Buffer.fallingTime - IC1_Buffer.risingTime;
-	int fullPeriodClockCycles = IC1_Buffer.risingTime - IC1_Buffer.priorRisingTime;
-	
+    IC_Ring_Reset(channel->buffer);
+
+    if (channel->capturesPerInterrupt > 1 || ALWAYS_CAPTURE_EVERY_EDGE)
+    {
+        IC_Channel_Configure(channel, EVERY_EDGE_TRIGGER_SETTING, channel->capturesPerInterrupt);
+    }
+    else
+    {
+        //starts out capturing rising edges
+        IC_Channel_Configure(channel, RISING_EDGE_TRIGGER_SETTING, channel->capturesPerInterrupt);
+    }
+}
+
+static void IC_Channel_Initialize(const IC_Channel* channel, IC_Module* module)
+{
+    module->dutyCyclePercentage = 0;
+    module->frequency = 0;
+    module->periodsMeasured = 0;
+    module->overruns = 0;
+    module->signalTimeoutTicks = 0;
+    module->lastEdgeTime = 0;
+    module->signalValid = false;
+
+    IC_Channel_Start(channel);
+}
+
+static void IC_Channel_Update(const IC_Channel* channel, IC_Module* module)
+{
+	IC_Ring* ring = channel->buffer;
+
+	//these are the basic properties of a standard PWM square wave signal,
+	//added up over every period since the last Update
+	uint32_t logicHighClockCycles;
+	uint32_t fullPeriodClockCycles;
+	unsigned int periods = IC_Ring_Drain(ring, &logicHighClockCycles, &fullPeriodClockCycles);
+
+	module->periodsMeasured = periods;
+	module->overruns = ring->overruns;
+
+	IC_Ring_Check_Signal(ring, periods, module->signalTimeoutTicks, &module->lastEdgeTime, &module->signalValid);
+
+	//keeps the last values if there was not a new period to measure
+	if (periods == 0)
+	{
+		return;
+	}
+
     //multiplied by 100, so 10.5 represents 10.5%
-	IC1_Module->dutyCyclePercentage = (double) logicHighClockCycles / fullPeriodClockCycles * 100;
-	
-	double secondsPerPeriod = (double) fullPeriodClockCycles / TIMER_FREQUENCY;
-	
-	IC1_Module->frequency = (double) 1.0 / secondsPerPeriod;
+	module->dutyCyclePercentage = (double) logicHighClockCycles / fullPeriodClockCycles * 100;
+
+	//1 / (seconds per period)
+	module->frequency = (double) channel->ticksPerSecond * periods / fullPeriodClockCycles;
+}
+
+static void IC_Channel_Fixed_Initialize(const IC_Channel* channel, IC_Fixed_Module* module)
+{
+    module->dutyCycle = 0;
+    module->periodTicks = 0;
+    module->frequency = 0;
+    module->periodsMeasured = 0;
+    module->overruns = 0;
+    module->signalTimeoutTicks = 0;
+    module->lastEdgeTime = 0;
+    module->signalValid = false;
+
+    IC_Channel_Start(channel);
+}
+
+static void IC_Channel_Fixed_Update(const IC_Channel* channel, IC_Fixed_Module* module)
+{
+	IC_Ring* ring = channel->buffer;
+
+	//the same measurements IC_Channel_Update uses
+	uint32_t logicHighClockCycles;
+	uint32_t fullPeriodClockCycles;
+	unsigned int periods = IC_Ring_Drain(ring, &logicHighClockCycles, &fullPeriodClockCycles);
+
+	module->periodsMeasured = periods;
+	module->overruns = ring->overruns;
+
+	IC_Ring_Check_Signal(ring, periods, module->signalTimeoutTicks, &module->lastEdgeTime, &module->signalValid);
+
+	if (periods == 0)
+	{
+		return;
+	}
+
+	module->periodTicks = Average_Ticks(fullPeriodClockCycles, periods);
+
+	//Q15_Ratio takes 16 bit values, so both sums are scaled down together until they fit
+	//(this only happens when more than one period was added up, and loses very little)
+	while (fullPeriodClockCycles > UINT16_MAX)
+	{
+		logicHighClockCycles >>= 1;
+		fullPeriodClockCycles >>= 1;
+	}
+
+	//(logic high time) / (period time) as a Q15 fraction, only integer division is used
+	module->dutyCycle = Q15_Ratio(logicHighClockCycles, fullPeriodClockCycles);
+	module->frequency = Calculate_Frequency(channel->ticksPerSecond, module->periodTicks);
+}
+
+
+
+//The interrupts must be named ICxInterrupt so that they can be
+//recognized as the interrupt for IC module #x
+void __attribute__ ((__interrupt__, auto_psv)) _IC1Interrupt(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_IC1_INTERRUPT);
+    IC_Handle_Period(&IC_Channels[IC1_CHANNEL]);
+    PROFILER_END(PROFILER_SITE_IC1_INTERRUPT);
+}
+
+void IC1_Initialize(IC_Module* IC1_Module)
+{
+    IC_Channel_Initialize(&IC_Channels[IC1_CHANNEL], IC1_Module);
+}
+
+void IC1_Update(IC_Module* IC1_Module)
+{
+    IC_Channel_Update(&IC_Channels[IC1_CHANNEL], IC1_Module);
+}
+
+void IC1_Fixed_Initialize(IC_Fixed_Module* IC1_Module)
+{
+    IC_Channel_Fixed_Initialize(&IC_Channels[IC1_CHANNEL], IC1_Module);
+}
+
+void IC1_Fixed_Update(IC_Fixed_Module* IC1_Module)
+{
+    IC_Channel_Fixed_Update(&IC_Channels[IC1_CHANNEL], IC1_Module);
+}
+
+int IC1_Read_Latest_Period(IC_Latest_Period* period)
+{
+    return IC_Ring_Read_Latest(&IC1_Ring, period);
+}
+
+void IC1_Set_Switch(IC_Ticks onMinimumTicks, IC_Ticks onMaximumTicks, unsigned int debouncePeriods, void (*SwitchedOn)(void))
+{
+    //the interrupt must not check a pulse against half of the new switch
+    IC1_Switch.enabled = false;
+    IC1_Switch.onMinimumTicks = onMinimumTicks;
+    IC1_Switch.onMaximumTicks = onMaximumTicks;
+    IC1_Switch.debouncePeriods = debouncePeriods;
+    IC1_Switch.SwitchedOn = SwitchedOn;
+    IC1_Switch.isOn = false;
+    IC1_Switch.disagreeingPeriods = 0;
+    IC1_Switch.timesSwitchedOn = 0;
+    IC1_Switch.enabled = true;
+}
+
+int IC1_Switch_Is_On(void)
+{
+    return IC1_Switch.isOn;
 }
 
 
 
 void __attribute__ ((__interrupt__, auto_psv)) _IC2Interrupt(void)
 {
-    if (IC2CON1bits.ICM == RISING_EDGE_TRIGGER_SETTING)
-    {
-        IC2CON1bits.ICM = FALLING_EDGE_TRIGGER_SETTING;
-    }
-    else if (IC2CON1bits.ICM == FALLING_EDGE_TRIGGER_SETTING)
-    {
-		IC2_Buffer.priorRisingTime = IC2_Buffer.risingTime;
-        IC2_Buffer.risingTime = IC2BUF;
-        IC2_Buffer.fallingTime = IC2BUF;
-        
-        IC2CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-    }
-    
-    IFS0bits.IC2IF = 0;
+    PROFILER_BEGIN(PROFILER_SITE_IC2_INTERRUPT);
+    IC_Handle_Period(&IC_Channels[IC2_CHANNEL]);
+    PROFILER_END(PROFILER_SITE_IC2_INTERRUPT);
 }
 
 void IC2_Initialize(IC_Module* IC2_Module)
 {
-    IC2CON1 = 0x0000;
-    
-    IC2_Module->dutyCyclePercentage = 0;
-    IC2_Module->frequency = 0;
-    
-	TRISBbits.TRISB5 = 1;
-	Nop();
-    
-	//the 5 represents RP5
-    RPINR7bits.IC2R = 0b101;
-    
-    while (IC2CON1bits.ICBNE)
-    {
-        int junk = IC2BUF;
-    }
-    
-    T1CON = 0b0000000000000000;
-    T1CONbits.TCKPS = 0b10;
-    T1CONbits.TCS = 0b0;
-    T1CONbits.TON = 1;
-    
-    IC2CON2bits.SYNCSEL = 0b00000;
-    IC2CON1bits.ICTSEL = 0b100;
-    IC2CON1bits.ICI = 0b00;
-    IC2CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-	
-    IPC1bits.IC2IP = 1;
-    IFS0bits.IC2IF = false;
-    IEC0bits.IC2IE = true;
+    IC_Channel_Initialize(&IC_Channels[IC2_CHANNEL], IC2_Module);
 }
 
 void IC2_Update(IC_Module* IC2_Module)
 {
-	int logicHighClockCycles = IC2_Buffer.fallingTime - IC2_Buffer.risingTime;
-	int fullPeriodClockCycles = IC2_Buffer.risingTime - IC2_Buffer.priorRisingTime;
-	
-	IC2_Module->dutyCyclePercentage = ((double) logicHighClockCycles / fullPeriodClockCycles) * 100;
-	
-	double secondsPerPeriod = (double) fullPeriodClockCycles / TIMER_FREQUENCY;
-	
-	IC2_Module->frequency = (double) 1.0 / secondsPerPeriod;
+    IC_Channel_Update(&IC_Channels[IC2_CHANNEL], IC2_Module);
+}
+
+void IC2_Fixed_Initialize(IC_Fixed_Module* IC2_Module)
+{
+    IC_Channel_Fixed_Initialize(&IC_Channels[IC2_CHANNEL], IC2_Module);
+}
+
+void IC2_Fixed_Update(IC_Fixed_Module* IC2_Module)
+{
+    IC_Channel_Fixed_Update(&IC_Channels[IC2_CHANNEL], IC2_Module);
+}
+
+int IC2_Read_Latest_Period(IC_Latest_Period* period)
+{
+    return IC_Ring_Read_Latest(&IC2_Ring, period);
 }
 
 
 
 void __attribute__ ((__interrupt__, auto_psv)) _IC3Interrupt(void)
 {
-    if (IC3CON1bits.ICM == RISING_EDGE_TRIGGER_SETTING)
-    {
-        IC3CON1bits.ICM = FALLING_EDGE_TRIGGER_SETTING;
-    }
-    else if (IC3CON1bits.ICM == FALLING_EDGE_TRIGGER_SETTING)
-    {
-		IC3_Buffer.priorRisingTime = IC3_Buffer.risingTime;
-        IC3_Buffer.risingTime = IC3BUF;
-        IC3_Buffer.fallingTime = IC3BUF;
-        
-        IC3CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-    }
-    
-    IFS2bits.IC3IF = 0;
+    PROFILER_BEGIN(PROFILER_SITE_IC3_INTERRUPT);
+    IC_Handle_Period(&IC_Channels[IC3_CHANNEL]);
+    PROFILER_END(PROFILER_SITE_IC3_INTERRUPT);
 }
 
 void IC3_Initialize(IC_Module* IC3_Module)
 {
-    IC3CON1 = 0x0000;
-    
-    IC3_Module->dutyCyclePercentage = 0;
-    IC3_Module->frequency = 0;
-    
-	TRISBbits.TRISB6 = 1;
-	Nop();
-    
-	//the 6 represents RP6
-    RPINR8bits.IC3R = 0b110;
-    
-    while (IC3CON1bits.ICBNE)
-    {
-        int junk = IC3BUF;
-    }
-    
-    T1CON = 0b0000000000000000;
-    T1CONbits.TCKPS = 0b10;
-    T1CONbits.TCS = 0b0;
-    T1CONbits.TON = 1;
-    
-    IC3CON2bits.SYNCSEL = 0b00000;
-    IC3CON1bits.ICTSEL = 0b100;
-    IC3CON1bits.ICI = 0b00;
-    IC3CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-	
-    IPC9bits.IC3IP = 1;
-    IFS2bits.IC3IF = false;
-    IEC2bits.IC3IE = true;
+    IC_Channel_Initialize(&IC_Channels[IC3_CHANNEL], IC3_Module);
 }
 
 void IC3_Update(IC_Module* IC3_Module)
 {
-	int logicHighClockCycles = IC3_Buffer.fallingTime - IC3_Buffer.risingTime;
-	int fullPeriodClockCycles = IC3_Buffer.risingTime - IC3_Buffer.priorRisingTime;
-	
-	IC3_Module->dutyCyclePercentage = ((double) logicHighClockCycles / fullPeriodClockCycles) * 100;
-	
-	double secondsPerPeriod = (double) fullPeriodClockCycles / TIMER_FREQUENCY;
-	
-	IC3_Module->frequency = (double) 1.0 / secondsPerPeriod;
+    IC_Channel_Update(&IC_Channels[IC3_CHANNEL], IC3_Module);
 }
 
+void IC3_Fixed_Initialize(IC_Fixed_Module* IC3_Module)
+{
+    IC_Channel_Fixed_Initialize(&IC_Channels[IC3_CHANNEL], IC3_Module);
+}
+
+void IC3_Fixed_Update(IC_Fixed_Module* IC3_Module)
+{
+    IC_Channel_Fixed_Update(&IC_Channels[IC3_CHANNEL], IC3_Module);
+}
+
+int IC3_Read_Latest_Period(IC_Latest_Period* period)
+{
+    return IC_Ring_Read_Latest(&IC3_Ring, period);
+}
+
+
 
-//this interrupt will be different because it is tied to monitoring
-//the number of pulses sent to the stepper motor
-//it triggers only on rising edges, counts the number of pulses,
-//and prevents further motion by setting a flag to notify
-//the main process if the stepper is too far to the left or right
-//This flag is updated automatically and usable any time
 void __attribute__ ((__interrupt__, auto_psv)) _IC4Interrupt(void)
 {
-    if (LATAbits.LATA2 == 0)
-    {
-        if (IC4_Buffer.numberOfCounts > ABSOLUTE_MIN_COUNTS)
-        {
-            --IC4_Buffer.numberOfCounts;
-        }
-    }
-    else if (IC4_Buffer.numberOfCounts < ABSOLUTE_MAX_COUNTS)
-    {
-        ++IC4_Buffer.numberOfCounts;
-    }
-    
-    IFS2bits.IC4IF = 0;
+    PROFILER_BEGIN(PROFILER_SITE_IC4_INTERRUPT);
+    IC_Handle_Count(&IC_Channels[IC4_CHANNEL]);
+    PROFILER_END(PROFILER_SITE_IC4_INTERRUPT);
 }
 
 void IC4_Initialize(Count_Monitor* IC4_Module)
 {
-    IC4CON1 = 0x0000;
-    
     IC4_Buffer.numberOfCounts = 0;
-    
+    IC4_Buffer.stopCountEnabled = false;
+    IC4_Buffer.stopCountReached = false;
+    IC4_Buffer.sequence = 0;
+
     IC4_Module->numberOfCounts = 0;
     IC4_Module->desiredPosition = 0;
     IC4_Module->allowClockwiseMotion = 1;
     IC4_Module->allowCounterClockwiseMotion = 1;
-    
-	TRISBbits.TRISB7 = 1;
-	Nop();
-    
-	//the 7 represents RP7
-    RPINR8bits.IC4R = 0b111;
-    
-    while (IC4CON1bits.ICBNE)
-    {
-        int junk = IC4BUF;
-    }
-    
-    T1CON = 0b0000000000000000;
-    T1CONbits.TCKPS = 0b10;
-    T1CONbits.TCS = 0b0;
-    T1CONbits.TON = 1;
-    
-    IC4CON2bits.SYNCSEL = 0b00000;
-    IC4CON1bits.ICTSEL = 0b100;
-    IC4CON1bits.ICI = 0b00;
-    IC4CON1bits.ICM = FALLING_EDGE_TRIGGER_SETTING;
-	
-    IPC9bits.IC4IP = 1;
-    IFS2bits.IC4IF = false;
-    IEC2bits.IC4IE = true;
+    IC4_Module->stopCountReached = false;
+
+    //counts every falling edge of the stepper motor's step signal
+    IC_Channel_Configure(&IC_Channels[IC4_CHANNEL], FALLING_EDGE_TRIGGER_SETTING, 1);
 }
 
 void IC4_Update(Count_Monitor* IC4_Module)
 {
-	IC4_Module->numberOfCounts = IC4_Buffer.numberOfCounts;
-    
-    if (IC4_Buffer.numberOfCounts <= ABSOLUTE_MIN_COUNTS)
+	unsigned int sequence;
+
+	//copied again if the interrupt counted a pulse in between, so the count and
+	//stopCountReached are always from the same moment
+	do
+	{
+		sequence = IC4_Buffer.sequence;
+
+		IC4_Module->numberOfCounts = IC4_Buffer.numberOfCounts;
+		IC4_Module->stopCountReached = IC4_Buffer.stopCountReached;
+	} while ((sequence & 1) || sequence != IC4_Buffer.sequence);
+
+    if (IC4_Module->numberOfCounts <= ABSOLUTE_MIN_COUNTS)
     {
         IC4_Module->allowClockwiseMotion = 0;
         IC4_Module->allowCounterClockwiseMotion = 1;
     }
-    else if (IC4_Buffer.numberOfCounts >= ABSOLUTE_MAX_COUNTS)
+    else if (IC4_Module->numberOfCounts >= ABSOLUTE_MAX_COUNTS)
     {
         IC4_Module->allowClockwiseMotion = 1;
         IC4_Module->allowCounterClockwiseMotion = 0;
@@ -382,130 +1101,199 @@ void IC4_Update(Count_Monitor* IC4_Module)
 
 
 
+void IC4_Set_Stop_Count(int stopCount, void (*Stop)(void))
+{
+    //the interrupt must not see a new stop count with an old Stop function
+    IC4_Buffer.stopCountEnabled = false;
+    IC4_Buffer.stopCountReached = false;
+    IC4_Buffer.Stop = Stop;
+    IC4_Buffer.stopCount = stopCount;
+    IC4_Buffer.stopCountEnabled = true;
+}
+
+void IC4_Clear_Stop_Count(void)
+{
+    IC4_Buffer.stopCountEnabled = false;
+}
+
+
+
 void __attribute__ ((__interrupt__, auto_psv)) _IC5Interrupt(void)
 {
-    if (IC5CON1bits.ICM == RISING_EDGE_TRIGGER_SETTING)
-    {
-        IC5CON1bits.ICM = FALLING_EDGE_TRIGGER_SETTING;
-    }
-    else if (IC5CON1bits.ICM == FALLING_EDGE_TRIGGER_SETTING)
-    {
-		IC5_Buffer.priorRisingTime = IC5_Buffer.risingTime;
-        IC5_Buffer.risingTime = IC5BUF;
-        IC5_Buffer.fallingTime = IC5BUF;
-        
-        IC5CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-    }
-    
-    IFS2bits.IC5IF = 0;
+    PROFILER_BEGIN(PROFILER_SITE_IC5_INTERRUPT);
+    IC_Handle_Period(&IC_Channels[IC5_CHANNEL]);
+    PROFILER_END(PROFILER_SITE_IC5_INTERRUPT);
 }
 
 void IC5_Initialize(IC_Module* IC5_Module)
 {
-    IC5CON1 = 0x0000;
-    
-    IC5_Module->dutyCyclePercentage = 0;
-    IC5_Module->frequency = 0;
-    
-	TRISBbits.TRISB8 = 1;
-	Nop();
-    
-	//the 8 represents RP8
-    RPINR9bits.IC5R = 0b1000;
-    
-    while (IC5CON1bits.ICBNE)
-    {
-        int junk = IC5BUF;
-    }
-    
-    T1CON = 0b0000000000000000;
-    T1CONbits.TCKPS = 0b10;
-    T1CONbits.TCS = 0b0;
-    T1CONbits.TON = 1;
-    
-    IC5CON2bits.SYNCSEL = 0b00000;
-    IC5CON1bits.ICTSEL = 0b100;
-    IC5CON1bits.ICI = 0b00;
-    IC5CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-	
-    IPC9bits.IC5IP = 1;
-    IFS2bits.IC5IF = false;
-    IEC2bits.IC5IE = true;
+    IC_Channel_Initialize(&IC_Channels[IC5_CHANNEL], IC5_Module);
 }
 
 void IC5_Update(IC_Module* IC5_Module)
 {
-	int logicHighClockCycles = IC5_Buffer.fallingTime - IC5_Buffer.risingTime;
-	int fullPeriodClockCycles = IC5_Buffer.risingTime - IC5_Buffer.priorRisingTime;
-	
-	IC5_Module->dutyCyclePercentage = ((double) logicHighClockCycles / fullPeriodClockCycles) * 100;
-	
-	double secondsPerPeriod = (double) fullPeriodClockCycles / TIMER_FREQUENCY;
-	
-	IC5_Module->frequency = (double) 1.0 / secondsPerPeriod;
+    IC_Channel_Update(&IC_Channels[IC5_CHANNEL], IC5_Module);
+}
+
+void IC5_Fixed_Initialize(IC_Fixed_Module* IC5_Module)
+{
+    IC_Channel_Fixed_Initialize(&IC_Channels[IC5_CHANNEL], IC5_Module);
+}
+
+void IC5_Fixed_Update(IC_Fixed_Module* IC5_Module)
+{
+    IC_Channel_Fixed_Update(&IC_Channels[IC5_CHANNEL], IC5_Module);
+}
+
+int IC5_Read_Latest_Period(IC_Latest_Period* period)
+{
+    return IC_Ring_Read_Latest(&IC5_Ring, period);
 }
 
 
 
 void __attribute__ ((__interrupt__, auto_psv)) _IC6Interrupt(void)
 {
-    if (IC6CON1bits.ICM == RISING_EDGE_TRIGGER_SETTING)
-    {
-        IC6CON1bits.ICM = FALLING_EDGE_TRIGGER_SETTING;
-    }
-    else if (IC6CON1bits.ICM == FALLING_EDGE_TRIGGER_SETTING)
+    PROFILER_BEGIN(PROFILER_SITE_IC6_INTERRUPT);
+    IC_Handle_Period(&IC_Channels[IC6_CHANNEL]);
+    PROFILER_END(PROFILER_SITE_IC6_INTERRUPT);
+}
+
+void IC6_Initialize(IC_Module* IC6_Module)
+{
+    IC_Channel_Initialize(&IC_Channels[IC6_CHANNEL], IC6_Module);
+}
+
+void IC6_Update(IC_Module* IC6_Module)
+{
+    IC_Channel_Update(&IC_Channels[IC6_CHANNEL], IC6_Module);
+}
+
+void IC6_Fixed_Initialize(IC_Fixed_Module* IC6_Module)
+{
+    IC_Channel_Fixed_Initialize(&IC_Channels[IC6_CHANNEL], IC6_Module);
+}
+
+void IC6_Fixed_Update(IC_Fixed_Module* IC6_Module)
+{
+    IC_Channel_Fixed_Update(&IC_Channels[IC6_CHANNEL], IC6_Module);
+}
+
+int IC6_Read_Latest_Period(IC_Latest_Period* period)
+{
+    return IC_Ring_Read_Latest(&IC6_Ring, period);
+}
+
+
+
+#if IC_PPM_MODULE != 0
+void IC_PPM_Initialize(IC_PPM_Module* module)
+{
+    unsigned int i;
+
+    IC_PPM_State.sequence = 0;
+    IC_PPM_State.numberOfChannels = 0;
+    IC_PPM_State.badFrames = 0;
+    IC_PPM_State.overruns = 0;
+    IC_PPM_State.restart = false;
+    IC_PPM_State.pendingChannels = PPM_NOT_SYNCHRONIZED;
+    IC_PPM_State.previousChannels = 0;
+    IC_PPM_State.hasLastEdgeTime = false;
+
+    for (i = 0; i < IC_PPM_MAX_CHANNELS; ++i)
     {
-		IC6_Buffer.priorRisingTime = IC6_Buffer.risingTime;
-        IC6_Buffer.risingTime = IC6BUF;
-        IC6_Buffer.fallingTime = IC6BUF;
-        
-        IC6CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
+        module->channelTicks[i] = 0;
     }
-    
-    IFS2bits.IC6IF = 0;
+    module->numberOfChannels = 0;
+    module->framesMeasured = 0;
+    module->badFrames = 0;
+    module->overruns = 0;
+    module->signalTimeoutTicks = 0;
+    module->lastEdgeTime = 0;
+    module->signalValid = false;
+    module->lastSequence = 0;
+
+    //only rising edges, and the FIFO is read out PPM_CAPTURES_PER_INTERRUPT at a time
+    IC_Channel_Configure(&IC_Channels[IC_PPM_MODULE - 1], RISING_EDGE_TRIGGER_SETTING, PPM_CAPTURES_PER_INTERRUPT);
 }
 
-void IC6_Initialize(IC_Module* IC6_Module)
+void IC_PPM_Update(IC_PPM_Module* module)
 {
-    IC6CON1 = 0x0000;
-    
-    IC6_Module->dutyCyclePercentage = 0;
-    IC6_Module->frequency = 0;
-    
-	TRISBbits.TRISB11 = 1;
-	Nop();
-    
-	//the 11 represents RP11
-    RPINR9bits.IC6R = 0b1011;
-    
-    while (IC6CON1bits.ICBNE)
+    unsigned int sequence;
+    unsigned int i;
+    IC_Ticks frameEndTime;
+    int wasValid = module->signalValid;
+
+    //copied again if the interrupt published a frame in between, so every channel is
+    //always from the same frame (the same as IC_Ring_Read_Latest)
+    do
     {
-        int junk = IC6BUF;
+        sequence = IC_PPM_State.sequence;
+
+        for (i = 0; i < IC_PPM_MAX_CHANNELS; ++i)
+        {
+            module->channelTicks[i] = IC_PPM_State.channelTicks[i];
+        }
+        module->numberOfChannels = IC_PPM_State.numberOfChannels;
+        frameEndTime = IC_PPM_State.frameEndTime;
+    } while ((sequence & 1) || sequence != IC_PPM_State.sequence);
+
+    module->framesMeasured = (sequence - module->lastSequence) >> 1;
+    module->lastSequence = sequence;
+    module->badFrames = IC_PPM_State.badFrames;
+    module->overruns = IC_PPM_State.overruns;
+
+    if (sequence == 0)
+    {
+        module->signalValid = false;
+        return;
+    }
+
+    module->lastEdgeTime = frameEndTime;
+
+    if (module->signalTimeoutTicks == 0)
+    {
+        module->signalValid = true;
+        return;
+    }
+
+    //the same check as IC_Ring_Check_Signal
+    module->signalValid = (module->framesMeasured > 0 || module->signalValid) && (IC_Ticks)(IC_Capture_Clock_Now() - frameEndTime) <= module->signalTimeoutTicks;
+
+    //an edge after the signal comes back cannot be measured from one before it was lost
+    //(with 16 bit captures, the time in between may have rolled over)
+    if (wasValid && !module->signalValid)
+    {
+        IC_PPM_State.restart = true;
     }
-    
-    T1CON = 0b0000000000000000;
-    T1CONbits.TCKPS = 0b10;
-    T1CONbits.TCS = 0b0;
-    T1CONbits.TON = 1;
-    
-    IC6CON2bits.SYNCSEL = 0b00000;
-    IC6CON1bits.ICTSEL = 0b111;
-    IC6CON1bits.ICI = 0b00;
-    IC6CON1bits.ICM = RISING_EDGE_TRIGGER_SETTING;
-	
-    IPC10bits.IC6IP = 1;
-    IFS2bits.IC6IF = false;
-    IEC2bits.IC6IE = true;
 }
 
-void IC6_Update(IC_Module* IC6_Module)
+void IC_PPM_Read_Channel(const IC_PPM_Module* module, unsigned int channel, IC_Fixed_Module* channelModule)
 {
-	int logicHighClockCycles = IC6_Buffer.fallingTime - IC6_Buffer.risingTime;
-	int fullPeriodClockCycles = IC6_Buffer.risingTime - IC6_Buffer.priorRisingTime;
-	
-	IC6_Module->dutyCyclePercentage = ((double) logicHighClockCycles / fullPeriodClockCycles) * 100;
-	
-	double secondsPerPeriod = (double) fullPeriodClockCycles / TIMER_FREQUENCY;
-	
-	IC6_Module->frequency = (double) 1.0 / secondsPerPeriod;
-}
\ No newline at end of file
+    uint32_t pulseTicks;
+    uint32_t periodTicks = IC_MILLISECONDS_TO_TICKS(IC_PPM_CHANNEL_PERIOD_MILLISECONDS);
+
+    channelModule->periodsMeasured = module->framesMeasured;
+    channelModule->overruns = module->overruns;
+    channelModule->signalTimeoutTicks = module->signalTimeoutTicks;
+    channelModule->lastEdgeTime = module->lastEdgeTime;
+    channelModule->signalValid = module->signalValid && channel < module->numberOfChannels;
+
+    if (channel >= module->numberOfChannels)
+    {
+        return;
+    }
+
+    channelModule->periodTicks = periodTicks;
+    channelModule->frequency = 1000 / IC_PPM_CHANNEL_PERIOD_MILLISECONDS;
+
+    //scaled down together until they fit Q15_Ratio (only with IC_32_BIT_TIMESTAMPS)
+    pulseTicks = module->channelTicks[channel];
+    while (periodTicks > UINT16_MAX)
+    {
+        pulseTicks >>= 1;
+        periodTicks >>= 1;
+    }
+    channelModule->dutyCycle = Q15_Ratio(pulseTicks, periodTicks);
+}
+#endif
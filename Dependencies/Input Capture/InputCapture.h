@@ -5,22 +5,237 @@
 
 #pragma once
 
-typedef struct IC_Buffer IC_Buffer;
+#include "ClockConfiguration.h"
+#include "FixedPoint.h"
+
+//the number of periods each PWM-type module can store between calls to Update
+//(must be a power of 2)
+#define IC_RING_SIZE 8
+
+//Define IC_32_BIT_TIMESTAMPS (here, or in the project's compiler options) to time the
+//PWM-type modules with timer3 running at Fcy instead of the shared 62.5kHz clock.  This
+//measures pulse widths 64 times more precisely at Fcy = 4MHz (0.25us instead of 16us), or
+//256 times at 16MHz (0.0625us), and timer3's overflows are counted to make the capture
+//times 32 bits, so periods as long as the slowest advertised signal (500mHz) are still
+//measured correctly.
+//It costs one timer3 interrupt every 65536 instruction cycles (16ms at 4MHz, 4ms at
+//16MHz), and every module captures every edge with an interrupt on each one (see
+//InputCapture.c)
+//#define IC_32_BIT_TIMESTAMPS
+
+//a time or length of time in ticks of the PWM-type modules' capture clock
+#ifdef IC_32_BIT_TIMESTAMPS
+typedef uint32_t IC_Ticks;
+#else
+typedef uint16_t IC_Ticks;
+#endif
+
+//how many IC_Ticks there are in one second (the shared 62.5kHz clock, or timer3 at Fcy,
+//see ClockConfiguration.h)
+#ifdef IC_32_BIT_TIMESTAMPS
+#define IC_TICKS_PER_SECOND ((uint32_t)CLOCK_FCY)
+#else
+#define IC_TICKS_PER_SECOND ((uint32_t)CLOCK_TIMER1_TICKS_PER_SECOND)
+#endif
+//converts a length of time in milliseconds to IC_Ticks (e.g. for signalTimeoutTicks)
+//(the tick rate has to divide evenly by 500, so the only rounding is to a whole tick)
+#if CLOCK_TIMER1_TICKS_PER_SECOND % 500 != 0 || CLOCK_FCY % 500 != 0
+#error "IC_MILLISECONDS_TO_TICKS needs timer1's rate and Fcy to be multiples of 500Hz"
+#endif
+#define IC_MILLISECONDS_TO_TICKS(ms) ((IC_Ticks)((uint32_t)(ms) * (IC_TICKS_PER_SECOND / 500) / 2))
+//the same for microseconds (rounded down to a whole tick)
+#define IC_MICROSECONDS_TO_TICKS(us) ((IC_Ticks)((uint32_t)(us) * (IC_TICKS_PER_SECOND / 500) / 2000))
+
+//How the PWM-type modules capture their signals with 16 bit timestamps:
+//IC_RECEIVER_CAPTURES_PER_INTERRUPT is for the receiver inputs (IC1, IC2, IC3 and IC5) and
+//IC_SPARE_CAPTURES_PER_INTERRUPT for IC6.  1 captures one edge per interrupt, switching
+//between rising and falling edge capture in the interrupt.  2 or 4 capture every edge and
+//only interrupt once that many captures are in the FIFO (2 is one interrupt per period, 4
+//is one every 2 periods).  Either can be defined here or in the project's compiler options.
+//With IC_32_BIT_TIMESTAMPS neither is used, and every module interrupts on every edge.
+#ifndef IC_RECEIVER_CAPTURES_PER_INTERRUPT
+#define IC_RECEIVER_CAPTURES_PER_INTERRUPT 2
+#endif
+#ifndef IC_SPARE_CAPTURES_PER_INTERRUPT
+#define IC_SPARE_CAPTURES_PER_INTERRUPT 4
+#endif
+#if (IC_RECEIVER_CAPTURES_PER_INTERRUPT != 1 && IC_RECEIVER_CAPTURES_PER_INTERRUPT != 2 && IC_RECEIVER_CAPTURES_PER_INTERRUPT != 4) || (IC_SPARE_CAPTURES_PER_INTERRUPT != 1 && IC_SPARE_CAPTURES_PER_INTERRUPT != 2 && IC_SPARE_CAPTURES_PER_INTERRUPT != 4)
+#error "IC_RECEIVER_CAPTURES_PER_INTERRUPT and IC_SPARE_CAPTURES_PER_INTERRUPT have to be 1, 2 or 4"
+#endif
+
+//Define IC_PPM_MODULE as a PWM-type module's number (1, 2, 3, 5 or 6), here or in the
+//project's compiler options, to decode a PPM receiver on that module's pin instead of
+//measuring a single PWM signal (see IC_PPM_Module below).  0 (or leaving it undefined)
+//keeps every module as it is.
+#ifndef IC_PPM_MODULE
+#define IC_PPM_MODULE 0
+#endif
+#if IC_PPM_MODULE == 4 || IC_PPM_MODULE > 6
+#error "IC_PPM_MODULE has to be a PWM-type module (1, 2, 3, 5 or 6)"
+#endif
+
+//the most channels a PPM frame can have
+#define IC_PPM_MAX_CHANNELS 8
+//a PPM channel is from one rising edge to the next, and anything from
+//IC_PPM_MINIMUM_CHANNEL_MICROSECONDS to IC_PPM_MAXIMUM_CHANNEL_MICROSECONDS is a channel
+//Anything longer than IC_PPM_SYNC_MICROSECONDS is the sync gap that ends a frame, and
+//anything else (a glitch, or a frame with more than IC_PPM_MAX_CHANNELS) throws the
+//frame out.
+#define IC_PPM_MINIMUM_CHANNEL_MICROSECONDS 700
+#define IC_PPM_MAXIMUM_CHANNEL_MICROSECONDS 2300
+#define IC_PPM_SYNC_MICROSECONDS 2700
+//a frame with fewer channels than this is thrown out
+#define IC_PPM_MINIMUM_CHANNELS 4
+//IC_PPM_Read_Channel reads a channel's pulse as if it came from a PWM receiver with
+//this frame length (so the duty cycles match the ones its separate outputs give)
+#define IC_PPM_CHANNEL_PERIOD_MILLISECONDS 20
+
+typedef struct IC_Edge_Record IC_Edge_Record;
+typedef struct IC_Latest_Period IC_Latest_Period;
+typedef struct IC_Ring IC_Ring;
 typedef struct Count_Monitor_Buffer Count_Monitor_Buffer;
+typedef struct IC_Switch_Buffer IC_Switch_Buffer;
+
+//the capture times of one period of the input signal
+struct IC_Edge_Record
+{
+	IC_Ticks risingTime;
+	IC_Ticks fallingTime;
+	//how many periods were lost (because the ring was full) right before this one
+	unsigned int periodsLostBefore;
+};
+
+//the last complete period a PWM-type module measured (see ICx_Read_Latest_Period)
+struct IC_Latest_Period
+{
+	IC_Ticks risingTime;
+	IC_Ticks fallingTime;
+	//the rising time of the period before this one, only valid if hasPriorRisingTime
+	//(it is not right after the module starts, or after captures were lost)
+	IC_Ticks priorRisingTime;
+	int hasPriorRisingTime;
+	//counts up by 1 for every period the interrupt measures (and rolls over), so a
+	//new period has arrived whenever it is different from the last read
+	//(only filled in by ICx_Read_Latest_Period)
+	unsigned int periodNumber;
+};
 
-struct IC_Buffer
+//Each PWM-type module's interrupt stores every period it measures in one of these.
+//Only the interrupt writes records and moves head, and only Update reads records and
+//moves tail, so the two never have to wait on each other (or disable interrupts).
+//head and tail count up forever, head - tail is the number of stored records.
+struct IC_Ring
 {
-	int priorRisingTime;
-	int risingTime;
-	int fallingTime;
+	volatile IC_Edge_Record records[IC_RING_SIZE];
+	volatile unsigned int head;
+	volatile unsigned int tail;
+
+	//the total number of periods lost because the ring was full
+	volatile unsigned int overruns;
+	//periods lost since the last record was stored (only used by the interrupt)
+	unsigned int periodsLost;
+	//for modules that capture every edge (see capturesPerInterrupt in InputCapture.c),
+	//whether the next capture is a rising edge, and the rising time waiting for its
+	//falling edge (also only used by the interrupt)
+	int nextCaptureIsRising;
+	int hasPendingRisingTime;
+	IC_Ticks pendingRisingTime;
+
+	//the rising time of the last record Update read, so that the next period can be
+	//measured from it (only used by Update)
+	IC_Ticks lastRisingTime;
+	int hasLastRisingTime;
+
+	//The last period the interrupt measured, which is kept even when the ring is full.
+	//The interrupt adds 1 to latestSequence before and after it changes latest, so the
+	//sequence is odd while latest is only half written, and a reader that sees the
+	//same even sequence before and after copying latest has a copy of one whole period
+	//(see IC_Ring_Read_Latest in InputCapture.c)
+	volatile unsigned int latestSequence;
+	volatile IC_Latest_Period latest;
+	//whether latest.risingTime came right before the next period the interrupt will
+	//measure, so it can be that period's priorRisingTime (only used by the interrupt)
+	int latestIsContinuous;
 };
 
 struct Count_Monitor_Buffer
 {
-	int numberOfCounts;
+	volatile int numberOfCounts;
+	//set by the interrupt when it calls Stop, and cleared by IC4_Set_Stop_Count
+	volatile int stopCountReached;
+	//odd while the interrupt is changing the two values above (the same as an
+	//IC_Ring's latestSequence), so IC4_Update always copies a matching pair
+	volatile unsigned int sequence;
+
+	//when stopCountEnabled is set, the interrupt calls Stop as soon as numberOfCounts
+	//reaches stopCount (see IC4_Set_Stop_Count)
+	volatile int stopCount;
+	volatile int stopCountEnabled;
+	void (*Stop)(void);
+};
+
+//A switch on a receiver channel that is checked by the module's own interrupt, on every
+//period it measures, instead of waiting for Update (see IC1_Set_Switch).  A pulse between
+//onMinimumTicks and onMaximumTicks long means on, and anything else means off.
+struct IC_Switch_Buffer
+{
+	IC_Ticks onMinimumTicks;
+	IC_Ticks onMaximumTicks;
+	//how many periods in a row have to disagree with isOn before it changes
+	unsigned int debouncePeriods;
+	//called by the interrupt as soon as the switch changes to on
+	void (*SwitchedOn)(void);
+	volatile int enabled;
+
+	volatile int isOn;
+	//the periods in a row that have disagreed with isOn (only used by the interrupt)
+	unsigned int disagreeingPeriods;
+	//how many times SwitchedOn has been called
+	volatile unsigned int timesSwitchedOn;
+};
+
+//the farthest the stepper motor can turn in either direction (180 degrees), the count
+//stops changing past these
+#define IC4_MINIMUM_COUNT -1412
+#define IC4_MAXIMUM_COUNT 1412
+
+//the PPM module's interrupt puts every channel of a frame together here, and only copies
+//them to the published frame once the sync gap shows that the frame is complete
+//(see IC_PPM_Update)
+typedef struct IC_PPM_Buffer IC_PPM_Buffer;
+
+struct IC_PPM_Buffer
+{
+	//the last frame the interrupt finished, written under sequence the same way as an
+	//IC_Ring's latest period, so a reader always gets every channel from the same frame
+	volatile IC_Ticks channelTicks[IC_PPM_MAX_CHANNELS];
+	volatile unsigned int numberOfChannels;
+	//the capture time of the rising edge that ended the frame's last channel
+	volatile IC_Ticks frameEndTime;
+	volatile unsigned int sequence;
+
+	//the frames that were thrown out, and the times the FIFO overflowed
+	volatile unsigned int badFrames;
+	volatile unsigned int overruns;
+
+	//set by IC_PPM_Update when the signal is lost, so the interrupt starts over from the
+	//next edge instead of measuring a channel from an edge before the signal was lost
+	volatile int restart;
+
+	//(only used by the interrupt)
+	//the frame being received, and how many of its channels have arrived (or
+	//0xFFFF until the next sync gap)
+	IC_Ticks pendingTicks[IC_PPM_MAX_CHANNELS];
+	unsigned int pendingChannels;
+	//how many channels the frame before it had
+	unsigned int previousChannels;
+	IC_Ticks lastEdgeTime;
+	int hasLastEdgeTime;
 };
 
 typedef struct IC_Module IC_Module;
+typedef struct IC_Fixed_Module IC_Fixed_Module;
+typedef struct IC_PPM_Module IC_PPM_Module;
 typedef struct Count_Monitor Count_Monitor;
 
 //this struct is designed to store information about
@@ -34,27 +249,121 @@ struct IC_Module
 	//functionality, it will only leave you with invalid values
 	double dutyCyclePercentage;
 	double frequency;
+	
+	//the number of periods the last Update averaged together (0 means there were no
+	//new periods, and the values above were left alone)
+	unsigned int periodsMeasured;
+	//the total number of periods that were lost because Update was not called often
+	//enough to keep up with the input signal (see IC_RING_SIZE)
+	unsigned int overruns;
+
+	//Signal loss detection:  signalTimeoutTicks is how long the input can go without
+	//finishing a period before it counts as lost (see IC_MILLISECONDS_TO_TICKS), and
+	//0 turns this off.  Initialize sets it to 0, so set it afterwards.
+	IC_Ticks signalTimeoutTicks;
+	//the capture time of the falling edge that ended the last period
+	IC_Ticks lastEdgeTime;
+	//1 while the input's periods keep arriving, 0 before the first whole period and once
+	//signalTimeoutTicks has passed since lastEdgeTime (checked by Update, so Update must
+	//be called at least once every 65536 ticks)
+	int signalValid;
+	//(lastEdgeTime and signalValid are READ-ONLY)
     
     void (*Initialize)();
 	void (*Update)(struct IC_Module*);
 };
 
+//this struct stores the same information as IC_Module, but its Update functions only
+//use integer math, so they do not need the (slow) floating point library
+//Use this one inside of the main control loop
+struct IC_Fixed_Module
+{
+	//the duty cycle as a Q15 fraction, where 32768 is 100% (see FixedPoint.h)
+	//e.g. a 12.5% duty cycle is 4096
+	Q15 dutyCycle;
+	//the average length of one period in ticks of the IC module's clock
+	//(62.5kHz, or Fcy with IC_32_BIT_TIMESTAMPS)
+	IC_Ticks periodTicks;
+	//in Hertz, rounded to the nearest Hz
+	uint16_t frequency;
+	//the same as in IC_Module
+	unsigned int periodsMeasured;
+	unsigned int overruns;
+	//(all of these are READ-ONLY, just like in IC_Module)
+
+	//the same signal loss detection as IC_Module
+	IC_Ticks signalTimeoutTicks;
+	IC_Ticks lastEdgeTime;
+	int signalValid;
+	
+	void (*Initialize)(struct IC_Fixed_Module*);
+	void (*Update)(struct IC_Fixed_Module*);
+};
+
+//A PPM receiver sends every channel on one wire:  a short pulse starts each channel, the
+//time from one pulse's rising edge to the next is that channel's servo pulse width, and a
+//long gap with no pulses (the sync gap) comes after the last channel.  The IC_PPM_MODULE's
+//interrupt captures every rising edge, and once a sync gap ends a frame of
+//IC_PPM_MINIMUM_CHANNELS to IC_PPM_MAX_CHANNELS good channels, it publishes the whole frame
+//at once.  A frame is only published if it has as many channels as the last frame that was
+//(or as the frame right before it, when the receiver really changes how many it sends), so
+//a glitch that splits a channel in two, or a signal that comes back in the middle of a
+//frame, can never shift the channels over.  This takes one module and one interrupt
+//source for the whole receiver (instead of one per channel), and with 4 captures per
+//interrupt, fewer interrupts than even 4 separate PWM inputs.
+struct IC_PPM_Module
+{
+	//every channel's pulse width in IC_Ticks, all from the same frame
+	IC_Ticks channelTicks[IC_PPM_MAX_CHANNELS];
+	//how many channels that frame had (0 until the first frame)
+	unsigned int numberOfChannels;
+	//the number of new frames since the last Update (0 means the channels were left alone,
+	//and frames in between two Updates are skipped, only the newest one is kept)
+	unsigned int framesMeasured;
+	//the total frames thrown out (a glitch, a channel out of range, or too many or too few
+	//channels) and the times the module's FIFO overflowed
+	unsigned int badFrames;
+	unsigned int overruns;
+	//(all of these are READ-ONLY)
+
+	//the same signal loss detection as IC_Module, where lastEdgeTime is the end of the last
+	//frame's last channel
+	IC_Ticks signalTimeoutTicks;
+	IC_Ticks lastEdgeTime;
+	int signalValid;
+
+	//the buffer's sequence when Update last copied a frame (only used by Update)
+	unsigned int lastSequence;
+};
+
 struct Count_Monitor
 {
 	//this variable will hold a reference to the number of counts held by the
     //stepper motor.  Negative values are CW, positive values are CCW.
     int numberOfCounts;
-    
+
+    //the position (in counts) that the stepper motor is being driven towards
+    int desiredPosition;
+
     int allowClockwiseMotion;
     int allowCounterClockwiseMotion;
     
     int brakeEngaged;
+
+    //whether the interrupt has stopped at the stop count set by IC4_Set_Stop_Count,
+    //as of the same moment as numberOfCounts
+    int stopCountReached;
     
     void (*Initialize)(Count_Monitor*);
 	void (*Update)(Count_Monitor*);
 };
 
 
+//ICx_Read_Latest_Period copies the last period the module's interrupt measured (without
+//waiting for Update, and without taking anything out of the ring), and never returns a
+//mix of two periods even if the interrupt runs in the middle of it.  It returns 0, or -1
+//if the module has not measured a whole period since it was initialized.
+
 //NOTE:  all these modules are intended to be used with
 //       a 3.3V square wave (pwm-type) input signal by
 //       measuring the rising and falling edges of the
@@ -69,6 +378,16 @@ struct Count_Monitor
 void __attribute__ ((__interrupt__, auto_psv)) _IC1Interrupt(void);
 void IC1_Initialize(IC_Module* IC1_Module);
 void IC1_Update(IC_Module* IC1_Module);
+void IC1_Fixed_Initialize(IC_Fixed_Module* IC1_Module);
+void IC1_Fixed_Update(IC_Fixed_Module* IC1_Module);
+int IC1_Read_Latest_Period(IC_Latest_Period* period);
+//Has IC1's interrupt check every pulse it measures against a switch (e.g. a kill switch),
+//and call SwitchedOn the moment debouncePeriods pulses in a row are between
+//onMinimumTicks and onMaximumTicks.  It changes back to off the same way, without a call.
+//SwitchedOn runs inside of the interrupt, so it must be short.  The switch starts off.
+void IC1_Set_Switch(IC_Ticks onMinimumTicks, IC_Ticks onMaximumTicks, unsigned int debouncePeriods, void (*SwitchedOn)(void));
+//1 if the switch set by IC1_Set_Switch is on, 0 if it is off (or was never set)
+int IC1_Switch_Is_On(void);
 
 
 //this interrupt is for propulsion thrust direction
@@ -78,6 +397,9 @@ void IC1_Update(IC_Module* IC1_Module);
 void __attribute__ ((__interrupt__, auto_psv)) _IC2Interrupt(void);
 void IC2_Initialize(IC_Module* IC2_Module);
 void IC2_Update(IC_Module* IC2_Module);
+void IC2_Fixed_Initialize(IC_Fixed_Module* IC2_Module);
+void IC2_Fixed_Update(IC_Fixed_Module* IC2_Module);
+int IC2_Read_Latest_Period(IC_Latest_Period* period);
 
 
 //this interrupt is for lift engine throttle (magnitude) control
@@ -87,6 +409,9 @@ void IC2_Update(IC_Module* IC2_Module);
 void __attribute__ ((__interrupt__, auto_psv)) _IC3Interrupt(void);
 void IC3_Initialize(IC_Module* IC3_Module);
 void IC3_Update(IC_Module* IC3_Module);
+void IC3_Fixed_Initialize(IC_Fixed_Module* IC3_Module);
+void IC3_Fixed_Update(IC_Fixed_Module* IC3_Module);
+int IC3_Read_Latest_Period(IC_Latest_Period* period);
 
 
 //this interrupt is for the kill switch (toggled on/off)
@@ -100,6 +425,13 @@ void IC3_Update(IC_Module* IC3_Module);
 void __attribute__ ((__interrupt__, auto_psv)) _IC4Interrupt(void);
 void IC4_Initialize(Count_Monitor* IC4_Module);
 void IC4_Update(Count_Monitor* IC4_Module);
+//has the interrupt call Stop (e.g. to turn off the stepper motor's step signal) on the
+//pulse that makes the count equal to stopCount, so that the motor stops exactly there
+//no matter how long it is until the main program checks on it again
+//Stop runs inside of the interrupt, so it must be short.  Only one stop count is kept,
+//and it is cleared once Stop has been called.
+void IC4_Set_Stop_Count(int stopCount, void (*Stop)(void));
+void IC4_Clear_Stop_Count(void);
 
 
 //Unused as of now in the hovercraft project, but it is here because
@@ -107,10 +439,32 @@ void IC4_Update(Count_Monitor* IC4_Module);
 void __attribute__ ((__interrupt__, auto_psv)) _IC5Interrupt(void);
 void IC5_Initialize(IC_Module* IC5_Module);
 void IC5_Update(IC_Module* IC5_Module);
+void IC5_Fixed_Initialize(IC_Fixed_Module* IC5_Module);
+void IC5_Fixed_Update(IC_Fixed_Module* IC5_Module);
+int IC5_Read_Latest_Period(IC_Latest_Period* period);
 
 
 //Unused as of now in the hovercraft project, but it is here because
 //the framework should have the potential to use all 6 of the IC modules if necessary
 void __attribute__ ((__interrupt__, auto_psv)) _IC6Interrupt(void);
 void IC6_Initialize(IC_Module* IC6_Module);
-void IC6_Update(IC_Module* IC6_Module);
\ No newline at end of file
+void IC6_Update(IC_Module* IC6_Module);
+void IC6_Fixed_Initialize(IC_Fixed_Module* IC6_Module);
+void IC6_Fixed_Update(IC_Fixed_Module* IC6_Module);
+int IC6_Read_Latest_Period(IC_Latest_Period* period);
+
+
+#if IC_PPM_MODULE != 0
+//Decodes the PPM receiver on IC_PPM_MODULE's pin.  That module's interrupt runs the PPM
+//decoder instead, so its own ICx_Initialize/Update functions must not be used.
+void IC_PPM_Initialize(IC_PPM_Module* module);
+//copies the newest whole frame and checks the signal (call it at least once every rollover
+//of the capture clock, just like the PWM-type modules' Update)
+void IC_PPM_Update(IC_PPM_Module* module);
+//Fills in an IC_Fixed_Module with one channel (0 - IC_PPM_MAX_CHANNELS - 1) of the frame
+//Update last copied, as if it came from its own PWM input:  the pulse as a duty cycle of
+//IC_PPM_CHANNEL_PERIOD_MILLISECONDS, that period, the frames measured and the signal loss.
+//signalValid is 0 if the frame did not have that channel.  This lets code written for
+//separate PWM inputs use a PPM receiver without any other changes.
+void IC_PPM_Read_Channel(const IC_PPM_Module* module, unsigned int channel, IC_Fixed_Module* channelModule);
+#endif
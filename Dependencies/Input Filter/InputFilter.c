@@ -0,0 +1,100 @@
+/*
+ * File:    InputFilter.c
+ * Author:  Zachary Downum
+ */
+
+#include "InputFilter.h"
+
+void Input_Filter_Initialize(Input_Filter* filter, Q15 initialValue)
+{
+	unsigned int i;
+
+	for (i = 0; i < INPUT_FILTER_MAX_MEDIAN_SIZE; ++i)
+	{
+		filter->medianSamples[i] = initialValue;
+	}
+	filter->medianNext = 0;
+
+	filter->iirSum = (uint32_t)initialValue << filter->iirShift;
+	filter->iirOutput = initialValue;
+
+	filter->output = initialValue;
+}
+
+//stores the newest reading over the oldest one, and returns the middle value
+static Q15 Input_Filter_Median(Input_Filter* filter, Q15 input)
+{
+	Q15 sorted[INPUT_FILTER_MAX_MEDIAN_SIZE];
+	unsigned int size = filter->medianSize;
+	unsigned int i;
+	unsigned int j;
+
+	filter->medianSamples[filter->medianNext] = input;
+	++filter->medianNext;
+	if (filter->medianNext >= size)
+	{
+		filter->medianNext = 0;
+	}
+
+	//an insertion sort, which is at most 10 comparisons for 5 values
+	for (i = 0; i < size; ++i)
+	{
+		Q15 sample = filter->medianSamples[i];
+
+		for (j = i; j > 0 && sorted[j - 1] > sample; --j)
+		{
+			sorted[j] = sorted[j - 1];
+		}
+		sorted[j] = sample;
+	}
+
+	return sorted[size / 2];
+}
+
+//output += (input - output) / 2^iirShift, done on the sum so nothing is rounded away
+static Q15 Input_Filter_IIR(Input_Filter* filter, Q15 input)
+{
+	filter->iirSum = filter->iirSum - filter->iirOutput + input;
+	filter->iirOutput = (Q15)(filter->iirSum >> filter->iirShift);
+
+	return filter->iirOutput;
+}
+
+//moves the output towards input by no more than maximumStep
+static Q15 Input_Filter_Slew(const Input_Filter* filter, Q15 input)
+{
+	Q15 output = filter->output;
+
+	if (input > output && input - output > filter->maximumStep)
+	{
+		return output + filter->maximumStep;
+	}
+	else if (input < output && output - input > filter->maximumStep)
+	{
+		return output - filter->maximumStep;
+	}
+
+	return input;
+}
+
+Q15 Input_Filter_Update(Input_Filter* filter, Q15 input)
+{
+	if (filter->medianSize > 1)
+	{
+		input = Input_Filter_Median(filter, input);
+	}
+
+	if (filter->iirShift != 0)
+	{
+		input = Input_Filter_IIR(filter, input);
+	}
+
+	if (filter->maximumStep != 0)
+	{
+		input = Input_Filter_Slew(filter, input);
+	}
+
+	filter->output = input;
+
+	return input;
+}
@@ -0,0 +1,63 @@
+/*
+ * File:    InputFilter.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include "FixedPoint.h"
+
+//Smooths a reading that arrives once per frame (e.g. an IC_Fixed_Module's dutyCycle
+//after every Update) using only integer math.  Each Input_Filter is made of up to three
+//stages, which run in this order and can each be turned off:
+//
+//  median:  the middle value of the last medianSize readings (3 or 5).  A spike of up
+//           to (medianSize - 1) / 2 frames in a row is thrown out completely.
+//           Step response:  the output jumps all the way to a new value after
+//           (medianSize + 1) / 2 frames (2 frames for 3, 3 frames for 5).
+//  IIR:     a first-order low pass, output += (input - output) / 2^iirShift, which is
+//           the same as averaging with a weight of 2^iirShift.
+//           Step response (frames until the output has moved this much of the step):
+//               iirShift   1    2    3    4    5
+//               50%        1    3    6   11   22
+//               90%        4    9   18   36   73
+//  slew:    the output moves by at most maximumStep per frame.
+//           Step response:  (size of the step) / maximumStep frames, rounded up.
+//
+//When more than one stage is on, each stage gets the new value on the same frame the
+//stage before it passes it on, so the latencies add up less 1 frame per extra stage,
+//e.g. a median of 3 followed by an iirShift of 1 gets halfway in 2 + 1 - 1 = 2 frames.
+//(Host Simulator/filter_step_response.c measures these)
+
+//the largest medianSize
+#define INPUT_FILTER_MAX_MEDIAN_SIZE 5
+
+typedef struct Input_Filter Input_Filter;
+
+struct Input_Filter
+{
+	//These have to be set before Input_Filter_Initialize is called
+	//3 or 5, or 0 to turn the median stage off
+	unsigned int medianSize;
+	//1 - 15, or 0 to turn the IIR stage off
+	unsigned int iirShift;
+	//the most the output can change in one frame, or 0 to turn the slew stage off
+	Q15 maximumStep;
+
+	//the filtered value (READ-ONLY)
+	Q15 output;
+
+	//only used by the functions below
+	Q15 medianSamples[INPUT_FILTER_MAX_MEDIAN_SIZE];
+	unsigned int medianNext;
+	//the IIR stage's output * 2^iirShift, which keeps the remainder that the division
+	//would throw away, so the output settles on exactly the input
+	uint32_t iirSum;
+	Q15 iirOutput;
+};
+
+//starts every stage as if it had been reading initialValue forever
+void Input_Filter_Initialize(Input_Filter* filter, Q15 initialValue);
+
+//adds one frame's reading, and returns the new output (also stored in filter->output)
+Q15 Input_Filter_Update(Input_Filter* filter, Q15 input);
@@ -4,10 +4,7 @@
  */
 
 #include "mcc_generated_files/mcc.h"
-
-//FCY is based off _XTAL_FREQ, the current system clock
-//(see system_configuration.h)
-#define FCY (_XTAL_FREQ / 2)
+#include "ClockConfiguration.h"
 
 #include <stdlib.h>
 #include <libpic30.h>
@@ -46,6 +43,7 @@ void PWM_Module_Initialize(PWM_Module* left_motor, PWM_Module* right_motor)
 int main(void)
 {
     SYSTEM_Initialize();
+    Clock_Initialize();
     PIC_Initialization();
 
     PWM_Module Left_Motor;
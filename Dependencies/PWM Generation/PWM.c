@@ -4,409 +4,819 @@
  */
 
 #include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+#include "Timebase.h"
 
 #include <xc.h>
 #include <stdlib.h>
 #include <libpic30.h>
 #include "PWM.h"
-
-//FCY and TCY are based off _XTAL_FREQ, the current system clock
-//(see system_configuration.h)
-#define FCY (_XTAL_FREQ / 2)
-#define TCY ((double)1.0 / FCY)
-#define TIMER_PRESCALER 64
+#include "Profiler.h"
 
 #define PWM_ROUNDING_OFFSET 0.5
 
+//the rates the OC modules' clocks are requested at:  OC1 and OC2 use the shared 62.5kHz
+//clock (the same one as the IC modules), and OC3 - OC6 use Fcy directly
+#define PWM_SHARED_TICKS_PER_SECOND ((uint32_t)CLOCK_TIMER1_TICKS_PER_SECOND)
+#define PWM_FCY_TICKS_PER_SECOND ((uint32_t)CLOCK_FCY)
+
+//OCM in OCxCON1 (edge-aligned PWM)
+#define PWM_EDGE_ALIGNED_MODE 0b110
+//SYNCSEL in OCxCON2:  0b11111 makes the module its own synchronization source, and
+//1 - 6 synchronize it to OC1 - OC6 (see PWM_Group)
+#define PWM_SELF_SYNC_SETTING 0b11111
+
 #define true 1
 #define false 0
 
+//every OC module's control registers have the same layout, so OC1's bit definitions
+//are used to access all of them
+typedef __typeof__(OC1CON1bits) PWM_Control1_Bits;
+typedef __typeof__(OC1CON2bits) PWM_Control2_Bits;
 
-//see Table 11-4 in the PIC24FJ128GA202 documentation for more codes
-//for remappable pin settings (starting on page 174)
-//The left motor's maps to OC1
-//The right motor's maps to OC2
-
-//The order of these aliases is as follows:
-//OC_CON1 --    main configuration register for the motor's PWM/OC module
-//OC_CON1bits --    direct access to the CON1 register's bits
-//OC_CON2 --    secondary config register for the motor's PWM/OC module
-//OC_CON2bits --    direct access to the CON2 register's bits
-//RP -- the configuration register for the remappable pin used by the PWM module
-//RP_Reference --   the reference code sent to the remappable pin
-//                              to sync it with a module
-//                              (13 = OC1 for the left motor,
-//                              14 = OC2 for the right motor)
-//OCR --    The register that controls what portion of the period the PWM will
-//          generate a logic high voltage (based on calculations using OCRS)
-//OCRS --   The register that controls the period of the PWM (based on
-//          calculations using the Tcy value)
+typedef struct PWM_Channel PWM_Channel;
+
+//The six OC modules only differ in which registers, pin and clock they use, so everything
+//that is different about a module is stored in its entry of PWM_Channels below and all of
+//the modules share the same code.
+//OCxR --   the number of ticks in each period that the output is high
+//OCxRS --  the number of ticks in each period, less 1
 //          See Example 15-1 (page 215) for calculation information
 //          Essentially, OCxR / OCxRS = duty cycle % for the PWM module
-#define OC1_RP RPOR0bits.RP0R
-#define OC1_Remappable_Pin_Reference 13
+struct PWM_Channel
+{
+    volatile uint16_t* dutyCycleRegister;
+    volatile uint16_t* periodRegister;
+    PWM_Control1_Bits* control1;
+    PWM_Control2_Bits* control2;
+    //1-6
+    unsigned int moduleNumber;
+
+    //the remappable pin the output goes out on (RPn is also pin RBn on this PIC)
+    unsigned int remappablePin;
+    //the peripheral pin select register for the pin, and where its 6 bit field starts
+    volatile uint16_t* pinSelect;
+    unsigned int pinSelectShift;
+    //the code that connects the pin to this module (13 = OC1 ... 18 = OC6)
+    unsigned int remappablePinReference;
+
+    //how fast the clock that counts the period should tick (Initialize asks the Timebase
+    //dependency for it, see PWM_Timebases)
+    uint32_t ticksPerSecond;
+    //the frequency Initialize starts the module at
+    uint16_t defaultFrequency;
+
+    //this module's bit in the interrupt flag and enable registers (used by PWM_Group)
+    volatile uint16_t* interruptFlag;
+    volatile uint16_t* interruptEnable;
+    uint16_t interruptMask;
+    //the interrupt priority register, and where this module's 3 bit field starts
+    volatile uint16_t* interruptPriority;
+    unsigned int interruptPriorityShift;
+};
+
+#define OC1_CHANNEL 0
+#define OC2_CHANNEL 1
+#define OC3_CHANNEL 2
+#define OC4_CHANNEL 3
+#define OC5_CHANNEL 4
+#define OC6_CHANNEL 5
+
+//see Table 11-4 (page 174) in the PIC24FJ128GA202 documentation for the remappable pin
+//codes, and page 89 for the interrupt registers
+//The 5V tolerant pins are skipped on purpose (see the readme)
+static const PWM_Channel PWM_Channels[] =
+{
+    { &OC1R, &OC1RS, (PWM_Control1_Bits*)&OC1CON1, (PWM_Control2_Bits*)&OC1CON2, 1, 0, &RPOR0, 0, 13, PWM_SHARED_TICKS_PER_SECOND, 1000, &IFS0, &IEC0, 1 << 2, &IPC0, 8 },
+    { &OC2R, &OC2RS, (PWM_Control1_Bits*)&OC2CON1, (PWM_Control2_Bits*)&OC2CON2, 2, 1, &RPOR0, 8, 14, PWM_SHARED_TICKS_PER_SECOND, 15000, &IFS0, &IEC0, 1 << 6, &IPC1, 8 },
+    { &OC3R, &OC3RS, (PWM_Control1_Bits*)&OC3CON1, (PWM_Control2_Bits*)&OC3CON2, 3, 2, &RPOR1, 0, 15, PWM_FCY_TICKS_PER_SECOND, 15000, &IFS1, &IEC1, 1 << 9, &IPC6, 4 },
+    { &OC4R, &OC4RS, (PWM_Control1_Bits*)&OC4CON1, (PWM_Control2_Bits*)&OC4CON2, 4, 3, &RPOR1, 8, 16, PWM_FCY_TICKS_PER_SECOND, 15000, &IFS1, &IEC1, 1 << 10, &IPC6, 8 },
+    { &OC5R, &OC5RS, (PWM_Control1_Bits*)&OC5CON1, (PWM_Control2_Bits*)&OC5CON2, 5, 9, &RPOR4, 8, 17, PWM_FCY_TICKS_PER_SECOND, 15000, &IFS2, &IEC2, 1 << 9, &IPC10, 4 },
+    { &OC6R, &OC6RS, (PWM_Control1_Bits*)&OC6CON1, (PWM_Control2_Bits*)&OC6CON2, 6, 10, &RPOR5, 0, 18, PWM_FCY_TICKS_PER_SECOND, 15000, &IFS2, &IEC2, 1 << 10, &IPC10, 8 },
+};
+
+//the clock each module is counting its period in, from the Timebase dependency
+//Initialize sets it from the module's entry above, and PWM_Fixed_Request_Clock (or
+//PWM_Servo_Initialize) can move the module onto another one afterwards.
+#define PWM_NUMBER_OF_CHANNELS (sizeof(PWM_Channels) / sizeof(PWM_Channels[0]))
+static const Timebase* PWM_Timebases[PWM_NUMBER_OF_CHANNELS];
+
+
+//The functions below are the whole driver.  They are all inlined, and each OCx function
+//passes its own constant entry of PWM_Channels, so the compiler turns every table lookup
+//into the OCx register itself and each OCx function ends up as the same code it was when
+//it was written out by hand.  Only the PWM_Output functions (which take the module number
+//at run time) actually read the table.
+
+static inline __attribute__((always_inline)) const Timebase* PWM_Channel_Timebase(const PWM_Channel* channel)
+{
+    return PWM_Timebases[channel->moduleNumber - 1];
+}
 
-#define OC2_RP RPOR0bits.RP1R
-#define OC2_Remappable_Pin_Reference 14
+//turns the module off and connects it to its pin, before its period and duty cycle are set
+static inline __attribute__((always_inline)) void PWM_Channel_Prepare(const PWM_Channel* channel)
+{
+    //disables the OC module while the pwm is set up
+    *(volatile uint16_t*)channel->control1 = 0x0000;
 
-#define OC3_RP RPOR1bits.RP2R
-#define OC3_Remappable_Pin_Reference 15
+    //a timer is only started by the first module (OC or IC) that asks for its rate, so
+    //the modules that are already running on it are never thrown off
+    PWM_Timebases[channel->moduleNumber - 1] = Timebase_Request(channel->ticksPerSecond);
 
-#define OC4_RP RPOR1bits.RP3R
-#define OC4_Remappable_Pin_Reference 16
+    //sets the pin to be digital and an output to ensure PWM is generated properly on
+    //the pin (RB10 has no analog function, so clearing its ANSB bit does nothing)
+    ANSB &= ~(1 << channel->remappablePin);
+    TRISB &= ~(1 << channel->remappablePin);
+    Nop();
 
-#define OC5_RP RPOR4bits.RP9R
-#define OC5_Remappable_Pin_Reference 17
+    //sets the remappable pin to output the value of the OC module
+    *channel->pinSelect = (*channel->pinSelect & ~(0x3F << channel->pinSelectShift)) | (channel->remappablePinReference << channel->pinSelectShift);
+}
 
-#define OC6_RP RPOR5bits.RP10R
-#define OC6_Remappable_Pin_Reference 18
+//connects the module to its clock and turns on edge-aligned pwm, once its registers are set
+static inline __attribute__((always_inline)) void PWM_Channel_Start(const PWM_Channel* channel)
+{
+    //sets itself as the synchronization source
+    *(volatile uint16_t*)channel->control2 = PWM_SELF_SYNC_SETTING;
 
+    channel->control1->OCTSEL = PWM_Channel_Timebase(channel)->outputCompareClockSetting;
 
-void PWM_OC1_Initialize(PWM_Module* OC1_PWM_module)
-{	
-    //disables the left motor's OC while the pwm is set up
-    OC1CON1 = 0x0000;
-    
-	//sets the pin to be digital and an output to ensure PWM is generated properly on
-	//the pin
-	ANSBbits.ANSB0 = 0;
-	TRISBbits.TRISB0 = 0;
-	Nop();
-    
-    //sets the remappable pin RP0 to output the value of OC1 (the output compare
-    //pin that is being used to generate the PWM)
-    OC1_RP = OC1_Remappable_Pin_Reference;
-    
-    //sets the default duty cycle percentage to 0 to reflect the register values
-    OC1_PWM_module->dutyCyclePercentage = 0;
-    //sets the default period to 1000 (Hz) to reflect the register values
-    OC1_PWM_module->frequency = 1000;
-    
-    OC1_PWM_module->UpdateFrequency(OC1_PWM_module);
-    OC1_PWM_module->UpdateDutyCycle(OC1_PWM_module);
-    
-    //turns timer1 off to configure it
-    T1CON = 0b0000000000000000;
-    //sets a 1:64 input clock prescaler, which increments the timer every
-    //8th clock cycle (from Fcy by default)
-    T1CONbits.TCKPS = 0b10;
-    //sets this timer's clock source to Fcy
-    T1CONbits.TCS = 0b0;
-    //turns timer1 back on after it is configured
-    T1CONbits.TON = 1;
-    
-    //sets itself as the synchronization source
-    OC1CON2 = 0b00011111;
-    
-    //sets the pwm timer to timer1
-    OC1CON1bits.OCTSEL = 0b100;
+    channel->control1->OCM = PWM_EDGE_ALIGNED_MODE;
+}
+
+static inline __attribute__((always_inline)) void PWM_Channel_Initialize(const PWM_Channel* channel, PWM_Module* module)
+{
+    PWM_Channel_Prepare(channel);
+
+    //the defaults reflect the register values
+    module->dutyCyclePercentage = 0;
+    module->frequency = channel->defaultFrequency;
+
+    module->UpdateFrequency(module);
+    module->UpdateDutyCycle(module);
+
+    PWM_Channel_Start(channel);
+}
+
+static inline __attribute__((always_inline)) double PWM_Channel_Get_DutyCycle(const PWM_Channel* channel)
+{
+    //OCR is the number of clock cycles that the module sends and active high for
+    //OCRS is the number of clock cycles for the entire period
+    //Therefore, OCR / OCRS = % duty cycle
+    return (double)*channel->dutyCycleRegister / *channel->periodRegister;
+}
+
+static inline __attribute__((always_inline)) double PWM_Channel_Get_Frequency(const PWM_Channel* channel)
+{
+    //The period (in seconds) is defined as (OCRS + 1) * TCY * (the clock's prescaler) in the
+    //data sheet, therefore 1 / that is the frequency (TCY * prescaler is one tick of the clock)
+    return (double)PWM_Channel_Timebase(channel)->ticksPerSecond / (*channel->periodRegister + 1);
+}
+
+static inline __attribute__((always_inline)) void PWM_Channel_Update_DutyCycle(const PWM_Channel* channel, const PWM_Module* module)
+{
+    //As stated before, OCR / OCRS = % duty cycle
+    //Therefore, (duty cycle percentage) * OCRS / 100 = number of logic high cycles
+    //This is new value is stored into OCR to edit the duty cycle, OCRS does not change
+    //Because the frequency does not change
+    int logicHighClockCycles = (module->dutyCyclePercentage * *channel->periodRegister / 100) + PWM_ROUNDING_OFFSET;
+    *channel->dutyCycleRegister = logicHighClockCycles;
+}
+
+static inline __attribute__((always_inline)) void PWM_Channel_Update_Frequency(const PWM_Channel* channel, const PWM_Module* module)
+{
+    //Using the 1 / ((OCRS + 1) * TCY) equation for frequency, we first solved for OCRS
+    //Then we plugged in the new frequency value to calculate the new OCRS value
+    //UpdateDutyCycle is called to recalculate OCR after the new value of OCRS is stored
+    double totalClockCycles = (double)PWM_Channel_Timebase(channel)->ticksPerSecond / module->frequency - 1;
+    *channel->periodRegister = (int)totalClockCycles;
+
+    module->UpdateDutyCycle(module);
+}
+
+
+//Integer (PWM_Fixed_Module and PWM_Output) versions of the functions above.  These use
+//the same registers and settings, only without any floating point math.
+
+//returns the number of ticks in one period (OCxRS + 1) at the given frequency, with the
+//frequency limited so that a period is 2 - 65535 ticks long
+static inline uint16_t PWM_Fixed_Period_Ticks(uint32_t ticksPerSecond, uint16_t frequency)
+{
+    if (frequency <= ticksPerSecond / 65536)
+    {
+        frequency = ticksPerSecond / 65536 + 1;
+    }
+    else if (frequency > ticksPerSecond / 2)
+    {
+        frequency = ticksPerSecond / 2;
+    }
+    
+    //the limits above keep the quotient within 16 bits
+    return FixedPoint_Divide(ticksPerSecond, frequency);
+}
+
+//returns the number of ticks in the high part of a period, rounded to the nearest tick
+//(the same rounding that PWM_ROUNDING_OFFSET gives the PWM_Module functions)
+static inline uint16_t PWM_Fixed_High_Ticks(uint16_t periodTicks, Q15 dutyCycle)
+{
+    if (dutyCycle >= Q15_ONE)
+    {
+        return periodTicks;
+    }
     
-    //turns on edge-aligned pwm functionality
-    OC1CON1bits.OCM = 0b110;
+    return (uint16_t)(((uint32_t)periodTicks * dutyCycle + (Q15_ONE / 2)) >> 15);
+}
+
+//sets OCxRS for the frequency and returns the period in ticks
+//(the only division, done once per frequency change instead of on every duty cycle update)
+static inline __attribute__((always_inline)) uint16_t PWM_Channel_Set_Period(const PWM_Channel* channel, uint16_t frequency)
+{
+    uint16_t periodTicks = PWM_Fixed_Period_Ticks(PWM_Channel_Timebase(channel)->ticksPerSecond, frequency);
+
+    *channel->periodRegister = periodTicks - 1;
+
+    return periodTicks;
+}
+
+//sets OCxR, limited to the period, and returns what it was set to
+static inline __attribute__((always_inline)) uint16_t PWM_Channel_Set_High_Ticks(const PWM_Channel* channel, uint16_t periodTicks, uint16_t highTicks)
+{
+    if (highTicks > periodTicks)
+    {
+        highTicks = periodTicks;
+    }
+
+    *channel->dutyCycleRegister = highTicks;
+
+    return highTicks;
+}
+
+static inline __attribute__((always_inline)) void PWM_Channel_Fixed_Initialize(const PWM_Channel* channel, PWM_Fixed_Module* module)
+{
+    PWM_Channel_Prepare(channel);
+
+    module->moduleNumber = channel->moduleNumber;
+    module->dutyCycle = 0;
+    module->frequency = channel->defaultFrequency;
+
+    module->UpdateFrequency(module);
+
+    PWM_Channel_Start(channel);
+}
+
+static inline __attribute__((always_inline)) void PWM_Channel_Fixed_Update_DutyCycle(const PWM_Channel* channel, PWM_Fixed_Module* module)
+{
+    //periodTicks was worked out by the last UpdateFrequency, so this is one multiply
+    module->highTicks = PWM_Fixed_High_Ticks(module->periodTicks, module->dutyCycle);
+    *channel->dutyCycleRegister = module->highTicks;
+}
+
+static inline __attribute__((always_inline)) void PWM_Channel_Fixed_Update_Frequency(const PWM_Channel* channel, PWM_Fixed_Module* module)
+{
+    module->periodTicks = PWM_Channel_Set_Period(channel, module->frequency);
+
+    module->UpdateDutyCycle(module);
+}
+
+static inline __attribute__((always_inline)) void PWM_Channel_Fixed_Set_High_Ticks(const PWM_Channel* channel, PWM_Fixed_Module* module, uint16_t highTicks)
+{
+    module->highTicks = PWM_Channel_Set_High_Ticks(channel, module->periodTicks, highTicks);
+}
+
+
+void PWM_OC1_Initialize(PWM_Module* OC1_PWM_module)
+{
+    PWM_Channel_Initialize(&PWM_Channels[OC1_CHANNEL], OC1_PWM_module);
 }
 
 double PWM_Get_OC1_DutyCycle(void)
 {
-	//OCR is the number of clock cycles that the module sends and active high for
-	//OCRS is the number of clock cycles for the entire period
-	//Therefore, OCR / OCRS = % duty cycle
-    return (double)OC1R / OC1RS;
+    return PWM_Channel_Get_DutyCycle(&PWM_Channels[OC1_CHANNEL]);
 }
 
 double PWM_Get_OC1_Frequency(void)
 {
-	//The period (in seconds) is defined as (OCRS + 1) * TCY in the data sheet
-	//therefore 1 / ((OCRS + 1) * TCY) is the frequency
-    double frequency = (double)1.0 / ((OC1RS + 1) * TCY);
-    
-    return frequency;
+    return PWM_Channel_Get_Frequency(&PWM_Channels[OC1_CHANNEL]);
 }
 
 void PWM_Update_OC1_DutyCycle(const PWM_Module* OC1_PWM_module)
 {
-	//As stated before, OCR / OCRS = % duty cycle
-	//Therefore, (duty cycle percentage) * OCRS / 100 = number of logic high cycles
-	//This is new value is stored into OCR to edit the duty cycle, OCRS does not change
-	//Because the frequency does not change
-    int logicHighClockCycles = (OC1_PWM_module->dutyCyclePercentage * OC1RS / 100) + PWM_ROUNDING_OFFSET;
-    OC1R = logicHighClockCycles;
+    PWM_Channel_Update_DutyCycle(&PWM_Channels[OC1_CHANNEL], OC1_PWM_module);
 }
 
 void PWM_Update_OC1_Frequency(const PWM_Module* OC1_PWM_module)
 {
-	//Using the 1 / ((OCRS + 1) * TCY) equation for frequency, we first solved for OCRS
-	//Then we plugged in the new frequency value to calculate the new OCRS value
-	//UpdateDutyCycle is called to recalculate OCR after the new value of OCRS is stored
-    double totalClockCycles = (double)1.0 / (OC1_PWM_module->frequency * TCY * TIMER_PRESCALER) - 1;
-    OC1RS = (int)totalClockCycles;
-    
-    OC1_PWM_module->UpdateDutyCycle(OC1_PWM_module);
+    PWM_Channel_Update_Frequency(&PWM_Channels[OC1_CHANNEL], OC1_PWM_module);
+}
+
+void PWM_OC1_Fixed_Initialize(PWM_Fixed_Module* OC1_PWM_module)
+{
+    PWM_Channel_Fixed_Initialize(&PWM_Channels[OC1_CHANNEL], OC1_PWM_module);
+}
+
+void PWM_Update_OC1_Fixed_DutyCycle(PWM_Fixed_Module* OC1_PWM_module)
+{
+    PWM_Channel_Fixed_Update_DutyCycle(&PWM_Channels[OC1_CHANNEL], OC1_PWM_module);
+}
+
+void PWM_Update_OC1_Fixed_Frequency(PWM_Fixed_Module* OC1_PWM_module)
+{
+    PWM_Channel_Fixed_Update_Frequency(&PWM_Channels[OC1_CHANNEL], OC1_PWM_module);
 }
 
+void PWM_Set_OC1_High_Ticks(PWM_Fixed_Module* OC1_PWM_module, uint16_t highTicks)
+{
+    PWM_Channel_Fixed_Set_High_Ticks(&PWM_Channels[OC1_CHANNEL], OC1_PWM_module, highTicks);
+}
 
-//See the OC1 module comments for why these commands were executed in this way
 void PWM_OC2_Initialize(PWM_Module* OC2_PWM_module)
 {
-    OC2CON1 = 0x0000;
-    
-    ANSBbits.ANSB1 = 0;
-	TRISBbits.TRISB1 = 0;
-    Nop();
-    
-    OC2_RP = OC2_Remappable_Pin_Reference;
-    
-    OC2_PWM_module->dutyCyclePercentage = 0;
-    OC2_PWM_module->frequency = 15000;
-    
-    OC2_PWM_module->UpdateFrequency(OC2_PWM_module);
-    OC2_PWM_module->UpdateDutyCycle(OC2_PWM_module);
-    
-    //turns timer1 off to configure it
-    T1CON = 0b0000000000000000;
-    //sets a 1:64 input clock prescaler, which increments the timer every
-    //8th clock cycle (from Fcy by default)
-    T1CONbits.TCKPS = 0b10;
-    //sets this timer's clock source to Fcy
-    T1CONbits.TCS = 0b0;
-    //turns timer1 back on after it is configured
-    T1CONbits.TON = 1;
-    
-    OC2CON2 = 0b00011111;
-    
-    OC2CON1bits.OCTSEL = 0b100;
-    
-    OC2CON1bits.OCM = 0b110;
+    PWM_Channel_Initialize(&PWM_Channels[OC2_CHANNEL], OC2_PWM_module);
 }
 
 double PWM_Get_OC2_DutyCycle(void)
 {
-    return (double)OC2R / OC2RS;
+    return PWM_Channel_Get_DutyCycle(&PWM_Channels[OC2_CHANNEL]);
 }
 
 double PWM_Get_OC2_Frequency(void)
-{    
-    double frequency = (double)1.0 / ((OC2RS + 1) * TCY);
-    
-    return frequency;
+{
+    return PWM_Channel_Get_Frequency(&PWM_Channels[OC2_CHANNEL]);
 }
 
 void PWM_Update_OC2_DutyCycle(const PWM_Module* OC2_PWM_module)
 {
-    int logicHighClockCycles = (OC2_PWM_module->dutyCyclePercentage * OC2RS / 100) + PWM_ROUNDING_OFFSET;
-    OC2R = logicHighClockCycles;
+    PWM_Channel_Update_DutyCycle(&PWM_Channels[OC2_CHANNEL], OC2_PWM_module);
 }
 
 void PWM_Update_OC2_Frequency(const PWM_Module* OC2_PWM_module)
-{    
-    double totalClockCycles = (double)1.0 / (OC2_PWM_module->frequency * TCY * TIMER_PRESCALER) - 1;
-    OC2RS = (int)totalClockCycles;
-    
-    OC2_PWM_module->UpdateDutyCycle(OC2_PWM_module);
+{
+    PWM_Channel_Update_Frequency(&PWM_Channels[OC2_CHANNEL], OC2_PWM_module);
+}
+
+void PWM_OC2_Fixed_Initialize(PWM_Fixed_Module* OC2_PWM_module)
+{
+    PWM_Channel_Fixed_Initialize(&PWM_Channels[OC2_CHANNEL], OC2_PWM_module);
 }
 
+void PWM_Update_OC2_Fixed_DutyCycle(PWM_Fixed_Module* OC2_PWM_module)
+{
+    PWM_Channel_Fixed_Update_DutyCycle(&PWM_Channels[OC2_CHANNEL], OC2_PWM_module);
+}
 
+void PWM_Update_OC2_Fixed_Frequency(PWM_Fixed_Module* OC2_PWM_module)
+{
+    PWM_Channel_Fixed_Update_Frequency(&PWM_Channels[OC2_CHANNEL], OC2_PWM_module);
+}
+
+void PWM_Set_OC2_High_Ticks(PWM_Fixed_Module* OC2_PWM_module, uint16_t highTicks)
+{
+    PWM_Channel_Fixed_Set_High_Ticks(&PWM_Channels[OC2_CHANNEL], OC2_PWM_module, highTicks);
+}
 
-//See the OC1 module comments for why these commands were executed in this way
 void PWM_OC3_Initialize(PWM_Module* OC3_PWM_module)
 {
-    OC3CON1 = 0x0000;
-    
-    ANSBbits.ANSB2 = 0;
-	TRISBbits.TRISB2 = 0;
-    Nop();
-    
-    OC3_RP = OC3_Remappable_Pin_Reference;
-    
-    OC3_PWM_module->dutyCyclePercentage = 0;
-    OC3_PWM_module->frequency = 15000;
-    
-    OC3_PWM_module->UpdateFrequency(OC3_PWM_module);
-    OC3_PWM_module->UpdateDutyCycle(OC3_PWM_module);
-    
-    OC3CON2 = 0b00011111;
-    
-    OC3CON1bits.OCTSEL = 0b111;
-    
-    OC3CON1bits.OCM = 0b110;
+    PWM_Channel_Initialize(&PWM_Channels[OC3_CHANNEL], OC3_PWM_module);
 }
 
 double PWM_Get_OC3_DutyCycle(void)
 {
-    return (double)OC3R / OC3RS;
+    return PWM_Channel_Get_DutyCycle(&PWM_Channels[OC3_CHANNEL]);
 }
 
 double PWM_Get_OC3_Frequency(void)
-{    
-    double frequency = (double)1.0 / ((OC3RS + 1) * TCY);
-    
-    return frequency;
+{
+    return PWM_Channel_Get_Frequency(&PWM_Channels[OC3_CHANNEL]);
 }
 
 void PWM_Update_OC3_DutyCycle(const PWM_Module* OC3_PWM_module)
 {
-    int logicHighClockCycles = (OC3_PWM_module->dutyCyclePercentage * OC3RS / 100) + PWM_ROUNDING_OFFSET;
-    OC3R = logicHighClockCycles;
+    PWM_Channel_Update_DutyCycle(&PWM_Channels[OC3_CHANNEL], OC3_PWM_module);
 }
 
 void PWM_Update_OC3_Frequency(const PWM_Module* OC3_PWM_module)
-{    
-    double totalClockCycles = (double)1.0 / (OC3_PWM_module->frequency * TCY) - 1;
-    OC3RS = (int)totalClockCycles;
-    
-    OC3_PWM_module->UpdateDutyCycle(OC3_PWM_module);
+{
+    PWM_Channel_Update_Frequency(&PWM_Channels[OC3_CHANNEL], OC3_PWM_module);
 }
 
+void PWM_OC3_Fixed_Initialize(PWM_Fixed_Module* OC3_PWM_module)
+{
+    PWM_Channel_Fixed_Initialize(&PWM_Channels[OC3_CHANNEL], OC3_PWM_module);
+}
+
+void PWM_Update_OC3_Fixed_DutyCycle(PWM_Fixed_Module* OC3_PWM_module)
+{
+    PWM_Channel_Fixed_Update_DutyCycle(&PWM_Channels[OC3_CHANNEL], OC3_PWM_module);
+}
+
+void PWM_Update_OC3_Fixed_Frequency(PWM_Fixed_Module* OC3_PWM_module)
+{
+    PWM_Channel_Fixed_Update_Frequency(&PWM_Channels[OC3_CHANNEL], OC3_PWM_module);
+}
 
+void PWM_Set_OC3_High_Ticks(PWM_Fixed_Module* OC3_PWM_module, uint16_t highTicks)
+{
+    PWM_Channel_Fixed_Set_High_Ticks(&PWM_Channels[OC3_CHANNEL], OC3_PWM_module, highTicks);
+}
 
-//See the OC1 module comments for why these commands were executed in this way
 void PWM_OC4_Initialize(PWM_Module* OC4_PWM_module)
 {
-    OC4CON1 = 0x0000;
-    
-    ANSBbits.ANSB3 = 0;
-	TRISBbits.TRISB3 = 0;
-    Nop();
-    
-    OC4_RP = OC4_Remappable_Pin_Reference;
-    
-    OC4_PWM_module->dutyCyclePercentage = 0;
-    OC4_PWM_module->frequency = 15000;
-    
-    OC4_PWM_module->UpdateFrequency(OC4_PWM_module);
-    OC4_PWM_module->UpdateDutyCycle(OC4_PWM_module);
-    
-    OC4CON2 = 0b00011111;
-    
-    OC4CON1bits.OCTSEL = 0b111;
-    
-    OC4CON1bits.OCM = 0b110;
+    PWM_Channel_Initialize(&PWM_Channels[OC4_CHANNEL], OC4_PWM_module);
 }
 
 double PWM_Get_OC4_DutyCycle(void)
 {
-    return (double)OC4R / OC4RS;
+    return PWM_Channel_Get_DutyCycle(&PWM_Channels[OC4_CHANNEL]);
 }
 
 double PWM_Get_OC4_Frequency(void)
-{    
-    double frequency = (double)1.0 / ((OC4RS + 1) * TCY);
-    
-    return frequency;
+{
+    return PWM_Channel_Get_Frequency(&PWM_Channels[OC4_CHANNEL]);
 }
 
 void PWM_Update_OC4_DutyCycle(const PWM_Module* OC4_PWM_module)
 {
-    int logicHighClockCycles = (OC4_PWM_module->dutyCyclePercentage * OC4RS / 100) + PWM_ROUNDING_OFFSET;
-    OC4R = logicHighClockCycles;
+    PWM_Channel_Update_DutyCycle(&PWM_Channels[OC4_CHANNEL], OC4_PWM_module);
 }
 
 void PWM_Update_OC4_Frequency(const PWM_Module* OC4_PWM_module)
-{    
-    double totalClockCycles = (double)1.0 / (OC4_PWM_module->frequency * TCY) - 1;
-    OC4RS = (int)totalClockCycles;
-    
-    OC4_PWM_module->UpdateDutyCycle(OC4_PWM_module);
+{
+    PWM_Channel_Update_Frequency(&PWM_Channels[OC4_CHANNEL], OC4_PWM_module);
+}
+
+void PWM_OC4_Fixed_Initialize(PWM_Fixed_Module* OC4_PWM_module)
+{
+    PWM_Channel_Fixed_Initialize(&PWM_Channels[OC4_CHANNEL], OC4_PWM_module);
+}
+
+void PWM_Update_OC4_Fixed_DutyCycle(PWM_Fixed_Module* OC4_PWM_module)
+{
+    PWM_Channel_Fixed_Update_DutyCycle(&PWM_Channels[OC4_CHANNEL], OC4_PWM_module);
 }
 
+void PWM_Update_OC4_Fixed_Frequency(PWM_Fixed_Module* OC4_PWM_module)
+{
+    PWM_Channel_Fixed_Update_Frequency(&PWM_Channels[OC4_CHANNEL], OC4_PWM_module);
+}
 
+void PWM_Set_OC4_High_Ticks(PWM_Fixed_Module* OC4_PWM_module, uint16_t highTicks)
+{
+    PWM_Channel_Fixed_Set_High_Ticks(&PWM_Channels[OC4_CHANNEL], OC4_PWM_module, highTicks);
+}
 
-//See the OC1 module comments for why these commands were executed in this way
 void PWM_OC5_Initialize(PWM_Module* OC5_PWM_module)
 {
-    OC5CON1 = 0x0000;
-    
-    ANSBbits.ANSB9 = 0;
-	TRISBbits.TRISB9 = 0;
-	Nop();
-    
-    OC5_RP = OC5_Remappable_Pin_Reference;
-    
-    OC5_PWM_module->dutyCyclePercentage = 0;
-    OC5_PWM_module->frequency = 15000;
-    
-    OC5_PWM_module->UpdateFrequency(OC5_PWM_module);
-    OC5_PWM_module->UpdateDutyCycle(OC5_PWM_module);
-    
-    OC5CON2 = 0b00011111;
-    
-    OC5CON1bits.OCTSEL = 0b111;
-    
-    OC5CON1bits.OCM = 0b110;
+    PWM_Channel_Initialize(&PWM_Channels[OC5_CHANNEL], OC5_PWM_module);
 }
 
 double PWM_Get_OC5_DutyCycle(void)
 {
-    return (double)OC5R / OC5RS;
+    return PWM_Channel_Get_DutyCycle(&PWM_Channels[OC5_CHANNEL]);
 }
 
 double PWM_Get_OC5_Frequency(void)
-{    
-    double frequency = (double)1.0 / ((OC5RS + 1) * TCY);
-    
-    return frequency;
+{
+    return PWM_Channel_Get_Frequency(&PWM_Channels[OC5_CHANNEL]);
 }
 
 void PWM_Update_OC5_DutyCycle(const PWM_Module* OC5_PWM_module)
 {
-    int logicHighClockCycles = (OC5_PWM_module->dutyCyclePercentage * OC5RS / 100) + PWM_ROUNDING_OFFSET;
-    OC5R = logicHighClockCycles;
+    PWM_Channel_Update_DutyCycle(&PWM_Channels[OC5_CHANNEL], OC5_PWM_module);
 }
 
 void PWM_Update_OC5_Frequency(const PWM_Module* OC5_PWM_module)
-{    
-    double totalClockCycles = (double)1.0 / (OC5_PWM_module->frequency * TCY) - 1;
-    OC5RS = (int)totalClockCycles;
-    
-    OC5_PWM_module->UpdateDutyCycle(OC5_PWM_module);
+{
+    PWM_Channel_Update_Frequency(&PWM_Channels[OC5_CHANNEL], OC5_PWM_module);
+}
+
+void PWM_OC5_Fixed_Initialize(PWM_Fixed_Module* OC5_PWM_module)
+{
+    PWM_Channel_Fixed_Initialize(&PWM_Channels[OC5_CHANNEL], OC5_PWM_module);
 }
 
+void PWM_Update_OC5_Fixed_DutyCycle(PWM_Fixed_Module* OC5_PWM_module)
+{
+    PWM_Channel_Fixed_Update_DutyCycle(&PWM_Channels[OC5_CHANNEL], OC5_PWM_module);
+}
 
+void PWM_Update_OC5_Fixed_Frequency(PWM_Fixed_Module* OC5_PWM_module)
+{
+    PWM_Channel_Fixed_Update_Frequency(&PWM_Channels[OC5_CHANNEL], OC5_PWM_module);
+}
+
+void PWM_Set_OC5_High_Ticks(PWM_Fixed_Module* OC5_PWM_module, uint16_t highTicks)
+{
+    PWM_Channel_Fixed_Set_High_Ticks(&PWM_Channels[OC5_CHANNEL], OC5_PWM_module, highTicks);
+}
 
-//See the OC1 module comments for why these commands were executed in this way
 void PWM_OC6_Initialize(PWM_Module* OC6_PWM_module)
 {
-    OC6CON1 = 0x0000;
+    PWM_Channel_Initialize(&PWM_Channels[OC6_CHANNEL], OC6_PWM_module);
+}
+
+double PWM_Get_OC6_DutyCycle(void)
+{
+    return PWM_Channel_Get_DutyCycle(&PWM_Channels[OC6_CHANNEL]);
+}
+
+double PWM_Get_OC6_Frequency(void)
+{
+    return PWM_Channel_Get_Frequency(&PWM_Channels[OC6_CHANNEL]);
+}
+
+void PWM_Update_OC6_DutyCycle(const PWM_Module* OC6_PWM_module)
+{
+    PWM_Channel_Update_DutyCycle(&PWM_Channels[OC6_CHANNEL], OC6_PWM_module);
+}
+
+void PWM_Update_OC6_Frequency(const PWM_Module* OC6_PWM_module)
+{
+    PWM_Channel_Update_Frequency(&PWM_Channels[OC6_CHANNEL], OC6_PWM_module);
+}
+
+void PWM_OC6_Fixed_Initialize(PWM_Fixed_Module* OC6_PWM_module)
+{
+    PWM_Channel_Fixed_Initialize(&PWM_Channels[OC6_CHANNEL], OC6_PWM_module);
+}
+
+void PWM_Update_OC6_Fixed_DutyCycle(PWM_Fixed_Module* OC6_PWM_module)
+{
+    PWM_Channel_Fixed_Update_DutyCycle(&PWM_Channels[OC6_CHANNEL], OC6_PWM_module);
+}
+
+void PWM_Update_OC6_Fixed_Frequency(PWM_Fixed_Module* OC6_PWM_module)
+{
+    PWM_Channel_Fixed_Update_Frequency(&PWM_Channels[OC6_CHANNEL], OC6_PWM_module);
+}
+
+void PWM_Set_OC6_High_Ticks(PWM_Fixed_Module* OC6_PWM_module, uint16_t highTicks)
+{
+    PWM_Channel_Fixed_Set_High_Ticks(&PWM_Channels[OC6_CHANNEL], OC6_PWM_module, highTicks);
+}
+
+
+//PWM_Output
+
+void PWM_Output_Initialize(PWM_Output* output, unsigned int moduleNumber, uint16_t frequency)
+{
+    const PWM_Channel* channel = &PWM_Channels[moduleNumber - 1];
+
+    PWM_Channel_Prepare(channel);
+
+    output->channel = moduleNumber - 1;
+    output->dutyCycle = 0;
+    output->periodTicks = PWM_Channel_Set_Period(channel, frequency);
+    *channel->dutyCycleRegister = 0;
+
+    PWM_Channel_Start(channel);
+}
+
+void PWM_Output_Set_DutyCycle(PWM_Output* output, Q15 dutyCycle)
+{
+    output->dutyCycle = dutyCycle;
+    *PWM_Channels[output->channel].dutyCycleRegister = PWM_Fixed_High_Ticks(output->periodTicks, dutyCycle);
+}
+
+void PWM_Output_Set_Frequency(PWM_Output* output, uint16_t frequency)
+{
+    const PWM_Channel* channel = &PWM_Channels[output->channel];
+
+    output->periodTicks = PWM_Channel_Set_Period(channel, frequency);
+    *channel->dutyCycleRegister = PWM_Fixed_High_Ticks(output->periodTicks, output->dutyCycle);
+}
+
+void PWM_Output_Set_High_Ticks(PWM_Output* output, uint16_t highTicks)
+{
+    PWM_Channel_Set_High_Ticks(&PWM_Channels[output->channel], output->periodTicks, highTicks);
+}
+
+//Clocks
+
+//moves a running module onto another clock (the module is turned off while OCTSEL changes)
+static const Timebase* PWM_Channel_Set_Clock(const PWM_Channel* channel, const Timebase* timebase)
+{
+    channel->control1->OCM = 0b000;
+    channel->control1->OCTSEL = timebase->outputCompareClockSetting;
+    PWM_Timebases[channel->moduleNumber - 1] = timebase;
+
+    return timebase;
+}
+
+uint32_t PWM_Fixed_Request_Clock(PWM_Fixed_Module* module, uint16_t lowestFrequency)
+{
+    const PWM_Channel* channel = &PWM_Channels[module->moduleNumber - 1];
+    const Timebase* timebase = PWM_Channel_Set_Clock(channel, Timebase_Request_For_Frequency(lowestFrequency));
+
+    //the period and high time are worked out again in ticks of the new clock
+    module->UpdateFrequency(module);
+
+    channel->control1->OCM = PWM_EDGE_ALIGNED_MODE;
+
+    return timebase->ticksPerSecond;
+}
+
+
+//PWM_Servo
+
+//Fcy in MHz (ClockConfiguration.h makes sure it is a whole number of MHz)
+#define PWM_FCY_TICKS_PER_MICROSECOND CLOCK_FCY_TICKS_PER_MICROSECOND
+
+void PWM_Servo_Initialize(PWM_Servo* servo)
+{
+    PWM_Fixed_Module* module = servo->output;
+    const PWM_Channel* channel = &PWM_Channels[module->moduleNumber - 1];
+    //the clock with the most ticks in one frame that still fits a frame in 16 bits
+    //(every servo with the same frame rate shares the same timer)
+    const Timebase* timebase = PWM_Channel_Set_Clock(channel, Timebase_Request_For_Frequency(servo->frameRate));
+    uint32_t periodTicks = timebase->ticksPerSecond / servo->frameRate;
+
+    if (periodTicks > 65535)
+    {
+        periodTicks = 65535;
+    }
+    servo->clockShift = timebase->prescalerShift;
+
+    module->frequency = servo->frameRate;
+    module->periodTicks = periodTicks;
+    *channel->periodRegister = periodTicks - 1;
+    module->UpdateDutyCycle(module);
+
+    channel->control1->OCM = PWM_EDGE_ALIGNED_MODE;
+}
+
+uint16_t PWM_Servo_Microseconds_To_Ticks(const PWM_Servo* servo, uint16_t microseconds)
+{
+    //rounded to the nearest tick
+    uint32_t ticks = ((uint32_t)microseconds * PWM_FCY_TICKS_PER_MICROSECOND + ((1UL << servo->clockShift) >> 1)) >> servo->clockShift;
+
+    if (ticks > servo->output->periodTicks)
+    {
+        ticks = servo->output->periodTicks;
+    }
+
+    return (uint16_t)ticks;
+}
+
+void PWM_Servo_Set_Pulse_Width(PWM_Servo* servo, uint16_t microseconds)
+{
+    servo->output->SetHighTicks(servo->output, PWM_Servo_Microseconds_To_Ticks(servo, microseconds));
+}
+
+
+//PWM_Group
+
+//the master's interrupt is above every other interrupt in the project (the IC modules,
+//timer2 and UART1 at 1, timer3 at 2), since it has to write the new OCxR values before
+//the shortest of them has passed, about 60 instruction cycles into the period (see
+//PWM_Group in PWM.h)
+#define PWM_GROUP_INTERRUPT_PRIORITY 5
+
+//the group whose master is each OC module (NULL for none)
+static PWM_Group* volatile PWM_Group_Masters[PWM_GROUP_MAX_MODULES];
+
+void PWM_Group_Initialize(PWM_Group* group)
+{
+    unsigned int masterNumber = group->modules[0]->moduleNumber;
+    const PWM_Channel* master = &PWM_Channels[masterNumber - 1];
+    unsigned int i;
+    
+    //the interrupt stays off while the group is set up
+    *master->interruptEnable &= ~master->interruptMask;
+    
+    for (i = 0; i < group->numberOfModules; ++i)
+    {
+        PWM_Fixed_Module* module = group->modules[i];
+        const PWM_Channel* channel = &PWM_Channels[module->moduleNumber - 1];
+        
+        group->dutyCycleRegisters[i] = channel->dutyCycleRegister;
+        group->stagedHighTicks[i] = module->highTicks;
+        group->pendingHighTicks[i] = module->highTicks;
+        
+        if (i > 0)
+        {
+            //the module is turned off while its sync source is changed, and then starts
+            //each of its periods along with the master's, counted by the master's clock
+            channel->control1->OCM = 0b000;
+            channel->control1->OCTSEL = master->control1->OCTSEL;
+            PWM_Timebases[module->moduleNumber - 1] = PWM_Timebases[masterNumber - 1];
+            channel->control2->SYNCSEL = masterNumber;
+            channel->control1->OCM = PWM_EDGE_ALIGNED_MODE;
+            
+            module->frequency = group->modules[0]->frequency;
+            module->periodTicks = group->modules[0]->periodTicks;
+        }
+    }
+    
+    group->commitPending = false;
+    group->commitsApplied = 0;
+    PWM_Group_Masters[masterNumber - 1] = group;
+    
+    *master->interruptPriority = (*master->interruptPriority & ~(0x7 << master->interruptPriorityShift)) | (PWM_GROUP_INTERRUPT_PRIORITY << master->interruptPriorityShift);
+    *master->interruptFlag &= ~master->interruptMask;
+    *master->interruptEnable |= master->interruptMask;
+}
+
+void PWM_Group_Stage_DutyCycle(PWM_Group* group, unsigned int index, Q15 dutyCycle)
+{
+    PWM_Fixed_Module* module = group->modules[index];
     
-	TRISBbits.TRISB10 = 0;
-    Nop();
+    //every module in the group has the master's period
+    module->dutyCycle = dutyCycle;
+    module->highTicks = PWM_Fixed_High_Ticks(group->modules[0]->periodTicks, dutyCycle);
+    group->stagedHighTicks[index] = module->highTicks;
+}
+
+void PWM_Group_Stage_High_Ticks(PWM_Group* group, unsigned int index, uint16_t highTicks)
+{
+    PWM_Fixed_Module* module = group->modules[index];
+    uint16_t periodTicks = group->modules[0]->periodTicks;
+
+    //like SetHighTicks, dutyCycle is left alone
+    module->highTicks = (highTicks > periodTicks) ? periodTicks : highTicks;
+    group->stagedHighTicks[index] = module->highTicks;
+}
+
+void PWM_Group_Commit(PWM_Group* group)
+{
+    unsigned int i;
+    
+    //the interrupt leaves pendingHighTicks alone until commitPending is set again, so it
+    //can never write a mix of the old and new values
+    group->commitPending = false;
     
-    OC6_RP = OC6_Remappable_Pin_Reference;
+    for (i = 0; i < group->numberOfModules; ++i)
+    {
+        group->pendingHighTicks[i] = group->stagedHighTicks[i];
+    }
     
-    OC6_PWM_module->dutyCyclePercentage = 0;
-    OC6_PWM_module->frequency = 15000;
+    group->commitPending = true;
+}
+
+//runs at the start of every one of the master's periods, while every module's timer
+//has just restarted, so each new OCxR is matched in the period it was written in
+//(inlined into each interrupt with its own constant module number, like the OCx functions)
+static inline __attribute__((always_inline)) void PWM_Group_Handle_Period(unsigned int moduleNumber)
+{
+    const PWM_Channel* channel = &PWM_Channels[moduleNumber - 1];
+    PWM_Group* group = PWM_Group_Masters[moduleNumber - 1];
+    unsigned int i;
     
-    OC6_PWM_module->UpdateFrequency(OC6_PWM_module);
-    OC6_PWM_module->UpdateDutyCycle(OC6_PWM_module);
+    *channel->interruptFlag &= ~channel->interruptMask;
     
-    OC6CON2 = 0b00011111;
+    if (group == NULL || !group->commitPending)
+    {
+        return;
+    }
     
-    OC6CON1bits.OCTSEL = 0b111;
+    for (i = 0; i < group->numberOfModules; ++i)
+    {
+        *group->dutyCycleRegisters[i] = group->pendingHighTicks[i];
+    }
     
-    OC6CON1bits.OCM = 0b110;
+    group->commitPending = false;
+    ++group->commitsApplied;
 }
 
-double PWM_Get_OC6_DutyCycle(void)
+//The interrupts must be named OCxInterrupt so that they can be
+//recognized as the interrupt for OC module #x (they are only turned on for a group's master)
+void __attribute__ ((__interrupt__, auto_psv)) _OC1Interrupt(void)
 {
-    return (double)OC6R / OC6RS;
+    PROFILER_BEGIN(PROFILER_SITE_OC_INTERRUPT);
+    PWM_Group_Handle_Period(1);
+    PROFILER_END(PROFILER_SITE_OC_INTERRUPT);
 }
 
-double PWM_Get_OC6_Frequency(void)
-{    
-    double frequency = (double)1.0 / ((OC6RS + 1) * TCY);
-    
-    return frequency;
+void __attribute__ ((__interrupt__, auto_psv)) _OC2Interrupt(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_OC_INTERRUPT);
+    PWM_Group_Handle_Period(2);
+    PROFILER_END(PROFILER_SITE_OC_INTERRUPT);
 }
 
-void PWM_Update_OC6_DutyCycle(const PWM_Module* OC6_PWM_module)
+void __attribute__ ((__interrupt__, auto_psv)) _OC3Interrupt(void)
 {
-    int logicHighClockCycles = (OC6_PWM_module->dutyCyclePercentage * OC6RS / 100) + PWM_ROUNDING_OFFSET;
-    OC6R = logicHighClockCycles;
+    PROFILER_BEGIN(PROFILER_SITE_OC_INTERRUPT);
+    PWM_Group_Handle_Period(3);
+    PROFILER_END(PROFILER_SITE_OC_INTERRUPT);
 }
 
-void PWM_Update_OC6_Frequency(const PWM_Module* OC6_PWM_module)
-{    
-    double totalClockCycles = (double)1.0 / (OC6_PWM_module->frequency * TCY) - 1;
-    OC6RS = (int)totalClockCycles;
-    
-    OC6_PWM_module->UpdateDutyCycle(OC6_PWM_module);
-}
\ No newline at end of file
+void __attribute__ ((__interrupt__, auto_psv)) _OC4Interrupt(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_OC_INTERRUPT);
+    PWM_Group_Handle_Period(4);
+    PROFILER_END(PROFILER_SITE_OC_INTERRUPT);
+}
+
+void __attribute__ ((__interrupt__, auto_psv)) _OC5Interrupt(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_OC_INTERRUPT);
+    PWM_Group_Handle_Period(5);
+    PROFILER_END(PROFILER_SITE_OC_INTERRUPT);
+}
+
+void __attribute__ ((__interrupt__, auto_psv)) _OC6Interrupt(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_OC_INTERRUPT);
+    PWM_Group_Handle_Period(6);
+    PROFILER_END(PROFILER_SITE_OC_INTERRUPT);
+}
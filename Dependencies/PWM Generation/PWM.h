@@ -7,7 +7,13 @@
 // more than once.  
 #pragma once
 
+#include "FixedPoint.h"
+
 typedef struct PWM_Module PWM_Module;
+typedef struct PWM_Fixed_Module PWM_Fixed_Module;
+typedef struct PWM_Group PWM_Group;
+typedef struct PWM_Output PWM_Output;
+typedef struct PWM_Servo PWM_Servo;
 
 struct PWM_Module
 {
@@ -25,6 +31,129 @@ struct PWM_Module
     void (*UpdateFrequency)(const struct PWM_Module*);
 };
 
+//The same PWM output as PWM_Module, using only integer math (see FixedPoint.h).
+//UpdateFrequency works out the length of the period once, and UpdateDutyCycle and
+//SetHighTicks reuse it, so changing the duty cycle is a multiply and a shift instead
+//of a floating point multiply and divide.
+//OC1 and OC2 count the ticks of a shared 62.5kHz timer (the same one as the IC modules, see
+//Timebase.h), so their frequency can be 1Hz - 31.25kHz.
+//OC3 - OC6 count Fcy ticks (4MHz, or 16MHz with CLOCK_PROFILE_FRC_PLL_32MHZ), so their
+//frequency can be 62Hz (245Hz at 16MHz) - 65.535kHz.
+//Frequencies outside of these ranges are limited to them.  PWM_Fixed_Request_Clock moves a
+//module onto the finest clock for the frequencies it will actually run at.
+struct PWM_Fixed_Module
+{
+    //the duty cycle as a Q15 fraction, where 32768 is 100%
+    //e.g. a 12.5% duty cycle is 4096
+    Q15 dutyCycle;
+    //in Hertz
+    uint16_t frequency;
+    
+    //the length of one period (OCxRS + 1) and of the high part of it (OCxR) in ticks
+    //of the module's clock, kept here so they never have to be read back and divided
+    //out (READ-ONLY)
+    uint16_t periodTicks;
+    uint16_t highTicks;
+    //the OC module's number (1 - 6), set by Initialize (READ-ONLY)
+    unsigned int moduleNumber;
+    
+    void (*Initialize)(struct PWM_Fixed_Module*);
+    
+    //sets OCxR from dutyCycle
+    void (*UpdateDutyCycle)(struct PWM_Fixed_Module*);
+    //sets OCxRS from frequency, then OCxR from dutyCycle
+    void (*UpdateFrequency)(struct PWM_Fixed_Module*);
+    //sets OCxR to a number of ticks (limited to periodTicks), for code that already works
+    //in ticks.  dutyCycle is left alone, so the next UpdateDutyCycle or UpdateFrequency
+    //goes back to it.
+    void (*SetHighTicks)(struct PWM_Fixed_Module*, uint16_t);
+};
+
+//A PWM_Module or PWM_Fixed_Module already wired to OC module n (1 - 6), e.g.
+//    PWM_Module left_motor = PWM_MODULE(1);
+//instead of setting each of its functions by hand
+#define PWM_MODULE(n) { .Initialize = PWM_OC##n##_Initialize, .GetDutyCycle = PWM_Get_OC##n##_DutyCycle, .UpdateDutyCycle = PWM_Update_OC##n##_DutyCycle, .GetFrequency = PWM_Get_OC##n##_Frequency, .UpdateFrequency = PWM_Update_OC##n##_Frequency }
+#define PWM_FIXED_MODULE(n) { .Initialize = PWM_OC##n##_Fixed_Initialize, .UpdateDutyCycle = PWM_Update_OC##n##_Fixed_DutyCycle, .UpdateFrequency = PWM_Update_OC##n##_Fixed_Frequency, .SetHighTicks = PWM_Set_OC##n##_High_Ticks }
+
+//A compact handle for one OC module's PWM output, with the same integer math as
+//PWM_Fixed_Module but no function pointers:  6 bytes on the PIC, compared to 16 for a
+//PWM_Module and 18 for a PWM_Fixed_Module.  The module is picked by number when it is
+//initialized, so one set of functions drives all six.  Each PWM_Output function looks its
+//module up in a table, so the OCx functions above (which are the same code with the
+//module already known) are still a few instruction cycles faster.
+struct PWM_Output
+{
+    //0 - 5 for OC1 - OC6 (READ-ONLY)
+    uint8_t channel;
+    //the length of one period in ticks of the module's clock (READ-ONLY)
+    uint16_t periodTicks;
+    //the last duty cycle set, kept so that changing the frequency keeps it (READ-ONLY)
+    Q15 dutyCycle;
+};
+
+//Drives a hobby servo (or an ESC) with its pulse width in microseconds.  PWM_Servo_Initialize
+//moves the module onto whichever clock gives the most ticks in one frame while still
+//fitting in 16 bits:  Fcy itself, or a shared timer at 1:8, 1:64 or 1:256 from the Timebase
+//dependency.  Compared to the 62.5kHz clock OC1 and OC2 start on, that is:
+//    Fcy     frameRate   clock          ticks per frame   microseconds per tick
+//    4MHz    50Hz        Fcy / 8        10000             2       (8x finer than timer1)
+//            200Hz       Fcy            20000             0.25    (64x)
+//            333Hz       Fcy            12012             0.25    (64x)
+//    16MHz   50Hz        Fcy / 8        40000             0.5     (32x)
+//            200Hz       Fcy / 8        10000             0.5     (32x)
+//            333Hz       Fcy            48048             0.0625  (256x)
+//Servos with the same frame rate share one timer.  If every shared timer is already taken
+//by other rates, a servo gets the next slower clock that fits (see Timebase.h).
+//The module keeps working as a PWM_Fixed_Module (dutyCycle, SetHighTicks and PWM_Group all
+//use the new periodTicks, and UpdateFrequency keeps the servo's clock).
+struct PWM_Servo
+{
+    //These have to be set before PWM_Servo_Initialize is called
+    //an already initialized PWM_Fixed_Module
+    PWM_Fixed_Module* output;
+    //frames per second (e.g. 50 for analog servos, 200 or 333 for digital ones)
+    uint16_t frameRate;
+
+    //the module's clock is Fcy / 2^clockShift (READ-ONLY)
+    unsigned int clockShift;
+};
+
+//the most PWM_Fixed_Modules a PWM_Group can hold
+#define PWM_GROUP_MAX_MODULES 6
+
+//Changes the duty cycles of several PWM_Fixed_Modules together, on the same period
+//boundary.  The first module is the master:  every other module is synchronized to it
+//(OCxCON2 SYNCSEL), so they all start their periods together, and new duty cycles are
+//staged, committed, and then written by the master's OC interrupt at the start of its
+//next period.  Because OCxR is only ever written right as a period starts, a change can
+//never cut a pulse short or stretch it into the next period (which a write in the middle
+//of a period can), and a group of one module is a glitch-free way to drive a servo.
+//Every module is moved onto the master's clock, and the master's frequency is the
+//frequency of the whole group.
+//The master's interrupt has to write the new OCxR values before the shortest of them has
+//passed, about 60 instruction cycles into the period, so a group should not be given a
+//high time under 1 tick on the 62.5kHz clock (OC1/OC2), 8 ticks on a PWM_Servo's Fcy / 8
+//clock, or ~60 ticks on Fcy (OC3 - OC6).
+struct PWM_Group
+{
+    //These have to be set before PWM_Group_Initialize is called
+    //each one already initialized, with the master's frequency set
+    PWM_Fixed_Module* modules[PWM_GROUP_MAX_MODULES];
+    unsigned int numberOfModules;
+    
+    //the number of commits the interrupt has written to the OC modules (READ-ONLY)
+    volatile unsigned int commitsApplied;
+    
+    //only used by the functions below
+    //stagedHighTicks is only touched by the main code, pendingHighTicks is handed to
+    //the interrupt once commitPending is set
+    uint16_t stagedHighTicks[PWM_GROUP_MAX_MODULES];
+    volatile uint16_t pendingHighTicks[PWM_GROUP_MAX_MODULES];
+    volatile int commitPending;
+    //each module's OCxR, so the interrupt does not have to look them up
+    volatile uint16_t* dutyCycleRegisters[PWM_GROUP_MAX_MODULES];
+};
+
 //Functions to generate a PWM signal using the OC1 module and the RP0 pin
 void PWM_OC1_Initialize(PWM_Module* OC1_PWM_module);
 //returns OCR / OCRS for the motor's PWM module, representing the duty cycle %
@@ -68,8 +197,78 @@ void PWM_Update_OC5_DutyCycle(const PWM_Module* OC5_PWM_module);
 void PWM_Update_OC5_Frequency(const PWM_Module* OC5_PWM_module);
 
 //Functions to generate a PWM signal using the OC6 module and the RP10 pin
-void PWM_OC4_Initialize(PWM_Module* OC6_PWM_module);
+void PWM_OC6_Initialize(PWM_Module* OC6_PWM_module);
 double PWM_Get_OC6_DutyCycle(void);
 double PWM_Get_OC6_Frequency(void);
 void PWM_Update_OC6_DutyCycle(const PWM_Module* OC6_PWM_module);
-void PWM_Update_OC6_Frequency(const PWM_Module* OC6_PWM_module);
\ No newline at end of file
+void PWM_Update_OC6_Frequency(const PWM_Module* OC6_PWM_module);
+
+//Integer versions of the functions above, for PWM_Fixed_Module (each OC module can be used
+//as a PWM_Module or a PWM_Fixed_Module, but not both)
+void PWM_OC1_Fixed_Initialize(PWM_Fixed_Module* OC1_PWM_module);
+void PWM_Update_OC1_Fixed_DutyCycle(PWM_Fixed_Module* OC1_PWM_module);
+void PWM_Update_OC1_Fixed_Frequency(PWM_Fixed_Module* OC1_PWM_module);
+void PWM_Set_OC1_High_Ticks(PWM_Fixed_Module* OC1_PWM_module, uint16_t highTicks);
+
+void PWM_OC2_Fixed_Initialize(PWM_Fixed_Module* OC2_PWM_module);
+void PWM_Update_OC2_Fixed_DutyCycle(PWM_Fixed_Module* OC2_PWM_module);
+void PWM_Update_OC2_Fixed_Frequency(PWM_Fixed_Module* OC2_PWM_module);
+void PWM_Set_OC2_High_Ticks(PWM_Fixed_Module* OC2_PWM_module, uint16_t highTicks);
+
+void PWM_OC3_Fixed_Initialize(PWM_Fixed_Module* OC3_PWM_module);
+void PWM_Update_OC3_Fixed_DutyCycle(PWM_Fixed_Module* OC3_PWM_module);
+void PWM_Update_OC3_Fixed_Frequency(PWM_Fixed_Module* OC3_PWM_module);
+void PWM_Set_OC3_High_Ticks(PWM_Fixed_Module* OC3_PWM_module, uint16_t highTicks);
+
+void PWM_OC4_Fixed_Initialize(PWM_Fixed_Module* OC4_PWM_module);
+void PWM_Update_OC4_Fixed_DutyCycle(PWM_Fixed_Module* OC4_PWM_module);
+void PWM_Update_OC4_Fixed_Frequency(PWM_Fixed_Module* OC4_PWM_module);
+void PWM_Set_OC4_High_Ticks(PWM_Fixed_Module* OC4_PWM_module, uint16_t highTicks);
+
+void PWM_OC5_Fixed_Initialize(PWM_Fixed_Module* OC5_PWM_module);
+void PWM_Update_OC5_Fixed_DutyCycle(PWM_Fixed_Module* OC5_PWM_module);
+void PWM_Update_OC5_Fixed_Frequency(PWM_Fixed_Module* OC5_PWM_module);
+void PWM_Set_OC5_High_Ticks(PWM_Fixed_Module* OC5_PWM_module, uint16_t highTicks);
+
+void PWM_OC6_Fixed_Initialize(PWM_Fixed_Module* OC6_PWM_module);
+void PWM_Update_OC6_Fixed_DutyCycle(PWM_Fixed_Module* OC6_PWM_module);
+void PWM_Update_OC6_Fixed_Frequency(PWM_Fixed_Module* OC6_PWM_module);
+void PWM_Set_OC6_High_Ticks(PWM_Fixed_Module* OC6_PWM_module, uint16_t highTicks);
+
+//Functions to drive any OC module through a PWM_Output
+//sets up OC module moduleNumber (1 - 6) with a 0% duty cycle at the given frequency
+//(the same frequency limits as PWM_Fixed_Module)
+void PWM_Output_Initialize(PWM_Output* output, unsigned int moduleNumber, uint16_t frequency);
+void PWM_Output_Set_DutyCycle(PWM_Output* output, Q15 dutyCycle);
+void PWM_Output_Set_Frequency(PWM_Output* output, uint16_t frequency);
+//sets OCxR to a number of ticks (limited to periodTicks), dutyCycle is left alone
+void PWM_Output_Set_High_Ticks(PWM_Output* output, uint16_t highTicks);
+
+//moves an initialized module onto the clock with the most ticks in one period of
+//lowestFrequency that still fits it in 16 bits (Fcy, or Fcy / 8, / 64 or / 256 on a shared
+//timer), and works out its period and high time again at its current frequency
+//The module's frequency can then be lowestFrequency - (the clock's rate / 2), and its
+//duty cycle has that many times finer steps.  Returns the clock's rate in ticks per second.
+//(e.g. a 400Hz step signal on OC2 goes from 156 ticks per period to 10000 at Fcy = 4MHz)
+uint32_t PWM_Fixed_Request_Clock(PWM_Fixed_Module* module, uint16_t lowestFrequency);
+
+//Functions to drive a servo with its pulse width in microseconds (see PWM_Servo)
+//picks the module's clock and sets its period to one frame, keeping its dutyCycle
+void PWM_Servo_Initialize(PWM_Servo* servo);
+//returns the number of ticks in a pulse of the given width, rounded to the nearest tick
+//and limited to one frame (e.g. for PWM_Group_Stage_High_Ticks)
+uint16_t PWM_Servo_Microseconds_To_Ticks(const PWM_Servo* servo, uint16_t microseconds);
+//sets the pulse width right away (through the module's SetHighTicks)
+void PWM_Servo_Set_Pulse_Width(PWM_Servo* servo, uint16_t microseconds);
+
+//Functions to change several PWM_Fixed_Modules' duty cycles together (see PWM_Group)
+//synchronizes the modules to the first one and turns on its OC interrupt
+//(only one group can use each module as its master)
+void PWM_Group_Initialize(PWM_Group* group);
+//sets the duty cycle of modules[index] for the next commit (nothing changes until then)
+void PWM_Group_Stage_DutyCycle(PWM_Group* group, unsigned int index, Q15 dutyCycle);
+//the same, with the high time in ticks (limited to the master's period)
+void PWM_Group_Stage_High_Ticks(PWM_Group* group, unsigned int index, uint16_t highTicks);
+//hands every staged duty cycle to the master's interrupt, which writes them all at the
+//start of the next period (if this is called again before then, the newer values are used)
+void PWM_Group_Commit(PWM_Group* group);
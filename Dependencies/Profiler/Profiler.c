@@ -0,0 +1,138 @@
+/*
+ * File:    Profiler.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+#include "Timebase.h"
+#include "Profiler.h"
+
+#ifdef PROFILER_ENABLED
+
+#define true 1
+#define false 0
+
+//timer5 counts Fcy and rolls over every 65536 cycles
+#define PROFILER_TIMER 5
+#define PROFILER_TIMER_TICKS 65536UL
+
+volatile Profiler_Site Profiler_Sites[PROFILER_NUMBER_OF_SITES];
+
+static const char* const Profiler_Site_Names[PROFILER_NUMBER_OF_SITES] =
+{
+    "IC1_Interrupt",
+    "IC2_Interrupt",
+    "IC3_Interrupt",
+    "IC4_Interrupt",
+    "IC5_Interrupt",
+    "IC6_Interrupt",
+    "OC_Interrupt",
+    "Scheduler_Tick",
+    "IC_Update",
+    "Kill_Switch",
+    "Steering_Mapping",
+    "Stepper_Loop",
+};
+
+int Profiler_Initialize(void)
+{
+    if (Timebase_Request_Dedicated(PROFILER_TIMER, CLOCK_FCY, PROFILER_TIMER_TICKS) == 0)
+    {
+        return false;
+    }
+
+    Profiler_Reset();
+    return true;
+}
+
+void Profiler_Reset(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < PROFILER_NUMBER_OF_SITES; ++i)
+    {
+        volatile Profiler_Site* site = &Profiler_Sites[i];
+
+        ++site->sequence;
+        site->count = 0;
+        site->totalCycles = 0;
+        site->minimumCycles = 0xFFFF;
+        site->maximumCycles = 0;
+        ++site->sequence;
+    }
+}
+
+void Profiler_Read(unsigned int site, Profiler_Site* copy)
+{
+    volatile Profiler_Site* source = &Profiler_Sites[site];
+    uint16_t sequence;
+
+    //reads it again if an interrupt recorded the site in the middle
+    do
+    {
+        sequence = source->sequence;
+        copy->count = source->count;
+        copy->totalCycles = source->totalCycles;
+        copy->minimumCycles = source->minimumCycles;
+        copy->maximumCycles = source->maximumCycles;
+    } while ((sequence & 1) || sequence != source->sequence);
+
+    copy->sequence = sequence;
+}
+
+static void Profiler_Put_String(const char* string, void (*Put)(char))
+{
+    while (*string != '\0')
+    {
+        Put(*string++);
+    }
+}
+
+static void Profiler_Put_Number(uint32_t value, void (*Put)(char))
+{
+    char digits[10];
+    unsigned int length = 0;
+
+    do
+    {
+        digits[length++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (length > 0)
+    {
+        Put(digits[--length]);
+    }
+}
+
+void Profiler_Dump(void (*Put)(char))
+{
+    unsigned int i;
+
+    Profiler_Put_String("site,count,minimum_cycles,maximum_cycles,average_cycles,total_cycles\n", Put);
+
+    for (i = 0; i < PROFILER_NUMBER_OF_SITES; ++i)
+    {
+        Profiler_Site site;
+
+        Profiler_Read(i, &site);
+
+        Profiler_Put_String(Profiler_Site_Names[i], Put);
+        Put(',');
+        Profiler_Put_Number(site.count, Put);
+        Put(',');
+        Profiler_Put_Number(site.count ? site.minimumCycles : 0, Put);
+        Put(',');
+        Profiler_Put_Number(site.maximumCycles, Put);
+        Put(',');
+        Profiler_Put_Number(site.count ? (site.totalCycles + site.count / 2) / site.count : 0, Put);
+        Put(',');
+        Profiler_Put_Number(site.totalCycles, Put);
+        Put('\n');
+    }
+
+    Put('\n');
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * File:    Profiler.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//Counts how many instruction cycles the firmware spends in each of its interrupts and in
+//each stage of main_driver.c's control loop while it is really running, to find out where
+//the PIC's time goes in flight.  Every site keeps its count and its minimum, maximum and
+//total cycles in Profiler_Sites, which Profiler_Dump writes out as CSV (main_driver.c sends
+//it over the Serial Port dependency whenever a 'p' is received).
+//
+//The profiler is only compiled in when PROFILER_ENABLED is defined (e.g. -DPROFILER_ENABLED
+//in the project's compiler options).  Otherwise PROFILER_BEGIN and PROFILER_END are empty,
+//and there is no table, no timer and nothing in Profiler.c, so the firmware is exactly
+//what it was without them.
+//
+//Sites are timed with timer5, free running at Fcy (the Benchmark dependency uses it the
+//same way, so the two can be used together).  A site has to take less than 65536 cycles
+//(16ms at 4MHz), and its time includes any interrupts that ran in the middle of it.  An
+//interrupt's time starts after the PIC has saved its registers, so each one really takes
+//about 10 cycles more than it shows.
+
+//The sites.  A new one needs a number here (with PROFILER_NUMBER_OF_SITES moved up) and a
+//name in Profiler_Site_Names (Profiler.c).
+//the interrupts
+#define PROFILER_SITE_IC1_INTERRUPT 0
+#define PROFILER_SITE_IC2_INTERRUPT 1
+#define PROFILER_SITE_IC3_INTERRUPT 2
+#define PROFILER_SITE_IC4_INTERRUPT 3
+#define PROFILER_SITE_IC5_INTERRUPT 4
+#define PROFILER_SITE_IC6_INTERRUPT 5
+//every OC module's interrupt (only PWM_Group turns them on)
+#define PROFILER_SITE_OC_INTERRUPT 6
+//the scheduler's timer2 tick
+#define PROFILER_SITE_SCHEDULER_TICK 7
+//main_driver.c's stages:  reading the receiver's IC modules, the kill switch's relays,
+//turning the steering input into the stepper motor's target, and moving the stepper motor
+#define PROFILER_SITE_IC_UPDATE 8
+#define PROFILER_SITE_KILL_SWITCH 9
+#define PROFILER_SITE_STEERING_MAPPING 10
+#define PROFILER_SITE_STEPPER_LOOP 11
+#define PROFILER_NUMBER_OF_SITES 12
+
+#ifdef PROFILER_ENABLED
+
+typedef struct Profiler_Site Profiler_Site;
+
+struct Profiler_Site
+{
+    //odd while the site is being recorded (see Profiler_Read)
+    uint16_t sequence;
+    uint32_t count;
+    uint32_t totalCycles;
+    //0xFFFF until the site has run
+    uint16_t minimumCycles;
+    uint16_t maximumCycles;
+};
+
+//READ-ONLY, use Profiler_Read to get a site that is updated by an interrupt
+extern volatile Profiler_Site Profiler_Sites[PROFILER_NUMBER_OF_SITES];
+
+//timer5 always belongs to the profiler (see Profiler_Initialize), so it is read directly
+//instead of through its Timebase, which saves a few cycles at every site
+#define PROFILER_NOW() TMR5
+
+//put PROFILER_BEGIN(site); where a site starts and PROFILER_END(site); where it ends, in the
+//same block (BEGIN declares the variable that END uses, so a site cannot be started twice
+//in one block)
+#define PROFILER_BEGIN(site) uint16_t Profiler_Start_##site = PROFILER_NOW()
+#define PROFILER_END(site) Profiler_Record(&Profiler_Sites[site], (uint16_t)(PROFILER_NOW() - Profiler_Start_##site))
+
+static inline __attribute__((always_inline)) void Profiler_Record(volatile Profiler_Site* site, uint16_t cycles)
+{
+    ++site->sequence;
+
+    ++site->count;
+    site->totalCycles += cycles;
+    if (cycles < site->minimumCycles)
+    {
+        site->minimumCycles = cycles;
+    }
+    if (cycles > site->maximumCycles)
+    {
+        site->maximumCycles = cycles;
+    }
+
+    ++site->sequence;
+}
+
+//starts timer5 for the profiler and clears every site
+//returns 0 if timer5 is already in use
+int Profiler_Initialize(void);
+
+//clears every site (a site that is recorded by an interrupt in the middle of this may keep
+//that one run)
+void Profiler_Reset(void);
+
+//copies a site, all from the same moment (an interrupt can record a site while it is read)
+void Profiler_Read(unsigned int site, Profiler_Site* copy);
+
+//writes every site one character at a time through Put, as CSV:
+//    site,count,minimum_cycles,maximum_cycles,average_cycles,total_cycles
+//followed by an empty line (about 400 characters in all)
+void Profiler_Dump(void (*Put)(char));
+
+#else
+
+#define PROFILER_BEGIN(site) ((void)0)
+#define PROFILER_END(site) ((void)0)
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * File:    Scheduler.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+#include "Timebase.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+
+//timer2 counts at Fcy (no prescaler), and rolls over once every tick
+#define SCHEDULER_TIMER 2
+#define CYCLES_PER_TICK (CLOCK_FCY / SCHEDULER_TICK_HZ)
+
+//PR2 is 16 bits
+#if CYCLES_PER_TICK > 65536
+#error "one scheduler tick is too many instruction cycles for timer2, raise SCHEDULER_TICK_HZ"
+#endif
+
+#define true 1
+#define false 0
+
+static Scheduler_Task* Tasks[SCHEDULER_MAX_TASKS];
+static unsigned int NumberOfTasks;
+
+//counted up by _T2Interrupt
+static volatile unsigned int Ticks;
+
+void Scheduler_Initialize(void)
+{
+    NumberOfTasks = 0;
+    Ticks = 0;
+
+    //sets the interrupt to a priority of 1 (lowest), the handler only counts the tick
+    IPC1bits.T2IP = 1;
+    IFS0bits.T2IF = 0;
+    IEC0bits.T2IE = 1;
+
+    //no prescaler, so the timer counts instruction cycles (which also lets
+    //Scheduler_Get_Cycles time the tasks), and it rolls over once every tick
+    //(it is only started the first time, and keeps running if this is called again)
+    (void)Timebase_Request_Dedicated(SCHEDULER_TIMER, CLOCK_FCY, CYCLES_PER_TICK);
+}
+
+void __attribute__ ((__interrupt__, auto_psv)) _T2Interrupt(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_SCHEDULER_TICK);
+    ++Ticks;
+
+    IFS0bits.T2IF = 0;
+    PROFILER_END(PROFILER_SITE_SCHEDULER_TICK);
+}
+
+unsigned int Scheduler_Get_Ticks(void)
+{
+    return Ticks;
+}
+
+uint32_t Scheduler_Get_Cycles(void)
+{
+    unsigned int ticks;
+    uint16_t cycles;
+    int rolledOver;
+
+    //_T2Interrupt can run in the middle of this, and then all three have to be read again
+    do
+    {
+        ticks = Ticks;
+        cycles = TMR2;
+        rolledOver = IFS0bits.T2IF;
+    } while (ticks != Ticks);
+
+    //timer2 has rolled over, but _T2Interrupt has not had the chance to count it yet
+    if (rolledOver && cycles < CYCLES_PER_TICK / 2)
+    {
+        ++ticks;
+    }
+
+    return (uint32_t)ticks * CYCLES_PER_TICK + cycles;
+}
+
+int Scheduler_Add_Task(Scheduler_Task* task)
+{
+    if (NumberOfTasks >= SCHEDULER_MAX_TASKS)
+    {
+        return -1;
+    }
+
+    task->runs = 0;
+    task->lastExecutionCycles = 0;
+    task->worstExecutionCycles = 0;
+    task->missedDeadlines = 0;
+    task->nextRunTick = Ticks + 1;
+
+    Tasks[NumberOfTasks] = task;
+    ++NumberOfTasks;
+
+    return 0;
+}
+
+static void Scheduler_Run_Task(Scheduler_Task* task)
+{
+    //ticks are compared by subtracting them, so that this still works when they roll over
+    unsigned int late = Ticks - task->nextRunTick;
+    uint32_t startCycles;
+    uint32_t executionCycles;
+
+    //more than a whole period late (something else ran for too long), so the runs that
+    //were missed are skipped instead of being run back to back to catch up
+    if (late >= task->periodTicks)
+    {
+        unsigned int skippedRuns = late / task->periodTicks;
+
+        task->missedDeadlines += skippedRuns;
+        task->nextRunTick += skippedRuns * task->periodTicks;
+    }
+
+    startCycles = Scheduler_Get_Cycles();
+    task->Run();
+    executionCycles = Scheduler_Get_Cycles() - startCycles;
+
+    ++task->runs;
+    task->lastExecutionCycles = executionCycles;
+    if (executionCycles > task->worstExecutionCycles)
+    {
+        task->worstExecutionCycles = executionCycles;
+    }
+
+    task->nextRunTick += task->periodTicks;
+
+    //the task's deadline is the start of its next period, so it missed it if that
+    //tick has already started
+    if ((int)(Ticks - task->nextRunTick) >= 0)
+    {
+        ++task->missedDeadlines;
+    }
+}
+
+void Scheduler_Run_Pending(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < NumberOfTasks; ++i)
+    {
+        //the task is due once the current tick has reached nextRunTick
+        if ((int)(Ticks - Tasks[i]->nextRunTick) >= 0)
+        {
+            Scheduler_Run_Task(Tasks[i]);
+        }
+    }
+}
+
+void Scheduler_Run(void)
+{
+    while (true)
+    {
+        Scheduler_Run_Pending();
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * File:    Scheduler.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//The scheduler runs each task at a fixed rate, counted in ticks of timer2 (which
+//interrupts SCHEDULER_TICK_HZ times a second).  Tasks run one at a time from the main
+//loop (never from the interrupt), in the order they were added, and each one has to
+//return before the next one can run.
+
+#define SCHEDULER_TICK_HZ 1000
+
+//the most tasks that can be added
+#define SCHEDULER_MAX_TASKS 8
+
+//converts a rate in Hz to the number of ticks between runs of a task
+//(the rate has to divide evenly into SCHEDULER_TICK_HZ to be exact)
+#define SCHEDULER_HZ_TO_TICKS(hz) (SCHEDULER_TICK_HZ / (hz))
+
+typedef struct Scheduler_Task Scheduler_Task;
+
+struct Scheduler_Task
+{
+    //the function that does the task's work, it should return as soon as it can
+    void (*Run)(void);
+    //how many ticks between runs (see SCHEDULER_HZ_TO_TICKS)
+    unsigned int periodTicks;
+
+    //These are updated by the scheduler, and should be READ-ONLY
+    //the number of times the task has run
+    uint32_t runs;
+    //how long the task took to run, in instruction cycles (Fcy)
+    uint32_t lastExecutionCycles;
+    uint32_t worstExecutionCycles;
+    //the number of times the task finished after its next run was already due, or
+    //was not started at all because it was more than a whole period late
+    unsigned int missedDeadlines;
+
+    //the tick the task is next due on (only used by the scheduler)
+    unsigned int nextRunTick;
+};
+
+//sets up timer2 and clears the task list
+void Scheduler_Initialize(void);
+
+//adds a task, its first run is due on the next tick
+//periodTicks and Run must be set first, and the task must stay in memory (e.g. a
+//global variable) for as long as the scheduler runs
+//returns 0, or -1 if there are already SCHEDULER_MAX_TASKS tasks
+int Scheduler_Add_Task(Scheduler_Task* task);
+
+//runs every task that is due (call this over and over from the main loop)
+void Scheduler_Run_Pending(void);
+
+//calls Scheduler_Run_Pending forever
+void Scheduler_Run(void);
+
+//the number of ticks since Scheduler_Initialize (rolls over after 65536)
+unsigned int Scheduler_Get_Ticks(void);
+
+//the time since Scheduler_Initialize in instruction cycles (rolls over after ~18 minutes)
+uint32_t Scheduler_Get_Cycles(void);
@@ -0,0 +1,153 @@
+/*
+ * File:    SerialPort.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+#include "SerialPort.h"
+
+#define true 1
+#define false 0
+
+//BRGH = 1, so each bit is 4 * (U1BRG + 1) instruction cycles
+#define SERIAL_PORT_BRG ((CLOCK_FCY + 2UL * SERIAL_PORT_BAUD_RATE) / (4UL * SERIAL_PORT_BAUD_RATE) - 1)
+
+#if SERIAL_PORT_BRG > 65535
+#error "SERIAL_PORT_BAUD_RATE is too slow for U1BRG"
+#endif
+
+#define SERIAL_PORT_TX_MASK (SERIAL_PORT_TX_BUFFER_SIZE - 1)
+
+//the RPORx output function code for U1TX
+#define U1TX_REMAPPABLE_PIN_REFERENCE 3
+
+//UTXISEL1:UTXISEL0 = 0b10, U1TXIF is set when the last byte in the FIFO moves into the
+//shift register, so each interrupt refills all 4 bytes while that one is still going out
+//(a quarter of the interrupts 0b00 (one per byte) takes, with no gap between bytes)
+#define TX_INTERRUPT_ON_EMPTY 0b10
+
+static uint8_t Transmit_Buffer[SERIAL_PORT_TX_BUFFER_SIZE];
+//Head is only moved by Serial_Port_Write, and Tail only by the interrupt (or by
+//Serial_Port_Write while the interrupt is off)
+static volatile uint16_t Transmit_Head;
+static volatile uint16_t Transmit_Tail;
+
+void Serial_Port_Initialize(void)
+{
+    U1MODE = 0x0000;
+    U1STA = 0x0000;
+
+    Transmit_Head = 0;
+    Transmit_Tail = 0;
+
+    //TX is an output and RX an input, both digital
+    ANSB &= ~((1 << SERIAL_PORT_TX_PIN) | (1 << SERIAL_PORT_RX_PIN));
+    TRISB &= ~(1 << SERIAL_PORT_TX_PIN);
+    TRISB |= 1 << SERIAL_PORT_RX_PIN;
+    Nop();
+
+    //(RP14R has to change along with SERIAL_PORT_TX_PIN)
+    RPOR7bits.RP14R = U1TX_REMAPPABLE_PIN_REFERENCE;
+    RPINR18bits.U1RXR = SERIAL_PORT_RX_PIN;
+
+    U1MODEbits.BRGH = 1;
+    U1BRG = SERIAL_PORT_BRG;
+
+    //the lowest priority (1), so sending never holds up an input capture
+    IPC3bits.U1TXIP = 1;
+    IEC0bits.U1TXIE = 0;
+    IEC0bits.U1RXIE = 0;
+
+    U1MODEbits.UARTEN = 1;
+    U1STAbits.UTXISEL1 = TX_INTERRUPT_ON_EMPTY >> 1;
+    U1STAbits.UTXISEL0 = TX_INTERRUPT_ON_EMPTY & 1;
+    U1STAbits.UTXEN = 1;
+    IFS0bits.U1TXIF = 0;
+}
+
+//moves queued bytes into the UART's FIFO until it is full
+static inline __attribute__((always_inline)) void Serial_Port_Fill_Transmitter(void)
+{
+    uint16_t tail = Transmit_Tail;
+
+    while (tail != Transmit_Head && !U1STAbits.UTXBF)
+    {
+        U1TXREG = Transmit_Buffer[tail];
+        tail = (tail + 1) & SERIAL_PORT_TX_MASK;
+    }
+
+    Transmit_Tail = tail;
+}
+
+void __attribute__ ((__interrupt__, auto_psv)) _U1TXInterrupt(void)
+{
+    IFS0bits.U1TXIF = 0;
+
+    Serial_Port_Fill_Transmitter();
+
+    //nothing left to send, Serial_Port_Write turns it back on
+    if (Transmit_Tail == Transmit_Head)
+    {
+        IEC0bits.U1TXIE = 0;
+    }
+}
+
+unsigned int Serial_Port_Free_Space(void)
+{
+    //one slot is always left empty, so a full buffer can be told apart from an empty one
+    return (Transmit_Tail - Transmit_Head - 1) & SERIAL_PORT_TX_MASK;
+}
+
+int Serial_Port_Write(const uint8_t* data, unsigned int length)
+{
+    uint16_t head = Transmit_Head;
+    unsigned int i;
+
+    if (length > Serial_Port_Free_Space())
+    {
+        return false;
+    }
+
+    for (i = 0; i < length; ++i)
+    {
+        Transmit_Buffer[head] = data[i];
+        head = (head + 1) & SERIAL_PORT_TX_MASK;
+    }
+
+    //the interrupt is off while the FIFO is topped up here, so the two never fill it at
+    //the same time, and it is turned back on to send the rest
+    IEC0bits.U1TXIE = 0;
+    Transmit_Head = head;
+    Serial_Port_Fill_Transmitter();
+    if (Transmit_Tail != Transmit_Head)
+    {
+        IEC0bits.U1TXIE = 1;
+    }
+
+    return true;
+}
+
+void Serial_Port_Put(char character)
+{
+    uint8_t byte = (uint8_t)character;
+
+    (void)Serial_Port_Write(&byte, 1);
+}
+
+int Serial_Port_Get(uint8_t* byte)
+{
+    //an overrun stops the receiver until OERR is cleared (which also empties the FIFO)
+    if (U1STAbits.OERR)
+    {
+        U1STAbits.OERR = 0;
+    }
+
+    if (!U1STAbits.URXDA)
+    {
+        return false;
+    }
+
+    *byte = (uint8_t)U1RXREG;
+    return true;
+}
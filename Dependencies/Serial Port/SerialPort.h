@@ -0,0 +1,44 @@
+/*
+ * File:    SerialPort.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//Sends and receives bytes on UART1 (8 data bits, no parity, 1 stop bit) without ever
+//waiting for the UART.  Bytes to send are copied into a ring buffer, and the U1TX
+//interrupt moves them into the UART's 4-byte FIFO as it empties, so writing a whole
+//message from a task only takes as long as copying it.  Received bytes are read straight
+//from the UART's 4-byte receive FIFO, so Serial_Port_Get has to be called often enough
+//to keep up (a task at 10Hz is plenty for typed commands).
+
+//38400 baud is within 0.2% of the exact rate at both Fcy = 4MHz and 16MHz
+#ifndef SERIAL_PORT_BAUD_RATE
+#define SERIAL_PORT_BAUD_RATE 38400
+#endif
+
+//RB14 and RB15, which nothing else on the hovercraft uses
+#define SERIAL_PORT_TX_PIN 14
+#define SERIAL_PORT_RX_PIN 15
+
+//has to be a power of 2
+#define SERIAL_PORT_TX_BUFFER_SIZE 1024
+
+//maps UART1 to its pins and turns it on
+void Serial_Port_Initialize(void);
+
+//queues length bytes to be sent, and returns 1, or returns 0 (and queues none of them)
+//if there is not room for all of them
+int Serial_Port_Write(const uint8_t* data, unsigned int length);
+
+//queues one character (it is dropped if the buffer is full), for the functions that
+//write text one character at a time (e.g. Benchmark_Write_CSV)
+void Serial_Port_Put(char character);
+
+//how many more bytes can be queued right now
+unsigned int Serial_Port_Free_Space(void);
+
+//stores the next received byte in *byte and returns 1, or returns 0 if there is none
+int Serial_Port_Get(uint8_t* byte);
@@ -0,0 +1,276 @@
+/*
+ * File:    SerialReceiver.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+#include "Timebase.h"
+#include "SerialReceiver.h"
+
+#define true 1
+#define false 0
+
+//BRGH = 1, so each bit is 4 * (U1BRG + 1) instruction cycles
+#define SERIAL_RECEIVER_BRG ((CLOCK_FCY + 2UL * SERIAL_RECEIVER_BAUD_RATE) / (4UL * SERIAL_RECEIVER_BAUD_RATE) - 1)
+
+#define SERIAL_RECEIVER_BUFFER_MASK (SERIAL_RECEIVER_BUFFER_SIZE - 1)
+
+//PDSEL = 0b01 is 8 data bits with even parity
+#define EIGHT_BITS_EVEN_PARITY 0b01
+//URXISEL = 0b10 interrupts once 3 bytes are in the FIFO, so a frame takes 8 interrupts instead of
+//25, and Update reads the 1 or 2 bytes left at the end of a frame itself
+#define RX_INTERRUPT_ON_3_BYTES 0b10
+
+//where the flags and the end byte are in a frame, and the bits of the flags byte that are
+//always 0
+#define FLAGS_OFFSET 23
+#define END_OFFSET 24
+#define UNUSED_FLAGS 0xF0
+#define CHANNEL_BITS 11
+#define CHANNEL_MASK 0x7FF
+
+static uint8_t Receive_Buffer[SERIAL_RECEIVER_BUFFER_SIZE];
+//Head and Tail count up forever (the buffer is indexed with them masked).  Head is only
+//moved by the interrupt, and Tail only by Update, once it is done with the bytes before it.
+static volatile uint16_t Receive_Head;
+static volatile uint16_t Receive_Tail;
+//when the interrupt last stored bytes, written along with Head under the sequence (see
+//Serial_Receiver_Update)
+static volatile uint16_t Receive_Time;
+static volatile unsigned int Receive_Sequence;
+static volatile unsigned int Receive_Overruns;
+
+//the 62.5kHz clock the frames are timed by
+static const Timebase* Receive_Timebase;
+
+void Serial_Receiver_Initialize(Serial_Receiver* receiver)
+{
+    unsigned int i;
+
+    for (i = 0; i < SERIAL_RECEIVER_CHANNELS; ++i)
+    {
+        receiver->channels[i] = 0;
+    }
+    receiver->flags = 0;
+    receiver->framesMeasured = 0;
+    receiver->skippedBytes = 0;
+    receiver->overruns = 0;
+    receiver->lostFrames = 0;
+    receiver->signalTimeoutTicks = 0;
+    receiver->lastFrameTime = 0;
+    receiver->signalValid = false;
+
+    Receive_Head = 0;
+    Receive_Tail = 0;
+    Receive_Sequence = 0;
+    Receive_Overruns = 0;
+    Receive_Timebase = Timebase_Request(SERIAL_RECEIVER_TICKS_PER_SECOND);
+    Receive_Time = *Receive_Timebase->counter;
+
+    U1MODE = 0x0000;
+    U1STA = 0x0000;
+
+    //RX is a digital input
+    ANSB &= ~(1 << SERIAL_RECEIVER_RX_PIN);
+    TRISB |= 1 << SERIAL_RECEIVER_RX_PIN;
+    Nop();
+
+    RPINR18bits.U1RXR = SERIAL_RECEIVER_RX_PIN;
+
+    U1MODEbits.BRGH = 1;
+    U1BRG = SERIAL_RECEIVER_BRG;
+    U1MODEbits.PDSEL = EIGHT_BITS_EVEN_PARITY;
+    U1MODEbits.STSEL = 1;
+    //SBUS idles low, so the receiver is inverted
+    U1MODEbits.URXINV = 1;
+    U1STAbits.URXISEL = RX_INTERRUPT_ON_3_BYTES;
+
+    //The lowest priority (1), so it never holds up an input capture.  The 4th byte in the FIFO
+    //and the one being received give it 240us to get to the bytes.
+    IPC2bits.U1RXIP = 1;
+    IFS0bits.U1RXIF = 0;
+    IEC0bits.U1RXIE = 1;
+
+    U1MODEbits.UARTEN = 1;
+}
+
+//Copies every byte in the UART's FIFO into the buffer, and nothing more (the frames are
+//found by Update).  The interrupt also records when it did, which Update does not, since
+//the last bytes of a frame arrived before it got to them.
+static inline __attribute__((always_inline)) void Serial_Receiver_Empty_FIFO(int recordTime)
+{
+    uint16_t head = Receive_Head;
+
+    while (U1STAbits.URXDA)
+    {
+        //PERR and FERR are for the byte at the top of the FIFO, so they are checked before
+        //it is read, and a bad byte is left out (the frame it was in is then too short, and
+        //is skipped by Update)
+        if (U1STAbits.PERR || U1STAbits.FERR)
+        {
+            (void)U1RXREG;
+        }
+        else if ((uint16_t)(head - Receive_Tail) >= SERIAL_RECEIVER_BUFFER_SIZE)
+        {
+            (void)U1RXREG;
+            ++Receive_Overruns;
+        }
+        else
+        {
+            Receive_Buffer[head & SERIAL_RECEIVER_BUFFER_MASK] = (uint8_t)U1RXREG;
+            ++head;
+        }
+    }
+
+    //an overrun stops the receiver until OERR is cleared
+    if (U1STAbits.OERR)
+    {
+        U1STAbits.OERR = 0;
+        ++Receive_Overruns;
+    }
+
+    ++Receive_Sequence;
+    Receive_Head = head;
+    if (recordTime)
+    {
+        Receive_Time = *Receive_Timebase->counter;
+    }
+    ++Receive_Sequence;
+}
+
+void __attribute__ ((__interrupt__, auto_psv)) _U1RXInterrupt(void)
+{
+    IFS0bits.U1RXIF = 0;
+
+    Serial_Receiver_Empty_FIFO(true);
+}
+
+static inline __attribute__((always_inline)) uint8_t Serial_Receiver_Byte(uint16_t position)
+{
+    return Receive_Buffer[position & SERIAL_RECEIVER_BUFFER_MASK];
+}
+
+//whether the 25 bytes starting at position can be a frame
+static int Serial_Receiver_Is_Frame(uint16_t position)
+{
+    uint8_t end = Serial_Receiver_Byte(position + END_OFFSET);
+
+    return Serial_Receiver_Byte(position) == SERIAL_RECEIVER_HEADER
+        && (Serial_Receiver_Byte(position + FLAGS_OFFSET) & UNUSED_FLAGS) == 0
+        && (end == 0x00 || (end & 0x0F) == 0x04);
+}
+
+//unpacks the channels of the frame at position straight out of the buffer
+static void Serial_Receiver_Decode(Serial_Receiver* receiver, uint16_t position)
+{
+    uint32_t bits = 0;
+    unsigned int numberOfBits = 0;
+    unsigned int i;
+
+    ++position;
+    for (i = 0; i < SERIAL_RECEIVER_CHANNELS; ++i)
+    {
+        while (numberOfBits < CHANNEL_BITS)
+        {
+            bits |= (uint32_t)Serial_Receiver_Byte(position) << numberOfBits;
+            ++position;
+            numberOfBits += 8;
+        }
+
+        receiver->channels[i] = bits & CHANNEL_MASK;
+        bits >>= CHANNEL_BITS;
+        numberOfBits -= CHANNEL_BITS;
+    }
+
+    receiver->flags = Serial_Receiver_Byte(position);
+}
+
+void Serial_Receiver_Update(Serial_Receiver* receiver)
+{
+    unsigned int sequence;
+    uint16_t head;
+    uint16_t receiveTime;
+    uint16_t tail = Receive_Tail;
+    uint16_t newestFrame = 0;
+    unsigned int frames = 0;
+
+    //the bytes that were too few for an interrupt, with the interrupt off so the two never
+    //read the FIFO at the same time
+    IEC0bits.U1RXIE = 0;
+    Serial_Receiver_Empty_FIFO(false);
+    IEC0bits.U1RXIE = 1;
+
+    //Head and the time it was written at, from the same interrupt (the same as
+    //IC_Ring_Read_Latest)
+    do
+    {
+        sequence = Receive_Sequence;
+        head = Receive_Head;
+        receiveTime = Receive_Time;
+    } while ((sequence & 1) || sequence != Receive_Sequence);
+
+    //Every whole frame is found where it is.  Once a frame has been found, the next one
+    //starts right after it, so bytes are only skipped one at a time until then.
+    while ((uint16_t)(head - tail) >= SERIAL_RECEIVER_FRAME_SIZE)
+    {
+        if (Serial_Receiver_Is_Frame(tail))
+        {
+            if (Serial_Receiver_Byte(tail + FLAGS_OFFSET) & SERIAL_RECEIVER_FLAG_FRAME_LOST)
+            {
+                ++receiver->lostFrames;
+            }
+            newestFrame = tail;
+            ++frames;
+            tail += SERIAL_RECEIVER_FRAME_SIZE;
+        }
+        else
+        {
+            ++receiver->skippedBytes;
+            ++tail;
+        }
+    }
+
+    //the newest frame is decoded before Tail moves past it, so the interrupt cannot write
+    //over it in the middle
+    if (frames > 0)
+    {
+        Serial_Receiver_Decode(receiver, newestFrame);
+        //the end of the frame, or of whatever came after it (either way, when the signal
+        //was last there)
+        receiver->lastFrameTime = receiveTime;
+    }
+    Receive_Tail = tail;
+
+    receiver->framesMeasured = frames;
+    receiver->overruns = Receive_Overruns;
+
+    //the same check as IC_Ring_Check_Signal, and the receiver's own failsafe
+    receiver->signalValid = (frames > 0 || receiver->signalValid) && !(receiver->flags & SERIAL_RECEIVER_FLAG_FAILSAFE);
+    if (receiver->signalTimeoutTicks != 0 && (uint16_t)(*Receive_Timebase->counter - receiver->lastFrameTime) > receiver->signalTimeoutTicks)
+    {
+        receiver->signalValid = false;
+    }
+}
+
+void Serial_Receiver_Read_Channel(const Serial_Receiver* receiver, unsigned int channel, IC_Fixed_Module* channelModule)
+{
+    uint32_t pulseEighths;
+
+    channelModule->periodsMeasured = receiver->framesMeasured;
+    channelModule->overruns = receiver->overruns;
+    channelModule->signalValid = receiver->signalValid && channel < SERIAL_RECEIVER_CHANNELS;
+
+    if (channel >= SERIAL_RECEIVER_CHANNELS)
+    {
+        return;
+    }
+
+    channelModule->periodTicks = IC_MILLISECONDS_TO_TICKS(SERIAL_RECEIVER_CHANNEL_PERIOD_MILLISECONDS);
+    channelModule->frequency = 1000 / SERIAL_RECEIVER_CHANNEL_PERIOD_MILLISECONDS;
+
+    //the pulse is channel * 5 / 8 + 880us, so in eighths of a microsecond it is exact, and
+    //32768 / (8 * 1000 * period in ms) of that is the duty cycle (rounded)
+    pulseEighths = (uint32_t)receiver->channels[channel] * 5 + 880 * 8;
+    channelModule->dutyCycle = (Q15)((pulseEighths * 4096 + 500UL * SERIAL_RECEIVER_CHANNEL_PERIOD_MILLISECONDS) / (1000UL * SERIAL_RECEIVER_CHANNEL_PERIOD_MILLISECONDS));
+}
@@ -0,0 +1,103 @@
+/*
+ * File:    SerialReceiver.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "InputCapture.h"
+
+//Reads an SBUS receiver (every channel in one serial frame) on UART1's RX pin.  The U1RX
+//interrupt only copies each byte into a ring buffer, and Serial_Receiver_Update finds the
+//frames right where they are in the ring (nothing is copied out of it) and decodes the
+//newest one.  Serial_Receiver_Read_Channel then hands any channel to code written for
+//IC_Fixed_Modules, the same way IC_PPM_Read_Channel does.
+//
+//SBUS is 100000 baud, 8 data bits, even parity and 2 stop bits, with the signal inverted
+//(the UART's URXINV undoes that, so no inverter is needed).  A frame is 25 bytes, sent
+//every 14ms (or 7ms in a receiver's fast mode):
+//    byte    0       SERIAL_RECEIVER_HEADER
+//    bytes   1 - 22  16 channels of 11 bits (0 - 2047), least significant bit first
+//    byte    23      flags (SERIAL_RECEIVER_FLAG_...)
+//    byte    24      0x00 (or, for SBUS2, 0x04, 0x14, 0x24 or 0x34)
+//A channel of 172 - 1811 is a 988us - 2012us servo pulse (992 is 1500us), in steps of
+//0.625us, instead of the 16us steps an IC module measures a PWM input's pulse in.
+
+//UART1's pin, the same one the Serial Port dependency receives on (the two cannot be used
+//together)
+#define SERIAL_RECEIVER_RX_PIN 15
+
+//100000 baud is exact at both Fcy = 4MHz and 16MHz
+#define SERIAL_RECEIVER_BAUD_RATE 100000
+
+#define SERIAL_RECEIVER_CHANNELS 16
+#define SERIAL_RECEIVER_FRAME_SIZE 25
+#define SERIAL_RECEIVER_HEADER 0x0F
+
+//the flags byte:  two on/off channels, a frame the receiver did not get from the
+//transmitter (it repeats the last one), and the receiver's own failsafe (it has lost the
+//transmitter, and keeps sending frames with the failsafe positions)
+#define SERIAL_RECEIVER_FLAG_CHANNEL_17 0x01
+#define SERIAL_RECEIVER_FLAG_CHANNEL_18 0x02
+#define SERIAL_RECEIVER_FLAG_FRAME_LOST 0x04
+#define SERIAL_RECEIVER_FLAG_FAILSAFE 0x08
+
+//has to be a power of 2, and hold every byte that can arrive between two Updates (5 frames
+//is 3 Updates at 50Hz with the receiver in its fast mode)
+#define SERIAL_RECEIVER_BUFFER_SIZE 128
+
+//The frames are timed by the same 62.5kHz clock as the IC modules (from the Timebase
+//dependency), in uint16_t ticks.
+#define SERIAL_RECEIVER_TICKS_PER_SECOND 62500UL
+#define SERIAL_RECEIVER_MILLISECONDS_TO_TICKS(ms) ((uint16_t)((uint32_t)(ms) * SERIAL_RECEIVER_TICKS_PER_SECOND / 1000))
+
+//Serial_Receiver_Read_Channel reads a channel as if it came from a PWM receiver with this
+//frame length (the same as IC_PPM_CHANNEL_PERIOD_MILLISECONDS)
+#define SERIAL_RECEIVER_CHANNEL_PERIOD_MILLISECONDS 20
+
+typedef struct Serial_Receiver Serial_Receiver;
+
+struct Serial_Receiver
+{
+	//every channel (0 - 2047), all from the same frame, and that frame's flags
+	uint16_t channels[SERIAL_RECEIVER_CHANNELS];
+	unsigned int flags;
+	//the number of new frames since the last Update (0 means the channels were left alone,
+	//and only the newest frame is decoded)
+	unsigned int framesMeasured;
+	//the total bytes skipped while looking for a frame (noise, a byte with a parity or
+	//framing error, or the receiver starting in the middle of a frame), the bytes lost
+	//because the buffer or the UART's FIFO was full, and the frames flagged
+	//SERIAL_RECEIVER_FLAG_FRAME_LOST
+	unsigned int skippedBytes;
+	unsigned int overruns;
+	unsigned int lostFrames;
+	//(all of these are READ-ONLY)
+
+	//Signal loss detection, the same as an IC_Module's:  signalTimeoutTicks is how long it can
+	//go without a byte after the last frame before the signal counts as lost (see
+	//SERIAL_RECEIVER_MILLISECONDS_TO_TICKS), and 0 turns this off.  Initialize sets it to 0, so
+	//set it afterwards.  lastFrameTime is when the last bytes of the last frame arrived.
+	//signalValid is 1 while frames keep arriving without SERIAL_RECEIVER_FLAG_FAILSAFE, and 0
+	//before the first frame.
+	uint16_t signalTimeoutTicks;
+	uint16_t lastFrameTime;
+	int signalValid;
+	//(lastFrameTime and signalValid are READ-ONLY)
+};
+
+//maps U1RX to its pin, turns UART1's receiver on for SBUS, and starts the U1RX interrupt
+void Serial_Receiver_Initialize(Serial_Receiver* receiver);
+
+//decodes the newest whole frame in the buffer and checks the signal (call it at least once
+//every 1 second, the capture clock's rollover, and often enough that the buffer never fills)
+void Serial_Receiver_Update(Serial_Receiver* receiver);
+
+//Fills in an IC_Fixed_Module with one channel (0 - SERIAL_RECEIVER_CHANNELS - 1) of the frame
+//Update last decoded, as if it came from its own PWM input:  the pulse as a duty cycle of
+//SERIAL_RECEIVER_CHANNEL_PERIOD_MILLISECONDS (a Q15 step is 0.61us, so every SBUS step is
+//kept), that period, the frames measured, the overruns and signalValid.  Its
+//signalTimeoutTicks and lastEdgeTime are left alone, since they are on the IC modules' clock.
+void Serial_Receiver_Read_Channel(const Serial_Receiver* receiver, unsigned int channel, IC_Fixed_Module* channelModule);
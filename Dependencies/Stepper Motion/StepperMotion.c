@@ -0,0 +1,226 @@
+/*
+ * File:    StepperMotion.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "StepperMotion.h"
+#include "FixedPoint.h"
+
+#define true 1
+#define false 0
+
+//the step signal's duty cycle while the motor is moving (20%)
+#define STEP_DUTY_CYCLE Q15_FROM_PERCENTAGE(20)
+
+//the stepper motor driver's direction pin, which the IC4 interrupt also reads to decide
+//whether to count up (1) or down (0)
+#define STEPPER_DIRECTION_PIN LATAbits.LATA2
+
+//the motion that the IC4 interrupt stops (see Stepper_Motion_Initialize)
+static Stepper_Motion* ActiveMotion;
+//set by the interrupt when it has stopped the motor at its target, so that
+//Stepper_Motion_Set_Step_Rate does not turn the step signal back on
+static volatile int StoppedAtTarget;
+
+static void Stepper_Motion_Turn_Off_Steps(Stepper_Motion* motion)
+{
+    motion->stepOutput->dutyCycle = 0;
+    motion->stepOutput->UpdateDutyCycle(motion->stepOutput);
+}
+
+//called by the IC4 interrupt on the step that reaches the stop count
+static void Stepper_Motion_Stop_At_Target(void)
+{
+    Stepper_Motion_Turn_Off_Steps(ActiveMotion);
+    StoppedAtTarget = true;
+}
+
+static void Stepper_Motion_Set_Step_Rate(Stepper_Motion* motion, unsigned int stepRate)
+{
+    motion->stepRate = stepRate;
+    motion->stepOutput->frequency = stepRate;
+    motion->stepOutput->UpdateFrequency(motion->stepOutput);
+
+    //if the interrupt stopped the motor while the new rate was being written, the
+    //step signal may have been turned back on, so it is turned off again
+    if (StoppedAtTarget)
+    {
+        Stepper_Motion_Turn_Off_Steps(motion);
+    }
+}
+
+static void Stepper_Motion_Stop(Stepper_Motion* motion)
+{
+    IC4_Clear_Stop_Count();
+    motion->stopCountSet = false;
+
+    Stepper_Motion_Turn_Off_Steps(motion);
+    motion->stepRate = 0;
+    motion->direction = 0;
+}
+
+//has the IC4 interrupt stop the motor at the target, if it is ahead of the motor
+static void Stepper_Motion_Update_Stop_Count(Stepper_Motion* motion, int remainingSteps)
+{
+    if (remainingSteps > 0)
+    {
+        //only set when it changes, since the interrupt cannot stop the motor for the
+        //moment that IC4_Set_Stop_Count is changing it
+        if (!motion->stopCountSet || motion->stopCount != motion->targetPosition)
+        {
+            motion->stopCount = motion->targetPosition;
+            motion->stopCountSet = true;
+            IC4_Set_Stop_Count(motion->stopCount, Stepper_Motion_Stop_At_Target);
+        }
+    }
+    else if (motion->stopCountSet)
+    {
+        IC4_Clear_Stop_Count();
+        motion->stopCountSet = false;
+    }
+}
+
+static void Stepper_Motion_Start(Stepper_Motion* motion, int direction)
+{
+    motion->direction = direction;
+    //constant stores only (single BSET/BCLR instructions): a computed value is a read-modify-write
+    //of LATA, which could undo the engine relays that Kill_Switch_Trip turns off in IC1's interrupt
+    if (direction > 0)
+    {
+        STEPPER_DIRECTION_PIN = 1;
+    }
+    else
+    {
+        STEPPER_DIRECTION_PIN = 0;
+    }
+
+    //the stop count is set before the first step, so even a 1 step move stops on time
+    StoppedAtTarget = false;
+    Stepper_Motion_Update_Stop_Count(motion, 1);
+
+    motion->stepOutput->dutyCycle = STEP_DUTY_CYCLE;
+    Stepper_Motion_Set_Step_Rate(motion, motion->startStepRate);
+}
+
+//the number of steps it takes to slow down from the current step rate to
+//startStepRate, plus the steps taken before the next Update
+//(v^2 - v0^2) / (2 * a)
+static unsigned int Stepper_Motion_Braking_Steps(const Stepper_Motion* motion)
+{
+    uint32_t rateSquaredDifference = (uint32_t)motion->stepRate * motion->stepRate - (uint32_t)motion->startStepRate * motion->startStepRate;
+
+    return FixedPoint_Divide(rateSquaredDifference, 2 * motion->acceleration) + motion->stepRate / motion->updateRate + 1;
+}
+
+void Stepper_Motion_Initialize(Stepper_Motion* motion)
+{
+    ActiveMotion = motion;
+    StoppedAtTarget = false;
+
+    motion->counter->Update(motion->counter);
+    motion->position = motion->counter->numberOfCounts;
+    motion->targetPosition = motion->position;
+    motion->stopCountSet = false;
+
+    Stepper_Motion_Stop(motion);
+}
+
+void Stepper_Motion_Set_Target(Stepper_Motion* motion, int targetPosition)
+{
+    if (targetPosition < IC4_MINIMUM_COUNT)
+    {
+        targetPosition = IC4_MINIMUM_COUNT;
+    }
+    else if (targetPosition > IC4_MAXIMUM_COUNT)
+    {
+        targetPosition = IC4_MAXIMUM_COUNT;
+    }
+
+    motion->targetPosition = targetPosition;
+}
+
+void Stepper_Motion_Update(Stepper_Motion* motion)
+{
+    //how much the step rate changes between two Updates
+    unsigned int rateChange = motion->acceleration / motion->updateRate;
+    unsigned int newStepRate;
+    int remainingSteps;
+    int speedUp;
+
+    //the count and stopCountReached are copied together, so if the interrupt stopped the
+    //motor, position is already the target (reading StoppedAtTarget after the count
+    //could see the stop with the count from one step before, and start another move)
+    motion->counter->Update(motion->counter);
+    motion->position = motion->counter->numberOfCounts;
+
+    if (motion->counter->stopCountReached && motion->stopCountSet)
+    {
+        StoppedAtTarget = false;
+        motion->stopCountSet = false;
+        motion->stepRate = 0;
+        motion->direction = 0;
+    }
+
+    if (motion->direction == 0)
+    {
+        if (motion->targetPosition != motion->position)
+        {
+            Stepper_Motion_Start(motion, (motion->targetPosition > motion->position) ? 1 : -1);
+        }
+
+        return;
+    }
+
+    //the steps left to go in the direction the motor is turning
+    remainingSteps = (motion->targetPosition - motion->position) * motion->direction;
+
+    //the target may have moved since the last Update
+    Stepper_Motion_Update_Stop_Count(motion, remainingSteps);
+
+    if (remainingSteps <= 0)
+    {
+        //the target is now behind the motor, so it slows down and stops, and the next
+        //Update turns it around
+        if (motion->stepRate <= motion->startStepRate)
+        {
+            Stepper_Motion_Stop(motion);
+            return;
+        }
+
+        speedUp = false;
+    }
+    else
+    {
+        //slows down once there are only just enough steps left to do it in
+        speedUp = (unsigned int)remainingSteps > Stepper_Motion_Braking_Steps(motion);
+    }
+
+    if (speedUp)
+    {
+        newStepRate = motion->stepRate + rateChange;
+
+        if (newStepRate > motion->maximumStepRate)
+        {
+            newStepRate = motion->maximumStepRate;
+        }
+    }
+    else if (motion->stepRate > motion->startStepRate + rateChange)
+    {
+        newStepRate = motion->stepRate - rateChange;
+    }
+    else
+    {
+        newStepRate = motion->startStepRate;
+    }
+
+    if (newStepRate != motion->stepRate)
+    {
+        Stepper_Motion_Set_Step_Rate(motion, newStepRate);
+    }
+}
+
+int Stepper_Motion_Is_Moving(const Stepper_Motion* motion)
+{
+    return motion->direction != 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * File:    StepperMotion.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include "PWM.h"
+#include "InputCapture.h"
+
+//Moves the propulsion direction stepper motor to a target position in the background.
+//The step signal is a PWM output (one step per period) and the steps are counted by
+//the IC4 Count_Monitor, whose interrupt stops the step signal on the exact step that
+//reaches the target.  Update only adjusts the step rate, so it never waits for the
+//motor and can be called from a scheduler task.
+//
+//The step rate follows a trapezoidal profile:  it starts at startStepRate, speeds up
+//by acceleration steps/s every second until it reaches maximumStepRate, and slows back
+//down in time to be at startStepRate when it gets to the target.
+
+typedef struct Stepper_Motion Stepper_Motion;
+
+struct Stepper_Motion
+{
+    //These have to be set before Stepper_Motion_Initialize is called
+    //the step signal (its Initialize must already have been called)
+    PWM_Fixed_Module* stepOutput;
+    //counts the steps (its Initialize must already have been called)
+    Count_Monitor* counter;
+    //the fastest rate the motor can start or stop at without missing steps (steps/s)
+    unsigned int startStepRate;
+    //the fastest rate the motor is allowed to run at (steps/s)
+    unsigned int maximumStepRate;
+    //how quickly the step rate changes (steps/s per second)
+    unsigned int acceleration;
+    //how many times a second Stepper_Motion_Update is called
+    unsigned int updateRate;
+
+    //These are updated by the functions below, and should be READ-ONLY
+    //where the motor is going and where it is, in counts (see IC4_MINIMUM_COUNT/MAXIMUM_COUNT)
+    int targetPosition;
+    int position;
+    //the current step rate in steps/s (0 when the motor is stopped)
+    unsigned int stepRate;
+    //1 when the count is going up, -1 when it is going down, 0 when stopped
+    int direction;
+
+    //the target the IC4 interrupt is set to stop at, if stopCountSet (only used here)
+    int stopCount;
+    int stopCountSet;
+};
+
+//stops the motor and sets the target to where it is now
+//only one Stepper_Motion can be used, since there is only one IC4 module
+void Stepper_Motion_Initialize(Stepper_Motion* motion);
+
+//sets where the motor should go (limited to IC4_MINIMUM_COUNT - IC4_MAXIMUM_COUNT)
+//this can be called at any time, even while the motor is moving
+void Stepper_Motion_Set_Target(Stepper_Motion* motion, int targetPosition);
+
+//starts, speeds up, slows down or turns around the motor (call this updateRate times a second)
+void Stepper_Motion_Update(Stepper_Motion* motion);
+
+//returns 1 while the motor is moving, 0 once it is stopped
+int Stepper_Motion_Is_Moving(const Stepper_Motion* motion);
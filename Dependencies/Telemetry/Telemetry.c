@@ -0,0 +1,344 @@
+/*
+ * File:    Telemetry.c
+ * Author:  Zachary Downum
+ */
+
+#include "SerialPort.h"
+#include "Telemetry.h"
+
+#define true 1
+#define false 0
+
+//the payload and its CRC, before COBS encoding
+#define TELEMETRY_DECODED_SIZE (TELEMETRY_PAYLOAD_SIZE + TELEMETRY_CRC_SIZE)
+
+static uint8_t Telemetry_Sequence;
+static uint16_t Telemetry_Dropped_Frames;
+
+//CRC-16/CCITT-FALSE a byte at a time, one lookup and two XORs per byte (512 bytes of flash
+//is a good trade for a check that runs over every byte of every frame)
+static const uint16_t Telemetry_CRC_Table[256] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+uint16_t Telemetry_CRC16(const uint8_t* data, unsigned int length)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (length > 0)
+    {
+        crc = (uint16_t)(crc << 8) ^ Telemetry_CRC_Table[(uint8_t)(crc >> 8) ^ *data++];
+        --length;
+    }
+
+    return crc;
+}
+
+static uint8_t* Telemetry_Put_16(uint8_t* out, uint16_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+
+    return out + 2;
+}
+
+static uint8_t* Telemetry_Put_32(uint8_t* out, uint32_t value)
+{
+    out = Telemetry_Put_16(out, (uint16_t)value);
+
+    return Telemetry_Put_16(out, (uint16_t)(value >> 16));
+}
+
+static uint16_t Telemetry_Get_16(const uint8_t* in)
+{
+    return (uint16_t)(in[0] | ((uint16_t)in[1] << 8));
+}
+
+static uint32_t Telemetry_Get_32(const uint8_t* in)
+{
+    return Telemetry_Get_16(in) | ((uint32_t)Telemetry_Get_16(in + 2) << 16);
+}
+
+//writes the payload (see the table in Telemetry.h) and its CRC
+static void Telemetry_Pack(const Telemetry_Frame* frame, uint8_t* decoded)
+{
+    uint8_t* out = decoded;
+    unsigned int i;
+    uint16_t crc;
+
+    *out++ = frame->version;
+    *out++ = frame->sequence;
+    out = Telemetry_Put_16(out, frame->tick);
+    *out++ = frame->flags;
+    for (i = 0; i < TELEMETRY_NUMBER_OF_INPUTS; ++i)
+    {
+        out = Telemetry_Put_16(out, frame->inputs[i].dutyCycle);
+        out = Telemetry_Put_32(out, frame->inputs[i].periodTicks);
+    }
+    out = Telemetry_Put_16(out, (uint16_t)frame->stepperCounts);
+    out = Telemetry_Put_16(out, (uint16_t)frame->stepperTarget);
+    out = Telemetry_Put_16(out, frame->stepRate);
+    out = Telemetry_Put_16(out, frame->throttleServoDutyCycle);
+    out = Telemetry_Put_16(out, frame->stepOutputDutyCycle);
+    for (i = 0; i < TELEMETRY_NUMBER_OF_TASKS; ++i)
+    {
+        out = Telemetry_Put_16(out, frame->tasks[i].lastExecutionCycles);
+        out = Telemetry_Put_16(out, frame->tasks[i].worstExecutionCycles);
+        out = Telemetry_Put_16(out, frame->tasks[i].missedDeadlines);
+    }
+    out = Telemetry_Put_16(out, frame->droppedFrames);
+
+    crc = Telemetry_CRC16(decoded, TELEMETRY_PAYLOAD_SIZE);
+    (void)Telemetry_Put_16(out, crc);
+}
+
+static void Telemetry_Unpack(const uint8_t* in, Telemetry_Frame* frame)
+{
+    unsigned int i;
+
+    frame->version = in[0];
+    frame->sequence = in[1];
+    frame->tick = Telemetry_Get_16(in + 2);
+    frame->flags = in[4];
+    in += 5;
+    for (i = 0; i < TELEMETRY_NUMBER_OF_INPUTS; ++i)
+    {
+        frame->inputs[i].dutyCycle = Telemetry_Get_16(in);
+        frame->inputs[i].periodTicks = Telemetry_Get_32(in + 2);
+        in += 6;
+    }
+    frame->stepperCounts = (int16_t)Telemetry_Get_16(in);
+    frame->stepperTarget = (int16_t)Telemetry_Get_16(in + 2);
+    frame->stepRate = Telemetry_Get_16(in + 4);
+    frame->throttleServoDutyCycle = Telemetry_Get_16(in + 6);
+    frame->stepOutputDutyCycle = Telemetry_Get_16(in + 8);
+    in += 10;
+    for (i = 0; i < TELEMETRY_NUMBER_OF_TASKS; ++i)
+    {
+        frame->tasks[i].lastExecutionCycles = Telemetry_Get_16(in);
+        frame->tasks[i].worstExecutionCycles = Telemetry_Get_16(in + 2);
+        frame->tasks[i].missedDeadlines = Telemetry_Get_16(in + 4);
+        in += 6;
+    }
+    frame->droppedFrames = Telemetry_Get_16(in);
+}
+
+//COBS:  every 0 is replaced by the distance to the next one, and the first byte is the
+//distance to the first 0 (a run of 254 bytes without a 0 would need an extra code byte,
+//but a frame is never that long)
+static unsigned int Telemetry_COBS_Encode(const uint8_t* in, unsigned int length, uint8_t* out)
+{
+    unsigned int codeIndex = 0;
+    unsigned int outIndex = 1;
+    uint8_t code = 1;
+    unsigned int i;
+
+    for (i = 0; i < length; ++i)
+    {
+        if (in[i] == 0)
+        {
+            out[codeIndex] = code;
+            codeIndex = outIndex++;
+            code = 1;
+        }
+        else
+        {
+            out[outIndex++] = in[i];
+            ++code;
+        }
+    }
+    out[codeIndex] = code;
+
+    return outIndex;
+}
+
+//returns the decoded length, or -1 if the bytes are not a COBS encoding of at most
+//maximumLength bytes
+static int Telemetry_COBS_Decode(const uint8_t* in, unsigned int length, uint8_t* out, unsigned int maximumLength)
+{
+    unsigned int inIndex = 0;
+    unsigned int outIndex = 0;
+
+    while (inIndex < length)
+    {
+        uint8_t code = in[inIndex++];
+        uint8_t i;
+
+        if (code == 0 || inIndex + code - 1 > length)
+        {
+            return -1;
+        }
+
+        for (i = 1; i < code; ++i)
+        {
+            if (in[inIndex] == 0 || outIndex >= maximumLength)
+            {
+                return -1;
+            }
+            out[outIndex++] = in[inIndex++];
+        }
+
+        //every code but the last one (and 0xFF, which has no 0 after it) stands for a 0
+        if (code != 0xFF && inIndex < length)
+        {
+            if (outIndex >= maximumLength)
+            {
+                return -1;
+            }
+            out[outIndex++] = 0;
+        }
+    }
+
+    return (int)outIndex;
+}
+
+void Telemetry_Initialize(void)
+{
+    Telemetry_Sequence = 0;
+    Telemetry_Dropped_Frames = 0;
+}
+
+unsigned int Telemetry_Encode(const Telemetry_Frame* frame, uint8_t* encoded)
+{
+    uint8_t decoded[TELEMETRY_DECODED_SIZE];
+    unsigned int length;
+
+    Telemetry_Pack(frame, decoded);
+    length = Telemetry_COBS_Encode(decoded, TELEMETRY_DECODED_SIZE, encoded);
+    encoded[length++] = 0;
+
+    return length;
+}
+
+int Telemetry_Send(Telemetry_Frame* frame)
+{
+    uint8_t encoded[TELEMETRY_ENCODED_SIZE];
+    unsigned int length;
+
+    frame->version = TELEMETRY_VERSION;
+    frame->sequence = Telemetry_Sequence++;
+    frame->droppedFrames = Telemetry_Dropped_Frames;
+
+    length = Telemetry_Encode(frame, encoded);
+    if (!Serial_Port_Write(encoded, length))
+    {
+        ++Telemetry_Dropped_Frames;
+        return false;
+    }
+
+    return true;
+}
+
+int Telemetry_Decode(const uint8_t* encoded, unsigned int length, Telemetry_Frame* frame)
+{
+    uint8_t decoded[TELEMETRY_DECODED_SIZE];
+    int decodedLength = Telemetry_COBS_Decode(encoded, length, decoded, TELEMETRY_DECODED_SIZE);
+
+    if (decodedLength < 0)
+    {
+        return TELEMETRY_DECODE_BAD_ENCODING;
+    }
+    if (decodedLength != TELEMETRY_DECODED_SIZE)
+    {
+        return TELEMETRY_DECODE_BAD_LENGTH;
+    }
+    if (Telemetry_CRC16(decoded, TELEMETRY_PAYLOAD_SIZE) != Telemetry_Get_16(decoded + TELEMETRY_PAYLOAD_SIZE))
+    {
+        return TELEMETRY_DECODE_BAD_CRC;
+    }
+    if (decoded[0] != TELEMETRY_VERSION)
+    {
+        return TELEMETRY_DECODE_UNKNOWN_VERSION;
+    }
+
+    Telemetry_Unpack(decoded, frame);
+    return TELEMETRY_DECODE_OK;
+}
+
+void Telemetry_Receiver_Initialize(Telemetry_Receiver* receiver)
+{
+    receiver->goodFrames = 0;
+    receiver->badFrames = 0;
+    receiver->lostFrames = 0;
+    receiver->length = 0;
+    receiver->overflowed = false;
+    receiver->hasSequence = false;
+    receiver->lastSequence = 0;
+}
+
+int Telemetry_Receive(Telemetry_Receiver* receiver, uint8_t byte, Telemetry_Frame* frame)
+{
+    int result;
+
+    if (byte != 0)
+    {
+        //a frame that is too long is kept out until its 0, and then counted as bad
+        if (receiver->length < TELEMETRY_ENCODED_SIZE)
+        {
+            receiver->buffer[receiver->length++] = byte;
+        }
+        else
+        {
+            receiver->overflowed = true;
+        }
+        return false;
+    }
+
+    //two 0s in a row are not a frame
+    if (receiver->length == 0 && !receiver->overflowed)
+    {
+        return false;
+    }
+
+    result = receiver->overflowed ? TELEMETRY_DECODE_BAD_LENGTH : Telemetry_Decode(receiver->buffer, receiver->length, frame);
+    receiver->length = 0;
+    receiver->overflowed = false;
+
+    if (result != TELEMETRY_DECODE_OK)
+    {
+        ++receiver->badFrames;
+        return false;
+    }
+
+    ++receiver->goodFrames;
+    if (receiver->hasSequence)
+    {
+        receiver->lostFrames += (uint8_t)(frame->sequence - receiver->lastSequence - 1);
+    }
+    receiver->hasSequence = true;
+    receiver->lastSequence = frame->sequence;
+
+    return true;
+}
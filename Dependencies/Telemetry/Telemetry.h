@@ -0,0 +1,160 @@
+/*
+ * File:    Telemetry.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//Sends a snapshot of the control loop (every receiver input, the stepper motor's count,
+//the kill switch's relays, the outputs and how long each task is taking) over the Serial
+//Port dependency as a small binary frame.  Telemetry_Send only packs the frame and copies
+//it into the serial port's buffer, and the U1TX interrupt sends it in the background, so
+//the task that calls it never waits on the UART.
+//
+//A frame on the wire is COBS encoded (so it never has a 0 byte in it) and ends with a 0,
+//so a receiver that starts listening in the middle of one finds the start of the next.
+//Decoded, it is the payload (TELEMETRY_PAYLOAD_SIZE bytes, starting with
+//TELEMETRY_VERSION) followed by a CRC-16 of the payload, every number little-endian:
+//    offset  size  field
+//    0       1     version (TELEMETRY_VERSION)
+//    1       1     sequence, 1 more than the last frame's (a gap means frames were lost)
+//    2       2     tick, the scheduler's tick when the frame was made (ms, rolls over)
+//    4       1     flags (TELEMETRY_FLAG_...)
+//    5       24    4 inputs (TELEMETRY_INPUT_...), each a 2 byte Q15 duty cycle and a
+//                  4 byte period in ticks of the IC modules' clock
+//    29      2     stepper counts (Count_Monitor.numberOfCounts)
+//    31      2     stepper target (in counts)
+//    33      2     step rate (steps/s)
+//    35      2     throttle servo duty cycle (Q15)
+//    37      2     step output duty cycle (Q15)
+//    39      24    4 tasks (TELEMETRY_TASK_...), each the last and worst execution time
+//                  in instruction cycles (limited to 65535) and the missed deadlines
+//    63      2     frames dropped because the serial port's buffer was full
+//    65      2     CRC-16/CCITT-FALSE (polynomial 0x1021, starting from 0xFFFF) of bytes 0-64
+//A new field goes at the end of the payload along with a new TELEMETRY_VERSION, so that a
+//decoder can tell the two apart.
+
+#define TELEMETRY_VERSION 1
+
+//the receiver inputs, in the order they are in the frame
+#define TELEMETRY_INPUT_KILL_SWITCH 0
+#define TELEMETRY_INPUT_THROTTLE 1
+#define TELEMETRY_INPUT_STEERING 2
+#define TELEMETRY_INPUT_BRAKE 3
+#define TELEMETRY_NUMBER_OF_INPUTS 4
+
+//main_driver.c's tasks, in the order they are in the frame
+#define TELEMETRY_TASK_RECEIVER_INPUT 0
+#define TELEMETRY_TASK_KILL_SWITCH 1
+#define TELEMETRY_TASK_MIXING 2
+#define TELEMETRY_TASK_STEPPER 3
+#define TELEMETRY_NUMBER_OF_TASKS 4
+
+//the flags:  the lift and propulsion engines' relays (LATA0 and LATA1), whether the
+//failsafe has the receiver's signal as lost, and each input's signalValid
+#define TELEMETRY_FLAG_LIFT_RELAY 0x01
+#define TELEMETRY_FLAG_PROPULSION_RELAY 0x02
+#define TELEMETRY_FLAG_SIGNAL_LOST 0x04
+//TELEMETRY_FLAG_INPUT_VALID(TELEMETRY_INPUT_THROTTLE) is the throttle input's
+#define TELEMETRY_FLAG_INPUT_VALID(input) (0x10 << (input))
+
+#define TELEMETRY_PAYLOAD_SIZE 65
+#define TELEMETRY_CRC_SIZE 2
+//COBS adds 1 byte (for up to 254 bytes), and the frame ends with a 0
+#define TELEMETRY_ENCODED_SIZE (TELEMETRY_PAYLOAD_SIZE + TELEMETRY_CRC_SIZE + 2)
+
+//Telemetry_Decode's results
+#define TELEMETRY_DECODE_OK 0
+#define TELEMETRY_DECODE_BAD_ENCODING -1
+#define TELEMETRY_DECODE_BAD_LENGTH -2
+#define TELEMETRY_DECODE_BAD_CRC -3
+#define TELEMETRY_DECODE_UNKNOWN_VERSION -4
+
+typedef struct Telemetry_Input Telemetry_Input;
+typedef struct Telemetry_Task_Timing Telemetry_Task_Timing;
+typedef struct Telemetry_Frame Telemetry_Frame;
+typedef struct Telemetry_Receiver Telemetry_Receiver;
+
+struct Telemetry_Input
+{
+    //the same as IC_Fixed_Module's
+    uint16_t dutyCycle;
+    uint32_t periodTicks;
+};
+
+struct Telemetry_Task_Timing
+{
+    uint16_t lastExecutionCycles;
+    uint16_t worstExecutionCycles;
+    uint16_t missedDeadlines;
+};
+
+struct Telemetry_Frame
+{
+    //set by Telemetry_Send
+    uint8_t version;
+    uint8_t sequence;
+
+    //the rest is filled in by the caller
+    uint16_t tick;
+    uint8_t flags;
+    Telemetry_Input inputs[TELEMETRY_NUMBER_OF_INPUTS];
+    int16_t stepperCounts;
+    int16_t stepperTarget;
+    uint16_t stepRate;
+    uint16_t throttleServoDutyCycle;
+    uint16_t stepOutputDutyCycle;
+    Telemetry_Task_Timing tasks[TELEMETRY_NUMBER_OF_TASKS];
+
+    //set by Telemetry_Send
+    uint16_t droppedFrames;
+};
+
+//Puts a frame back together one received byte at a time (on a PC, or anything else that
+//reads the stream), see Telemetry_Receive
+struct Telemetry_Receiver
+{
+    //READ-ONLY
+    //the frames that were decoded, and the ones that were thrown out (a bad CRC, a bad
+    //length or encoding, or an unknown version)
+    uint32_t goodFrames;
+    uint32_t badFrames;
+    //the frames that were missing between two good ones, from their sequence numbers
+    uint32_t lostFrames;
+
+    //(only used by Telemetry_Receive)
+    uint8_t buffer[TELEMETRY_ENCODED_SIZE];
+    unsigned int length;
+    int overflowed;
+    int hasSequence;
+    uint8_t lastSequence;
+};
+
+//starts the sequence and the dropped frame count over
+void Telemetry_Initialize(void);
+
+//fills in the version, the sequence and the dropped frame count, and queues the frame on
+//the serial port
+//returns 1, or 0 if the serial port's buffer did not have room (the frame is dropped and
+//counted in the next one's droppedFrames)
+int Telemetry_Send(Telemetry_Frame* frame);
+
+//writes the frame as it is sent (COBS encoded, with its CRC and the 0 on the end) into
+//encoded, which has to have room for TELEMETRY_ENCODED_SIZE bytes, and returns its length
+unsigned int Telemetry_Encode(const Telemetry_Frame* frame, uint8_t* encoded);
+
+//decodes one frame from the length bytes before its 0 (the 0 itself is not included)
+//returns TELEMETRY_DECODE_OK and fills in *frame, or one of the errors above
+int Telemetry_Decode(const uint8_t* encoded, unsigned int length, Telemetry_Frame* frame);
+
+//the CRC-16/CCITT-FALSE of length bytes (0x29B1 for "123456789")
+uint16_t Telemetry_CRC16(const uint8_t* data, unsigned int length);
+
+//clears the receiver (if it starts in the middle of a frame, that frame is counted as bad)
+void Telemetry_Receiver_Initialize(Telemetry_Receiver* receiver);
+
+//hands the receiver the next byte from the stream
+//returns 1 when that byte finished a good frame (which is copied into *frame), or 0
+int Telemetry_Receive(Telemetry_Receiver* receiver, uint8_t byte, Telemetry_Frame* frame);
@@ -0,0 +1,177 @@
+/*
+ * File:    Timebase.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "Timebase.h"
+
+#define true 1
+#define false 0
+
+#define TIMEBASE_NUMBER_OF_TIMERS 5
+
+//OCTSEL and ICTSEL both count Fcy itself with 0b111
+#define TIMEBASE_FCY_CLOCK_SETTING 0b111
+
+//the longest a timer's period can be (PRx = 0xFFFF)
+#define TIMEBASE_FREE_RUNNING_TICKS 65536UL
+
+//every timer's control register has TON and TCKPS in the same place, so timer2's bit
+//definitions are used to access all of them
+typedef __typeof__(T2CONbits) Timebase_Control_Bits;
+
+typedef struct Timebase_Timer Timebase_Timer;
+
+struct Timebase_Timer
+{
+    Timebase_Control_Bits* control;
+    volatile uint16_t* counter;
+    volatile uint16_t* period;
+    //the OCTSEL and ICTSEL codes for this timer (they are not the same for timer2 and timer3)
+    unsigned int outputCompareClockSetting;
+    unsigned int inputCaptureClockSetting;
+    //true if Timebase_Request can hand it out
+    int shared;
+};
+
+//indexed by timer number - 1, see OCxCON1 (page 213) and ICxCON1 (page 204) in the
+//PIC24FJ128GA204 family documentation for the clock select codes
+static const Timebase_Timer Timebase_Timers[TIMEBASE_NUMBER_OF_TIMERS] =
+{
+    { (Timebase_Control_Bits*)&T1CON, &TMR1, &PR1, 0b100, 0b100, true },
+    { (Timebase_Control_Bits*)&T2CON, &TMR2, &PR2, 0b000, 0b001, false },
+    { (Timebase_Control_Bits*)&T3CON, &TMR3, &PR3, 0b001, 0b000, false },
+    { (Timebase_Control_Bits*)&T4CON, &TMR4, &PR4, 0b010, 0b010, true },
+    { (Timebase_Control_Bits*)&T5CON, &TMR5, &PR5, 0b011, 0b011, true },
+};
+
+//the prescalers a timer can have, as the number of bits they shift Fcy right by (fastest
+//first), and the TCKPS code for each
+static const unsigned int Timebase_Prescaler_Shifts[] = { 0, 3, 6, 8 };
+static const unsigned int Timebase_Prescaler_Settings[] = { 0b00, 0b01, 0b10, 0b11 };
+#define TIMEBASE_NUMBER_OF_PRESCALERS (sizeof(Timebase_Prescaler_Shifts) / sizeof(Timebase_Prescaler_Shifts[0]))
+
+//[0] is Fcy itself, and [n] is timer n (filled in when the timer is started)
+//A timer that is not running (TON = 0) is free, whatever its entry says, so the entries
+//never have to be cleared.
+static Timebase Timebases[TIMEBASE_NUMBER_OF_TIMERS + 1] =
+{
+    { 0, CLOCK_FCY, 0, TIMEBASE_FCY_CLOCK_SETTING, TIMEBASE_FCY_CLOCK_SETTING, 0, false },
+};
+
+//returns the index in Timebase_Prescaler_Shifts of the fastest rate that is at most
+//ticksPerSecond (or of the slowest rate, if all of them are faster)
+static unsigned int Timebase_Prescaler_For(uint32_t ticksPerSecond)
+{
+    unsigned int i;
+
+    for (i = 0; i < TIMEBASE_NUMBER_OF_PRESCALERS - 1; ++i)
+    {
+        if ((CLOCK_FCY >> Timebase_Prescaler_Shifts[i]) <= ticksPerSecond)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+//sets a timer up and starts it (the only place a timer is ever turned off, which is only
+//done while nothing uses it)
+static const Timebase* Timebase_Start(unsigned int timerNumber, unsigned int prescaler, uint32_t periodTicks, int dedicated)
+{
+    const Timebase_Timer* timer = &Timebase_Timers[timerNumber - 1];
+    Timebase* timebase = &Timebases[timerNumber];
+
+    //turns the timer off to configure it, with Fcy as its clock source
+    *(volatile uint16_t*)timer->control = 0x0000;
+    *timer->counter = 0;
+    //the timer restarts from 0 after it reaches PRx, so PRx + 1 ticks is one period
+    *timer->period = periodTicks - 1;
+    timer->control->TCKPS = Timebase_Prescaler_Settings[prescaler];
+
+    timebase->timer = timerNumber;
+    timebase->prescalerShift = Timebase_Prescaler_Shifts[prescaler];
+    timebase->ticksPerSecond = CLOCK_FCY >> timebase->prescalerShift;
+    timebase->outputCompareClockSetting = timer->outputCompareClockSetting;
+    timebase->inputCaptureClockSetting = timer->inputCaptureClockSetting;
+    timebase->counter = timer->counter;
+    timebase->dedicated = dedicated;
+
+    timer->control->TON = 1;
+
+    return timebase;
+}
+
+const Timebase* Timebase_Request(uint32_t ticksPerSecond)
+{
+    unsigned int prescaler = Timebase_Prescaler_For(ticksPerSecond);
+    unsigned int shift = Timebase_Prescaler_Shifts[prescaler];
+    const Timebase* slower = 0;
+    const Timebase* slowest = 0;
+    unsigned int freeTimer = 0;
+    unsigned int i;
+
+    if (shift == 0)
+    {
+        return &Timebases[0];
+    }
+
+    for (i = 1; i <= TIMEBASE_NUMBER_OF_TIMERS; ++i)
+    {
+        const Timebase* timebase = &Timebases[i];
+
+        if (!Timebase_Timers[i - 1].shared)
+        {
+            continue;
+        }
+
+        if (!Timebase_Timers[i - 1].control->TON)
+        {
+            if (freeTimer == 0)
+            {
+                freeTimer = i;
+            }
+            continue;
+        }
+
+        if (timebase->prescalerShift == shift)
+        {
+            return timebase;
+        }
+
+        //in case every shared timer is taken
+        if (timebase->prescalerShift > shift && (slower == 0 || timebase->prescalerShift < slower->prescalerShift))
+        {
+            slower = timebase;
+        }
+        if (slowest == 0 || timebase->prescalerShift > slowest->prescalerShift)
+        {
+            slowest = timebase;
+        }
+    }
+
+    if (freeTimer != 0)
+    {
+        return Timebase_Start(freeTimer, prescaler, TIMEBASE_FREE_RUNNING_TICKS, false);
+    }
+
+    return (slower != 0) ? slower : slowest;
+}
+
+const Timebase* Timebase_Request_For_Frequency(uint16_t frequency)
+{
+    //one period is at most 65535 ticks (OCxRS + 1, see PWM.c)
+    return Timebase_Request((uint32_t)frequency * 65535);
+}
+
+const Timebase* Timebase_Request_Dedicated(unsigned int timer, uint32_t ticksPerSecond, uint32_t periodTicks)
+{
+    if (Timebase_Timers[timer - 1].control->TON)
+    {
+        return Timebases[timer].dedicated ? &Timebases[timer] : 0;
+    }
+
+    return Timebase_Start(timer, Timebase_Prescaler_For(ticksPerSecond), periodTicks, true);
+}
@@ -0,0 +1,70 @@
+/*
+ * File:    Timebase.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "ClockConfiguration.h"
+
+//Hands out the PIC's five timers to the IC and OC modules (and anything else that counts
+//ticks), so that each timer is set up once and is never restarted under a module that is
+//already using it.
+//
+//A module asks for a tick rate with Timebase_Request and gets the fastest clock that is no
+//faster than that:  Fcy itself (which the IC and OC modules count without a timer), or
+//Fcy / 8, / 64 or / 256 from one of the shared timers (timer1, timer4 and timer5).  Every
+//module that asks for the same rate shares the same timer, and each new rate starts the
+//next free one.  A rate that is exactly one of those four is always given exactly, as long
+//as a shared timer is free or already runs at it.  Once all three are running at other
+//rates, the fastest of them that is still slower than the rate asked for is given instead
+//(or the slowest one, if all of them are faster).
+//
+//Timer2 and timer3 are never shared.  Timebase_Request_Dedicated gives one of them to a
+//single module that needs its own period or interrupt:  the scheduler's tick uses timer2,
+//and the Input Capture dependency's 32-bit timestamps use timer3.
+//The Benchmark and Profiler dependencies also take timer5 as a dedicated timer (both free
+//running at Fcy, so they can share it), so they only run in programs that need no more
+//than two shared rates (see Benchmark.h and Profiler.h).
+//
+//What main_driver.c ends up with:
+//    IC modules                  62.5kHz     timer1 (shared)
+//    throttle servo (50Hz)       Fcy / 8     timer4 (shared, see PWM_Servo)
+//    stepper step signal (OC2)   Fcy         no timer (see PWM_Fixed_Request_Clock)
+//    scheduler tick              Fcy         timer2 (dedicated)
+//    IC_32_BIT_TIMESTAMPS        Fcy         timer3 (dedicated)
+
+typedef struct Timebase Timebase;
+
+struct Timebase
+{
+    //1 - 5, or 0 for Fcy itself (no timer)
+    unsigned int timer;
+    //how fast the clock ticks, and its prescaler as the number of bits it shifts Fcy right by
+    uint32_t ticksPerSecond;
+    unsigned int prescalerShift;
+    //the OCTSEL and ICTSEL codes that count this clock
+    unsigned int outputCompareClockSetting;
+    unsigned int inputCaptureClockSetting;
+    //the timer's count (TMRx), or 0 (NULL) for Fcy
+    volatile uint16_t* counter;
+    //true if the timer belongs to one module (see Timebase_Request_Dedicated)
+    int dedicated;
+};
+
+//returns the fastest clock that ticks at most ticksPerSecond times a second, starting a
+//shared timer for it if none is running at that rate yet
+const Timebase* Timebase_Request(uint32_t ticksPerSecond);
+
+//returns the clock with the most ticks in one period of frequency (in Hz) that still fits
+//the period in 16 bits (e.g. for an OC module that never runs slower than frequency)
+const Timebase* Timebase_Request_For_Frequency(uint16_t frequency);
+
+//starts timer (1 - 5) for one module at the fastest rate that is at most ticksPerSecond,
+//rolling over every periodTicks ticks (1 - 65536), and returns it
+//If the module already has the timer it is returned as it is, so a module can call this from
+//every one of its Initialize functions.  Returns 0 (NULL) if the timer is running as a
+//shared timer.
+const Timebase* Timebase_Request_Dedicated(unsigned int timer, uint32_t ticksPerSecond, uint32_t periodTicks);
@@ -4,10 +4,14 @@
  */
 
 #include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
 
-//FCY is based off _XTAL_FREQ, the current system clock
-//(see system_configuration.h)
-#define FCY (_XTAL_FREQ / 2)
+//This program is built with CLOCK_PROFILE defined as CLOCK_PROFILE_FRC_PLL_32MHZ in the project's
+//compiler options (see Finalized Design/ReadMe.txt), which gives the throttle servo 26x the steps it
+//has on timer1.  At Fcy = 4MHz it only gets 7.9x.
+#if CLOCK_PROFILE != CLOCK_PROFILE_FRC_PLL_32MHZ
+#warning "main_driver.c is meant to be built with CLOCK_PROFILE_FRC_PLL_32MHZ (the throttle servo gets under 10x timer1's steps otherwise)"
+#endif
 
 #include <stdlib.h>
 #include <libpic30.h>
@@ -15,40 +19,197 @@
 
 #include "PWM.h"
 #include "InputCapture.h"
+#include "FixedPoint.h"
+#include "Scheduler.h"
+#include "StepperMotion.h"
+#include "InputFilter.h"
+#include "Profiler.h"
+#if defined(PROFILER_ENABLED) || defined(TELEMETRY_ENABLED)
+#include "SerialPort.h"
+#endif
+#ifdef TELEMETRY_ENABLED
+#include "Telemetry.h"
+#endif
+#ifdef RECEIVER_SBUS
+#include "SerialReceiver.h"
+#endif
+
+//All duty cycles in this file are Q15 fractions (32768 = 100%, see FixedPoint.h), so the control loop
+//only uses integer math.  Q15_FROM_PERCENTAGE is calculated by the compiler, not the PIC.
 
 //these were experimentally derived, so these may not be the optimal values
-#define SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE (double)5.563
-#define SWITCH_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE (double)12.453
-#define SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE (double)((SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE + SWITCH_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE) / 2)
+#define SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE Q15_FROM_PERCENTAGE(5.563)
+#define SWITCH_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE Q15_FROM_PERCENTAGE(12.453)
+#define SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE ((SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE + SWITCH_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE) / 2)
 
 //these were experimentally derived, so these may not be the optimal values
-#define THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE (double)5.563
-#define THROTTLE_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE (double)12.453
-#define THROTTLE_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE (double)((THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE + THROTTLE_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE) / 2)
+#define THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE Q15_FROM_PERCENTAGE(5.563)
+#define THROTTLE_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE Q15_FROM_PERCENTAGE(12.453)
+#define THROTTLE_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE ((THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE + THROTTLE_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE) / 2)
+
+#define STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE Q15_FROM_PERCENTAGE(7.462)
+#define STEERING_MAX_INPUT_SIGNAL_DUTY_CYCLE Q15_FROM_PERCENTAGE(13.813)
+#define STEERING_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE ((STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE + STEERING_MAX_INPUT_SIGNAL_DUTY_CYCLE) / 2)
+
+//the switch inputs take the median of the last 5 readings, so up to 2 bad readings in a row cannot flip
+//them, and a real flip gets through in 3 frames (60ms)
+//the throttle and steering inputs take the median of 3 readings (to throw out a single bad reading), then
+//average the result with the one before (iirShift 1), which gets halfway to a new input in 2 frames (40ms)
+//(see InputFilter.h for how these are measured)
+//These and the steering constants below can be changed from the compiler options (e.g. by the Host
+//Simulator's plant_simulator, to try other values without editing this file).
+#ifndef SWITCH_FILTER_MEDIAN_SIZE
+#define SWITCH_FILTER_MEDIAN_SIZE 5
+#endif
+#ifndef STICK_FILTER_MEDIAN_SIZE
+#define STICK_FILTER_MEDIAN_SIZE 3
+#endif
+#ifndef STICK_FILTER_IIR_SHIFT
+#define STICK_FILTER_IIR_SHIFT 1
+#endif
+
+//the receiver sends a new frame 50 times a second, so the tasks that use its inputs run at
+//the same rate, and the stepper motor is checked 10 times as often so that it stops close
+//to where it should
+#define RECEIVER_TASK_HZ 50
+#define STEPPER_TASK_HZ 500
+
+//with PROFILER_ENABLED defined, the profiler's table (see Profiler.h) is sent over the serial
+//port whenever a PROFILER_DUMP_COMMAND is received, and cleared by a PROFILER_RESET_COMMAND
+#define PROFILER_TASK_HZ 10
+#define PROFILER_DUMP_COMMAND 'p'
+#define PROFILER_RESET_COMMAND 'r'
+
+//with TELEMETRY_ENABLED defined, a telemetry frame (see Telemetry.h) is sent TELEMETRY_HZ times a
+//second.  A frame is 69 bytes, or 18ms at 38400 baud, so up to 25Hz leaves room on the serial port
+//for the profiler's table.  TELEMETRY_HZ has to divide evenly into SCHEDULER_TICK_HZ.
+#ifndef TELEMETRY_HZ
+#define TELEMETRY_HZ 10
+#endif
+
+//with RECEIVER_PPM defined, the receiver sends every channel on one wire (PPM) to RP4, where IC1 decodes
+//them (IC_PPM_MODULE has to be 1, see InputCapture.h), instead of one PWM output per input on RP4 - RP8,
+//which leaves IC2, IC3 and IC5 and their interrupts free.  The rest of the control loop reads each
+//channel through the same IC_Fixed_Modules (see IC_PPM_Read_Channel).  These are the receiver's channels
+//(counting from 0) for each input.
+#ifdef RECEIVER_PPM
+#if IC_PPM_MODULE != 1
+#error "RECEIVER_PPM needs IC_PPM_MODULE defined as 1 (IC1, on the kill switch's pin)"
+#endif
+#ifndef PPM_THROTTLE_CHANNEL
+#define PPM_THROTTLE_CHANNEL 2
+#endif
+#ifndef PPM_STEERING_CHANNEL
+#define PPM_STEERING_CHANNEL 3
+#endif
+#ifndef PPM_KILL_SWITCH_CHANNEL
+#define PPM_KILL_SWITCH_CHANNEL 4
+#endif
+#ifndef PPM_BRAKE_CHANNEL
+#define PPM_BRAKE_CHANNEL 5
+#endif
+#endif
+
+//with RECEIVER_SBUS defined, the receiver's SBUS output goes to RB15 instead, and UART1 reads every
+//channel from it (see SerialReceiver.h).  Its 0.625us steps give the control loop about 25 times the
+//resolution of a 16us capture tick.  UART1 is then taken, so the profiler and telemetry cannot be used
+//with it.  These are the receiver's channels (counting from 0) for each input.
+#ifdef RECEIVER_SBUS
+#if defined(RECEIVER_PPM) || defined(PROFILER_ENABLED) || defined(TELEMETRY_ENABLED)
+#error "RECEIVER_SBUS uses UART1, so it cannot be used with RECEIVER_PPM, PROFILER_ENABLED or TELEMETRY_ENABLED"
+#endif
+#ifndef SBUS_THROTTLE_CHANNEL
+#define SBUS_THROTTLE_CHANNEL 2
+#endif
+#ifndef SBUS_STEERING_CHANNEL
+#define SBUS_STEERING_CHANNEL 3
+#endif
+#ifndef SBUS_KILL_SWITCH_CHANNEL
+#define SBUS_KILL_SWITCH_CHANNEL 4
+#endif
+#ifndef SBUS_BRAKE_CHANNEL
+#define SBUS_BRAKE_CHANNEL 5
+#endif
+#endif
 
-#define STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE (double)7.462
-#define STEERING_MAX_INPUT_SIGNAL_DUTY_CYCLE (double)13.813
-#define STEERING_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE (double)((STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE + STEERING_MAX_INPUT_SIGNAL_DUTY_CYCLE) / 2)
+//Failsafe:  if any receiver input goes RECEIVER_SIGNAL_TIMEOUT_FRAMES frames without a pulse (the
+//transmitter is off, out of range, or a wire came loose), the engines' relays are turned off, the
+//throttle servo goes to idle and the stepper motor goes back to center until every input is back.
+//The extra half frame keeps a pulse that is a little late from counting as missed.
+//Worst case from the end of the last pulse to safe outputs:  the timeout (70ms), plus up to one
+//receiver task period before it is noticed (20ms), plus 1 scheduler tick (1ms), so the relays are off
+//within 91ms.  The throttle servo's new pulse width starts with its next 20ms period, within 111ms.
+#define RECEIVER_FRAME_MILLISECONDS (1000 / RECEIVER_TASK_HZ)
+#define RECEIVER_SIGNAL_TIMEOUT_FRAMES 3
+#define RECEIVER_SIGNAL_TIMEOUT_TICKS IC_MILLISECONDS_TO_TICKS(RECEIVER_SIGNAL_TIMEOUT_FRAMES * RECEIVER_FRAME_MILLISECONDS + RECEIVER_FRAME_MILLISECONDS / 2)
+
+//Kill switch fast path:  IC1's interrupt checks every kill switch pulse itself (see IC1_Set_Switch), and
+//turns the relays off as soon as KILL_SWITCH_DEBOUNCE_FRAMES pulses in a row are engaged, instead of
+//waiting for the switch's filter and the kill switch task (up to 3 frames plus a task period).  Worst
+//case from the switch being flipped to the relays off:  the rest of the frame the switch was flipped in
+//(20ms), the frames after it up to the last of the debounce frames (20ms more for 2), and that pulse
+//itself (up to 2.5ms), so about 42ms.  1 frame would trip on a single bad pulse, and 0 turns this off (the
+//relays are then only turned off by the kill switch task).  It only works on IC1's own pulses, so it is
+//not used with RECEIVER_PPM or RECEIVER_SBUS.
+//A pulse counts as engaged from the switch's midpoint up to KILL_SWITCH_ENGAGED_MAXIMUM_MICROSECONDS (a
+//pulse longer than any servo pulse is not a switch position).
+#ifndef KILL_SWITCH_DEBOUNCE_FRAMES
+#define KILL_SWITCH_DEBOUNCE_FRAMES 2
+#endif
+#define KILL_SWITCH_ENGAGED_MINIMUM_MICROSECONDS ((uint32_t)SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE * RECEIVER_FRAME_MILLISECONDS * 1000 / Q15_ONE)
+#define KILL_SWITCH_ENGAGED_MAXIMUM_MICROSECONDS 3000
 
 //Setting the INCREMENT_ADJUSTMENT_FACTOR to 100 achieves an output duty cycle that goes from 0% to 100%
 //make the INCREMENT_ADJUSTMENT_FACTOR smaller to make the maximum output duty cycle % smaller
 //make the INCREMENT_ADJUSTMENT_FACTOR larger to make the maximum output duty cycle % larger (not recommended as 100% should be the absolute max)
 #define THROTTLE_INCREMENT_ADJUSTMENT_FACTOR 10
-#define PROPULSION_THROTTLE_CYCLE_INCREMENT ((double)(THROTTLE_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE - THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE) / THROTTLE_INCREMENT_ADJUSTMENT_FACTOR)
-#define PROPULSION_THROTTLE_SERVO_OFFSET 1.8
+//the input's full range (minimum to maximum) is multiplied by this gain to make the output's full range
+//(INCREMENT_ADJUSTMENT_FACTOR percent), it is a Q12 number so 4096 represents a gain of 1.0
+#define PROPULSION_THROTTLE_GAIN_SHIFT 12
+#define PROPULSION_THROTTLE_GAIN ((int32_t)((double)Q15_FROM_PERCENTAGE(THROTTLE_INCREMENT_ADJUSTMENT_FACTOR) * (1L << PROPULSION_THROTTLE_GAIN_SHIFT) / (THROTTLE_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE - THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE) + 0.5))
+#define PROPULSION_THROTTLE_SERVO_OFFSET Q15_FROM_PERCENTAGE(1.8)
 
+//the steering input is turned into a location from 0 to STEERING_INCREMENT_ADJUSTMENT_FACTOR, which is stored
+//in 1/16ths of a step (0-1600) so that it keeps the precision it had as a double
 #define STEERING_INCREMENT_ADJUSTMENT_FACTOR 100
-#define PROPULSION_STEERING_CYCLE_INCREMENT ((double)(STEERING_MAX_INPUT_SIGNAL_DUTY_CYCLE - STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE) / STEERING_INCREMENT_ADJUSTMENT_FACTOR)
+#define STEERING_LOCATION_SCALE 16
+//a Q15 number (32768 = 1.0) that converts the input duty cycle to that location
+#define PROPULSION_STEERING_GAIN_SHIFT 15
+#define PROPULSION_STEERING_GAIN ((int32_t)((double)STEERING_INCREMENT_ADJUSTMENT_FACTOR * STEERING_LOCATION_SCALE * (1L << PROPULSION_STEERING_GAIN_SHIFT) / (STEERING_MAX_INPUT_SIGNAL_DUTY_CYCLE - STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE) + 0.5))
 
 //this dead zone will be used to prevent the user from turning the propulsion motor without intentionally
 //moving the left joystick to the left or right.
 #define DEAD_ZONE_OFFSET 10
 
+//the steering location (0-100) has to move more than this from where the motor was last sent before it is
+//sent somewhere new, so jitter in the steering input does not keep the motor hunting back and forth
+#ifndef STEERING_HYSTERESIS
+#define STEERING_HYSTERESIS 2
+#endif
+//stepper motor targets within this many counts of center are treated as center (the dead band around the
+//steering stick's center)
+#ifndef STEERING_DEAD_BAND_COUNTS
+#define STEERING_DEAD_BAND_COUNTS 32
+#endif
+
 #define ROUNDING_OFFSET 0.5
 
 #define COUNTS_FOR_90_DEGREE_TURN 706
 #define COUNTS_FOR_180_DEGREE_TURN 1412
 
+//the stepper motor's step rate profile (see StepperMotion.h)
+//it used to always step at 400Hz, so that is still where every move starts and ends
+//these may not be the optimal values, and should be checked on the motor
+#ifndef STEPPER_START_STEP_RATE
+#define STEPPER_START_STEP_RATE 400
+#endif
+#ifndef STEPPER_MAXIMUM_STEP_RATE
+#define STEPPER_MAXIMUM_STEP_RATE 1600
+#endif
+#ifndef STEPPER_ACCELERATION
+#define STEPPER_ACCELERATION 4000
+#endif
+
 //basic initialization for all pins
 void PIC_Initialization(void)
 {
@@ -63,19 +224,19 @@ void PIC_Initialization(void)
     Nop();
 }
 
-void IC_Module_Initialize(IC_Module* kill_switch_input, IC_Module* propulsion_throttle_servo_input, IC_Module* propulsion_direction_motor_input, IC_Module* propulsion_brake_input, Count_Monitor* stepper_motor_counter_input)
+void IC_Module_Initialize(IC_Fixed_Module* kill_switch_input, IC_Fixed_Module* propulsion_throttle_servo_input, IC_Fixed_Module* propulsion_direction_motor_input, IC_Fixed_Module* propulsion_brake_input, Count_Monitor* stepper_motor_counter_input)
 {
-    kill_switch_input->Initialize = IC1_Initialize;
-    kill_switch_input->Update = IC1_Update;
+    kill_switch_input->Initialize = IC1_Fixed_Initialize;
+    kill_switch_input->Update = IC1_Fixed_Update;
     
-    propulsion_throttle_servo_input->Initialize = IC2_Initialize;
-    propulsion_throttle_servo_input->Update = IC2_Update;
+    propulsion_throttle_servo_input->Initialize = IC2_Fixed_Initialize;
+    propulsion_throttle_servo_input->Update = IC2_Fixed_Update;
 	
-	propulsion_direction_motor_input->Initialize = IC3_Initialize;
-	propulsion_direction_motor_input->Update = IC3_Update;
+	propulsion_direction_motor_input->Initialize = IC3_Fixed_Initialize;
+	propulsion_direction_motor_input->Update = IC3_Fixed_Update;
 	
-	propulsion_brake_input->Initialize = IC5_Initialize;
-	propulsion_brake_input->Update = IC5_Update;
+	propulsion_brake_input->Initialize = IC5_Fixed_Initialize;
+	propulsion_brake_input->Update = IC5_Fixed_Update;
     
     stepper_motor_counter_input->Initialize = IC4_Initialize;
     stepper_motor_counter_input->Update = IC4_Update;
@@ -83,19 +244,17 @@ void IC_Module_Initialize(IC_Module* kill_switch_input, IC_Module* propulsion_th
 	
 }
 
-void PWM_Module_Initialize(PWM_Module* propulsion_thrust_servo_output, PWM_Module* duration_to_turn_propulsion_engine_output)
+void PWM_Module_Initialize(PWM_Fixed_Module* propulsion_thrust_servo_output, PWM_Fixed_Module* duration_to_turn_propulsion_engine_output)
 {
-    propulsion_thrust_servo_output->Initialize = PWM_OC1_Initialize;
-    propulsion_thrust_servo_output->GetDutyCycle = PWM_Get_OC1_DutyCycle;
-    propulsion_thrust_servo_output->GetFrequency = PWM_Get_OC1_Frequency;
-    propulsion_thrust_servo_output->UpdateDutyCycle = PWM_Update_OC1_DutyCycle;
-    propulsion_thrust_servo_output->UpdateFrequency = PWM_Update_OC1_Frequency;
-    
-    duration_to_turn_propulsion_engine_output->Initialize = PWM_OC2_Initialize;
-    duration_to_turn_propulsion_engine_output->GetDutyCycle = PWM_Get_OC2_DutyCycle;
-    duration_to_turn_propulsion_engine_output->GetFrequency = PWM_Get_OC2_Frequency;
-    duration_to_turn_propulsion_engine_output->UpdateDutyCycle = PWM_Update_OC2_DutyCycle;
-    duration_to_turn_propulsion_engine_output->UpdateFrequency = PWM_Update_OC2_Frequency;
+    propulsion_thrust_servo_output->Initialize = PWM_OC1_Fixed_Initialize;
+    propulsion_thrust_servo_output->UpdateDutyCycle = PWM_Update_OC1_Fixed_DutyCycle;
+    propulsion_thrust_servo_output->UpdateFrequency = PWM_Update_OC1_Fixed_Frequency;
+    propulsion_thrust_servo_output->SetHighTicks = PWM_Set_OC1_High_Ticks;
+    
+    duration_to_turn_propulsion_engine_output->Initialize = PWM_OC2_Fixed_Initialize;
+    duration_to_turn_propulsion_engine_output->UpdateDutyCycle = PWM_Update_OC2_Fixed_DutyCycle;
+    duration_to_turn_propulsion_engine_output->UpdateFrequency = PWM_Update_OC2_Fixed_Frequency;
+    duration_to_turn_propulsion_engine_output->SetHighTicks = PWM_Set_OC2_High_Ticks;
 }
 
 void Kill_Switch_Initialize(void)
@@ -105,186 +264,473 @@ void Kill_Switch_Initialize(void)
 	LATAbits.LATA1 = 0;
 }
 
-int main(void)
+//called by IC1's interrupt when the kill switch is engaged (see KILL_SWITCH_DEBOUNCE_FRAMES)
+//each line is a single BCLR instruction, so neither can be lost in the middle of the main program writing to LATA,
+//as long as the main program only ever writes LATA with constant bit stores (LATAbits.LATAx = 0 or 1, which are
+//BSET/BCLR too).  Writing a computed value or the whole register reads LATA, changes it and writes it back,
+//which would turn the relays back on if IC1's interrupt trips in between (see Stepper_Motion_Start).
+void Kill_Switch_Trip(void)
+{
+	LATAbits.LATA0 = 0;
+	LATAbits.LATA1 = 0;
+}
+
+//every input and output used by the control loop
+IC_Fixed_Module kill_switch_input;
+IC_Fixed_Module propulsion_throttle_servo_input;
+IC_Fixed_Module propulsion_direction_motor_input;
+IC_Fixed_Module propulsion_brake_input;
+Count_Monitor stepper_motor_counter_input;
+#ifdef RECEIVER_PPM
+//every receiver channel, which the four inputs above are filled in from
+IC_PPM_Module receiver_ppm;
+#endif
+#ifdef RECEIVER_SBUS
+Serial_Receiver receiver_sbus;
+#endif
+
+PWM_Fixed_Module propulsion_throttle_servo_output;
+PWM_Fixed_Module turn_propulsion_engine_output;
+//the throttle servo's new pulse widths are only written at the start of one of its periods, so
+//a change can never cut a pulse short or stretch one into the next period (see PWM_Group)
+PWM_Group propulsion_throttle_servo_group;
+//runs the throttle servo on the clock with the most ticks per 20ms frame (see PWM_Servo), so the
+//same Q15 duty cycles from the mixing task give it 32x finer steps than the 62.5kHz clock at
+//Fcy = 16MHz (8x at 4MHz)
+PWM_Servo propulsion_throttle_servo;
+
+//the filtered receiver inputs (see SWITCH_FILTER_MEDIAN_SIZE), their outputs are what the tasks use
+Input_Filter propulsion_throttle_filter = { STICK_FILTER_MEDIAN_SIZE, STICK_FILTER_IIR_SHIFT, 0 };
+Input_Filter propulsion_steering_filter = { STICK_FILTER_MEDIAN_SIZE, STICK_FILTER_IIR_SHIFT, 0 };
+Input_Filter kill_switch_filter = { SWITCH_FILTER_MEDIAN_SIZE, 0, 0 };
+Input_Filter brake_switch_filter = { SWITCH_FILTER_MEDIAN_SIZE, 0, 0 };
+//in 1/STEERING_LOCATION_SCALE steps
+int previousPositionOfPropulsionMotor = 0;
+//moves the stepper motor to where the mixing task wants it
+Stepper_Motion stepper_motion;
+//1 while any receiver input has no signal (see RECEIVER_SIGNAL_TIMEOUT_FRAMES), which is also the
+//case until every input has sent its first pulses
+int receiverSignalLost = 1;
+
+void Receiver_Input_Task_Run(void);
+void Kill_Switch_Task_Run(void);
+void Mixing_Task_Run(void);
+void Stepper_Task_Run(void);
+#ifdef PROFILER_ENABLED
+void Profiler_Task_Run(void);
+#endif
+#ifdef TELEMETRY_ENABLED
+void Telemetry_Task_Run(void);
+#endif
+
+//these run in this order whenever more than one is due on the same tick, so the inputs
+//are always read before they are used
+Scheduler_Task receiver_input_task = { Receiver_Input_Task_Run, SCHEDULER_HZ_TO_TICKS(RECEIVER_TASK_HZ) };
+Scheduler_Task kill_switch_task = { Kill_Switch_Task_Run, SCHEDULER_HZ_TO_TICKS(RECEIVER_TASK_HZ) };
+Scheduler_Task mixing_task = { Mixing_Task_Run, SCHEDULER_HZ_TO_TICKS(RECEIVER_TASK_HZ) };
+Scheduler_Task stepper_task = { Stepper_Task_Run, SCHEDULER_HZ_TO_TICKS(STEPPER_TASK_HZ) };
+#ifdef PROFILER_ENABLED
+Scheduler_Task profiler_task = { Profiler_Task_Run, SCHEDULER_HZ_TO_TICKS(PROFILER_TASK_HZ) };
+#endif
+#ifdef TELEMETRY_ENABLED
+Scheduler_Task telemetry_task = { Telemetry_Task_Run, SCHEDULER_HZ_TO_TICKS(TELEMETRY_HZ) };
+#endif
+
+void Hovercraft_Initialize(void)
 {
-	double averagedPropulsionThrottleDutyCycle = SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE;
-	double averagedPropulsionSteeringDutyCycle = STEERING_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE;
-    double averagedKillSwitchDutyCycle = SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE;
-    double averagedBrakeSwitchDutyCycle = SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE;
-    double previousPositionOfPropulsionMotor = 0;
-	
     SYSTEM_Initialize();
+    //every timing constant assumes the clock profile's oscillator (see ClockConfiguration.h), so if
+    //it did not start, nothing else is set up and every pin stays an input
+    if (!Clock_Initialize())
+    {
+        while (1)
+        {
+        }
+    }
     PIC_Initialization();
 	Kill_Switch_Initialize();
     
-    IC_Module kill_switch_input;
-    IC_Module propulsion_throttle_servo_input;
-	IC_Module propulsion_direction_motor_input;
-	IC_Module propulsion_brake_input;
-    Count_Monitor stepper_motor_counter_input;
     IC_Module_Initialize(&kill_switch_input, &propulsion_throttle_servo_input, &propulsion_direction_motor_input, &propulsion_brake_input, &stepper_motor_counter_input);
-    
-    PWM_Module propulsion_throttle_servo_output;
-    PWM_Module turn_propulsion_engine_output;
     PWM_Module_Initialize(&propulsion_throttle_servo_output, &turn_propulsion_engine_output);
 	
+#if defined(RECEIVER_PPM)
+    IC_PPM_Initialize(&receiver_ppm);
+#elif defined(RECEIVER_SBUS)
+    Serial_Receiver_Initialize(&receiver_sbus);
+#else
     kill_switch_input.Initialize(&kill_switch_input);
     propulsion_throttle_servo_input.Initialize(&propulsion_throttle_servo_input);
     propulsion_direction_motor_input.Initialize(&propulsion_direction_motor_input);
 	propulsion_brake_input.Initialize(&propulsion_brake_input);
+#if KILL_SWITCH_DEBOUNCE_FRAMES > 0
+    IC1_Set_Switch(IC_MICROSECONDS_TO_TICKS(KILL_SWITCH_ENGAGED_MINIMUM_MICROSECONDS), IC_MICROSECONDS_TO_TICKS(KILL_SWITCH_ENGAGED_MAXIMUM_MICROSECONDS), KILL_SWITCH_DEBOUNCE_FRAMES, Kill_Switch_Trip);
+#endif
+#endif
     stepper_motor_counter_input.Initialize(&stepper_motor_counter_input);
     
+    //the inputs start out where they were before the filters had any readings:  no throttle, steering
+    //centered, and both switches off
+    Input_Filter_Initialize(&propulsion_throttle_filter, THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE);
+    Input_Filter_Initialize(&propulsion_steering_filter, STEERING_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE);
+    Input_Filter_Initialize(&kill_switch_filter, SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE);
+    Input_Filter_Initialize(&brake_switch_filter, SWITCH_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE);
+    
+    kill_switch_input.signalTimeoutTicks = RECEIVER_SIGNAL_TIMEOUT_TICKS;
+    propulsion_throttle_servo_input.signalTimeoutTicks = RECEIVER_SIGNAL_TIMEOUT_TICKS;
+    propulsion_direction_motor_input.signalTimeoutTicks = RECEIVER_SIGNAL_TIMEOUT_TICKS;
+    propulsion_brake_input.signalTimeoutTicks = RECEIVER_SIGNAL_TIMEOUT_TICKS;
+#ifdef RECEIVER_PPM
+    receiver_ppm.signalTimeoutTicks = RECEIVER_SIGNAL_TIMEOUT_TICKS;
+#endif
+#ifdef RECEIVER_SBUS
+    receiver_sbus.signalTimeoutTicks = SERIAL_RECEIVER_MILLISECONDS_TO_TICKS(RECEIVER_SIGNAL_TIMEOUT_FRAMES * RECEIVER_FRAME_MILLISECONDS + RECEIVER_FRAME_MILLISECONDS / 2);
+#endif
+    
     propulsion_throttle_servo_output.Initialize(&propulsion_throttle_servo_output);
     turn_propulsion_engine_output.Initialize(&turn_propulsion_engine_output);
     
     propulsion_throttle_servo_output.frequency = 50;
     propulsion_throttle_servo_output.UpdateFrequency(&propulsion_throttle_servo_output);
+    propulsion_throttle_servo.output = &propulsion_throttle_servo_output;
+    propulsion_throttle_servo.frameRate = 50;
+    PWM_Servo_Initialize(&propulsion_throttle_servo);
+    propulsion_throttle_servo_group.modules[0] = &propulsion_throttle_servo_output;
+    propulsion_throttle_servo_group.numberOfModules = 1;
+    PWM_Group_Initialize(&propulsion_throttle_servo_group);
     
     turn_propulsion_engine_output.frequency = 400;
     turn_propulsion_engine_output.UpdateFrequency(&turn_propulsion_engine_output);
-    turn_propulsion_engine_output.dutyCyclePercentage = 0;
+    //the step rate never drops below STEPPER_START_STEP_RATE, so the step signal can run from Fcy
+    //instead of sharing the 62.5kHz clock with the IC modules, which times every step rate exactly
+    //(1600 steps a second is 2500 ticks at Fcy = 4MHz, instead of 39, which was really 1603)
+    (void)PWM_Fixed_Request_Clock(&turn_propulsion_engine_output, STEPPER_START_STEP_RATE);
+    turn_propulsion_engine_output.dutyCycle = 0;
     turn_propulsion_engine_output.UpdateDutyCycle(&turn_propulsion_engine_output);
+    
+    stepper_motion.stepOutput = &turn_propulsion_engine_output;
+    stepper_motion.counter = &stepper_motor_counter_input;
+    stepper_motion.startStepRate = STEPPER_START_STEP_RATE;
+    stepper_motion.maximumStepRate = STEPPER_MAXIMUM_STEP_RATE;
+    stepper_motion.acceleration = STEPPER_ACCELERATION;
+    stepper_motion.updateRate = STEPPER_TASK_HZ;
+    Stepper_Motion_Initialize(&stepper_motion);
     __delay_ms(1000);
     
-    while(true)
+#if defined(PROFILER_ENABLED) || defined(TELEMETRY_ENABLED)
+    Serial_Port_Initialize();
+#endif
+#ifdef PROFILER_ENABLED
+    //timer5 is free in this program, and the profile starts with the control loop (not the delay)
+    (void)Profiler_Initialize();
+#endif
+#ifdef TELEMETRY_ENABLED
+    Telemetry_Initialize();
+#endif
+    
+    //the tasks are added last, so that their first run is not already late because of the delay
+    Scheduler_Initialize();
+    Scheduler_Add_Task(&receiver_input_task);
+    Scheduler_Add_Task(&kill_switch_task);
+    Scheduler_Add_Task(&mixing_task);
+    Scheduler_Add_Task(&stepper_task);
+#ifdef PROFILER_ENABLED
+    Scheduler_Add_Task(&profiler_task);
+#endif
+#ifdef TELEMETRY_ENABLED
+    //last, so each frame has the results of the tasks that ran on the same tick
+    Scheduler_Add_Task(&telemetry_task);
+#endif
+}
+
+//reads every receiver input and filters them (RECEIVER_TASK_HZ)
+void Receiver_Input_Task_Run(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_IC_UPDATE);
+#if defined(RECEIVER_PPM)
+    //one copy of the newest frame, so all four inputs are from the same one
+    IC_PPM_Update(&receiver_ppm);
+    IC_PPM_Read_Channel(&receiver_ppm, PPM_KILL_SWITCH_CHANNEL, &kill_switch_input);
+    IC_PPM_Read_Channel(&receiver_ppm, PPM_STEERING_CHANNEL, &propulsion_direction_motor_input);
+    IC_PPM_Read_Channel(&receiver_ppm, PPM_THROTTLE_CHANNEL, &propulsion_throttle_servo_input);
+    IC_PPM_Read_Channel(&receiver_ppm, PPM_BRAKE_CHANNEL, &propulsion_brake_input);
+#elif defined(RECEIVER_SBUS)
+    Serial_Receiver_Update(&receiver_sbus);
+    Serial_Receiver_Read_Channel(&receiver_sbus, SBUS_KILL_SWITCH_CHANNEL, &kill_switch_input);
+    Serial_Receiver_Read_Channel(&receiver_sbus, SBUS_STEERING_CHANNEL, &propulsion_direction_motor_input);
+    Serial_Receiver_Read_Channel(&receiver_sbus, SBUS_THROTTLE_CHANNEL, &propulsion_throttle_servo_input);
+    Serial_Receiver_Read_Channel(&receiver_sbus, SBUS_BRAKE_CHANNEL, &propulsion_brake_input);
+#else
+	kill_switch_input.Update(&kill_switch_input);
+	propulsion_direction_motor_input.Update(&propulsion_direction_motor_input);
+	propulsion_throttle_servo_input.Update(&propulsion_throttle_servo_input);
+	propulsion_brake_input.Update(&propulsion_brake_input);
+#endif
+    PROFILER_END(PROFILER_SITE_IC_UPDATE);
+    
+    receiverSignalLost = !kill_switch_input.signalValid || !propulsion_direction_motor_input.signalValid || !propulsion_throttle_servo_input.signalValid || !propulsion_brake_input.signalValid;
+    
+    //the inputs keep their last readings while there is no signal, so those are not filtered in
+    if (receiverSignalLost)
     {
-		kill_switch_input.Update(&kill_switch_input);
-        averagedKillSwitchDutyCycle = (100 * averagedKillSwitchDutyCycle + kill_switch_input.dutyCyclePercentage) / 101;
-		propulsion_direction_motor_input.Update(&propulsion_direction_motor_input);
-        averagedPropulsionSteeringDutyCycle = (averagedPropulsionSteeringDutyCycle + propulsion_direction_motor_input.dutyCyclePercentage) / 2;
-		propulsion_throttle_servo_input.Update(&propulsion_throttle_servo_input);
-		averagedPropulsionThrottleDutyCycle = (averagedPropulsionThrottleDutyCycle + propulsion_throttle_servo_input.dutyCyclePercentage) / 2;
-        
-        //this is to regulate the duty cycle that is sent to the servo so that it falls within the acceptable range for
-        //the servo that is being used by the project.
-        //this duty cycle should be approximately between 5% and 15% (with 10% being directly in the center, or 90 degrees of motion in a 180 degree servo)
-        propulsion_throttle_servo_output.dutyCyclePercentage = (averagedPropulsionThrottleDutyCycle - THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE) / PROPULSION_THROTTLE_CYCLE_INCREMENT + PROPULSION_THROTTLE_SERVO_OFFSET;
+        //the kill switch's filter starts over from fully engaged, so the engines only come back on
+        //once the switch has been read as off for 3 frames after the signal returns
+        Input_Filter_Initialize(&kill_switch_filter, SWITCH_MAXIMUM_INPUT_SIGNAL_DUTY_CYCLE);
+        return;
+    }
+    
+    Input_Filter_Update(&kill_switch_filter, kill_switch_input.dutyCycle);
+    Input_Filter_Update(&propulsion_steering_filter, propulsion_direction_motor_input.dutyCycle);
+    Input_Filter_Update(&propulsion_throttle_filter, propulsion_throttle_servo_input.dutyCycle);
+    Input_Filter_Update(&brake_switch_filter, propulsion_brake_input.dutyCycle);
+}
+
+//turns the engines' relays on or off based on the kill switch (RECEIVER_TASK_HZ)
+void Kill_Switch_Task_Run(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_KILL_SWITCH);
+    
+    //the relays stay off while IC1's interrupt still sees the kill switch engaged, even before its
+    //filter has caught up
+    if (receiverSignalLost || IC1_Switch_Is_On())
+    {
+        LATAbits.LATA0 = 0;
+        LATAbits.LATA1 = 0;
+    }
+    //This is here to account for minor variations that put the input duty cycle above or below
+    //the minimum or maximum input signal duty (which could cause undefined behavior on the output signal)
+    //this is a binary interpretation of an input signal that could have multiple values, treating it like the switch it represents
+    else if (kill_switch_filter.output < SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE || (LATBbits.LATB4 == 1 && LATBbits.LATB5 == 1 && LATBbits.LATB6 == 1 && LATBbits.LATB8 == 1))
+    {
+        LATAbits.LATA0 = 1;
+        LATAbits.LATA1 = 1;
         
-        //This is here to account for minor variations that put the input duty cycle above or below
-        //the minimum or maximum input signal duty (which could cause undefined behavior on the output signal)
-        //if, for whatever reason, the duty cycle that is sent to the servo is below 0% or above 100%, this will
-        //regulate the duty cycle to remain within acceptable values
-        if (propulsion_throttle_servo_output.dutyCyclePercentage < 0)
+        //IC1's interrupt sets the switch on before it calls Kill_Switch_Trip, so if it tripped anywhere
+        //between the check above and here, the switch is on now and the relays go back off (they are
+        //only on for a few instructions, far too short for a relay to close)
+        if (IC1_Switch_Is_On())
         {
-            propulsion_throttle_servo_output.dutyCyclePercentage = 0;
-        }
-        else if (propulsion_throttle_servo_output.dutyCyclePercentage > 100)
-        {
-            propulsion_throttle_servo_output.dutyCyclePercentage = 100;
+            LATAbits.LATA0 = 0;
+            LATAbits.LATA1 = 0;
         }
+    }
+    else if (kill_switch_filter.output >= SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE)
+    {
+        LATAbits.LATA0 = 0;
+        LATAbits.LATA1 = 0;
+    }
+    
+    PROFILER_END(PROFILER_SITE_KILL_SWITCH);
+}
+
+//turns the throttle and steering inputs into the throttle servo's position and the
+//stepper motor's target location (RECEIVER_TASK_HZ)
+void Mixing_Task_Run(void)
+{
+    if (receiverSignalLost)
+    {
+        //the throttle servo's position for the minimum throttle input, and the stepper motor centered
+        PWM_Group_Stage_DutyCycle(&propulsion_throttle_servo_group, 0, PROPULSION_THROTTLE_SERVO_OFFSET);
+        PWM_Group_Commit(&propulsion_throttle_servo_group);
+        Stepper_Motion_Set_Target(&stepper_motion, 0);
+        return;
+    }
+    
+    //this is to regulate the duty cycle that is sent to the servo so that it falls within the acceptable range for
+    //the servo that is being used by the project.
+    //this duty cycle should be approximately between 5% and 15% (with 10% being directly in the center, or 90 degrees of motion in a 180 degree servo)
+    int32_t throttleServoDutyCycle = ((((int32_t)propulsion_throttle_filter.output - THROTTLE_MINIMUM_INPUT_SIGNAL_DUTY_CYCLE) * PROPULSION_THROTTLE_GAIN) >> PROPULSION_THROTTLE_GAIN_SHIFT) + PROPULSION_THROTTLE_SERVO_OFFSET;
+    
+    //This is here to account for minor variations that put the input duty cycle above or below
+    //the minimum or maximum input signal duty (which could cause undefined behavior on the output signal)
+    //if, for whatever reason, the duty cycle that is sent to the servo is below 0% or above 100%, this will
+    //regulate the duty cycle to remain within acceptable values
+    if (throttleServoDutyCycle < 0)
+    {
+        throttleServoDutyCycle = 0;
+    }
+    else if (throttleServoDutyCycle > Q15_ONE)
+    {
+        throttleServoDutyCycle = Q15_ONE;
+    }
+    
+    PWM_Group_Stage_DutyCycle(&propulsion_throttle_servo_group, 0, (Q15)throttleServoDutyCycle);
+    PWM_Group_Commit(&propulsion_throttle_servo_group);
+    
+    PROFILER_BEGIN(PROFILER_SITE_STEERING_MAPPING);
+	int discreteLocation = 0;
+    if (brake_switch_filter.output < SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE)
+    {
+		//represents a leftward turn of the propulsion engine
+		//at the moment, the frequency of the PWM signal * the number of counts per trigger = 800 (counts per rotation) * rotations per second
+		//this will allow for smooth movement of the stepper motor
+		//if PWM frequency * counts per trigger > 800 * RPS, then the user input will experience a delay in controlling the stepper motor
+		//if PWM frequency * counts per trigger < 800 * RPS, then the user input will cause jerking in the stepper motor response
+		//preciseLocation goes from 0-100, in 1/16th steps (see STEERING_LOCATION_SCALE)
+		int32_t preciseLocation = (((int32_t)propulsion_steering_filter.output - STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE) * PROPULSION_STEERING_GAIN) >> PROPULSION_STEERING_GAIN_SHIFT;
         
-        propulsion_throttle_servo_output.UpdateDutyCycle(&propulsion_throttle_servo_output);
-        
-        //This is here to account for minor variations that put the input duty cycle above or below
-        //the minimum or maximum input signal duty (which could cause undefined behavior on the output signal)
-        //this is a binary interpretation of an input signal that could have multiple values, treating it like the switch it represents
-        if (averagedKillSwitchDutyCycle < SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE || (LATBbits.LATB4 == 1 && LATBbits.LATB5 == 1 && LATBbits.LATB6 == 1 && LATBbits.LATB8 == 1))
+        if (preciseLocation < 0)
         {
-            LATAbits.LATA0 = 1;
-            LATAbits.LATA1 = 1;
+            preciseLocation = 0;
         }
-        else if (averagedKillSwitchDutyCycle >= SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE)
+        else if (preciseLocation > 100 * STEERING_LOCATION_SCALE)
         {
-            LATAbits.LATA0 = 0;
-            LATAbits.LATA1 = 0;
+            preciseLocation = 100 * STEERING_LOCATION_SCALE;
         }
-		
-		propulsion_brake_input.Update(&propulsion_brake_input);
-        averagedBrakeSwitchDutyCycle = (100 * averagedBrakeSwitchDutyCycle + propulsion_brake_input.dutyCyclePercentage) / 101;
-		
         
-		int discreteLocation = 0;
-        if (averagedBrakeSwitchDutyCycle < SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE)
+        if (preciseLocation < previousPositionOfPropulsionMotor + STEERING_HYSTERESIS * STEERING_LOCATION_SCALE && preciseLocation > previousPositionOfPropulsionMotor - STEERING_HYSTERESIS * STEERING_LOCATION_SCALE)
         {
-			//represents a leftward turn of the propulsion engine
-			//at the moment, the frequency of the PWM signal * the number of counts per trigger = 800 (counts per rotation) * rotations per second
-			//this will allow for smooth movement of the stepper motor
-			//if PWM frequency * counts per trigger > 800 * RPS, then the user input will experience a delay in controlling the stepper motor
-			//if PWM frequency * counts per trigger < 800 * RPS, then the user input will cause jerking in the stepper motor response
-			double preciseLocation = (averagedPropulsionSteeringDutyCycle - STEERING_MIN_INPUT_SIGNAL_DUTY_CYCLE) / PROPULSION_STEERING_CYCLE_INCREMENT;
-            
-            if (preciseLocation < 0)
-            {
-                preciseLocation = 0;
-            }
-            else if (preciseLocation > 100)
-            {
-                preciseLocation = 100;
-            }
-            
-            if (preciseLocation < previousPositionOfPropulsionMotor + 2 && preciseLocation > previousPositionOfPropulsionMotor - 2)
-            {
-                preciseLocation = previousPositionOfPropulsionMotor;
-            }
-            else
-            {
-                previousPositionOfPropulsionMotor = preciseLocation;
-            }
-            
-			//changes the values of preciseLocation from 0-100 to a -200 to 200 scale with a dead zone on either end of the controller
-			preciseLocation = (preciseLocation - 50) * 16;
-            
-
-            discreteLocation = (int)(preciseLocation);
-			
-			if (discreteLocation >= -32 && discreteLocation <= 32)
-			{
-				discreteLocation = 0;
-			}
-			//these are made 201 so that when they are averaged out with the current numberOfCounts, it will eventually reach 200 and -200
-			else if (discreteLocation > COUNTS_FOR_90_DEGREE_TURN + 1)
-			{
-				discreteLocation = COUNTS_FOR_90_DEGREE_TURN + 1;
-			}
-			else if (discreteLocation < -COUNTS_FOR_90_DEGREE_TURN - 1)
-			{
-				discreteLocation = -COUNTS_FOR_90_DEGREE_TURN - 1;
-			}
+            preciseLocation = previousPositionOfPropulsionMotor;
         }
-        else if (averagedBrakeSwitchDutyCycle >= SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE)
+        else
         {
-			if (stepper_motor_counter_input.numberOfCounts >= 0)
-			{
-				discreteLocation = COUNTS_FOR_180_DEGREE_TURN;
-			}
-			else if (stepper_motor_counter_input.numberOfCounts < 0)
-			{
-				discreteLocation = -COUNTS_FOR_180_DEGREE_TURN;
-			}
+            previousPositionOfPropulsionMotor = preciseLocation;
         }
         
-        int desiredLocation = ((double)discreteLocation + stepper_motor_counter_input.numberOfCounts) / 2;
-        
-        while (desiredLocation != stepper_motor_counter_input.numberOfCounts)
+		//changes the values of preciseLocation from 0-100 to a -200 to 200 scale with a dead zone on either end of the controller
+		//(the compiler reduces this to a subtraction, because preciseLocation is already in 1/16ths)
+        discreteLocation = (preciseLocation - 50 * STEERING_LOCATION_SCALE) * 16 / STEERING_LOCATION_SCALE;
+		
+		if (discreteLocation >= -STEERING_DEAD_BAND_COUNTS && discreteLocation <= STEERING_DEAD_BAND_COUNTS)
+		{
+			discreteLocation = 0;
+		}
+		else if (discreteLocation > COUNTS_FOR_90_DEGREE_TURN)
+		{
+			discreteLocation = COUNTS_FOR_90_DEGREE_TURN;
+		}
+		else if (discreteLocation < -COUNTS_FOR_90_DEGREE_TURN)
+		{
+			discreteLocation = -COUNTS_FOR_90_DEGREE_TURN;
+		}
+    }
+    else if (brake_switch_filter.output >= SWITCH_MIDPOINT_INPUT_SIGNAL_DUTY_CYCLE)
+    {
+		if (stepper_motor_counter_input.numberOfCounts >= 0)
+		{
+			discreteLocation = COUNTS_FOR_180_DEGREE_TURN;
+		}
+		else if (stepper_motor_counter_input.numberOfCounts < 0)
+		{
+			discreteLocation = -COUNTS_FOR_180_DEGREE_TURN;
+		}
+    }
+    PROFILER_END(PROFILER_SITE_STEERING_MAPPING);
+    
+    Stepper_Motion_Set_Target(&stepper_motion, discreteLocation);
+}
+
+//moves the stepper motor towards its target (STEPPER_TASK_HZ)
+//This used to be a loop that waited for the motor to get there at a constant 400Hz, which
+//held up everything else.  Now the IC4 interrupt stops the motor at its target, and this
+//only speeds it up and slows it down.
+void Stepper_Task_Run(void)
+{
+    PROFILER_BEGIN(PROFILER_SITE_STEPPER_LOOP);
+    Stepper_Motion_Update(&stepper_motion);
+    PROFILER_END(PROFILER_SITE_STEPPER_LOOP);
+}
+
+#ifdef PROFILER_ENABLED
+//answers the commands from the serial port (PROFILER_TASK_HZ)
+//A dump is only started once the last one has been sent, so two never get mixed together.
+void Profiler_Task_Run(void)
+{
+    uint8_t command;
+    
+    while (Serial_Port_Get(&command))
+    {
+        if (command == PROFILER_DUMP_COMMAND && Serial_Port_Free_Space() == SERIAL_PORT_TX_BUFFER_SIZE - 1)
+        {
+            Profiler_Dump(Serial_Port_Put);
+        }
+        else if (command == PROFILER_RESET_COMMAND)
         {
-            stepper_motor_counter_input.Update(&stepper_motor_counter_input);
-            desiredLocation = ((double)discreteLocation + stepper_motor_counter_input.numberOfCounts) / 2;
-
-            if (stepper_motor_counter_input.numberOfCounts > desiredLocation && stepper_motor_counter_input.allowClockwiseMotion == 1)
-            {
-                //This is the enable bit for the stepper motor responsible for turning the propulsion engine to control direction
-                LATAbits.LATA2 = 0;
-
-                turn_propulsion_engine_output.dutyCyclePercentage = 20;
-                turn_propulsion_engine_output.UpdateDutyCycle(&turn_propulsion_engine_output);
-            }
-            //represents a rightward turn of the propulsion engine
-            else if (stepper_motor_counter_input.numberOfCounts < desiredLocation && stepper_motor_counter_input.allowCounterClockwiseMotion == 1)
-            {
-                //This is the enable bit for the stepper motor responsible for turning the propulsion engine to control direction
-                LATAbits.LATA2 = 1;
-
-                turn_propulsion_engine_output.dutyCyclePercentage = 20;
-                turn_propulsion_engine_output.UpdateDutyCycle(&turn_propulsion_engine_output);
-            }
-            //the motor holds its position
-            else
-            {
-                turn_propulsion_engine_output.dutyCyclePercentage = 0;
-                turn_propulsion_engine_output.UpdateDutyCycle(&turn_propulsion_engine_output);
-            }
+            Profiler_Reset();
         }
     }
+}
+#endif
+
+#ifdef TELEMETRY_ENABLED
+static void Telemetry_Set_Input(Telemetry_Input* telemetryInput, const IC_Fixed_Module* input)
+{
+    telemetryInput->dutyCycle = input->dutyCycle;
+    telemetryInput->periodTicks = input->periodTicks;
+}
+
+//execution times over 65535 cycles are sent as 65535
+static void Telemetry_Set_Task_Timing(Telemetry_Task_Timing* timing, const Scheduler_Task* task)
+{
+    timing->lastExecutionCycles = (task->lastExecutionCycles > 0xFFFF) ? 0xFFFF : (uint16_t)task->lastExecutionCycles;
+    timing->worstExecutionCycles = (task->worstExecutionCycles > 0xFFFF) ? 0xFFFF : (uint16_t)task->worstExecutionCycles;
+    timing->missedDeadlines = task->missedDeadlines;
+}
+
+//sends a snapshot of the inputs, outputs and task timing (TELEMETRY_HZ)
+//If the serial port is still busy (with the profiler's table, say), the frame is dropped
+//instead of waiting, and counted in the next one.
+void Telemetry_Task_Run(void)
+{
+    Telemetry_Frame frame;
+    
+    frame.tick = (uint16_t)Scheduler_Get_Ticks();
+    
+    frame.flags = 0;
+    if (LATAbits.LATA0)
+    {
+        frame.flags |= TELEMETRY_FLAG_LIFT_RELAY;
+    }
+    if (LATAbits.LATA1)
+    {
+        frame.flags |= TELEMETRY_FLAG_PROPULSION_RELAY;
+    }
+    if (receiverSignalLost)
+    {
+        frame.flags |= TELEMETRY_FLAG_SIGNAL_LOST;
+    }
+    if (kill_switch_input.signalValid)
+    {
+        frame.flags |= TELEMETRY_FLAG_INPUT_VALID(TELEMETRY_INPUT_KILL_SWITCH);
+    }
+    if (propulsion_throttle_servo_input.signalValid)
+    {
+        frame.flags |= TELEMETRY_FLAG_INPUT_VALID(TELEMETRY_INPUT_THROTTLE);
+    }
+    if (propulsion_direction_motor_input.signalValid)
+    {
+        frame.flags |= TELEMETRY_FLAG_INPUT_VALID(TELEMETRY_INPUT_STEERING);
+    }
+    if (propulsion_brake_input.signalValid)
+    {
+        frame.flags |= TELEMETRY_FLAG_INPUT_VALID(TELEMETRY_INPUT_BRAKE);
+    }
+    
+    Telemetry_Set_Input(&frame.inputs[TELEMETRY_INPUT_KILL_SWITCH], &kill_switch_input);
+    Telemetry_Set_Input(&frame.inputs[TELEMETRY_INPUT_THROTTLE], &propulsion_throttle_servo_input);
+    Telemetry_Set_Input(&frame.inputs[TELEMETRY_INPUT_STEERING], &propulsion_direction_motor_input);
+    Telemetry_Set_Input(&frame.inputs[TELEMETRY_INPUT_BRAKE], &propulsion_brake_input);
+    
+    frame.stepperCounts = (int16_t)stepper_motor_counter_input.numberOfCounts;
+    frame.stepperTarget = (int16_t)stepper_motion.targetPosition;
+    frame.stepRate = (uint16_t)stepper_motion.stepRate;
+    frame.throttleServoDutyCycle = propulsion_throttle_servo_output.dutyCycle;
+    frame.stepOutputDutyCycle = turn_propulsion_engine_output.dutyCycle;
+    
+    Telemetry_Set_Task_Timing(&frame.tasks[TELEMETRY_TASK_RECEIVER_INPUT], &receiver_input_task);
+    Telemetry_Set_Task_Timing(&frame.tasks[TELEMETRY_TASK_KILL_SWITCH], &kill_switch_task);
+    Telemetry_Set_Task_Timing(&frame.tasks[TELEMETRY_TASK_MIXING], &mixing_task);
+    Telemetry_Set_Task_Timing(&frame.tasks[TELEMETRY_TASK_STEPPER], &stepper_task);
+    
+    (void)Telemetry_Send(&frame);
+}
+#endif
+
+int main(void)
+{
+    Hovercraft_Initialize();
+    
+    //runs the tasks at their rates forever
+    Scheduler_Run();
     
     return -1;
-}
\ No newline at end of file
+}
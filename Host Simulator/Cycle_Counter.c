@@ -0,0 +1,457 @@
+/*
+ * File:    Cycle_Counter.c
+ * Author:  Zachary Downum
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Cycle_Counter.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#define CYCLE_COUNTER_SUPPORTED 1
+#else
+#define CYCLE_COUNTER_SUPPORTED 0
+#endif
+
+#define true 1
+#define false 0
+
+#define INT3_OPCODE 0xCC
+
+//approximate cycle counts of the XC16 soft-float helpers (__addsf3, __mulsf3, __divsf3,
+//__floatsisf, __fixsfsi, __gtsf2...).  XC16's double is the same 32-bit format by default.
+#define SOFT_FLOAT_ADD_CYCLES 120
+#define SOFT_FLOAT_MULTIPLY_CYCLES 110
+#define SOFT_FLOAT_DIVIDE_CYCLES 380
+#define SOFT_FLOAT_SQUARE_ROOT_CYCLES 500
+#define SOFT_FLOAT_INT_TO_FLOAT_CYCLES 70
+#define SOFT_FLOAT_FLOAT_TO_INT_CYCLES 60
+#define SOFT_FLOAT_COMPARE_CYCLES 50
+
+//REPEAT #17 + DIV.SD for 16-bit operands, and __divsi3 for 32-bit (long) operands
+#define INTEGER_DIVIDE_CYCLES 19
+#define LONG_DIVIDE_CYCLES 300
+//a 32 x 32 multiply takes several 16 x 16 MULs on the PIC24
+#define LONG_MULTIPLY_CYCLES 4
+
+#define CALL_CYCLES 2
+#define RETURN_CYCLES 3
+
+#define MAX_NESTING 16
+
+//weights are cached by instruction address so each instruction is only decoded once
+#define WEIGHT_CACHE_SIZE 4096
+#define MARKER_WEIGHT 0xFFFFFFFFUL
+
+//an empty BEGIN/END pair is measured first so that the cost of the markers themselves
+//can be taken back out of every measurement
+#define CALIBRATION_SITE -1
+
+volatile int Cycle_Counter_Active = false;
+volatile int Cycle_Counter_Marker = 0;
+
+static Cycle_Counter_Site Sites[CYCLE_COUNTER_MAX_SITES];
+static int NumberOfSites = 0;
+static unsigned long MarkerOverhead = 0;
+static unsigned long MarkerInstructions = 0;
+
+int Cycle_Counter_Register_Site(const char* name, int isInterrupt)
+{
+    if (NumberOfSites == CYCLE_COUNTER_MAX_SITES)
+    {
+        fprintf(stderr, "Cycle counter: too many sites (max %d)\n", CYCLE_COUNTER_MAX_SITES);
+        exit(EXIT_FAILURE);
+    }
+
+    Sites[NumberOfSites].name = name;
+    Sites[NumberOfSites].isInterrupt = isInterrupt;
+
+    return NumberOfSites++;
+}
+
+const Cycle_Counter_Site* Cycle_Counter_Get_Site(int site)
+{
+    return &Sites[site];
+}
+
+int Cycle_Counter_Get_Number_Of_Sites(void)
+{
+    return NumberOfSites;
+}
+
+static void Record(int site, unsigned long cycles, unsigned long instructions)
+{
+    if (site == CALIBRATION_SITE)
+    {
+        MarkerOverhead = cycles;
+        MarkerInstructions = instructions;
+        return;
+    }
+
+    Cycle_Counter_Site* s = &Sites[site];
+
+    cycles = cycles > MarkerOverhead ? cycles - MarkerOverhead : 0;
+    instructions = instructions > MarkerInstructions ? instructions - MarkerInstructions : 0;
+
+    if (s->isInterrupt)
+    {
+        cycles += CYCLE_COUNTER_INTERRUPT_OVERHEAD;
+    }
+
+    if (s->calls == 0 || cycles < s->minimumCycles)
+    {
+        s->minimumCycles = cycles;
+    }
+    if (cycles > s->maximumCycles)
+    {
+        s->maximumCycles = cycles;
+    }
+
+    s->totalCycles += cycles;
+    s->totalInstructions += instructions;
+    ++s->calls;
+}
+
+#if CYCLE_COUNTER_SUPPORTED
+
+//the estimated PIC24 cost of one x86-64 instruction (see Cycle_Counter.h)
+static unsigned long Weigh_Instruction(const unsigned char* code)
+{
+    int scalarDouble = false;
+    int scalarSingle = false;
+    int wide = false;
+    int i = 0;
+
+    //legacy prefixes (F2/F3 select the scalar double/single SSE forms)
+    while (i < 8)
+    {
+        unsigned char prefix = code[i];
+
+        if (prefix == 0xF2)
+        {
+            scalarDouble = true;
+        }
+        else if (prefix == 0xF3)
+        {
+            scalarSingle = true;
+        }
+        else if (prefix != 0x66 && prefix != 0x67 && prefix != 0x2E && prefix != 0x3E && prefix != 0x26 && prefix != 0x36 && prefix != 0x64 && prefix != 0x65 && prefix != 0xF0)
+        {
+            break;
+        }
+
+        ++i;
+    }
+
+    //REX prefix, W selects 64-bit operands (a PIC24 long)
+    if ((code[i] & 0xF0) == 0x40)
+    {
+        wide = (code[i] & 0x08) != 0;
+        ++i;
+    }
+
+    unsigned char opcode = code[i];
+
+    if (opcode == 0x0F)
+    {
+        unsigned char extended = code[i + 1];
+        int scalarFloat = scalarDouble || scalarSingle;
+
+        switch (extended)
+        {
+            case 0x58:
+            case 0x5C:
+            case 0x5D:
+            case 0x5F:
+                return scalarFloat ? SOFT_FLOAT_ADD_CYCLES : 1;
+            case 0x59:
+                return scalarFloat ? SOFT_FLOAT_MULTIPLY_CYCLES : 1;
+            case 0x5E:
+                return scalarFloat ? SOFT_FLOAT_DIVIDE_CYCLES : 1;
+            case 0x51:
+                return scalarFloat ? SOFT_FLOAT_SQUARE_ROOT_CYCLES : 1;
+            case 0x2A:
+                return scalarFloat ? SOFT_FLOAT_INT_TO_FLOAT_CYCLES : 1;
+            case 0x2C:
+            case 0x2D:
+                return scalarFloat ? SOFT_FLOAT_FLOAT_TO_INT_CYCLES : 1;
+            case 0x2E:
+            case 0x2F:
+                //(u)comisd/(u)comiss have no F2/F3 prefix
+                return SOFT_FLOAT_COMPARE_CYCLES;
+            case 0xAF:
+                return wide ? LONG_MULTIPLY_CYCLES : 1;
+            default:
+                return 1;
+        }
+    }
+
+    if (opcode == 0xF7)
+    {
+        unsigned int operation = (code[i + 1] >> 3) & 0x7;
+
+        //F7 /6 is div, /7 is idiv, /4 is mul and /5 is imul
+        if (operation == 6 || operation == 7)
+        {
+            return wide ? LONG_DIVIDE_CYCLES : INTEGER_DIVIDE_CYCLES;
+        }
+        if (operation == 4 || operation == 5)
+        {
+            return wide ? LONG_MULTIPLY_CYCLES : 1;
+        }
+    }
+
+    if (opcode == 0x69 || opcode == 0x6B)
+    {
+        return wide ? LONG_MULTIPLY_CYCLES : 1;
+    }
+
+    if (opcode == 0xE8)
+    {
+        return CALL_CYCLES;
+    }
+
+    if (opcode == 0xC3)
+    {
+        return RETURN_CYCLES;
+    }
+
+    return 1;
+}
+
+static int Read_Code(pid_t child, unsigned long long address, unsigned char* code)
+{
+    int i;
+
+    for (i = 0; i < 2; ++i)
+    {
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKTEXT, child, (void*)(address + i * sizeof(long)), NULL);
+
+        if (errno != 0)
+        {
+            return -1;
+        }
+
+        memcpy(code + i * sizeof(long), &word, sizeof(long));
+    }
+
+    return 0;
+}
+
+//code placed in the CYCLE_COUNTER_FREE section stands in for a single PIC24 instruction
+//(e.g. reading ICxBUF), so only the call to it is counted
+extern const char __start_cycle_counter_free[] __attribute__((weak));
+extern const char __stop_cycle_counter_free[] __attribute__((weak));
+
+static int Is_Free_Code(unsigned long long address)
+{
+    return __start_cycle_counter_free != NULL && address >= (unsigned long long)__start_cycle_counter_free && address < (unsigned long long)__stop_cycle_counter_free;
+}
+
+static unsigned long Get_Weight(pid_t child, unsigned long long address)
+{
+    static unsigned long long cachedAddresses[WEIGHT_CACHE_SIZE];
+    static unsigned long cachedWeights[WEIGHT_CACHE_SIZE];
+    unsigned int slot = (unsigned int)(address % WEIGHT_CACHE_SIZE);
+    unsigned char code[16];
+
+    if (cachedAddresses[slot] == address)
+    {
+        return cachedWeights[slot];
+    }
+
+    if (Read_Code(child, address, code) != 0)
+    {
+        return 0;
+    }
+
+    cachedAddresses[slot] = address;
+    if (code[0] == INT3_OPCODE)
+    {
+        cachedWeights[slot] = MARKER_WEIGHT;
+    }
+    else
+    {
+        cachedWeights[slot] = Is_Free_Code(address) ? 0 : Weigh_Instruction(code);
+    }
+
+    return cachedWeights[slot];
+}
+
+static int Read_Marker(pid_t child)
+{
+    return (int)ptrace(PTRACE_PEEKDATA, child, (void*)&Cycle_Counter_Marker, NULL);
+}
+
+int Cycle_Counter_Run(void (*workload)(void))
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0)
+        {
+            _exit(2);
+        }
+
+        raise(SIGSTOP);
+
+        Cycle_Counter_Active = true;
+        CYCLE_COUNTER_BEGIN(CALIBRATION_SITE);
+        CYCLE_COUNTER_END(CALIBRATION_SITE);
+        workload();
+        fflush(stdout);
+        fflush(stderr);
+        _exit(0);
+    }
+
+    if (child < 0)
+    {
+        workload();
+        return -1;
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+
+    if (!WIFSTOPPED(status))
+    {
+        //the child could not be traced (e.g. ptrace is blocked in a container)
+        workload();
+        return -1;
+    }
+
+    ptrace(PTRACE_SETOPTIONS, child, NULL, (void*)PTRACE_O_EXITKILL);
+
+    int openSites[MAX_NESTING];
+    unsigned long openCycles[MAX_NESTING];
+    unsigned long openInstructions[MAX_NESTING];
+    int depth = 0;
+    int pendingSignal = 0;
+    int steppedOverMarker = false;
+
+    while (true)
+    {
+        steppedOverMarker = false;
+
+        if (depth == 0)
+        {
+            ptrace(PTRACE_CONT, child, NULL, (void*)(long)pendingSignal);
+        }
+        else
+        {
+            errno = 0;
+            unsigned long long address = (unsigned long long)ptrace(PTRACE_PEEKUSER, child, (void*)offsetof(struct user_regs_struct, rip), NULL);
+            if (errno != 0)
+            {
+                break;
+            }
+
+            unsigned long cycles = Get_Weight(child, address);
+
+            if (cycles == MARKER_WEIGHT)
+            {
+                steppedOverMarker = true;
+            }
+            else
+            {
+                int i;
+
+                //the cost counts towards every site that is currently open
+                for (i = 0; i < depth; ++i)
+                {
+                    openCycles[i] += cycles;
+                    if (cycles > 0)
+                    {
+                        ++openInstructions[i];
+                    }
+                }
+            }
+
+            ptrace(PTRACE_SINGLESTEP, child, NULL, (void*)(long)pendingSignal);
+        }
+
+        pendingSignal = 0;
+        waitpid(child, &status, 0);
+
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+        {
+            break;
+        }
+
+        int signal = WSTOPSIG(status);
+        if (signal != SIGTRAP)
+        {
+            pendingSignal = signal;
+            continue;
+        }
+
+        //a SIGTRAP is either the end of a single step or one of the int3 markers
+        if (depth > 0 && !steppedOverMarker)
+        {
+            continue;
+        }
+
+        int marker = Read_Marker(child);
+        //(markers are 2 * site for BEGIN and 2 * site + 1 for END, site may be -1)
+        int site = (marker + 2) / 2 - 1;
+
+        if (site < CALIBRATION_SITE || site >= NumberOfSites)
+        {
+            continue;
+        }
+
+        if ((marker & 1) == 0 && depth < MAX_NESTING)
+        {
+            openSites[depth] = site;
+            openCycles[depth] = 0;
+            openInstructions[depth] = 0;
+            ++depth;
+        }
+        else if ((marker & 1) == 1 && depth > 0 && openSites[depth - 1] == site)
+        {
+            --depth;
+            Record(site, openCycles[depth], openInstructions[depth]);
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+int Cycle_Counter_Run(void (*workload)(void))
+{
+    workload();
+    return -1;
+}
+
+#endif
+
+void Cycle_Counter_Print_Report(FILE* output)
+{
+    int i;
+
+    fprintf(output, "%-36s %10s %10s %10s %10s\n", "site", "calls", "min", "mean", "max");
+
+    for (i = 0; i < NumberOfSites; ++i)
+    {
+        const Cycle_Counter_Site* s = &Sites[i];
+        unsigned long mean = s->calls ? (unsigned long)(s->totalCycles / s->calls) : 0;
+
+        fprintf(output, "%-36s %10lu %10lu %10lu %10lu\n", s->name, s->calls, s->minimumCycles, mean, s->maximumCycles);
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * File:    Cycle_Counter.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+//The cycle counter estimates how many PIC24 instruction cycles a piece of firmware
+//would take by running it on the host one instruction at a time (under ptrace) and
+//weighting every host instruction by what the equivalent PIC24 code costs:
+//    - ordinary instructions are 1 cycle, calls are 2 and returns are 3
+//    - floating point instructions are charged what the XC16 soft-float helpers take,
+//      since the PIC24 has no FPU (this is where most of the cost of double math shows up)
+//    - integer division is charged the 18 cycle REPEAT/DIV sequence (or the library
+//      routine for 32-bit operands)
+//These are estimates, not a cycle-accurate model, but they are consistent between runs,
+//so they are good for comparing two versions of the same code.
+//
+//Code to be measured is wrapped in CYCLE_COUNTER_BEGIN/END with a site number from
+//Cycle_Counter_Register_Site.  The markers cost nothing when the counter is not running.
+//Only x86-64 Linux hosts are supported, everywhere else the counts stay at 0.
+
+#define CYCLE_COUNTER_MAX_SITES 64
+
+//PIC24 interrupt latency (5 cycles) plus RETFIE (3 cycles), added to interrupt sites
+#define CYCLE_COUNTER_INTERRUPT_OVERHEAD 8
+
+typedef struct Cycle_Counter_Site Cycle_Counter_Site;
+
+struct Cycle_Counter_Site
+{
+    const char* name;
+    int isInterrupt;
+
+    unsigned long calls;
+    unsigned long long totalCycles;
+    unsigned long minimumCycles;
+    unsigned long maximumCycles;
+    //the host instructions that were stepped through (not counting CYCLE_COUNTER_FREE code),
+    //which do not depend on the weights above
+    unsigned long long totalInstructions;
+};
+
+extern volatile int Cycle_Counter_Active;
+extern volatile int Cycle_Counter_Marker;
+
+#if defined(__x86_64__) && defined(__linux__)
+#define CYCLE_COUNTER_TRAP() __asm__ volatile ("int3" ::: "memory")
+#else
+#define CYCLE_COUNTER_TRAP() ((void)0)
+#endif
+
+//marks a host function that stands in for a single PIC24 instruction, only the call
+//to it is counted (the simulator's ICxBUF read uses this)
+#define CYCLE_COUNTER_FREE __attribute__((section("cycle_counter_free"), noinline))
+
+//the marker value tells the tracer which site starts (even) or stops (odd)
+#define CYCLE_COUNTER_BEGIN(site) \
+    do { if (Cycle_Counter_Active) { Cycle_Counter_Marker = 2 * (site); CYCLE_COUNTER_TRAP(); } } while (0)
+#define CYCLE_COUNTER_END(site) \
+    do { if (Cycle_Counter_Active) { Cycle_Counter_Marker = 2 * (site) + 1; CYCLE_COUNTER_TRAP(); } } while (0)
+
+//returns the site number to pass to CYCLE_COUNTER_BEGIN/END
+int Cycle_Counter_Register_Site(const char* name, int isInterrupt);
+
+//runs the workload in a traced child process and collects the counts for every site
+//returns 0 on success, or -1 if tracing is not possible (the workload is then run
+//untraced so that its other output is still produced)
+int Cycle_Counter_Run(void (*workload)(void));
+
+const Cycle_Counter_Site* Cycle_Counter_Get_Site(int site);
+int Cycle_Counter_Get_Number_Of_Sites(void);
+
+void Cycle_Counter_Print_Report(FILE* output);
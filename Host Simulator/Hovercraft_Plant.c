@@ -0,0 +1,139 @@
+/*
+ * File:    Hovercraft_Plant.c
+ * Author:  Zachary Downum
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "Hovercraft_Plant.h"
+
+#define true 1
+#define false 0
+
+#define PLANT_PI 3.14159265358979
+
+//the hull (kg) and how hard it is to turn (kg m^2), and how far behind the center of
+//mass the propulsion engine pushes (m)
+#define PLANT_MASS 60.0
+#define PLANT_YAW_INERTIA 12.0
+#define PLANT_ENGINE_ARM 0.9
+
+//the propulsion engine's thrust at full speed (N), and how quickly its speed follows the
+//throttle (s) and runs down once its relay is off (s)
+#define PLANT_MAXIMUM_THRUST 40.0
+#define PLANT_ENGINE_TIME_CONSTANT 0.4
+#define PLANT_ENGINE_STOP_TIME_CONSTANT 1.0
+
+//how quickly the skirt fills once the lift engine is on, and empties once it is off (s)
+#define PLANT_LIFT_TIME_CONSTANT 1.5
+#define PLANT_SETTLE_TIME_CONSTANT 0.5
+
+//drag on the hull (N per (m/s)^2) and yaw damping (N m per rad/s), hovering and sitting
+//in the water
+#define PLANT_HOVER_DRAG 1.5
+#define PLANT_WATER_DRAG 40.0
+#define PLANT_HOVER_YAW_DAMPING 6.0
+#define PLANT_WATER_YAW_DAMPING 60.0
+
+//moves value towards target with a first order lag
+static double Plant_Lag(double value, double target, double timeConstant, double seconds)
+{
+    return value + (target - value) * (1.0 - exp(-seconds / timeConstant));
+}
+
+void Hovercraft_Plant_Initialize(Hovercraft_Plant* plant)
+{
+    memset(plant, 0, sizeof(*plant));
+    plant->servoPulseMicroseconds = PLANT_SERVO_CLOSED_MICROSECONDS;
+}
+
+void Hovercraft_Plant_Step_Motor(Hovercraft_Plant* plant, int direction)
+{
+    int stepDirection = direction ? 1 : -1;
+
+    if (plant->lastStepDirection != 0 && plant->lastStepDirection != stepDirection)
+    {
+        ++plant->directionReversals;
+    }
+    plant->lastStepDirection = stepDirection;
+
+    plant->engineCounts += stepDirection;
+    ++plant->totalSteps;
+}
+
+double Hovercraft_Plant_Engine_Angle(const Hovercraft_Plant* plant)
+{
+    return plant->engineCounts * 90.0 / PLANT_COUNTS_PER_90_DEGREES;
+}
+
+void Hovercraft_Plant_Step(Hovercraft_Plant* plant, double seconds)
+{
+    double servoTarget;
+    double servoStep = PLANT_SERVO_DEGREES_PER_SECOND * seconds;
+    double throttle;
+    double thrust;
+    double engineAngle;
+    double drag;
+    double yawDamping;
+    double headingRadians;
+
+    //the servo turns 180 degrees over its travel, as fast as it can towards the pulse width
+    servoTarget = (plant->servoPulseMicroseconds - PLANT_SERVO_CLOSED_MICROSECONDS) * 180.0 / (PLANT_SERVO_OPEN_MICROSECONDS - PLANT_SERVO_CLOSED_MICROSECONDS);
+    if (servoTarget < 0)
+    {
+        servoTarget = 0;
+    }
+    else if (servoTarget > 180)
+    {
+        servoTarget = 180;
+    }
+
+    if (servoTarget > plant->servoAngle + servoStep)
+    {
+        plant->servoAngle += servoStep;
+    }
+    else if (servoTarget < plant->servoAngle - servoStep)
+    {
+        plant->servoAngle -= servoStep;
+    }
+    else
+    {
+        plant->servoAngle = servoTarget;
+    }
+
+    throttle = plant->servoAngle / 180.0;
+    if (plant->propulsionRelayOn)
+    {
+        plant->engineSpeed = Plant_Lag(plant->engineSpeed, throttle, PLANT_ENGINE_TIME_CONSTANT, seconds);
+    }
+    else
+    {
+        plant->engineSpeed = Plant_Lag(plant->engineSpeed, 0, PLANT_ENGINE_STOP_TIME_CONSTANT, seconds);
+    }
+
+    if (plant->liftRelayOn)
+    {
+        plant->lift = Plant_Lag(plant->lift, 1, PLANT_LIFT_TIME_CONSTANT, seconds);
+    }
+    else
+    {
+        plant->lift = Plant_Lag(plant->lift, 0, PLANT_SETTLE_TIME_CONSTANT, seconds);
+    }
+
+    //a propeller's thrust goes with the square of its speed
+    thrust = PLANT_MAXIMUM_THRUST * plant->engineSpeed * plant->engineSpeed;
+    engineAngle = Hovercraft_Plant_Engine_Angle(plant) * PLANT_PI / 180.0;
+    drag = PLANT_WATER_DRAG + (PLANT_HOVER_DRAG - PLANT_WATER_DRAG) * plant->lift;
+    yawDamping = PLANT_WATER_YAW_DAMPING + (PLANT_HOVER_YAW_DAMPING - PLANT_WATER_YAW_DAMPING) * plant->lift;
+
+    //the hull only moves forward (it slides sideways as well, but that does not change
+    //how the control code behaves)
+    plant->speed += (thrust * cos(engineAngle) - drag * plant->speed * fabs(plant->speed)) / PLANT_MASS * seconds;
+    plant->yawRate += ((thrust * sin(engineAngle) * PLANT_ENGINE_ARM - yawDamping * plant->yawRate * PLANT_PI / 180.0) / PLANT_YAW_INERTIA) * 180.0 / PLANT_PI * seconds;
+
+    plant->heading += plant->yawRate * seconds;
+    headingRadians = plant->heading * PLANT_PI / 180.0;
+    plant->x += plant->speed * sin(headingRadians) * seconds;
+    plant->y += plant->speed * cos(headingRadians) * seconds;
+}
@@ -0,0 +1,71 @@
+/*
+ * File:    Hovercraft_Plant.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+//A simple model of the hovercraft that main_driver.c controls, so the control code can be
+//run in a closed loop in the simulator:
+//    - the throttle servo follows its pulse width (OC1) at a limited speed, and the
+//      propulsion engine's speed follows the servo's position (first order), with the
+//      engine relay (LATA1) cutting it off
+//    - the lift engine (LATA0) fills and empties the skirt, which changes how much the
+//      water drags on the hull and how much it damps turning
+//    - the propulsion engine is turned by the stepper motor, one step for every rising
+//      edge of the step signal (RB1) in the direction LATA2 sets, and its thrust pushes
+//      the hull forward (cos of the engine's angle) and turns it (sin of the angle)
+//The numbers are rough guesses for a small hovercraft, not measurements.  They are meant
+//for comparing control settings against each other, not for predicting the real thing.
+
+//the stepper motor's step signal (OC2's output, RB1)
+#define PLANT_STEP_PIN 1
+
+//706 counts turn the propulsion engine 90 degrees (COUNTS_FOR_90_DEGREE_TURN in main_driver.c)
+#define PLANT_COUNTS_PER_90_DEGREES 706
+
+//the throttle servo's travel:  closed at main_driver.c's PROPULSION_THROTTLE_SERVO_OFFSET
+//(1.8% of 20ms) and fully open 2ms later, moving at most PLANT_SERVO_DEGREES_PER_SECOND
+#define PLANT_SERVO_CLOSED_MICROSECONDS 360.0
+#define PLANT_SERVO_OPEN_MICROSECONDS 2360.0
+#define PLANT_SERVO_DEGREES_PER_SECOND 400.0
+
+typedef struct Hovercraft_Plant Hovercraft_Plant;
+
+struct Hovercraft_Plant
+{
+    //inputs, set from the firmware's outputs before every Hovercraft_Plant_Step
+    double servoPulseMicroseconds;
+    int liftRelayOn;
+    int propulsionRelayOn;
+
+    //the propulsion engine's angle in stepper counts (+ turns the hovercraft right)
+    long engineCounts;
+    unsigned long totalSteps;
+    unsigned long directionReversals;
+    int lastStepDirection;
+
+    //throttle opening and engine speed (0 - 1), and how full the skirt is (0 - 1)
+    double servoAngle;
+    double engineSpeed;
+    double lift;
+
+    //hull speed (m/s), yaw rate (degrees/s), heading (degrees) and position (m)
+    double speed;
+    double yawRate;
+    double heading;
+    double x;
+    double y;
+};
+
+//starts the hovercraft sitting still on the water, engines off, pointed at heading 0
+void Hovercraft_Plant_Initialize(Hovercraft_Plant* plant);
+
+//counts one step of the stepper motor (direction is LATA2, 1 for + counts)
+void Hovercraft_Plant_Step_Motor(Hovercraft_Plant* plant, int direction);
+
+//moves the model forward by seconds (small steps, e.g. one scheduler tick)
+void Hovercraft_Plant_Step(Hovercraft_Plant* plant, double seconds);
+
+//the propulsion engine's angle in degrees (+ is right)
+double Hovercraft_Plant_Engine_Angle(const Hovercraft_Plant* plant);
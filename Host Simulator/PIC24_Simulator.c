@@ -0,0 +1,1428 @@
+/*
+ * File:    PIC24_Simulator.c
+ * Author:  Zachary Downum
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PIC24_Simulator.h"
+#include "Cycle_Counter.h"
+
+#define true 1
+#define false 0
+
+#define NO_CONNECTION -1
+#define NO_EVENT 0xFFFFFFFFFFFFFFFFULL
+
+//an ISR that never clears its own flag would hang the PIC forever, the simulator
+//gives up after this many back-to-back entries of the same vector instead
+#define RUNAWAY_INTERRUPT_LIMIT 100000
+
+//the output function codes written to RPORx for OC1..OC6 (see PWM.c)
+#define OC1_REMAPPABLE_PIN_REFERENCE 13
+
+//IC/OC clock select codes (ICTSEL/OCTSEL) that pick Fcy instead of a timer's clock
+#define SYSTEM_CLOCK_SELECT 0b111
+
+//SYNCSEL codes for Timer1..Timer5 and for an OC module synchronizing to itself
+#define SYNCSEL_TIMER1 0b01011
+#define SYNCSEL_TIMER5 0b01111
+#define SYNCSEL_SELF 0b11111
+//SYNCSEL codes for OC1..OC6 (an OC module following another one's period)
+#define SYNCSEL_OC1 0b00001
+#define SYNCSEL_OC6 0b00110
+
+#define IC_MODE_OFF 0b000
+#define IC_MODE_EVERY_EDGE 0b001
+#define IC_MODE_FALLING_EDGE 0b010
+#define IC_MODE_RISING_EDGE 0b011
+#define IC_MODE_EVERY_4TH_RISING_EDGE 0b100
+#define IC_MODE_EVERY_16TH_RISING_EDGE 0b101
+#define IC_MODE_INTERRUPT_ONLY 0b111
+
+#define OC_MODE_EDGE_ALIGNED_PWM 0b110
+#define OC_MODE_CENTER_ALIGNED_PWM 0b111
+
+//UTXISEL1:UTXISEL0, when U1TXIF is set
+#define UART_TX_INTERRUPT_ON_SPACE 0b00
+#define UART_TX_INTERRUPT_ON_DONE 0b01
+#define UART_TX_INTERRUPT_ON_EMPTY 0b10
+//the slot U1TXREG writes go to when the UART ignores them
+#define UART_TX_IGNORED_SLOT PIC24_SIM_UART_TX_SLOTS
+
+volatile PIC24_Sim_Register_File PIC24_Sim_Registers;
+
+void (*PIC24_Sim_Interrupt_Entry_Hook)(unsigned int vector) = NULL;
+void (*PIC24_Sim_Interrupt_Exit_Hook)(unsigned int vector) = NULL;
+void (*PIC24_Sim_Output_Edge_Hook)(unsigned int rpPin, int level) = NULL;
+void (*PIC24_Sim_UART_Transmit_Hook)(uint8_t byte) = NULL;
+
+//the interrupt service routines are provided by whichever firmware files are linked in
+//(weak, so that a build without e.g. PWM.c still links)
+extern void _IC1Interrupt(void) __attribute__((weak));
+extern void _IC2Interrupt(void) __attribute__((weak));
+extern void _IC3Interrupt(void) __attribute__((weak));
+extern void _IC4Interrupt(void) __attribute__((weak));
+extern void _IC5Interrupt(void) __attribute__((weak));
+extern void _IC6Interrupt(void) __attribute__((weak));
+extern void _OC1Interrupt(void) __attribute__((weak));
+extern void _OC2Interrupt(void) __attribute__((weak));
+extern void _OC3Interrupt(void) __attribute__((weak));
+extern void _OC4Interrupt(void) __attribute__((weak));
+extern void _OC5Interrupt(void) __attribute__((weak));
+extern void _OC6Interrupt(void) __attribute__((weak));
+extern void _T1Interrupt(void) __attribute__((weak));
+extern void _T2Interrupt(void) __attribute__((weak));
+extern void _T3Interrupt(void) __attribute__((weak));
+extern void _T4Interrupt(void) __attribute__((weak));
+extern void _T5Interrupt(void) __attribute__((weak));
+extern void _U1RXInterrupt(void) __attribute__((weak));
+extern void _U1TXInterrupt(void) __attribute__((weak));
+
+typedef struct
+{
+    unsigned long long cycle;
+    unsigned long sequence;
+    unsigned int pin;
+    int level;
+} Scheduled_Edge;
+
+typedef struct
+{
+    uint16_t values[PIC24_SIM_IC_FIFO_DEPTH];
+    unsigned int head;
+    unsigned int count;
+    //counts captures towards the ICI interrupt threshold
+    unsigned int capturesSinceInterrupt;
+    //counts rising edges for the every 4th/16th rising edge modes
+    unsigned int prescaledEdges;
+    uint16_t lastValue;
+} IC_State;
+
+typedef struct
+{
+    int running;
+    unsigned long prescale;
+    uint16_t period;
+    unsigned long long anchorCycle;
+    uint16_t anchorValue;
+    unsigned long long nextMatchCycle;
+    //what the simulator last wrote into the register, used to spot firmware writes
+    uint16_t shadowCON;
+    uint16_t shadowTMR;
+} Timer_State;
+
+typedef struct
+{
+    uint16_t shadowCON1;
+    uint16_t shadowCON2;
+    uint16_t shadowRS;
+    //the OCxR value the output is following (see Handle_OC_Duty_Write)
+    uint16_t shadowR;
+    unsigned long long anchorCycle;
+    int lastLevel;
+    //set when OCxR was written in the middle of a period in a way that holds the
+    //output at overrideLevel until that period (overridePeriod) is over
+    int hasOverride;
+    unsigned long long overridePeriod;
+    int overrideLevel;
+    //the last period start that set the module's interrupt flag
+    unsigned long long lastInterruptCycle;
+} OC_State;
+
+typedef struct
+{
+    //the transmit FIFO is a ring of slots in U1TXREG, and while shifting is set its
+    //oldest byte is the one in the shift register
+    unsigned int txHead;
+    unsigned int txCount;
+    int shifting;
+    unsigned long long shiftEndCycle;
+    int transmitterWasEnabled;
+
+    uint16_t rx[PIC24_SIM_UART_RX_FIFO_DEPTH];
+    unsigned int rxHead;
+    unsigned int rxCount;
+} UART_State;
+
+static struct
+{
+    unsigned long long now;
+    int externalLevel[PIC24_SIM_NUMBER_OF_RP_PINS];
+    int connectedInput[PIC24_SIM_NUMBER_OF_RP_PINS];
+
+    Scheduled_Edge* edges;
+    unsigned long numberOfEdges;
+    unsigned long edgeCapacity;
+    unsigned long edgeSequence;
+
+    IC_State IC[PIC24_SIM_NUMBER_OF_IC_MODULES];
+    Timer_State Timer[PIC24_SIM_NUMBER_OF_TIMERS];
+    OC_State OC[PIC24_SIM_NUMBER_OF_OC_MODULES];
+    UART_State UART1;
+
+    unsigned long interruptCount[PIC24_SIM_NUMBER_OF_VECTORS];
+} PIC24_Sim;
+
+static const unsigned int IC_Vectors[PIC24_SIM_NUMBER_OF_IC_MODULES] =
+{
+    PIC24_SIM_VECTOR_IC1, PIC24_SIM_VECTOR_IC2, PIC24_SIM_VECTOR_IC3,
+    PIC24_SIM_VECTOR_IC4, PIC24_SIM_VECTOR_IC5, PIC24_SIM_VECTOR_IC6
+};
+
+static const unsigned int OC_Vectors[PIC24_SIM_NUMBER_OF_OC_MODULES] =
+{
+    PIC24_SIM_VECTOR_OC1, PIC24_SIM_VECTOR_OC2, PIC24_SIM_VECTOR_OC3,
+    PIC24_SIM_VECTOR_OC4, PIC24_SIM_VECTOR_OC5, PIC24_SIM_VECTOR_OC6
+};
+
+static const unsigned int Timer_Vectors[PIC24_SIM_NUMBER_OF_TIMERS] =
+{
+    PIC24_SIM_VECTOR_T1, PIC24_SIM_VECTOR_T2, PIC24_SIM_VECTOR_T3,
+    PIC24_SIM_VECTOR_T4, PIC24_SIM_VECTOR_T5
+};
+
+static void (*Get_Interrupt_Handler(unsigned int vector))(void)
+{
+    switch (vector)
+    {
+        case PIC24_SIM_VECTOR_IC1: return _IC1Interrupt;
+        case PIC24_SIM_VECTOR_IC2: return _IC2Interrupt;
+        case PIC24_SIM_VECTOR_IC3: return _IC3Interrupt;
+        case PIC24_SIM_VECTOR_IC4: return _IC4Interrupt;
+        case PIC24_SIM_VECTOR_IC5: return _IC5Interrupt;
+        case PIC24_SIM_VECTOR_IC6: return _IC6Interrupt;
+        case PIC24_SIM_VECTOR_OC1: return _OC1Interrupt;
+        case PIC24_SIM_VECTOR_OC2: return _OC2Interrupt;
+        case PIC24_SIM_VECTOR_OC3: return _OC3Interrupt;
+        case PIC24_SIM_VECTOR_OC4: return _OC4Interrupt;
+        case PIC24_SIM_VECTOR_OC5: return _OC5Interrupt;
+        case PIC24_SIM_VECTOR_OC6: return _OC6Interrupt;
+        case PIC24_SIM_VECTOR_T1: return _T1Interrupt;
+        case PIC24_SIM_VECTOR_T2: return _T2Interrupt;
+        case PIC24_SIM_VECTOR_T3: return _T3Interrupt;
+        case PIC24_SIM_VECTOR_T4: return _T4Interrupt;
+        case PIC24_SIM_VECTOR_T5: return _T5Interrupt;
+        case PIC24_SIM_VECTOR_U1RX: return _U1RXInterrupt;
+        case PIC24_SIM_VECTOR_U1TX: return _U1TXInterrupt;
+        default: return NULL;
+    }
+}
+
+static void Set_Interrupt_Flag(unsigned int vector)
+{
+    PIC24_Sim_Registers.IFS[vector / 16] |= (uint16_t)(1u << (vector % 16));
+}
+
+static unsigned int Get_Interrupt_Priority(unsigned int vector)
+{
+    return (PIC24_Sim_Registers.IPC[vector / 4] >> ((vector % 4) * 4)) & 0x7;
+}
+
+static int Is_Interrupt_Pending(unsigned int vector)
+{
+    uint16_t mask = (uint16_t)(1u << (vector % 16));
+
+    return (PIC24_Sim_Registers.IFS[vector / 16] & mask) && (PIC24_Sim_Registers.IEC[vector / 16] & mask) && Get_Interrupt_Priority(vector) > 0;
+}
+
+//runs every pending and enabled ISR, highest priority first
+//(ties go to the lower vector number, just like the PIC's natural order)
+static void Service_Interrupts(void)
+{
+    unsigned int lastVector = PIC24_SIM_NUMBER_OF_VECTORS;
+    unsigned long repeatedEntries = 0;
+
+    while (true)
+    {
+        unsigned int bestVector = PIC24_SIM_NUMBER_OF_VECTORS;
+        unsigned int bestPriority = 0;
+        unsigned int vector;
+
+        for (vector = 0; vector < PIC24_SIM_NUMBER_OF_VECTORS; ++vector)
+        {
+            //skips the rest of a flag register at once when none of its interrupts are
+            //both flagged and enabled (this runs after every event)
+            if (vector % 16 == 0 && !(PIC24_Sim_Registers.IFS[vector / 16] & PIC24_Sim_Registers.IEC[vector / 16]))
+            {
+                vector += 15;
+                continue;
+            }
+
+            if (Is_Interrupt_Pending(vector) && Get_Interrupt_Priority(vector) > bestPriority)
+            {
+                bestVector = vector;
+                bestPriority = Get_Interrupt_Priority(vector);
+            }
+        }
+
+        if (bestVector == PIC24_SIM_NUMBER_OF_VECTORS)
+        {
+            return;
+        }
+
+        void (*handler)(void) = Get_Interrupt_Handler(bestVector);
+        if (handler == NULL)
+        {
+            //the PIC would take the default interrupt (a reset), the simulator just
+            //drops the request so that the rest of the run can continue
+            fprintf(stderr, "PIC24 simulator: vector %u is enabled but has no ISR\n", bestVector);
+            PIC24_Sim_Registers.IEC[bestVector / 16] &= (uint16_t)~(1u << (bestVector % 16));
+            continue;
+        }
+
+        repeatedEntries = (bestVector == lastVector) ? repeatedEntries + 1 : 0;
+        lastVector = bestVector;
+        if (repeatedEntries > RUNAWAY_INTERRUPT_LIMIT)
+        {
+            fprintf(stderr, "PIC24 simulator: the ISR for vector %u never clears its flag\n", bestVector);
+            exit(EXIT_FAILURE);
+        }
+
+        ++PIC24_Sim.interruptCount[bestVector];
+
+        if (PIC24_Sim_Interrupt_Entry_Hook != NULL)
+        {
+            PIC24_Sim_Interrupt_Entry_Hook(bestVector);
+        }
+
+        handler();
+
+        if (PIC24_Sim_Interrupt_Exit_Hook != NULL)
+        {
+            PIC24_Sim_Interrupt_Exit_Hook(bestVector);
+        }
+    }
+}
+
+
+
+//Timers
+static unsigned long Get_Prescale(uint16_t con)
+{
+    static const unsigned long prescalers[4] = { 1, 8, 64, 256 };
+
+    return prescalers[(con >> 4) & 0x3];
+}
+
+static uint16_t Get_Timer_Value(int index)
+{
+    Timer_State* timer = &PIC24_Sim.Timer[index];
+
+    if (!timer->running)
+    {
+        return timer->anchorValue;
+    }
+
+    unsigned long long elapsedTicks = (PIC24_Sim.now - timer->anchorCycle) / timer->prescale;
+    unsigned long long periodTicks = (unsigned long long)timer->period + 1;
+
+    //a timer that starts above its period register counts up to 0xFFFF and rolls over
+    //before it can match
+    if (timer->anchorValue > timer->period)
+    {
+        unsigned long long ticksToRollover = 0x10000 - timer->anchorValue;
+
+        if (elapsedTicks < ticksToRollover)
+        {
+            return (uint16_t)(timer->anchorValue + elapsedTicks);
+        }
+
+        return (uint16_t)((elapsedTicks - ticksToRollover) % periodTicks);
+    }
+
+    return (uint16_t)((timer->anchorValue + elapsedTicks) % periodTicks);
+}
+
+//the cycle at which the timer will next reset to 0 (and set its interrupt flag)
+static void Compute_Next_Timer_Match(int index)
+{
+    Timer_State* timer = &PIC24_Sim.Timer[index];
+
+    if (!timer->running)
+    {
+        timer->nextMatchCycle = NO_EVENT;
+        return;
+    }
+
+    unsigned long long periodTicks = (unsigned long long)timer->period + 1;
+    unsigned long long firstResetTick;
+
+    if (timer->anchorValue > timer->period)
+    {
+        firstResetTick = 0x10000 - timer->anchorValue;
+    }
+    else
+    {
+        firstResetTick = periodTicks - timer->anchorValue;
+    }
+
+    unsigned long long elapsedTicks = (PIC24_Sim.now - timer->anchorCycle) / timer->prescale;
+    unsigned long long resetTick = firstResetTick;
+
+    if (elapsedTicks >= firstResetTick)
+    {
+        resetTick += ((elapsedTicks - firstResetTick) / periodTicks + 1) * periodTicks;
+    }
+
+    timer->nextMatchCycle = timer->anchorCycle + resetTick * timer->prescale;
+}
+
+static void Anchor_Timer(int index)
+{
+    Timer_State* timer = &PIC24_Sim.Timer[index];
+    volatile PIC24_Sim_Timer_Registers* registers = &PIC24_Sim_Registers.Timer[index];
+    TxCONBITS con = *(TxCONBITS*)&registers->CON;
+
+    //only the internal (Fcy) clock source is modelled
+    timer->running = con.TON && !con.TCS;
+    timer->prescale = Get_Prescale(registers->CON);
+    timer->period = registers->PR;
+    timer->anchorCycle = PIC24_Sim.now;
+    timer->anchorValue = registers->TMR;
+    timer->shadowCON = registers->CON;
+    timer->shadowTMR = registers->TMR;
+
+    Compute_Next_Timer_Match(index);
+}
+
+static void Update_Timer_Registers(void)
+{
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_TIMERS; ++i)
+    {
+        uint16_t value = Get_Timer_Value(i);
+
+        PIC24_Sim_Registers.Timer[i].TMR = value;
+        PIC24_Sim.Timer[i].shadowTMR = value;
+    }
+}
+
+//the number of instruction cycles per tick of the clock selected by an ICTSEL/OCTSEL code
+static unsigned long Get_Clock_Select_Prescale(unsigned int clockSelect, int isOutputCompare)
+{
+    //IC:  000 = Timer3, 001 = Timer2, 010 = Timer4, 011 = Timer5, 100 = Timer1, 111 = Fcy
+    //OC:  000 = Timer2, 001 = Timer3, 010 = Timer4, 011 = Timer5, 100 = Timer1, 111 = Fcy
+    static const int icTimers[4] = { 2, 1, 3, 4 };
+    static const int ocTimers[4] = { 1, 2, 3, 4 };
+
+    if (clockSelect == SYSTEM_CLOCK_SELECT)
+    {
+        return 1;
+    }
+
+    if (clockSelect == 0b100)
+    {
+        return Get_Prescale(PIC24_Sim_Registers.Timer[0].CON);
+    }
+
+    if (clockSelect < 4)
+    {
+        int timer = isOutputCompare ? ocTimers[clockSelect] : icTimers[clockSelect];
+
+        return Get_Prescale(PIC24_Sim_Registers.Timer[timer].CON);
+    }
+
+    return 1;
+}
+
+
+
+//Input Capture
+static int Get_IC_Input_Pin(int index)
+{
+    uint16_t rpinr = PIC24_Sim_Registers.RPINR[7 + index / 2];
+
+    return (index % 2 == 0) ? (rpinr & 0x3F) : ((rpinr >> 8) & 0x3F);
+}
+
+static uint16_t Get_IC_Timebase(int index)
+{
+    ICxCON1BITS con1 = *(ICxCON1BITS*)&PIC24_Sim_Registers.IC[index].CON1;
+    ICxCON2BITS con2 = *(ICxCON2BITS*)&PIC24_Sim_Registers.IC[index].CON2;
+
+    //a module synchronized to a timer restarts with it, so it reads the same count
+    if (con2.SYNCSEL >= SYNCSEL_TIMER1 && con2.SYNCSEL <= SYNCSEL_TIMER5)
+    {
+        return Get_Timer_Value(con2.SYNCSEL - SYNCSEL_TIMER1);
+    }
+
+    //otherwise ICxTMR free-runs from its clock and rolls over at 0xFFFF
+    return (uint16_t)(PIC24_Sim.now / Get_Clock_Select_Prescale(con1.ICTSEL, false));
+}
+
+static void Clear_IC_FIFO(int index)
+{
+    IC_State* ic = &PIC24_Sim.IC[index];
+
+    ic->head = 0;
+    ic->count = 0;
+    ic->capturesSinceInterrupt = 0;
+    ic->prescaledEdges = 0;
+}
+
+static void Capture_Edge(int index, int level)
+{
+    IC_State* ic = &PIC24_Sim.IC[index];
+    volatile ICxCON1BITS* con1 = (volatile ICxCON1BITS*)&PIC24_Sim_Registers.IC[index].CON1;
+    int capture = false;
+
+    //ICBNE is read-only, so if the firmware has cleared it while the FIFO still holds
+    //values it must have rewritten ICxCON1 (which turns the module off and flushes it)
+    if (con1->ICM == IC_MODE_OFF || (ic->count > 0 && !con1->ICBNE))
+    {
+        Clear_IC_FIFO(index);
+        con1->ICOV = 0;
+
+        if (con1->ICM == IC_MODE_OFF)
+        {
+            return;
+        }
+    }
+
+    switch (con1->ICM)
+    {
+        case IC_MODE_EVERY_EDGE:
+            capture = true;
+            break;
+        case IC_MODE_FALLING_EDGE:
+            capture = (level == 0);
+            break;
+        case IC_MODE_RISING_EDGE:
+            capture = (level == 1);
+            break;
+        case IC_MODE_EVERY_4TH_RISING_EDGE:
+        case IC_MODE_EVERY_16TH_RISING_EDGE:
+            if (level == 1)
+            {
+                unsigned int divider = (con1->ICM == IC_MODE_EVERY_4TH_RISING_EDGE) ? 4 : 16;
+
+                ic->prescaledEdges = (ic->prescaledEdges + 1) % divider;
+                capture = (ic->prescaledEdges == 0);
+            }
+            break;
+        case IC_MODE_INTERRUPT_ONLY:
+            if (level == 1)
+            {
+                Set_Interrupt_Flag(IC_Vectors[index]);
+            }
+            return;
+        default:
+            return;
+    }
+
+    if (!capture)
+    {
+        return;
+    }
+
+    if (ic->count == PIC24_SIM_IC_FIFO_DEPTH)
+    {
+        //the 5th capture is lost and ICOV is raised until the FIFO is read
+        con1->ICOV = 1;
+        return;
+    }
+
+    ic->values[(ic->head + ic->count) % PIC24_SIM_IC_FIFO_DEPTH] = Get_IC_Timebase(index);
+    ++ic->count;
+    con1->ICBNE = 1;
+
+    //ICI = 0b00 interrupts on every capture, 0b11 on every 4th
+    if (++ic->capturesSinceInterrupt > con1->ICI)
+    {
+        ic->capturesSinceInterrupt = 0;
+        Set_Interrupt_Flag(IC_Vectors[index]);
+    }
+}
+
+//on the PIC this is a single MOV from ICxBUF, so its host cost is not counted
+CYCLE_COUNTER_FREE unsigned int PIC24_Sim_Read_ICxBUF(unsigned int moduleIndex)
+{
+    IC_State* ic = &PIC24_Sim.IC[moduleIndex];
+    volatile ICxCON1BITS* con1 = (volatile ICxCON1BITS*)&PIC24_Sim_Registers.IC[moduleIndex].CON1;
+
+    if (ic->count > 0)
+    {
+        ic->lastValue = ic->values[ic->head];
+        ic->head = (ic->head + 1) % PIC24_SIM_IC_FIFO_DEPTH;
+        --ic->count;
+    }
+
+    if (ic->count == 0)
+    {
+        con1->ICBNE = 0;
+        con1->ICOV = 0;
+    }
+
+    PIC24_Sim_Registers.IC[moduleIndex].BUF = ic->lastValue;
+
+    //reading an empty FIFO returns the last value that was in it
+    return ic->lastValue;
+}
+
+
+
+//Output Compare
+static int Get_OC_Output_Pin(int index)
+{
+    int pin;
+
+    for (pin = 0; pin < PIC24_SIM_NUMBER_OF_RP_PINS; ++pin)
+    {
+        uint16_t rpor = PIC24_Sim_Registers.RPOR[pin / 2];
+        unsigned int function = (pin % 2 == 0) ? (rpor & 0x3F) : ((rpor >> 8) & 0x3F);
+
+        if (function == OC1_REMAPPABLE_PIN_REFERENCE + (unsigned int)index)
+        {
+            return pin;
+        }
+    }
+
+    return NO_CONNECTION;
+}
+
+static int Is_OC_Generating_PWM(int index)
+{
+    unsigned int mode = PIC24_Sim_Registers.OC[index].CON1 & 0x7;
+
+    return mode == OC_MODE_EDGE_ALIGNED_PWM || mode == OC_MODE_CENTER_ALIGNED_PWM;
+}
+
+static unsigned int Get_OC_Sync_Select(int index)
+{
+    OCxCON2BITS con2 = *(OCxCON2BITS*)&PIC24_Sim_Registers.OC[index].CON2;
+
+    return con2.SYNCSEL;
+}
+
+//the module whose timer this module's period follows:  itself, or the OC module named
+//by SYNCSEL, which restarts this module's timer at the start of each of its own periods
+//(the simulator follows the other module from the moment SYNCSEL is written, instead of
+//from its next period like the PIC)
+static int Get_OC_Sync_Source(int index)
+{
+    unsigned int syncSelect = Get_OC_Sync_Select(index);
+
+    if (syncSelect >= SYNCSEL_OC1 && syncSelect <= SYNCSEL_OC6)
+    {
+        int source = (int)(syncSelect - SYNCSEL_OC1);
+
+        if (source != index && Is_OC_Generating_PWM(source) && Get_OC_Sync_Select(source) == SYNCSEL_SELF)
+        {
+            return source;
+        }
+    }
+
+    return index;
+}
+
+static unsigned long long Get_OC_Period_Ticks(int index)
+{
+    int source = Get_OC_Sync_Source(index);
+
+    //synchronized to itself (or to another module) the timer resets when the source
+    //module's timer matches its OCxRS, otherwise it free-runs through all 16 bits
+    if (source != index || Get_OC_Sync_Select(index) == SYNCSEL_SELF)
+    {
+        return (unsigned long long)PIC24_Sim_Registers.OC[source].RS + 1;
+    }
+
+    return 0x10000;
+}
+
+static unsigned long long Get_OC_Anchor(int index)
+{
+    return PIC24_Sim.OC[Get_OC_Sync_Source(index)].anchorCycle;
+}
+
+static unsigned long Get_OC_Prescale(int index)
+{
+    OCxCON1BITS con1 = *(OCxCON1BITS*)&PIC24_Sim_Registers.OC[index].CON1;
+
+    return Get_Clock_Select_Prescale(con1.OCTSEL, true);
+}
+
+//the number of ticks since the module's timer was started (the current period is
+//ticks / periodTicks, and the position in it is ticks % periodTicks)
+static unsigned long long Get_OC_Elapsed_Ticks(int index)
+{
+    return (PIC24_Sim.now - Get_OC_Anchor(index)) / Get_OC_Prescale(index);
+}
+
+static int Get_OC_Level(int index)
+{
+    if (!Is_OC_Generating_PWM(index))
+    {
+        return 0;
+    }
+
+    OC_State* oc = &PIC24_Sim.OC[index];
+    unsigned long long periodTicks = Get_OC_Period_Ticks(index);
+    unsigned long long tick = Get_OC_Elapsed_Ticks(index);
+
+    if (oc->hasOverride && tick / periodTicks == oc->overridePeriod)
+    {
+        return oc->overrideLevel;
+    }
+
+    //edge-aligned PWM is high from the start of the period until OCxTMR matches OCxR
+    return (tick % periodTicks) < oc->shadowR;
+}
+
+static unsigned long long Get_Next_OC_Edge(int index)
+{
+    if (!Is_OC_Generating_PWM(index))
+    {
+        return NO_EVENT;
+    }
+
+    OC_State* oc = &PIC24_Sim.OC[index];
+    unsigned long long periodTicks = Get_OC_Period_Ticks(index);
+    unsigned long long dutyTicks = oc->shadowR;
+    unsigned long long prescale = Get_OC_Prescale(index);
+    unsigned long long periodCycles = periodTicks * prescale;
+    unsigned long long anchor = Get_OC_Anchor(index);
+    unsigned long long periodStart = PIC24_Sim.now - (PIC24_Sim.now - anchor) % periodCycles;
+
+    //a held level lasts until the next period, which starts high unless OCxR is 0
+    if (oc->hasOverride && (PIC24_Sim.now - anchor) / periodCycles == oc->overridePeriod)
+    {
+        unsigned long long nextPeriodStart = periodStart + periodCycles;
+
+        if (oc->overrideLevel != (dutyTicks > 0))
+        {
+            return nextPeriodStart;
+        }
+        if (dutyTicks > 0 && dutyTicks < periodTicks)
+        {
+            return nextPeriodStart + dutyTicks * prescale;
+        }
+        return NO_EVENT;
+    }
+
+    //0% and 100% duty cycles never change level
+    if (dutyTicks == 0 || dutyTicks >= periodTicks)
+    {
+        return NO_EVENT;
+    }
+
+    unsigned long long rise = periodStart;
+    unsigned long long fall = periodStart + dutyTicks * prescale;
+
+    if (rise <= PIC24_Sim.now)
+    {
+        rise += periodCycles;
+    }
+    if (fall <= PIC24_Sim.now)
+    {
+        fall += periodCycles;
+    }
+
+    return rise < fall ? rise : fall;
+}
+
+//OCxR is modeled without a buffer:  the output only goes low when the timer matches
+//OCxR, so a write in the middle of a period that the timer has already passed is not
+//matched until the next period.  Shortening a pulse that is already longer than the new
+//value holds the output high for the rest of the period, and lengthening one that has
+//already ended leaves it low.
+static void Handle_OC_Duty_Write(int index)
+{
+    OC_State* oc = &PIC24_Sim.OC[index];
+    uint16_t dutyTicks = PIC24_Sim_Registers.OC[index].R;
+
+    if (Is_OC_Generating_PWM(index))
+    {
+        unsigned long long periodTicks = Get_OC_Period_Ticks(index);
+        unsigned long long elapsedTicks = Get_OC_Elapsed_Ticks(index);
+        unsigned long long period = elapsedTicks / periodTicks;
+        unsigned long long tick = elapsedTicks % periodTicks;
+        int level = Get_OC_Level(index);
+
+        oc->hasOverride = false;
+
+        //a write right at the start of a period applies to that whole period
+        if (tick > 0 && ((level && dutyTicks <= tick) || (!level && dutyTicks > tick)))
+        {
+            oc->hasOverride = true;
+            oc->overridePeriod = period;
+            oc->overrideLevel = level;
+        }
+    }
+
+    oc->shadowR = dutyTicks;
+}
+
+//in the PWM modes the module's interrupt flag is set at the start of every period
+//(only simulated while the interrupt is enabled, so idle modules cost nothing)
+static int Is_OC_Interrupt_Enabled(int index)
+{
+    unsigned int vector = OC_Vectors[index];
+
+    return Is_OC_Generating_PWM(index) && (PIC24_Sim_Registers.IEC[vector / 16] & (1u << (vector % 16)));
+}
+
+static unsigned long long Get_Next_OC_Period_Start(int index)
+{
+    if (!Is_OC_Interrupt_Enabled(index))
+    {
+        return NO_EVENT;
+    }
+
+    unsigned long long periodCycles = Get_OC_Period_Ticks(index) * Get_OC_Prescale(index);
+    unsigned long long anchor = Get_OC_Anchor(index);
+
+    return PIC24_Sim.now - (PIC24_Sim.now - anchor) % periodCycles + periodCycles;
+}
+
+static void Set_OC_Period_Flags(void)
+{
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_OC_MODULES; ++i)
+    {
+        OC_State* oc = &PIC24_Sim.OC[i];
+
+        if (!Is_OC_Interrupt_Enabled(i) || oc->lastInterruptCycle == PIC24_Sim.now)
+        {
+            continue;
+        }
+
+        unsigned long long periodCycles = Get_OC_Period_Ticks(i) * Get_OC_Prescale(i);
+        unsigned long long anchor = Get_OC_Anchor(i);
+
+        if (PIC24_Sim.now > anchor && (PIC24_Sim.now - anchor) % periodCycles == 0)
+        {
+            oc->lastInterruptCycle = PIC24_Sim.now;
+            Set_Interrupt_Flag(OC_Vectors[i]);
+        }
+    }
+}
+
+
+
+//UART1 (8 data bits with no parity or 9 data bits, 1 or 2 stop bits, no flow control)
+//Everything PIC24_Sim_Next_U1TXREG_Slot calls is CYCLE_COUNTER_FREE as well, so writing
+//U1TXREG is only counted as the one instruction it is on the PIC
+CYCLE_COUNTER_FREE static int Is_UART_Transmitter_On(void)
+{
+    return U1MODEbits.UARTEN && U1STAbits.UTXEN;
+}
+
+//how long one byte takes, start bit to stop bit
+CYCLE_COUNTER_FREE static unsigned long long Get_UART_Byte_Cycles(void)
+{
+    unsigned long long cyclesPerBit = (unsigned long long)(U1BRG + 1) * (U1MODEbits.BRGH ? 4 : 16);
+    unsigned int bits = 1 + (U1MODEbits.PDSEL == 0b11 ? 9 : 8) + (U1MODEbits.STSEL ? 2 : 1);
+
+    return cyclesPerBit * bits;
+}
+
+CYCLE_COUNTER_FREE static unsigned int Get_UART_TX_Interrupt_Mode(void)
+{
+    return (U1STAbits.UTXISEL1 << 1) | U1STAbits.UTXISEL0;
+}
+
+//the status bits the firmware reads (the rest of U1STA is left as the firmware wrote it)
+CYCLE_COUNTER_FREE static void Update_UART_Status(void)
+{
+    UART_State* uart = &PIC24_Sim.UART1;
+
+    U1STAbits.UTXBF = uart->txCount - (unsigned int)uart->shifting >= PIC24_SIM_UART_TX_SLOTS - 1;
+    U1STAbits.TRMT = uart->txCount == 0;
+    U1STAbits.URXDA = uart->rxCount > 0;
+    U1STAbits.RIDLE = 1;
+}
+
+//moves the oldest byte in the FIFO into the shift register
+CYCLE_COUNTER_FREE static void Start_UART_Shift(void)
+{
+    UART_State* uart = &PIC24_Sim.UART1;
+    unsigned int mode = Get_UART_TX_Interrupt_Mode();
+
+    uart->shifting = true;
+    uart->shiftEndCycle = PIC24_Sim.now + Get_UART_Byte_Cycles();
+
+    if (mode == UART_TX_INTERRUPT_ON_SPACE || (mode == UART_TX_INTERRUPT_ON_EMPTY && uart->txCount == 1))
+    {
+        Set_Interrupt_Flag(PIC24_SIM_VECTOR_U1TX);
+    }
+}
+
+CYCLE_COUNTER_FREE unsigned int PIC24_Sim_Next_U1TXREG_Slot(void)
+{
+    UART_State* uart = &PIC24_Sim.UART1;
+    unsigned int slot;
+
+    if (!Is_UART_Transmitter_On() || uart->txCount - (unsigned int)uart->shifting >= PIC24_SIM_UART_TX_SLOTS - 1)
+    {
+        return UART_TX_IGNORED_SLOT;
+    }
+
+    slot = (uart->txHead + uart->txCount) % PIC24_SIM_UART_TX_SLOTS;
+    ++uart->txCount;
+    if (!uart->shifting)
+    {
+        Start_UART_Shift();
+    }
+
+    Update_UART_Status();
+    return slot;
+}
+
+//the byte in the shift register has been sent
+static void Finish_UART_Byte(void)
+{
+    UART_State* uart = &PIC24_Sim.UART1;
+    uint8_t byte = (uint8_t)PIC24_Sim_Registers.UART1.TXREG[uart->txHead];
+
+    uart->txHead = (uart->txHead + 1) % PIC24_SIM_UART_TX_SLOTS;
+    --uart->txCount;
+    uart->shifting = false;
+
+    if (uart->txCount > 0)
+    {
+        Start_UART_Shift();
+    }
+    else if (Get_UART_TX_Interrupt_Mode() == UART_TX_INTERRUPT_ON_DONE)
+    {
+        Set_Interrupt_Flag(PIC24_SIM_VECTOR_U1TX);
+    }
+
+    Update_UART_Status();
+
+    if (PIC24_Sim_UART_Transmit_Hook != NULL)
+    {
+        PIC24_Sim_UART_Transmit_Hook(byte);
+    }
+}
+
+void PIC24_Sim_UART_Receive(uint8_t byte)
+{
+    UART_State* uart = &PIC24_Sim.UART1;
+
+    if (!U1MODEbits.UARTEN)
+    {
+        return;
+    }
+
+    if (uart->rxCount == PIC24_SIM_UART_RX_FIFO_DEPTH)
+    {
+        U1STAbits.OERR = 1;
+        return;
+    }
+
+    uart->rx[(uart->rxHead + uart->rxCount) % PIC24_SIM_UART_RX_FIFO_DEPTH] = byte;
+    ++uart->rxCount;
+
+    //URXISEL 0b0x interrupts on every byte, 0b10 at 3 bytes and 0b11 at 4
+    if (U1STAbits.URXISEL < 0b10 || uart->rxCount >= U1STAbits.URXISEL + 1)
+    {
+        Set_Interrupt_Flag(PIC24_SIM_VECTOR_U1RX);
+    }
+
+    Update_UART_Status();
+}
+
+CYCLE_COUNTER_FREE unsigned int PIC24_Sim_Read_U1RXREG(void)
+{
+    UART_State* uart = &PIC24_Sim.UART1;
+    uint16_t byte;
+
+    if (uart->rxCount == 0)
+    {
+        return 0;
+    }
+
+    byte = uart->rx[uart->rxHead];
+    uart->rxHead = (uart->rxHead + 1) % PIC24_SIM_UART_RX_FIFO_DEPTH;
+    --uart->rxCount;
+
+    Update_UART_Status();
+    return byte;
+}
+
+//turning the UART off empties both FIFOs, and turning the transmitter on sets U1TXIF
+//(its buffer is empty)
+static void Sync_UART_Changes(void)
+{
+    UART_State* uart = &PIC24_Sim.UART1;
+    int transmitterOn = Is_UART_Transmitter_On();
+
+    if (!U1MODEbits.UARTEN && (uart->txCount > 0 || uart->rxCount > 0))
+    {
+        uart->txCount = 0;
+        uart->rxCount = 0;
+        uart->shifting = false;
+        Update_UART_Status();
+    }
+
+    if (transmitterOn && !uart->transmitterWasEnabled)
+    {
+        Set_Interrupt_Flag(PIC24_SIM_VECTOR_U1TX);
+    }
+    uart->transmitterWasEnabled = transmitterOn;
+}
+
+
+
+//Pins
+static void Drive_Input_Pin(unsigned int pin, int level)
+{
+    int i;
+
+    if (pin >= PIC24_SIM_NUMBER_OF_RP_PINS || PIC24_Sim.externalLevel[pin] == level)
+    {
+        return;
+    }
+
+    PIC24_Sim.externalLevel[pin] = level;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_IC_MODULES; ++i)
+    {
+        if (Get_IC_Input_Pin(i) == (int)pin)
+        {
+            Capture_Edge(i, level);
+        }
+    }
+}
+
+int PIC24_Sim_Get_Pin_Level(unsigned int rpPin)
+{
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_OC_MODULES; ++i)
+    {
+        if (Is_OC_Generating_PWM(i) && Get_OC_Output_Pin(i) == (int)rpPin)
+        {
+            return Get_OC_Level(i);
+        }
+    }
+
+    if (!((PIC24_Sim_Registers.PortB.TRIS >> rpPin) & 1))
+    {
+        return (PIC24_Sim_Registers.PortB.LAT >> rpPin) & 1;
+    }
+
+    return PIC24_Sim.externalLevel[rpPin];
+}
+
+//the same levels as PIC24_Sim_Get_Pin_Level gives, with each OC module's pin looked up
+//once instead of once per pin (this runs after every event, so it is most of the time
+//the simulator takes)
+static void Update_Port_Registers(void)
+{
+    uint16_t ocDriven = 0;
+    uint16_t ocLevels = 0;
+    uint16_t tris = PIC24_Sim_Registers.PortB.TRIS;
+    uint16_t portB = 0;
+    unsigned int pin;
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_OC_MODULES; ++i)
+    {
+        int ocPin;
+
+        if (!Is_OC_Generating_PWM(i))
+        {
+            continue;
+        }
+
+        ocPin = Get_OC_Output_Pin(i);
+        //the lowest numbered module wins if two are mapped to the same pin
+        if (ocPin != NO_CONNECTION && !((ocDriven >> ocPin) & 1))
+        {
+            ocDriven |= (uint16_t)(1 << ocPin);
+            ocLevels |= (uint16_t)(Get_OC_Level(i) << ocPin);
+        }
+    }
+
+    for (pin = 0; pin < PIC24_SIM_NUMBER_OF_RP_PINS; ++pin)
+    {
+        int level;
+
+        if ((ocDriven >> pin) & 1)
+        {
+            level = (ocLevels >> pin) & 1;
+        }
+        else if (!((tris >> pin) & 1))
+        {
+            level = (PIC24_Sim_Registers.PortB.LAT >> pin) & 1;
+        }
+        else
+        {
+            level = PIC24_Sim.externalLevel[pin];
+        }
+
+        portB |= (uint16_t)(level << pin);
+    }
+
+    PIC24_Sim_Registers.PortB.PORT = portB;
+    //Port A has no remappable inputs, so it only ever reads back what it drives
+    PIC24_Sim_Registers.PortA.PORT = PIC24_Sim_Registers.PortA.LAT & (uint16_t)~PIC24_Sim_Registers.PortA.TRIS;
+}
+
+
+
+//Edge queue (a binary min-heap ordered by time, then by the order edges were scheduled)
+static int Edge_Before(const Scheduled_Edge* a, const Scheduled_Edge* b)
+{
+    return a->cycle < b->cycle || (a->cycle == b->cycle && a->sequence < b->sequence);
+}
+
+static void Swap_Edges(unsigned long a, unsigned long b)
+{
+    Scheduled_Edge temporary = PIC24_Sim.edges[a];
+
+    PIC24_Sim.edges[a] = PIC24_Sim.edges[b];
+    PIC24_Sim.edges[b] = temporary;
+}
+
+void PIC24_Sim_Schedule_Edge(unsigned int rpPin, unsigned long long cycle, int level)
+{
+    if (PIC24_Sim.numberOfEdges == PIC24_Sim.edgeCapacity)
+    {
+        PIC24_Sim.edgeCapacity = PIC24_Sim.edgeCapacity ? PIC24_Sim.edgeCapacity * 2 : 1024;
+        PIC24_Sim.edges = realloc(PIC24_Sim.edges, PIC24_Sim.edgeCapacity * sizeof(Scheduled_Edge));
+
+        if (PIC24_Sim.edges == NULL)
+        {
+            fprintf(stderr, "PIC24 simulator: out of memory for scheduled edges\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    unsigned long child = PIC24_Sim.numberOfEdges++;
+
+    PIC24_Sim.edges[child].cycle = cycle;
+    PIC24_Sim.edges[child].sequence = PIC24_Sim.edgeSequence++;
+    PIC24_Sim.edges[child].pin = rpPin;
+    PIC24_Sim.edges[child].level = level ? 1 : 0;
+
+    while (child > 0 && Edge_Before(&PIC24_Sim.edges[child], &PIC24_Sim.edges[(child - 1) / 2]))
+    {
+        Swap_Edges(child, (child - 1) / 2);
+        child = (child - 1) / 2;
+    }
+}
+
+static Scheduled_Edge Pop_Edge(void)
+{
+    Scheduled_Edge first = PIC24_Sim.edges[0];
+    unsigned long parent = 0;
+
+    PIC24_Sim.edges[0] = PIC24_Sim.edges[--PIC24_Sim.numberOfEdges];
+
+    while (true)
+    {
+        unsigned long smallest = parent;
+        unsigned long left = 2 * parent + 1;
+        unsigned long right = left + 1;
+
+        if (left < PIC24_Sim.numberOfEdges && Edge_Before(&PIC24_Sim.edges[left], &PIC24_Sim.edges[smallest]))
+        {
+            smallest = left;
+        }
+        if (right < PIC24_Sim.numberOfEdges && Edge_Before(&PIC24_Sim.edges[right], &PIC24_Sim.edges[smallest]))
+        {
+            smallest = right;
+        }
+        if (smallest == parent)
+        {
+            return first;
+        }
+
+        Swap_Edges(parent, smallest);
+        parent = smallest;
+    }
+}
+
+void PIC24_Sim_Schedule_Pulse_Train(unsigned int rpPin, unsigned long long startCycle, unsigned long highCycles, unsigned long periodCycles, unsigned int numberOfPeriods)
+{
+    unsigned int i;
+
+    for (i = 0; i < numberOfPeriods; ++i)
+    {
+        unsigned long long rise = startCycle + (unsigned long long)i * periodCycles;
+
+        PIC24_Sim_Schedule_Edge(rpPin, rise, 1);
+        PIC24_Sim_Schedule_Edge(rpPin, rise + highCycles, 0);
+    }
+}
+
+
+
+//Simulation
+void PIC24_Sim_Reset(void)
+{
+    int i;
+
+    free(PIC24_Sim.edges);
+    memset(&PIC24_Sim, 0, sizeof(PIC24_Sim));
+    memset((void*)&PIC24_Sim_Registers, 0, sizeof(PIC24_Sim_Registers));
+
+    //power-on values: every pin is an analog input and every period register is 0xFFFF
+    PIC24_Sim_Registers.PortA.TRIS = 0xFFFF;
+    PIC24_Sim_Registers.PortB.TRIS = 0xFFFF;
+    PIC24_Sim_Registers.PortA.ANS = 0xFFFF;
+    PIC24_Sim_Registers.PortB.ANS = 0xFFFF;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_TIMERS; ++i)
+    {
+        PIC24_Sim_Registers.Timer[i].PR = 0xFFFF;
+        Anchor_Timer(i);
+    }
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_RP_PINS; ++i)
+    {
+        PIC24_Sim.connectedInput[i] = NO_CONNECTION;
+    }
+
+    //every interrupt defaults to priority 4 after a reset
+    for (i = 0; i < 30; ++i)
+    {
+        PIC24_Sim_Registers.IPC[i] = 0x4444;
+    }
+
+    //the configuration bits start the PIC on the FRC oscillator with its postscaler
+    //(FNOSC = FRCDIV), and RCDIV resets to 1:2
+    OSCCONbits.COSC = 0b111;
+    OSCCONbits.NOSC = 0b111;
+    CLKDIVbits.RCDIV = 0b001;
+
+    //the UART's transmitter starts out empty and its receiver idle
+    U1STAbits.TRMT = 1;
+    U1STAbits.RIDLE = 1;
+}
+
+void PIC24_Sim_Write_OSCCONH(unsigned int value)
+{
+    OSCCON = (OSCCON & 0x00FF) | ((value & 0xFF) << 8);
+}
+
+void PIC24_Sim_Write_OSCCONL(unsigned int value)
+{
+    OSCCON = (OSCCON & 0xFF00) | (value & 0xFF);
+
+    //the switch to NOSC happens right away, and the FRCPLL (0b001) and primary PLL (0b011)
+    //settings lock their PLL at the same time
+    if (OSCCONbits.OSWEN)
+    {
+        OSCCONbits.COSC = OSCCONbits.NOSC;
+        OSCCONbits.LOCK = (OSCCONbits.NOSC == 0b001 || OSCCONbits.NOSC == 0b011);
+        OSCCONbits.OSWEN = 0;
+    }
+}
+
+unsigned long long PIC24_Sim_Now(void)
+{
+    return PIC24_Sim.now;
+}
+
+void PIC24_Sim_Connect_Pins(unsigned int outputPin, unsigned int inputPin)
+{
+    PIC24_Sim.connectedInput[outputPin] = (int)inputPin;
+}
+
+unsigned long PIC24_Sim_Get_Interrupt_Count(unsigned int vector)
+{
+    return PIC24_Sim.interruptCount[vector];
+}
+
+//the firmware changes registers directly, so any change that affects timing
+//(timer configuration, OC mode or period) is picked up here before time moves on
+static void Sync_Firmware_Changes(void)
+{
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_TIMERS; ++i)
+    {
+        Timer_State* timer = &PIC24_Sim.Timer[i];
+        volatile PIC24_Sim_Timer_Registers* registers = &PIC24_Sim_Registers.Timer[i];
+
+        if (registers->CON != timer->shadowCON || registers->PR != timer->period || registers->TMR != timer->shadowTMR)
+        {
+            //a timer keeps its count while it is stopped, so the register is the new anchor
+            if (registers->TMR == timer->shadowTMR)
+            {
+                registers->TMR = Get_Timer_Value(i);
+            }
+
+            Anchor_Timer(i);
+        }
+    }
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_OC_MODULES; ++i)
+    {
+        OC_State* oc = &PIC24_Sim.OC[i];
+        volatile PIC24_Sim_OC_Registers* registers = &PIC24_Sim_Registers.OC[i];
+
+        if (registers->CON1 != oc->shadowCON1 || registers->CON2 != oc->shadowCON2 || registers->RS != oc->shadowRS)
+        {
+            //a new mode or period restarts the module's timer
+            oc->shadowCON1 = registers->CON1;
+            oc->shadowCON2 = registers->CON2;
+            oc->shadowRS = registers->RS;
+            oc->anchorCycle = PIC24_Sim.now;
+            oc->hasOverride = false;
+        }
+
+        if (registers->R != oc->shadowR)
+        {
+            Handle_OC_Duty_Write(i);
+        }
+    }
+
+    Sync_UART_Changes();
+}
+
+//OC outputs that are looped back into an input pin change that pin immediately
+static void Propagate_OC_Outputs(void)
+{
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_OC_MODULES; ++i)
+    {
+        int pin = Get_OC_Output_Pin(i);
+
+        if (pin == NO_CONNECTION || PIC24_Sim.connectedInput[pin] == NO_CONNECTION)
+        {
+            continue;
+        }
+
+        int level = Get_OC_Level(i);
+        if (level != PIC24_Sim.OC[i].lastLevel)
+        {
+            PIC24_Sim.OC[i].lastLevel = level;
+            Drive_Input_Pin((unsigned int)PIC24_Sim.connectedInput[pin], level);
+
+            if (PIC24_Sim_Output_Edge_Hook != NULL)
+            {
+                PIC24_Sim_Output_Edge_Hook((unsigned int)pin, level);
+            }
+        }
+    }
+}
+
+static unsigned long long Get_Next_Connected_OC_Edge(void)
+{
+    unsigned long long next = NO_EVENT;
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_OC_MODULES; ++i)
+    {
+        int pin = Get_OC_Output_Pin(i);
+
+        if (pin != NO_CONNECTION && PIC24_Sim.connectedInput[pin] != NO_CONNECTION)
+        {
+            unsigned long long edge = Get_Next_OC_Edge(i);
+
+            if (edge < next)
+            {
+                next = edge;
+            }
+        }
+    }
+
+    return next;
+}
+
+void PIC24_Sim_Run_Until(unsigned long long cycle)
+{
+    Sync_Firmware_Changes();
+    Propagate_OC_Outputs();
+    Update_Port_Registers();
+    Service_Interrupts();
+
+    while (true)
+    {
+        unsigned long long next = NO_EVENT;
+        int i;
+
+        Sync_Firmware_Changes();
+
+        if (PIC24_Sim.numberOfEdges > 0)
+        {
+            next = PIC24_Sim.edges[0].cycle < PIC24_Sim.now ? PIC24_Sim.now : PIC24_Sim.edges[0].cycle;
+        }
+
+        for (i = 0; i < PIC24_SIM_NUMBER_OF_TIMERS; ++i)
+        {
+            if (PIC24_Sim.Timer[i].nextMatchCycle < next)
+            {
+                next = PIC24_Sim.Timer[i].nextMatchCycle;
+            }
+        }
+
+        unsigned long long ocEdge = Get_Next_Connected_OC_Edge();
+        if (ocEdge < next)
+        {
+            next = ocEdge;
+        }
+
+        if (PIC24_Sim.UART1.shifting && PIC24_Sim.UART1.shiftEndCycle < next)
+        {
+            next = PIC24_Sim.UART1.shiftEndCycle;
+        }
+
+        for (i = 0; i < PIC24_SIM_NUMBER_OF_OC_MODULES; ++i)
+        {
+            unsigned long long periodStart = Get_Next_OC_Period_Start(i);
+
+            if (periodStart < next)
+            {
+                next = periodStart;
+            }
+        }
+
+        if (next > cycle)
+        {
+            PIC24_Sim.now = cycle > PIC24_Sim.now ? cycle : PIC24_Sim.now;
+            Update_Timer_Registers();
+            Update_Port_Registers();
+            return;
+        }
+
+        PIC24_Sim.now = next;
+        Update_Timer_Registers();
+
+        while (PIC24_Sim.numberOfEdges > 0 && PIC24_Sim.edges[0].cycle <= PIC24_Sim.now)
+        {
+            Scheduled_Edge edge = Pop_Edge();
+
+            Drive_Input_Pin(edge.pin, edge.level);
+        }
+
+        for (i = 0; i < PIC24_SIM_NUMBER_OF_TIMERS; ++i)
+        {
+            if (PIC24_Sim.Timer[i].nextMatchCycle <= PIC24_Sim.now)
+            {
+                Set_Interrupt_Flag(Timer_Vectors[i]);
+                Compute_Next_Timer_Match(i);
+            }
+        }
+
+        if (PIC24_Sim.UART1.shifting && PIC24_Sim.UART1.shiftEndCycle <= PIC24_Sim.now)
+        {
+            Finish_UART_Byte();
+        }
+
+        Set_OC_Period_Flags();
+        Propagate_OC_Outputs();
+        Update_Port_Registers();
+        Service_Interrupts();
+    }
+}
+
+void PIC24_Sim_Run_For(unsigned long long cycles)
+{
+    PIC24_Sim_Run_Until(PIC24_Sim.now + cycles);
+}
+
+//called by the MCC-generated main() preamble on the PIC, nothing needs configuring here
+void SYSTEM_Initialize(void)
+{
+}
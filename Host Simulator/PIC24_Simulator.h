@@ -0,0 +1,607 @@
+/*
+ * File:    PIC24_Simulator.h
+ * Author:  Zachary Downum
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+//This is a register-level model of the parts of the PIC24FJ128GA202 that the
+//Dependencies folder uses (Input Capture, Output Compare, Timer1-5, the interrupt
+//controller, Peripheral Pin Select, Ports A/B, the oscillator switch and UART1).  It lets
+//InputCapture.c and PWM.c be compiled unmodified for a Linux host so that they can be
+//benchmarked and tested.
+//
+//Every SFR name the firmware uses (IC1CON1, IC1CON1bits, OC1RS, T1CON, IFS0bits...)
+//is a macro that expands to a field of PIC24_Sim_Registers, so firmware code reads and
+//writes them exactly as it would on the PIC.  The only exception is ICxBUF, which has
+//to pop the capture FIFO when it is read, so it expands to a function call (and so do
+//U1RXREG, which pops the receive FIFO, and U1TXREG, which pushes onto the transmit FIFO).
+//
+//Time only passes inside the simulator when PIC24_Sim_Run_Until (or __delay_ms) is
+//called.  Firmware code itself runs in zero simulated time, which is why cycle costs are
+//measured separately (see Cycle_Counter.h).
+
+//the host equivalents of the XC16 interrupt attributes
+#define __interrupt__ __used__
+#define auto_psv __used__
+
+#define Nop() ((void)0)
+
+#define PIC24_SIM_NUMBER_OF_IC_MODULES 6
+#define PIC24_SIM_NUMBER_OF_OC_MODULES 6
+#define PIC24_SIM_NUMBER_OF_TIMERS 5
+#define PIC24_SIM_NUMBER_OF_RP_PINS 16
+#define PIC24_SIM_IC_FIFO_DEPTH 4
+#define PIC24_SIM_NUMBER_OF_VECTORS 128
+//the UART's transmit FIFO is 4 deep, plus the shift register
+#define PIC24_SIM_UART_TX_SLOTS 5
+#define PIC24_SIM_UART_RX_FIFO_DEPTH 4
+
+
+//IC module registers (see section 13 of the PIC24FJ128GA204 family data sheet)
+typedef struct
+{
+    uint16_t ICM:3;
+    uint16_t ICBNE:1;
+    uint16_t ICOV:1;
+    uint16_t ICI:2;
+    uint16_t :3;
+    uint16_t ICTSEL:3;
+    uint16_t ICSIDL:1;
+    uint16_t :2;
+} ICxCON1BITS;
+
+typedef struct
+{
+    uint16_t SYNCSEL:5;
+    uint16_t :1;
+    uint16_t TRIGSTAT:1;
+    uint16_t ICTRIG:1;
+    uint16_t IC32:1;
+    uint16_t :7;
+} ICxCON2BITS;
+
+//OC module registers (see section 14 of the PIC24FJ128GA204 family data sheet)
+typedef struct
+{
+    uint16_t OCM:3;
+    uint16_t TRIGMODE:1;
+    uint16_t OCFLT0:1;
+    uint16_t OCFLT1:1;
+    uint16_t OCFLT2:1;
+    uint16_t ENFLT0:1;
+    uint16_t ENFLT1:1;
+    uint16_t ENFLT2:1;
+    uint16_t OCTSEL:3;
+    uint16_t OCSIDL:1;
+    uint16_t :2;
+} OCxCON1BITS;
+
+typedef struct
+{
+    uint16_t SYNCSEL:5;
+    uint16_t OCTRIS:1;
+    uint16_t TRIGSTAT:1;
+    uint16_t OCTRIG:1;
+    uint16_t OC32:1;
+    uint16_t DCB:2;
+    uint16_t :1;
+    uint16_t OCINV:1;
+    uint16_t FLTTRIEN:1;
+    uint16_t FLTOUT:1;
+    uint16_t FLTMD:1;
+} OCxCON2BITS;
+
+//Timer1 and Timer2-5 share the same layout for the bits the firmware uses
+//(T32 only exists on Timer2 and Timer4)
+typedef struct
+{
+    uint16_t :1;
+    uint16_t TCS:1;
+    uint16_t TSYNC:1;
+    uint16_t T32:1;
+    uint16_t TCKPS:2;
+    uint16_t TGATE:1;
+    uint16_t :6;
+    uint16_t TSIDL:1;
+    uint16_t :1;
+    uint16_t TON:1;
+} TxCONBITS;
+
+typedef struct
+{
+    uint16_t IC1R:6;
+    uint16_t :2;
+    uint16_t IC2R:6;
+    uint16_t :2;
+} RPINR7BITS;
+
+typedef struct
+{
+    uint16_t IC3R:6;
+    uint16_t :2;
+    uint16_t IC4R:6;
+    uint16_t :2;
+} RPINR8BITS;
+
+typedef struct
+{
+    uint16_t IC5R:6;
+    uint16_t :2;
+    uint16_t IC6R:6;
+    uint16_t :2;
+} RPINR9BITS;
+
+typedef struct
+{
+    uint16_t U1RXR:6;
+    uint16_t :2;
+    uint16_t U1CTSR:6;
+    uint16_t :2;
+} RPINR18BITS;
+
+//RPORn holds the output function for RP(2n) and RP(2n + 1)
+typedef struct { uint16_t RP0R:6; uint16_t :2; uint16_t RP1R:6; uint16_t :2; } RPOR0BITS;
+typedef struct { uint16_t RP2R:6; uint16_t :2; uint16_t RP3R:6; uint16_t :2; } RPOR1BITS;
+typedef struct { uint16_t RP4R:6; uint16_t :2; uint16_t RP5R:6; uint16_t :2; } RPOR2BITS;
+typedef struct { uint16_t RP6R:6; uint16_t :2; uint16_t RP7R:6; uint16_t :2; } RPOR3BITS;
+typedef struct { uint16_t RP8R:6; uint16_t :2; uint16_t RP9R:6; uint16_t :2; } RPOR4BITS;
+typedef struct { uint16_t RP10R:6; uint16_t :2; uint16_t RP11R:6; uint16_t :2; } RPOR5BITS;
+typedef struct { uint16_t RP12R:6; uint16_t :2; uint16_t RP13R:6; uint16_t :2; } RPOR6BITS;
+typedef struct { uint16_t RP14R:6; uint16_t :2; uint16_t RP15R:6; uint16_t :2; } RPOR7BITS;
+
+//the interrupt flag/enable registers, only the bits the firmware uses are named
+//vector number = 16 * (register index) + (bit number)
+typedef struct
+{
+    uint16_t INT0IF:1; uint16_t IC1IF:1; uint16_t OC1IF:1; uint16_t T1IF:1;
+    uint16_t :1; uint16_t IC2IF:1; uint16_t OC2IF:1; uint16_t T2IF:1;
+    uint16_t T3IF:1; uint16_t SPF1IF:1; uint16_t SPI1IF:1; uint16_t U1RXIF:1;
+    uint16_t U1TXIF:1; uint16_t :2; uint16_t NVMIF:1;
+} IFS0BITS;
+
+typedef struct
+{
+    uint16_t :9; uint16_t OC3IF:1; uint16_t OC4IF:1; uint16_t T4IF:1;
+    uint16_t T5IF:1; uint16_t INT2IF:1; uint16_t U2RXIF:1; uint16_t U2TXIF:1;
+} IFS1BITS;
+
+typedef struct
+{
+    uint16_t :5; uint16_t IC3IF:1; uint16_t IC4IF:1; uint16_t IC5IF:1;
+    uint16_t IC6IF:1; uint16_t OC5IF:1; uint16_t OC6IF:1; uint16_t :5;
+} IFS2BITS;
+
+typedef struct
+{
+    uint16_t INT0IE:1; uint16_t IC1IE:1; uint16_t OC1IE:1; uint16_t T1IE:1;
+    uint16_t :1; uint16_t IC2IE:1; uint16_t OC2IE:1; uint16_t T2IE:1;
+    uint16_t T3IE:1; uint16_t SPF1IE:1; uint16_t SPI1IE:1; uint16_t U1RXIE:1;
+    uint16_t U1TXIE:1; uint16_t :2; uint16_t NVMIE:1;
+} IEC0BITS;
+
+typedef struct
+{
+    uint16_t :9; uint16_t OC3IE:1; uint16_t OC4IE:1; uint16_t T4IE:1;
+    uint16_t T5IE:1; uint16_t INT2IE:1; uint16_t U2RXIE:1; uint16_t U2TXIE:1;
+} IEC1BITS;
+
+typedef struct
+{
+    uint16_t :5; uint16_t IC3IE:1; uint16_t IC4IE:1; uint16_t IC5IE:1;
+    uint16_t IC6IE:1; uint16_t OC5IE:1; uint16_t OC6IE:1; uint16_t :5;
+} IEC2BITS;
+
+//IPCn holds the 3-bit priorities of vectors 4n to 4n + 3
+typedef struct { uint16_t INT0IP:3; uint16_t :1; uint16_t IC1IP:3; uint16_t :1; uint16_t OC1IP:3; uint16_t :1; uint16_t T1IP:3; uint16_t :1; } IPC0BITS;
+typedef struct { uint16_t :4; uint16_t IC2IP:3; uint16_t :1; uint16_t OC2IP:3; uint16_t :1; uint16_t T2IP:3; uint16_t :1; } IPC1BITS;
+typedef struct { uint16_t T3IP:3; uint16_t :1; uint16_t SPF1IP:3; uint16_t :1; uint16_t SPI1IP:3; uint16_t :1; uint16_t U1RXIP:3; uint16_t :1; } IPC2BITS;
+typedef struct { uint16_t U1TXIP:3; uint16_t :13; } IPC3BITS;
+typedef struct { uint16_t :4; uint16_t OC3IP:3; uint16_t :1; uint16_t OC4IP:3; uint16_t :1; uint16_t T4IP:3; uint16_t :1; } IPC6BITS;
+typedef struct { uint16_t T5IP:3; uint16_t :1; uint16_t INT2IP:3; uint16_t :1; uint16_t U2RXIP:3; uint16_t :1; uint16_t U2TXIP:3; uint16_t :1; } IPC7BITS;
+typedef struct { uint16_t :4; uint16_t IC3IP:3; uint16_t :1; uint16_t IC4IP:3; uint16_t :1; uint16_t IC5IP:3; uint16_t :1; } IPC9BITS;
+typedef struct { uint16_t IC6IP:3; uint16_t :1; uint16_t OC5IP:3; uint16_t :1; uint16_t OC6IP:3; uint16_t :5; } IPC10BITS;
+
+//one bit per pin for the port registers
+typedef struct { uint16_t LATA0:1; uint16_t LATA1:1; uint16_t LATA2:1; uint16_t LATA3:1; uint16_t LATA4:1; uint16_t :11; } LATABITS;
+typedef struct { uint16_t TRISA0:1; uint16_t TRISA1:1; uint16_t TRISA2:1; uint16_t TRISA3:1; uint16_t TRISA4:1; uint16_t :11; } TRISABITS;
+typedef struct { uint16_t RA0:1; uint16_t RA1:1; uint16_t RA2:1; uint16_t RA3:1; uint16_t RA4:1; uint16_t :11; } PORTABITS;
+typedef struct { uint16_t ANSA0:1; uint16_t ANSA1:1; uint16_t ANSA2:1; uint16_t ANSA3:1; uint16_t ANSA4:1; uint16_t :11; } ANSABITS;
+
+typedef struct
+{
+    uint16_t LATB0:1; uint16_t LATB1:1; uint16_t LATB2:1; uint16_t LATB3:1;
+    uint16_t LATB4:1; uint16_t LATB5:1; uint16_t LATB6:1; uint16_t LATB7:1;
+    uint16_t LATB8:1; uint16_t LATB9:1; uint16_t LATB10:1; uint16_t LATB11:1;
+    uint16_t LATB12:1; uint16_t LATB13:1; uint16_t LATB14:1; uint16_t LATB15:1;
+} LATBBITS;
+
+typedef struct
+{
+    uint16_t TRISB0:1; uint16_t TRISB1:1; uint16_t TRISB2:1; uint16_t TRISB3:1;
+    uint16_t TRISB4:1; uint16_t TRISB5:1; uint16_t TRISB6:1; uint16_t TRISB7:1;
+    uint16_t TRISB8:1; uint16_t TRISB9:1; uint16_t TRISB10:1; uint16_t TRISB11:1;
+    uint16_t TRISB12:1; uint16_t TRISB13:1; uint16_t TRISB14:1; uint16_t TRISB15:1;
+} TRISBBITS;
+
+typedef struct
+{
+    uint16_t RB0:1; uint16_t RB1:1; uint16_t RB2:1; uint16_t RB3:1;
+    uint16_t RB4:1; uint16_t RB5:1; uint16_t RB6:1; uint16_t RB7:1;
+    uint16_t RB8:1; uint16_t RB9:1; uint16_t RB10:1; uint16_t RB11:1;
+    uint16_t RB12:1; uint16_t RB13:1; uint16_t RB14:1; uint16_t RB15:1;
+} PORTBBITS;
+
+typedef struct
+{
+    uint16_t ANSB0:1; uint16_t ANSB1:1; uint16_t ANSB2:1; uint16_t ANSB3:1;
+    uint16_t ANSB4:1; uint16_t ANSB5:1; uint16_t ANSB6:1; uint16_t ANSB7:1;
+    uint16_t ANSB8:1; uint16_t ANSB9:1; uint16_t ANSB10:1; uint16_t ANSB11:1;
+    uint16_t ANSB12:1; uint16_t ANSB13:1; uint16_t ANSB14:1; uint16_t ANSB15:1;
+} ANSBBITS;
+
+//the oscillator registers (see section 9 of the data sheet), only what Clock_Initialize uses
+typedef struct
+{
+    uint16_t OSWEN:1; uint16_t :4; uint16_t LOCK:1; uint16_t :2;
+    uint16_t NOSC:3; uint16_t :1; uint16_t COSC:3; uint16_t :1;
+} OSCCONBITS;
+
+typedef struct { uint16_t :8; uint16_t RCDIV:3; uint16_t DOZEN:1; uint16_t DOZE:3; uint16_t ROI:1; } CLKDIVBITS;
+
+//UART registers (see section 17 of the data sheet)
+typedef struct
+{
+    uint16_t STSEL:1; uint16_t PDSEL:2; uint16_t BRGH:1; uint16_t URXINV:1; uint16_t ABAUD:1;
+    uint16_t LPBACK:1; uint16_t WAKE:1; uint16_t UEN:2; uint16_t :1; uint16_t RTSMD:1;
+    uint16_t IREN:1; uint16_t USIDL:1; uint16_t :1; uint16_t UARTEN:1;
+} UxMODEBITS;
+
+typedef struct
+{
+    uint16_t URXDA:1; uint16_t OERR:1; uint16_t FERR:1; uint16_t PERR:1; uint16_t RIDLE:1;
+    uint16_t ADDEN:1; uint16_t URXISEL:2; uint16_t TRMT:1; uint16_t UTXBF:1; uint16_t UTXEN:1;
+    uint16_t UTXBRK:1; uint16_t :1; uint16_t UTXISEL0:1; uint16_t UTXINV:1; uint16_t UTXISEL1:1;
+} UxSTABITS;
+
+
+typedef struct
+{
+    uint16_t CON1;
+    uint16_t CON2;
+    //the head of the capture FIFO, only ever read through PIC24_Sim_Read_ICxBUF
+    uint16_t BUF;
+    uint16_t TMR;
+} PIC24_Sim_IC_Registers;
+
+typedef struct
+{
+    uint16_t CON1;
+    uint16_t CON2;
+    uint16_t RS;
+    uint16_t R;
+    uint16_t TMR;
+} PIC24_Sim_OC_Registers;
+
+typedef struct
+{
+    uint16_t CON;
+    uint16_t TMR;
+    uint16_t PR;
+} PIC24_Sim_Timer_Registers;
+
+typedef struct
+{
+    uint16_t ANS;
+    uint16_t TRIS;
+    uint16_t PORT;
+    uint16_t LAT;
+} PIC24_Sim_Port_Registers;
+
+typedef struct
+{
+    uint16_t MODE;
+    uint16_t STA;
+    uint16_t BRG;
+    //the transmit FIFO and shift register, only ever written through
+    //PIC24_Sim_Next_U1TXREG_Slot (the last slot takes writes the UART ignores)
+    uint16_t TXREG[PIC24_SIM_UART_TX_SLOTS + 1];
+} PIC24_Sim_UART_Registers;
+
+//every SFR that the firmware can touch
+typedef struct
+{
+    PIC24_Sim_IC_Registers IC[PIC24_SIM_NUMBER_OF_IC_MODULES];
+    PIC24_Sim_OC_Registers OC[PIC24_SIM_NUMBER_OF_OC_MODULES];
+    PIC24_Sim_Timer_Registers Timer[PIC24_SIM_NUMBER_OF_TIMERS];
+
+    uint16_t IFS[8];
+    uint16_t IEC[8];
+    uint16_t IPC[30];
+
+    uint16_t RPINR[30];
+    uint16_t RPOR[8];
+
+    PIC24_Sim_Port_Registers PortA;
+    PIC24_Sim_Port_Registers PortB;
+
+    uint16_t OscillatorControl;
+    uint16_t ClockDivider;
+
+    PIC24_Sim_UART_Registers UART1;
+} PIC24_Sim_Register_File;
+
+extern volatile PIC24_Sim_Register_File PIC24_Sim_Registers;
+
+#define PIC24_SIM_BITS(type, reg) (*(volatile type*)&PIC24_Sim_Registers.reg)
+
+unsigned int PIC24_Sim_Read_ICxBUF(unsigned int moduleIndex);
+
+//OSCCON's high and low bytes can only be written through these unlock sequences on the
+//PIC, and a clock switch finishes as soon as OSWEN is set (the PLL locks right away)
+void PIC24_Sim_Write_OSCCONH(unsigned int value);
+void PIC24_Sim_Write_OSCCONL(unsigned int value);
+#define __builtin_write_OSCCONH(value) PIC24_Sim_Write_OSCCONH(value)
+#define __builtin_write_OSCCONL(value) PIC24_Sim_Write_OSCCONL(value)
+
+//a write to U1TXREG goes into the slot this returns, which is the next free place in the
+//transmit FIFO (writes while the FIFO is full or the transmitter is off are thrown away)
+unsigned int PIC24_Sim_Next_U1TXREG_Slot(void);
+unsigned int PIC24_Sim_Read_U1RXREG(void);
+
+#define IC1CON1 PIC24_Sim_Registers.IC[0].CON1
+#define IC2CON1 PIC24_Sim_Registers.IC[1].CON1
+#define IC3CON1 PIC24_Sim_Registers.IC[2].CON1
+#define IC4CON1 PIC24_Sim_Registers.IC[3].CON1
+#define IC5CON1 PIC24_Sim_Registers.IC[4].CON1
+#define IC6CON1 PIC24_Sim_Registers.IC[5].CON1
+#define IC1CON1bits PIC24_SIM_BITS(ICxCON1BITS, IC[0].CON1)
+#define IC2CON1bits PIC24_SIM_BITS(ICxCON1BITS, IC[1].CON1)
+#define IC3CON1bits PIC24_SIM_BITS(ICxCON1BITS, IC[2].CON1)
+#define IC4CON1bits PIC24_SIM_BITS(ICxCON1BITS, IC[3].CON1)
+#define IC5CON1bits PIC24_SIM_BITS(ICxCON1BITS, IC[4].CON1)
+#define IC6CON1bits PIC24_SIM_BITS(ICxCON1BITS, IC[5].CON1)
+#define IC1CON2 PIC24_Sim_Registers.IC[0].CON2
+#define IC2CON2 PIC24_Sim_Registers.IC[1].CON2
+#define IC3CON2 PIC24_Sim_Registers.IC[2].CON2
+#define IC4CON2 PIC24_Sim_Registers.IC[3].CON2
+#define IC5CON2 PIC24_Sim_Registers.IC[4].CON2
+#define IC6CON2 PIC24_Sim_Registers.IC[5].CON2
+#define IC1CON2bits PIC24_SIM_BITS(ICxCON2BITS, IC[0].CON2)
+#define IC2CON2bits PIC24_SIM_BITS(ICxCON2BITS, IC[1].CON2)
+#define IC3CON2bits PIC24_SIM_BITS(ICxCON2BITS, IC[2].CON2)
+#define IC4CON2bits PIC24_SIM_BITS(ICxCON2BITS, IC[3].CON2)
+#define IC5CON2bits PIC24_SIM_BITS(ICxCON2BITS, IC[4].CON2)
+#define IC6CON2bits PIC24_SIM_BITS(ICxCON2BITS, IC[5].CON2)
+#define IC1BUF PIC24_Sim_Read_ICxBUF(0)
+#define IC2BUF PIC24_Sim_Read_ICxBUF(1)
+#define IC3BUF PIC24_Sim_Read_ICxBUF(2)
+#define IC4BUF PIC24_Sim_Read_ICxBUF(3)
+#define IC5BUF PIC24_Sim_Read_ICxBUF(4)
+#define IC6BUF PIC24_Sim_Read_ICxBUF(5)
+#define IC1TMR PIC24_Sim_Registers.IC[0].TMR
+#define IC2TMR PIC24_Sim_Registers.IC[1].TMR
+#define IC3TMR PIC24_Sim_Registers.IC[2].TMR
+#define IC4TMR PIC24_Sim_Registers.IC[3].TMR
+#define IC5TMR PIC24_Sim_Registers.IC[4].TMR
+#define IC6TMR PIC24_Sim_Registers.IC[5].TMR
+
+#define OC1CON1 PIC24_Sim_Registers.OC[0].CON1
+#define OC2CON1 PIC24_Sim_Registers.OC[1].CON1
+#define OC3CON1 PIC24_Sim_Registers.OC[2].CON1
+#define OC4CON1 PIC24_Sim_Registers.OC[3].CON1
+#define OC5CON1 PIC24_Sim_Registers.OC[4].CON1
+#define OC6CON1 PIC24_Sim_Registers.OC[5].CON1
+#define OC1CON1bits PIC24_SIM_BITS(OCxCON1BITS, OC[0].CON1)
+#define OC2CON1bits PIC24_SIM_BITS(OCxCON1BITS, OC[1].CON1)
+#define OC3CON1bits PIC24_SIM_BITS(OCxCON1BITS, OC[2].CON1)
+#define OC4CON1bits PIC24_SIM_BITS(OCxCON1BITS, OC[3].CON1)
+#define OC5CON1bits PIC24_SIM_BITS(OCxCON1BITS, OC[4].CON1)
+#define OC6CON1bits PIC24_SIM_BITS(OCxCON1BITS, OC[5].CON1)
+#define OC1CON2 PIC24_Sim_Registers.OC[0].CON2
+#define OC2CON2 PIC24_Sim_Registers.OC[1].CON2
+#define OC3CON2 PIC24_Sim_Registers.OC[2].CON2
+#define OC4CON2 PIC24_Sim_Registers.OC[3].CON2
+#define OC5CON2 PIC24_Sim_Registers.OC[4].CON2
+#define OC6CON2 PIC24_Sim_Registers.OC[5].CON2
+#define OC1CON2bits PIC24_SIM_BITS(OCxCON2BITS, OC[0].CON2)
+#define OC2CON2bits PIC24_SIM_BITS(OCxCON2BITS, OC[1].CON2)
+#define OC3CON2bits PIC24_SIM_BITS(OCxCON2BITS, OC[2].CON2)
+#define OC4CON2bits PIC24_SIM_BITS(OCxCON2BITS, OC[3].CON2)
+#define OC5CON2bits PIC24_SIM_BITS(OCxCON2BITS, OC[4].CON2)
+#define OC6CON2bits PIC24_SIM_BITS(OCxCON2BITS, OC[5].CON2)
+#define OC1RS PIC24_Sim_Registers.OC[0].RS
+#define OC2RS PIC24_Sim_Registers.OC[1].RS
+#define OC3RS PIC24_Sim_Registers.OC[2].RS
+#define OC4RS PIC24_Sim_Registers.OC[3].RS
+#define OC5RS PIC24_Sim_Registers.OC[4].RS
+#define OC6RS PIC24_Sim_Registers.OC[5].RS
+#define OC1R PIC24_Sim_Registers.OC[0].R
+#define OC2R PIC24_Sim_Registers.OC[1].R
+#define OC3R PIC24_Sim_Registers.OC[2].R
+#define OC4R PIC24_Sim_Registers.OC[3].R
+#define OC5R PIC24_Sim_Registers.OC[4].R
+#define OC6R PIC24_Sim_Registers.OC[5].R
+#define OC1TMR PIC24_Sim_Registers.OC[0].TMR
+#define OC2TMR PIC24_Sim_Registers.OC[1].TMR
+#define OC3TMR PIC24_Sim_Registers.OC[2].TMR
+#define OC4TMR PIC24_Sim_Registers.OC[3].TMR
+#define OC5TMR PIC24_Sim_Registers.OC[4].TMR
+#define OC6TMR PIC24_Sim_Registers.OC[5].TMR
+
+#define T1CON PIC24_Sim_Registers.Timer[0].CON
+#define T2CON PIC24_Sim_Registers.Timer[1].CON
+#define T3CON PIC24_Sim_Registers.Timer[2].CON
+#define T4CON PIC24_Sim_Registers.Timer[3].CON
+#define T5CON PIC24_Sim_Registers.Timer[4].CON
+#define T1CONbits PIC24_SIM_BITS(TxCONBITS, Timer[0].CON)
+#define T2CONbits PIC24_SIM_BITS(TxCONBITS, Timer[1].CON)
+#define T3CONbits PIC24_SIM_BITS(TxCONBITS, Timer[2].CON)
+#define T4CONbits PIC24_SIM_BITS(TxCONBITS, Timer[3].CON)
+#define T5CONbits PIC24_SIM_BITS(TxCONBITS, Timer[4].CON)
+#define TMR1 PIC24_Sim_Registers.Timer[0].TMR
+#define TMR2 PIC24_Sim_Registers.Timer[1].TMR
+#define TMR3 PIC24_Sim_Registers.Timer[2].TMR
+#define TMR4 PIC24_Sim_Registers.Timer[3].TMR
+#define TMR5 PIC24_Sim_Registers.Timer[4].TMR
+#define PR1 PIC24_Sim_Registers.Timer[0].PR
+#define PR2 PIC24_Sim_Registers.Timer[1].PR
+#define PR3 PIC24_Sim_Registers.Timer[2].PR
+#define PR4 PIC24_Sim_Registers.Timer[3].PR
+#define PR5 PIC24_Sim_Registers.Timer[4].PR
+
+#define IFS0 PIC24_Sim_Registers.IFS[0]
+#define IFS1 PIC24_Sim_Registers.IFS[1]
+#define IFS2 PIC24_Sim_Registers.IFS[2]
+#define IFS0bits PIC24_SIM_BITS(IFS0BITS, IFS[0])
+#define IFS1bits PIC24_SIM_BITS(IFS1BITS, IFS[1])
+#define IFS2bits PIC24_SIM_BITS(IFS2BITS, IFS[2])
+#define IEC0 PIC24_Sim_Registers.IEC[0]
+#define IEC1 PIC24_Sim_Registers.IEC[1]
+#define IEC2 PIC24_Sim_Registers.IEC[2]
+#define IEC0bits PIC24_SIM_BITS(IEC0BITS, IEC[0])
+#define IEC1bits PIC24_SIM_BITS(IEC1BITS, IEC[1])
+#define IEC2bits PIC24_SIM_BITS(IEC2BITS, IEC[2])
+#define IPC0 PIC24_Sim_Registers.IPC[0]
+#define IPC1 PIC24_Sim_Registers.IPC[1]
+#define IPC2 PIC24_Sim_Registers.IPC[2]
+#define IPC3 PIC24_Sim_Registers.IPC[3]
+#define IPC4 PIC24_Sim_Registers.IPC[4]
+#define IPC5 PIC24_Sim_Registers.IPC[5]
+#define IPC6 PIC24_Sim_Registers.IPC[6]
+#define IPC7 PIC24_Sim_Registers.IPC[7]
+#define IPC8 PIC24_Sim_Registers.IPC[8]
+#define IPC9 PIC24_Sim_Registers.IPC[9]
+#define IPC10 PIC24_Sim_Registers.IPC[10]
+#define IPC0bits PIC24_SIM_BITS(IPC0BITS, IPC[0])
+#define IPC1bits PIC24_SIM_BITS(IPC1BITS, IPC[1])
+#define IPC2bits PIC24_SIM_BITS(IPC2BITS, IPC[2])
+#define IPC3bits PIC24_SIM_BITS(IPC3BITS, IPC[3])
+#define IPC6bits PIC24_SIM_BITS(IPC6BITS, IPC[6])
+#define IPC7bits PIC24_SIM_BITS(IPC7BITS, IPC[7])
+#define IPC9bits PIC24_SIM_BITS(IPC9BITS, IPC[9])
+#define IPC10bits PIC24_SIM_BITS(IPC10BITS, IPC[10])
+
+#define RPINR7 PIC24_Sim_Registers.RPINR[7]
+#define RPINR8 PIC24_Sim_Registers.RPINR[8]
+#define RPINR9 PIC24_Sim_Registers.RPINR[9]
+#define RPINR7bits PIC24_SIM_BITS(RPINR7BITS, RPINR[7])
+#define RPINR8bits PIC24_SIM_BITS(RPINR8BITS, RPINR[8])
+#define RPINR9bits PIC24_SIM_BITS(RPINR9BITS, RPINR[9])
+#define RPINR18 PIC24_Sim_Registers.RPINR[18]
+#define RPINR18bits PIC24_SIM_BITS(RPINR18BITS, RPINR[18])
+#define RPOR0 PIC24_Sim_Registers.RPOR[0]
+#define RPOR1 PIC24_Sim_Registers.RPOR[1]
+#define RPOR2 PIC24_Sim_Registers.RPOR[2]
+#define RPOR3 PIC24_Sim_Registers.RPOR[3]
+#define RPOR4 PIC24_Sim_Registers.RPOR[4]
+#define RPOR5 PIC24_Sim_Registers.RPOR[5]
+#define RPOR6 PIC24_Sim_Registers.RPOR[6]
+#define RPOR7 PIC24_Sim_Registers.RPOR[7]
+#define RPOR0bits PIC24_SIM_BITS(RPOR0BITS, RPOR[0])
+#define RPOR1bits PIC24_SIM_BITS(RPOR1BITS, RPOR[1])
+#define RPOR2bits PIC24_SIM_BITS(RPOR2BITS, RPOR[2])
+#define RPOR3bits PIC24_SIM_BITS(RPOR3BITS, RPOR[3])
+#define RPOR4bits PIC24_SIM_BITS(RPOR4BITS, RPOR[4])
+#define RPOR5bits PIC24_SIM_BITS(RPOR5BITS, RPOR[5])
+#define RPOR6bits PIC24_SIM_BITS(RPOR6BITS, RPOR[6])
+#define RPOR7bits PIC24_SIM_BITS(RPOR7BITS, RPOR[7])
+
+#define ANSA PIC24_Sim_Registers.PortA.ANS
+#define ANSB PIC24_Sim_Registers.PortB.ANS
+#define TRISA PIC24_Sim_Registers.PortA.TRIS
+#define TRISB PIC24_Sim_Registers.PortB.TRIS
+#define LATA PIC24_Sim_Registers.PortA.LAT
+#define LATB PIC24_Sim_Registers.PortB.LAT
+#define PORTA PIC24_Sim_Registers.PortA.PORT
+#define PORTB PIC24_Sim_Registers.PortB.PORT
+#define ANSAbits PIC24_SIM_BITS(ANSABITS, PortA.ANS)
+#define ANSBbits PIC24_SIM_BITS(ANSBBITS, PortB.ANS)
+#define TRISAbits PIC24_SIM_BITS(TRISABITS, PortA.TRIS)
+#define TRISBbits PIC24_SIM_BITS(TRISBBITS, PortB.TRIS)
+#define LATAbits PIC24_SIM_BITS(LATABITS, PortA.LAT)
+#define LATBbits PIC24_SIM_BITS(LATBBITS, PortB.LAT)
+#define PORTAbits PIC24_SIM_BITS(PORTABITS, PortA.PORT)
+#define PORTBbits PIC24_SIM_BITS(PORTBBITS, PortB.PORT)
+
+#define OSCCON PIC24_Sim_Registers.OscillatorControl
+#define CLKDIV PIC24_Sim_Registers.ClockDivider
+#define OSCCONbits PIC24_SIM_BITS(OSCCONBITS, OscillatorControl)
+#define CLKDIVbits PIC24_SIM_BITS(CLKDIVBITS, ClockDivider)
+
+#define U1MODE PIC24_Sim_Registers.UART1.MODE
+#define U1STA PIC24_Sim_Registers.UART1.STA
+#define U1BRG PIC24_Sim_Registers.UART1.BRG
+#define U1MODEbits PIC24_SIM_BITS(UxMODEBITS, UART1.MODE)
+#define U1STAbits PIC24_SIM_BITS(UxSTABITS, UART1.STA)
+#define U1TXREG PIC24_Sim_Registers.UART1.TXREG[PIC24_Sim_Next_U1TXREG_Slot()]
+#define U1RXREG PIC24_Sim_Read_U1RXREG()
+
+
+//simulator control (used by the host drivers, never by the firmware)
+
+//clears every register, pending edge and connection, and sets the time back to 0
+void PIC24_Sim_Reset(void);
+
+//the current simulated time, in instruction cycles (Tcy)
+unsigned long long PIC24_Sim_Now(void);
+
+//queues a logic level change on an RP pin (the pin number matches RBx on this chip)
+//at an absolute time in instruction cycles
+void PIC24_Sim_Schedule_Edge(unsigned int rpPin, unsigned long long cycle, int level);
+
+//queues a PWM-style square wave on an RP pin, starting at startCycle
+//(high for highCycles, then low for the rest of periodCycles, numberOfPeriods times)
+void PIC24_Sim_Schedule_Pulse_Train(unsigned int rpPin, unsigned long long startCycle, unsigned long highCycles, unsigned long periodCycles, unsigned int numberOfPeriods);
+
+//wires the output of whichever OC module is mapped to outputPin to the input pin
+//(e.g. the stepper driver's step signal looped back into a counting IC module)
+void PIC24_Sim_Connect_Pins(unsigned int outputPin, unsigned int inputPin);
+
+//advances simulated time, applying every edge, timer match and interrupt on the way
+void PIC24_Sim_Run_Until(unsigned long long cycle);
+void PIC24_Sim_Run_For(unsigned long long cycles);
+
+//the logic level currently driven by the OC module mapped to rpPin (or the external level)
+int PIC24_Sim_Get_Pin_Level(unsigned int rpPin);
+
+//called around every interrupt service routine the simulator dispatches
+//(vector numbers follow the IFS/IEC bit numbering, e.g. 1 = IC1, 38 = IC4)
+extern void (*PIC24_Sim_Interrupt_Entry_Hook)(unsigned int vector);
+extern void (*PIC24_Sim_Interrupt_Exit_Hook)(unsigned int vector);
+
+//called whenever the output of an OC module that is connected to an input pin (see
+//PIC24_Sim_Connect_Pins) changes level, at the simulated time it changes
+extern void (*PIC24_Sim_Output_Edge_Hook)(unsigned int rpPin, int level);
+
+//hands a byte to UART1's receiver, as if it had just finished arriving on its RX pin
+//(it is lost, and OERR is set, if the receive FIFO is already full)
+void PIC24_Sim_UART_Receive(uint8_t byte);
+
+//called with every byte UART1 sends, at the simulated time its stop bit ends
+extern void (*PIC24_Sim_UART_Transmit_Hook)(uint8_t byte);
+
+//the number of times each vector has been serviced since the last reset
+unsigned long PIC24_Sim_Get_Interrupt_Count(unsigned int vector);
+
+#define PIC24_SIM_VECTOR_IC1 1
+#define PIC24_SIM_VECTOR_OC1 2
+#define PIC24_SIM_VECTOR_T1 3
+#define PIC24_SIM_VECTOR_IC2 5
+#define PIC24_SIM_VECTOR_OC2 6
+#define PIC24_SIM_VECTOR_T2 7
+#define PIC24_SIM_VECTOR_T3 8
+#define PIC24_SIM_VECTOR_U1RX 11
+#define PIC24_SIM_VECTOR_U1TX 12
+#define PIC24_SIM_VECTOR_OC3 25
+#define PIC24_SIM_VECTOR_OC4 26
+#define PIC24_SIM_VECTOR_T4 27
+#define PIC24_SIM_VECTOR_T5 28
+#define PIC24_SIM_VECTOR_IC3 37
+#define PIC24_SIM_VECTOR_IC4 38
+#define PIC24_SIM_VECTOR_IC5 39
+#define PIC24_SIM_VECTOR_IC6 40
+#define PIC24_SIM_VECTOR_OC5 41
+#define PIC24_SIM_VECTOR_OC6 42
@@ -0,0 +1,89 @@
+/*
+ * File:    filter_step_response.c
+ * Author:  Zachary Downum
+ */
+
+//Measures the step response of Input Filter configurations (the number of frames until
+//the output has moved 50% and 90% of the way to a new input, and until it gets there),
+//and checks that a short spike gets through the median stage or not.  The latencies
+//in InputFilter.h and main_driver.c come from this.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "InputFilter.h"
+
+//the kill switch's two positions (see main_driver.c), 5.563% and 12.453%
+#define STEP_LOW Q15_FROM_PERCENTAGE(5.563)
+#define STEP_HIGH Q15_FROM_PERCENTAGE(12.453)
+
+#define MAXIMUM_FRAMES 1000
+
+static void Print_Step_Response(const char* name, unsigned int medianSize, unsigned int iirShift, Q15 maximumStep)
+{
+    Input_Filter filter;
+    unsigned int halfway = 0;
+    unsigned int ninetyPercent = 0;
+    unsigned int settled = 0;
+    Q15 peak;
+    unsigned int spikeFrames = (medianSize > 1) ? (medianSize - 1) / 2 : 1;
+    unsigned int frame;
+
+    filter.medianSize = medianSize;
+    filter.iirShift = iirShift;
+    filter.maximumStep = maximumStep;
+
+    Input_Filter_Initialize(&filter, STEP_LOW);
+    for (frame = 1; frame <= MAXIMUM_FRAMES && settled == 0; ++frame)
+    {
+        Q15 output = Input_Filter_Update(&filter, STEP_HIGH);
+
+        if (halfway == 0 && (output - STEP_LOW) * 2 >= STEP_HIGH - STEP_LOW)
+        {
+            halfway = frame;
+        }
+        if (ninetyPercent == 0 && (output - STEP_LOW) * 10 >= (STEP_HIGH - STEP_LOW) * 9)
+        {
+            ninetyPercent = frame;
+        }
+        if (output == STEP_HIGH)
+        {
+            settled = frame;
+        }
+    }
+
+    //a spike as long as the median stage is meant to throw out
+    Input_Filter_Initialize(&filter, STEP_LOW);
+    peak = STEP_LOW;
+    for (frame = 0; frame < 10; ++frame)
+    {
+        Q15 output = Input_Filter_Update(&filter, (frame < spikeFrames) ? STEP_HIGH : STEP_LOW);
+
+        if (output > peak)
+        {
+            peak = output;
+        }
+    }
+
+    printf("    %-28s %4u %4u %6u      %5.1f%%\n", name, halfway, ninetyPercent, settled, 100.0 * (peak - STEP_LOW) / (STEP_HIGH - STEP_LOW));
+}
+
+int main(void)
+{
+    printf("step from %u to %u (frames until the output moves 50%%, 90%% and all of the way),\n", STEP_LOW, STEP_HIGH);
+    printf("and how much of a spike of (medianSize - 1) / 2 frames (1 frame with no median) gets through:\n");
+    printf("    %-28s %4s %4s %6s   %s\n", "filter", "50%", "90%", "exact", "spike");
+
+    Print_Step_Response("median of 3", 3, 0, 0);
+    Print_Step_Response("median of 5", 5, 0, 0);
+    Print_Step_Response("IIR, iirShift 1", 0, 1, 0);
+    Print_Step_Response("IIR, iirShift 2", 0, 2, 0);
+    Print_Step_Response("IIR, iirShift 3", 0, 3, 0);
+    Print_Step_Response("IIR, iirShift 4", 0, 4, 0);
+    Print_Step_Response("IIR, iirShift 5", 0, 5, 0);
+    Print_Step_Response("slew, 1% per frame", 0, 0, Q15_FROM_PERCENTAGE(1));
+    Print_Step_Response("median of 3, iirShift 1", 3, 1, 0);
+    Print_Step_Response("median of 5, iirShift 1", 5, 1, 0);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,344 @@
+/*
+ * File:    firmware_benchmark.c
+ * Author:  Zachary Downum
+ */
+
+//Runs the Benchmark dependency's firmware cases (see FirmwareBenchmark.h) in the simulator
+//under the cycle counter, and writes the results as a table, CSV or JSON, so a change to
+//InputCapture.c, PWM.c or main_driver.c can be compared with the revision before it.
+//The PIC runs the same cases with "Testing/Firmware Benchmark/firmware_benchmark_driver.c".
+//The cycles are the cycle counter's estimates, and the instructions are the host
+//instructions it stepped through (which do not depend on its estimates, so they show any
+//change to the code, even one the estimates miss).
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Benchmark.h"
+#include "Cycle_Counter.h"
+#include "FirmwareBenchmark.h"
+#include "Scheduler.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+
+//50Hz, the frame rate of the wireless controller's receiver
+#define RECEIVER_FRAME_CYCLES (20000UL * CYCLES_PER_MICROSECOND)
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+#define DEFAULT_NUMBER_OF_FRAMES 50
+//how many times each of the PWM cases is run
+#define REPEATED_RUNS 256
+
+//the inputs FirmwareBenchmark.h uses, and the pins main_driver.c uses
+#define IC1_PIN 4
+#define IC2_PIN 5
+#define STEPPER_COUNT_PIN 7
+#define IC6_PIN 11
+#define KILL_SWITCH_PIN 4
+#define THROTTLE_PIN 5
+#define STEERING_PIN 6
+#define BRAKE_PIN 8
+#define STEP_OUTPUT_PIN 1
+
+//the receiver-style inputs are 1.5ms pulses, and the stepper's count input runs at 400Hz
+#define INPUT_START_CYCLES 100
+#define INPUT_PULSE_CYCLES (1500 * CYCLES_PER_MICROSECOND)
+#define FAST_INPUT_PERIOD_CYCLES (FCY / FIRMWARE_BENCHMARK_FAST_INPUT_HZ)
+#define STEPPER_COUNT_PERIOD_CYCLES (FCY / 400)
+
+//main_driver.c waits 1 second after initializing, and its steering goes from one side to
+//the other every second so the stepper task has moves to make
+#define STARTUP_FRAMES 50
+#define SWITCH_PULSE_CYCLES (1100 * CYCLES_PER_MICROSECOND)
+#define THROTTLE_PULSE_CYCLES (1800 * CYCLES_PER_MICROSECOND)
+#define STEERING_LEFT_PULSE_CYCLES (1700 * CYCLES_PER_MICROSECOND)
+#define STEERING_RIGHT_PULSE_CYCLES (2500 * CYCLES_PER_MICROSECOND)
+#define STEERING_FRAMES_PER_SIDE 50
+
+//from main_driver.c
+void Hovercraft_Initialize(void);
+extern Scheduler_Task receiver_input_task;
+extern Scheduler_Task stepper_task;
+
+static unsigned int NumberOfFrames = DEFAULT_NUMBER_OF_FRAMES;
+static int Sites[FIRMWARE_BENCHMARK_NUMBER_OF_CASES];
+static int MeasureInterrupts;
+static FILE* Output;
+
+static void Interrupt_Entry(unsigned int vector)
+{
+    if (!MeasureInterrupts)
+    {
+        return;
+    }
+    if (vector == PIC24_SIM_VECTOR_IC1)
+    {
+        CYCLE_COUNTER_BEGIN(Sites[FIRMWARE_BENCHMARK_IC1_INTERRUPT_50HZ]);
+    }
+    else if (vector == PIC24_SIM_VECTOR_IC6)
+    {
+        CYCLE_COUNTER_BEGIN(Sites[FIRMWARE_BENCHMARK_IC6_INTERRUPT_6KHZ]);
+    }
+}
+
+static void Interrupt_Exit(unsigned int vector)
+{
+    if (!MeasureInterrupts)
+    {
+        return;
+    }
+    if (vector == PIC24_SIM_VECTOR_IC1)
+    {
+        CYCLE_COUNTER_END(Sites[FIRMWARE_BENCHMARK_IC1_INTERRUPT_50HZ]);
+    }
+    else if (vector == PIC24_SIM_VECTOR_IC6)
+    {
+        CYCLE_COUNTER_END(Sites[FIRMWARE_BENCHMARK_IC6_INTERRUPT_6KHZ]);
+    }
+}
+
+static void Run_Measured(unsigned int caseIndex)
+{
+    CYCLE_COUNTER_BEGIN(Sites[caseIndex]);
+    Firmware_Benchmark_Cases[caseIndex].Run();
+    CYCLE_COUNTER_END(Sites[caseIndex]);
+}
+
+//the number of whole periods of the 6kHz input that fit in the frames, all of which
+//finish before the last frame does
+static unsigned long Fast_Input_Periods(void)
+{
+    return (unsigned long)NumberOfFrames * RECEIVER_FRAME_CYCLES / FAST_INPUT_PERIOD_CYCLES - 1;
+}
+
+//the IC and PWM cases, with the inputs running
+static void Run_Firmware_Cases(void)
+{
+    unsigned int frame;
+    unsigned int i;
+    unsigned int run;
+
+    PIC24_Sim_Reset();
+    Firmware_Benchmark_Initialize();
+
+    PIC24_Sim_Schedule_Pulse_Train(IC1_PIN, INPUT_START_CYCLES, INPUT_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, NumberOfFrames);
+    PIC24_Sim_Schedule_Pulse_Train(IC2_PIN, INPUT_START_CYCLES, INPUT_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, NumberOfFrames);
+    PIC24_Sim_Schedule_Pulse_Train(IC6_PIN, INPUT_START_CYCLES, FAST_INPUT_PERIOD_CYCLES / 2, FAST_INPUT_PERIOD_CYCLES, Fast_Input_Periods());
+    PIC24_Sim_Schedule_Pulse_Train(STEPPER_COUNT_PIN, INPUT_START_CYCLES, STEPPER_COUNT_PERIOD_CYCLES / 2, STEPPER_COUNT_PERIOD_CYCLES, NumberOfFrames * (RECEIVER_FRAME_CYCLES / STEPPER_COUNT_PERIOD_CYCLES));
+
+    MeasureInterrupts = true;
+    for (frame = 0; frame < NumberOfFrames; ++frame)
+    {
+        PIC24_Sim_Run_For(RECEIVER_FRAME_CYCLES);
+
+        for (i = 0; i < FIRMWARE_BENCHMARK_FRAME_CASES; ++i)
+        {
+            Run_Measured(i);
+        }
+        Firmware_Benchmark_Drain_Fast_Input();
+    }
+    MeasureInterrupts = false;
+
+    for (i = FIRMWARE_BENCHMARK_FIRST_REPEATED_CASE; i < FIRMWARE_BENCHMARK_FIRST_REPEATED_CASE + FIRMWARE_BENCHMARK_REPEATED_CASES; ++i)
+    {
+        for (run = 0; run < REPEATED_RUNS; ++run)
+        {
+            Run_Measured(i);
+        }
+    }
+}
+
+//main_driver.c's scheduler, one tick at a time (like main_driver_benchmark), with every tick
+//that runs a task measured as either a control iteration or a stepper tick
+static void Run_Control_Loop(void)
+{
+    unsigned int totalFrames = STARTUP_FRAMES + NumberOfFrames + 1;
+    unsigned long tick;
+    unsigned int frame;
+
+    PIC24_Sim_Reset();
+    PIC24_Sim_Connect_Pins(STEP_OUTPUT_PIN, STEPPER_COUNT_PIN);
+
+    PIC24_Sim_Schedule_Pulse_Train(KILL_SWITCH_PIN, INPUT_START_CYCLES, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    PIC24_Sim_Schedule_Pulse_Train(THROTTLE_PIN, 2 * INPUT_START_CYCLES, THROTTLE_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    PIC24_Sim_Schedule_Pulse_Train(BRAKE_PIN, 5 * INPUT_START_CYCLES, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    for (frame = 0; frame < totalFrames; ++frame)
+    {
+        unsigned long steering = (frame / STEERING_FRAMES_PER_SIDE) % 2 ? STEERING_RIGHT_PULSE_CYCLES : STEERING_LEFT_PULSE_CYCLES;
+
+        PIC24_Sim_Schedule_Pulse_Train(STEERING_PIN, 3 * INPUT_START_CYCLES + (unsigned long long)frame * RECEIVER_FRAME_CYCLES, steering, RECEIVER_FRAME_CYCLES, 1);
+    }
+
+    Hovercraft_Initialize();
+
+    for (tick = 0; tick < (unsigned long)NumberOfFrames * (RECEIVER_FRAME_CYCLES / SCHEDULER_TICK_CYCLES); ++tick)
+    {
+        int site = -1;
+
+        PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+
+        //(nextRunTick is only for the scheduler, but it says which tasks are due)
+        if ((int)(Scheduler_Get_Ticks() - receiver_input_task.nextRunTick) >= 0)
+        {
+            site = Sites[FIRMWARE_BENCHMARK_CONTROL_ITERATION];
+        }
+        else if ((int)(Scheduler_Get_Ticks() - stepper_task.nextRunTick) >= 0)
+        {
+            site = Sites[FIRMWARE_BENCHMARK_STEPPER_TICK];
+        }
+
+        if (site >= 0)
+        {
+            CYCLE_COUNTER_BEGIN(site);
+            Scheduler_Run_Pending();
+            CYCLE_COUNTER_END(site);
+        }
+        else
+        {
+            Scheduler_Run_Pending();
+        }
+    }
+}
+
+static void Benchmark_Workload(void)
+{
+    Run_Firmware_Cases();
+    Run_Control_Loop();
+}
+
+//the cycle counter measures the cases in another process, so its sites' totals are copied
+//into the cases afterwards (operations is 0 for one operation per call)
+static void Copy_Site(unsigned int caseIndex, uint32_t operations)
+{
+    Benchmark_Case* benchmarkCase = &Firmware_Benchmark_Cases[caseIndex];
+    const Cycle_Counter_Site* site = Cycle_Counter_Get_Site(Sites[caseIndex]);
+
+    benchmarkCase->runs = site->calls;
+    benchmarkCase->operations = operations ? operations : site->calls * benchmarkCase->operationsPerRun;
+    benchmarkCase->totalCycles = (uint32_t)site->totalCycles;
+    benchmarkCase->minimumCycles = site->minimumCycles;
+    benchmarkCase->maximumCycles = site->maximumCycles;
+    benchmarkCase->totalInstructions = (uint32_t)site->totalInstructions;
+}
+
+static void Put(char c)
+{
+    fputc(c, Output);
+}
+
+static void Print_Table(void)
+{
+    unsigned int i;
+
+    printf("estimated PIC24 instruction cycles (Fcy = %lu Hz), %u frames:\n", (unsigned long)FCY, NumberOfFrames);
+    printf("%-32s %-10s %8s %12s %12s %12s %14s\n", "case", "per", "count", "cycles", "max/run", "host instr", "per second");
+
+    for (i = 0; i < FIRMWARE_BENCHMARK_NUMBER_OF_CASES; ++i)
+    {
+        const Benchmark_Case* benchmarkCase = &Firmware_Benchmark_Cases[i];
+        double operations = benchmarkCase->operations ? benchmarkCase->operations : 1;
+
+        printf("%-32s %-10s %8lu %12.1f %12lu %12.1f %14.0f\n", benchmarkCase->name, benchmarkCase->operation, (unsigned long)benchmarkCase->operations,
+               benchmarkCase->totalCycles / operations, (unsigned long)benchmarkCase->maximumCycles, benchmarkCase->totalInstructions / operations,
+               benchmarkCase->totalCycles ? (double)FCY * benchmarkCase->operations / benchmarkCase->totalCycles : 0.0);
+    }
+}
+
+//writes the results with Benchmark_Write_CSV or Benchmark_Write_JSON to fileName ("-" is stdout)
+static int Write_Results(const char* fileName, const char* revision, void (*Write)(const Benchmark_Case*, unsigned int, const char*, const char*, void (*)(char)))
+{
+    Output = strcmp(fileName, "-") == 0 ? stdout : fopen(fileName, "w");
+    if (Output == NULL)
+    {
+        perror(fileName);
+        return false;
+    }
+
+    Write(Firmware_Benchmark_Cases, FIRMWARE_BENCHMARK_NUMBER_OF_CASES, revision, "host", Put);
+
+    if (Output != stdout)
+    {
+        fclose(Output);
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* csvFileName = NULL;
+    const char* jsonFileName = NULL;
+    const char* revision = "working";
+    unsigned int i;
+
+    for (i = 1; i < (unsigned int)argc; ++i)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < (unsigned int)argc)
+        {
+            NumberOfFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < (unsigned int)argc)
+        {
+            csvFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < (unsigned int)argc)
+        {
+            jsonFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--revision") == 0 && i + 1 < (unsigned int)argc)
+        {
+            revision = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--frames <n>] [--csv <file or ->] [--json <file or ->] [--revision <label>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (NumberOfFrames < 2)
+    {
+        NumberOfFrames = 2;
+    }
+
+    for (i = 0; i < FIRMWARE_BENCHMARK_NUMBER_OF_CASES; ++i)
+    {
+        Sites[i] = Cycle_Counter_Register_Site(Firmware_Benchmark_Cases[i].name, i == FIRMWARE_BENCHMARK_IC1_INTERRUPT_50HZ || i == FIRMWARE_BENCHMARK_IC6_INTERRUPT_6KHZ);
+    }
+    PIC24_Sim_Interrupt_Entry_Hook = Interrupt_Entry;
+    PIC24_Sim_Interrupt_Exit_Hook = Interrupt_Exit;
+
+    if (Cycle_Counter_Run(Benchmark_Workload) != 0)
+    {
+        fprintf(stderr, "cycle counting is not available on this host\n");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < FIRMWARE_BENCHMARK_NUMBER_OF_CASES; ++i)
+    {
+        Copy_Site(i, 0);
+    }
+    //two edges in every period of the inputs
+    Copy_Site(FIRMWARE_BENCHMARK_IC1_INTERRUPT_50HZ, 2 * NumberOfFrames);
+    Copy_Site(FIRMWARE_BENCHMARK_IC6_INTERRUPT_6KHZ, 2 * Fast_Input_Periods());
+
+    if (csvFileName == NULL && jsonFileName == NULL)
+    {
+        Print_Table();
+        return EXIT_SUCCESS;
+    }
+
+    if (csvFileName != NULL && !Write_Results(csvFileName, revision, Benchmark_Write_CSV))
+    {
+        return EXIT_FAILURE;
+    }
+    if (jsonFileName != NULL && !Write_Results(jsonFileName, revision, Benchmark_Write_JSON))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
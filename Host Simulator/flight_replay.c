@@ -0,0 +1,641 @@
+/*
+ * File:    flight_replay.c
+ * Author:  Zachary Downum
+ */
+
+//Plays a flight log (the receiver's pulses from a real or simulated session) back into the
+//Finalized Design's main_driver.c, many times faster than real time, and writes what the
+//firmware did with them as a trajectory:  the throttle servo's pulse, the engines' relays and
+//the stepper motor's target, position and steps, once every receiver frame.  Nothing in the
+//replay depends on the host (there is no jitter, and the firmware takes no simulated time),
+//so the same log and the same firmware always give the same trajectory, to the bit.
+//Building it again with other tuning (see MAIN_DRIVER_TUNING in the Makefile) or another
+//revision of main_driver.c, replaying the same log, and diffing the two trajectories shows
+//exactly where and by how much the change would have made the craft do something different.
+//
+//    flight_replay --record <telemetry capture> <flight log>
+//        turns the bytes main_driver.c sent with TELEMETRY_ENABLED (see Telemetry.h) into a
+//        flight log
+//    flight_replay <flight log> [--seconds <s>] [--trajectory <file.csv>]
+//        replays the log and writes the trajectory
+//    flight_replay --diff <a.csv> <b.csv>
+//        compares two trajectories column by column (the exit status is 1 if they differ)
+//
+//A flight log is the same as host_simulator's edge files, one edge per line:
+//    <microseconds from power on> <RP pin> <level>
+//and lines starting with # are comments.  Edges on the stepper motor's count input (RP7) are
+//skipped, because the step signal (RB1) is always looped back into it, so a change to the
+//stepper logic moves the motor the way it would have on the craft.
+//
+//Telemetry has each input's duty cycle and period rather than its edges, so --record puts
+//the pulses back together from them, on the IC modules' ticks so that the replay measures
+//the same duty cycles the craft did.  A pulse is measured once the period after it has
+//started, so each one gets the duty cycle of the first telemetry frame sent after that, and
+//with main_driver.c built with TELEMETRY_HZ = 50 (one telemetry frame per receiver frame)
+//the replay has the same stepper motor target, position and relays as every frame recorded.
+//At a lower rate the receiver frames in between repeat the same pulse.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "InputCapture.h"
+#include "Scheduler.h"
+#include "StepperMotion.h"
+#include "Telemetry.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+#define CYCLES_PER_MILLISECOND (FCY / 1000)
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+
+//50Hz, the frame rate of the wireless controller's receiver
+#define RECEIVER_FRAME_MICROSECONDS 20000UL
+#define RECEIVER_FRAME_TICKS (RECEIVER_FRAME_MICROSECONDS * SCHEDULER_TICK_HZ / 1000000)
+#define RECEIVER_FRAME_IC_TICKS ((unsigned long long)RECEIVER_FRAME_MICROSECONDS * IC_TICKS_PER_SECOND / 1000000)
+
+//main_driver.c waits 1 second after initializing before the scheduler starts counting its
+//ticks, so a telemetry frame's tick is this long after power on
+#define STARTUP_MICROSECONDS 1000000UL
+
+//the replay keeps going this long after the log's last edge, so the failsafe can be seen
+#define RUN_OUT_MICROSECONDS 500000UL
+
+//the pins main_driver.c uses (see InputCapture.c), in the order of the TELEMETRY_INPUT_s,
+//each input's pulse start within a receiver frame (in IC ticks), and the stepper motor's
+//step signal (RB1) and count input
+static const unsigned int Input_Pins[TELEMETRY_NUMBER_OF_INPUTS] = { 4, 5, 6, 8 };
+static const unsigned long Input_Start_Ticks[TELEMETRY_NUMBER_OF_INPUTS] = { 2, 4, 6, 10 };
+#define STEP_OUTPUT_PIN 1
+#define STEPPER_COUNT_PIN 7
+
+#define MAXIMUM_COLUMNS 32
+
+//the settings main_driver.c was compiled with (see the Makefile)
+#ifndef MAIN_DRIVER_TUNING
+#define MAIN_DRIVER_TUNING ""
+#endif
+
+//from main_driver.c
+void Hovercraft_Initialize(void);
+extern Stepper_Motion stepper_motion;
+extern int receiverSignalLost;
+
+typedef struct Log_Edge Log_Edge;
+
+struct Log_Edge
+{
+    double microseconds;
+    unsigned int pin;
+    int level;
+};
+
+typedef struct Trajectory Trajectory;
+
+//a trajectory CSV read back in for --diff
+struct Trajectory
+{
+    char header[512];
+    char* names[MAXIMUM_COLUMNS];
+    unsigned int numberOfColumns;
+    double* values;
+    unsigned long numberOfRows;
+};
+
+static unsigned long Steps;
+
+//Recorder
+
+static void Add_Edge(Log_Edge** edges, unsigned long* numberOfEdges, unsigned long* capacity, double microseconds, unsigned int pin, int level)
+{
+    if (*numberOfEdges == *capacity)
+    {
+        *capacity = *capacity ? *capacity * 2 : 4096;
+        *edges = realloc(*edges, *capacity * sizeof(Log_Edge));
+        if (*edges == NULL)
+        {
+            fprintf(stderr, "out of memory for the flight log\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    (*edges)[*numberOfEdges].microseconds = microseconds;
+    (*edges)[*numberOfEdges].pin = pin;
+    (*edges)[*numberOfEdges].level = level;
+    ++*numberOfEdges;
+}
+
+static int Compare_Edges(const void* a, const void* b)
+{
+    const Log_Edge* first = a;
+    const Log_Edge* second = b;
+
+    if (first->microseconds != second->microseconds)
+    {
+        return first->microseconds < second->microseconds ? -1 : 1;
+    }
+    return (int)first->pin - (int)second->pin;
+}
+
+//the IC modules' tick that a scheduler tick of a telemetry frame falls on
+static unsigned long long Frame_Tick_To_IC_Ticks(unsigned long long tick)
+{
+    return (STARTUP_MICROSECONDS * SCHEDULER_TICK_HZ / 1000000 + tick) * IC_TICKS_PER_SECOND / SCHEDULER_TICK_HZ;
+}
+
+static double Ticks_To_Microseconds(unsigned long long ticks)
+{
+    return (double)ticks * 1000000.0 / IC_TICKS_PER_SECOND;
+}
+
+static int Record(const char* captureFileName, const char* logFileName)
+{
+    FILE* capture = fopen(captureFileName, "rb");
+    FILE* log;
+    Telemetry_Receiver receiver;
+    Telemetry_Frame frame;
+    Telemetry_Frame* frames = NULL;
+    unsigned long long* frameTicks = NULL;
+    unsigned long numberOfFrames = 0;
+    unsigned long frameCapacity = 0;
+    Log_Edge* edges = NULL;
+    unsigned long numberOfEdges = 0;
+    unsigned long edgeCapacity = 0;
+    unsigned long long endTicks;
+    unsigned long i;
+    int byte;
+
+    if (capture == NULL)
+    {
+        perror(captureFileName);
+        return false;
+    }
+
+    Telemetry_Receiver_Initialize(&receiver);
+    while ((byte = fgetc(capture)) != EOF)
+    {
+        if (!Telemetry_Receive(&receiver, (uint8_t)byte, &frame))
+        {
+            continue;
+        }
+
+        if (numberOfFrames == frameCapacity)
+        {
+            frameCapacity = frameCapacity ? frameCapacity * 2 : 1024;
+            frames = realloc(frames, frameCapacity * sizeof(Telemetry_Frame));
+            frameTicks = realloc(frameTicks, frameCapacity * sizeof(unsigned long long));
+            if (frames == NULL || frameTicks == NULL)
+            {
+                fprintf(stderr, "out of memory for the telemetry frames\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        //the tick rolls over every 65.536s, so it is counted up from the first frame's
+        frames[numberOfFrames] = frame;
+        frameTicks[numberOfFrames] = numberOfFrames ? frameTicks[numberOfFrames - 1] + (uint16_t)(frame.tick - frames[numberOfFrames - 1].tick) : frame.tick;
+        ++numberOfFrames;
+    }
+    fclose(capture);
+
+    if (numberOfFrames == 0)
+    {
+        fprintf(stderr, "%s has no telemetry frames in it\n", captureFileName);
+        return false;
+    }
+
+    //the last frame's pulses go on for one more receiver frame
+    endTicks = Frame_Tick_To_IC_Ticks(frameTicks[numberOfFrames - 1]) + RECEIVER_FRAME_IC_TICKS;
+
+    //each input's pulses are one after another, one recorded period apart, with the duty
+    //cycle of the first telemetry frame that could have measured them (the last frame's
+    //once they run out)
+    for (i = 0; i < TELEMETRY_NUMBER_OF_INPUTS; ++i)
+    {
+        unsigned long long riseTicks = Input_Start_Ticks[i];
+        unsigned long current = 0;
+
+        while (riseTicks < endTicks)
+        {
+            const Telemetry_Input* input;
+            unsigned long long highTicks;
+
+            while (current + 1 < numberOfFrames && Frame_Tick_To_IC_Ticks(frameTicks[current]) <= riseTicks + RECEIVER_FRAME_IC_TICKS)
+            {
+                ++current;
+            }
+            input = &frames[current].inputs[i];
+
+            //no pulses while the PIC had the input as lost
+            if (!(frames[current].flags & TELEMETRY_FLAG_INPUT_VALID(i)) || input->periodTicks == 0)
+            {
+                riseTicks += RECEIVER_FRAME_IC_TICKS;
+                continue;
+            }
+
+            //the IC module rounds the duty cycle down, so this is the one number of ticks that
+            //gives the same duty cycle again
+            highTicks = ((unsigned long long)input->dutyCycle * input->periodTicks + 32767) >> 15;
+            if (highTicks > 0 && highTicks < input->periodTicks)
+            {
+                Add_Edge(&edges, &numberOfEdges, &edgeCapacity, Ticks_To_Microseconds(riseTicks), Input_Pins[i], 1);
+                Add_Edge(&edges, &numberOfEdges, &edgeCapacity, Ticks_To_Microseconds(riseTicks + highTicks), Input_Pins[i], 0);
+            }
+            riseTicks += input->periodTicks;
+        }
+    }
+
+    qsort(edges, numberOfEdges, sizeof(Log_Edge), Compare_Edges);
+
+    log = fopen(logFileName, "w");
+    if (log == NULL)
+    {
+        perror(logFileName);
+        free(edges);
+        free(frames);
+        free(frameTicks);
+        return false;
+    }
+
+    fprintf(log, "# flight log recorded from %s\n", captureFileName);
+    fprintf(log, "# %lu telemetry frames (%lu bad, %lu lost), %.1fs\n", numberOfFrames, (unsigned long)receiver.badFrames, (unsigned long)receiver.lostFrames, (double)(frameTicks[numberOfFrames - 1] - frameTicks[0]) / 1000);
+    fprintf(log, "# <microseconds> <RP pin> <level>\n");
+    for (i = 0; i < numberOfEdges; ++i)
+    {
+        fprintf(log, "%.3f %u %d\n", edges[i].microseconds, edges[i].pin, edges[i].level);
+    }
+    fclose(log);
+
+    printf("%s:  %lu telemetry frames (%lu bad, %lu lost) made %lu edges in %s\n", captureFileName, numberOfFrames, (unsigned long)receiver.badFrames, (unsigned long)receiver.lostFrames, numberOfEdges, logFileName);
+
+    free(edges);
+    free(frames);
+    free(frameTicks);
+    return true;
+}
+
+//Replay
+
+//schedules every edge in the log, and returns when the last one is (in microseconds), or -1
+static double Schedule_Flight_Log(const char* fileName)
+{
+    FILE* file = fopen(fileName, "r");
+    char line[128];
+    unsigned long lineNumber = 0;
+    unsigned long skipped = 0;
+    double last = 0;
+
+    if (file == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        double microseconds;
+        unsigned int pin;
+        int level;
+
+        ++lineNumber;
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+
+        if (sscanf(line, "%lf %u %d", &microseconds, &pin, &level) != 3 || pin >= PIC24_SIM_NUMBER_OF_RP_PINS || microseconds < 0)
+        {
+            fprintf(stderr, "%s:%lu: expected <microseconds> <pin> <level>\n", fileName, lineNumber);
+            fclose(file);
+            return -1;
+        }
+
+        if (pin == STEPPER_COUNT_PIN)
+        {
+            ++skipped;
+            continue;
+        }
+
+        //rounded to the nearest cycle, so a log recorded at one clock profile plays back
+        //the same at another
+        PIC24_Sim_Schedule_Edge(pin, (unsigned long long)(microseconds * CYCLES_PER_MICROSECOND + 0.5), level);
+        if (microseconds > last)
+        {
+            last = microseconds;
+        }
+    }
+
+    fclose(file);
+
+    if (skipped > 0)
+    {
+        printf("%lu edges on the stepper motor's count input (RP%u) were skipped, it is looped back from the step signal\n", skipped, STEPPER_COUNT_PIN);
+    }
+
+    return last;
+}
+
+//every rising edge of the step signal is one step
+static void Count_Step(unsigned int rpPin, int level)
+{
+    if (rpPin == STEP_OUTPUT_PIN && level)
+    {
+        ++Steps;
+    }
+}
+
+static void Write_Trajectory_Row(FILE* file)
+{
+    //OC1 is the throttle servo at 50Hz (OC1RS + 1 ticks per frame)
+    double servoMicroseconds = OC1RS ? (double)OC1R * RECEIVER_FRAME_MICROSECONDS / ((double)OC1RS + 1) : 0;
+
+    fprintf(file, "%llu,%u,%u,%.1f,%u,%u,%d,%d,%d,%u,%d,%lu\n", PIC24_Sim_Now() / CYCLES_PER_MILLISECOND,
+            (unsigned int)OC1R, (unsigned int)OC1RS, servoMicroseconds, (unsigned int)LATAbits.LATA0, (unsigned int)LATAbits.LATA1,
+            receiverSignalLost, stepper_motion.targetPosition, stepper_motion.position, stepper_motion.stepRate,
+            stepper_motion.direction, Steps);
+}
+
+static int Replay(const char* logFileName, double seconds, const char* trajectoryFileName)
+{
+    FILE* trajectory = NULL;
+    double lastEdge;
+    unsigned long long endCycle;
+    unsigned long tick;
+    double wallSeconds;
+    struct timespec wallStart;
+    struct timespec wallEnd;
+
+    PIC24_Sim_Reset();
+    PIC24_Sim_Connect_Pins(STEP_OUTPUT_PIN, STEPPER_COUNT_PIN);
+    PIC24_Sim_Output_Edge_Hook = Count_Step;
+    Steps = 0;
+
+    lastEdge = Schedule_Flight_Log(logFileName);
+    if (lastEdge < 0)
+    {
+        return false;
+    }
+    endCycle = seconds > 0 ? (unsigned long long)(seconds * FCY) : (unsigned long long)((lastEdge + RUN_OUT_MICROSECONDS) * CYCLES_PER_MICROSECOND);
+
+    if (trajectoryFileName != NULL)
+    {
+        trajectory = fopen(trajectoryFileName, "w");
+        if (trajectory == NULL)
+        {
+            perror(trajectoryFileName);
+            return false;
+        }
+        fprintf(trajectory, "# main_driver.c built with:  %s\n", MAIN_DRIVER_TUNING[0] ? MAIN_DRIVER_TUNING : "its own settings");
+        fprintf(trajectory, "time_ms,servo_ocr,servo_ocrs,servo_us,lift_relay,propulsion_relay,signal_lost,stepper_target,stepper_position,step_rate,step_direction,steps\n");
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    Hovercraft_Initialize();
+
+    //the firmware takes no simulated time, so the scheduler is run once right after every
+    //timer2 tick (see main_driver_benchmark.c)
+    for (tick = 0; PIC24_Sim_Now() + SCHEDULER_TICK_CYCLES <= endCycle; ++tick)
+    {
+        PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+        Scheduler_Run_Pending();
+
+        if (trajectory != NULL && tick % RECEIVER_FRAME_TICKS == 0)
+        {
+            Write_Trajectory_Row(trajectory);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    wallSeconds = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+
+    if (trajectory != NULL)
+    {
+        fclose(trajectory);
+    }
+
+    printf("main_driver.c built with:  %s (Fcy = %lu Hz)\n", MAIN_DRIVER_TUNING[0] ? MAIN_DRIVER_TUNING : "its own settings", (unsigned long)FCY);
+    printf("%s:  %.1fs replayed in %.3fs (%.0fx real time)\n", logFileName, (double)PIC24_Sim_Now() / FCY, wallSeconds, (double)PIC24_Sim_Now() / FCY / wallSeconds);
+    printf("    stepper motor:  %lu steps, at %d counts (target %d)\n", Steps, stepper_motion.position, stepper_motion.targetPosition);
+    printf("    throttle servo OC1R = %u, engine relays %u/%u\n", (unsigned int)OC1R, (unsigned int)LATAbits.LATA0, (unsigned int)LATAbits.LATA1);
+
+    return true;
+}
+
+//Diff
+
+static int Read_Trajectory(const char* fileName, Trajectory* trajectory)
+{
+    FILE* file = fopen(fileName, "r");
+    char line[512];
+    unsigned long capacity = 0;
+    char* name;
+
+    memset(trajectory, 0, sizeof(Trajectory));
+    if (file == NULL)
+    {
+        perror(fileName);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char* field;
+        unsigned int column = 0;
+
+        if (line[0] == '#')
+        {
+            continue;
+        }
+
+        if (trajectory->numberOfColumns == 0)
+        {
+            strncpy(trajectory->header, line, sizeof(trajectory->header) - 1);
+            for (name = strtok(trajectory->header, ",\r\n"); name != NULL && trajectory->numberOfColumns < MAXIMUM_COLUMNS; name = strtok(NULL, ",\r\n"))
+            {
+                trajectory->names[trajectory->numberOfColumns++] = name;
+            }
+            continue;
+        }
+
+        if (trajectory->numberOfRows == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 4096;
+            trajectory->values = realloc(trajectory->values, capacity * trajectory->numberOfColumns * sizeof(double));
+            if (trajectory->values == NULL)
+            {
+                fprintf(stderr, "out of memory for %s\n", fileName);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        for (field = strtok(line, ",\r\n"); field != NULL && column < trajectory->numberOfColumns; field = strtok(NULL, ",\r\n"))
+        {
+            trajectory->values[trajectory->numberOfRows * trajectory->numberOfColumns + column++] = strtod(field, NULL);
+        }
+        if (column != trajectory->numberOfColumns)
+        {
+            fprintf(stderr, "%s:  row %lu has %u columns, not %u\n", fileName, trajectory->numberOfRows + 1, column, trajectory->numberOfColumns);
+            fclose(file);
+            return false;
+        }
+        ++trajectory->numberOfRows;
+    }
+
+    fclose(file);
+
+    if (trajectory->numberOfColumns == 0)
+    {
+        fprintf(stderr, "%s is not a trajectory\n", fileName);
+        return false;
+    }
+
+    return true;
+}
+
+//returns 0 if the trajectories are the same, 1 if they differ, and 2 if they cannot be compared
+static int Diff(const char* firstFileName, const char* secondFileName)
+{
+    Trajectory first;
+    Trajectory second;
+    unsigned long rows;
+    unsigned long differentRows = 0;
+    unsigned int column;
+    unsigned long row;
+
+    if (!Read_Trajectory(firstFileName, &first) || !Read_Trajectory(secondFileName, &second))
+    {
+        return 2;
+    }
+
+    if (first.numberOfColumns != second.numberOfColumns)
+    {
+        fprintf(stderr, "%s and %s do not have the same columns\n", firstFileName, secondFileName);
+        return 2;
+    }
+    for (column = 0; column < first.numberOfColumns; ++column)
+    {
+        if (strcmp(first.names[column], second.names[column]) != 0)
+        {
+            fprintf(stderr, "%s and %s do not have the same columns (%s and %s)\n", firstFileName, secondFileName, first.names[column], second.names[column]);
+            return 2;
+        }
+    }
+
+    rows = first.numberOfRows < second.numberOfRows ? first.numberOfRows : second.numberOfRows;
+    if (first.numberOfRows != second.numberOfRows)
+    {
+        printf("%s has %lu rows and %s has %lu, only the first %lu are compared\n", firstFileName, first.numberOfRows, secondFileName, second.numberOfRows, rows);
+    }
+
+    for (row = 0; row < rows; ++row)
+    {
+        for (column = 0; column < first.numberOfColumns; ++column)
+        {
+            if (first.values[row * first.numberOfColumns + column] != second.values[row * second.numberOfColumns + column])
+            {
+                ++differentRows;
+                break;
+            }
+        }
+    }
+
+    printf("%s vs %s:  %lu of %lu rows differ\n", firstFileName, secondFileName, differentRows, rows);
+    printf("    %-18s %8s %12s %12s %12s %10s\n", "column", "rows", "max diff", "mean |diff|", "first (ms)", "b - a");
+
+    //the first column is the time, which the rest are compared at
+    for (column = 1; column < first.numberOfColumns; ++column)
+    {
+        unsigned long differences = 0;
+        double maximum = 0;
+        double total = 0;
+        double firstTime = 0;
+        double firstDifference = 0;
+
+        for (row = 0; row < rows; ++row)
+        {
+            double difference = second.values[row * second.numberOfColumns + column] - first.values[row * first.numberOfColumns + column];
+
+            if (difference != 0)
+            {
+                if (differences == 0)
+                {
+                    firstTime = first.values[row * first.numberOfColumns];
+                    firstDifference = difference;
+                }
+                ++differences;
+                total += fabs(difference);
+                if (fabs(difference) > maximum)
+                {
+                    maximum = fabs(difference);
+                }
+            }
+        }
+
+        if (differences > 0)
+        {
+            printf("    %-18s %8lu %12.1f %12.2f %12.0f %+10.1f\n", first.names[column], differences, maximum, total / differences, firstTime, firstDifference);
+        }
+        else
+        {
+            printf("    %-18s %8s\n", first.names[column], "same");
+        }
+    }
+
+    free(first.values);
+    free(second.values);
+
+    return differentRows > 0 || first.numberOfRows != second.numberOfRows ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* logFileName = NULL;
+    const char* trajectoryFileName = NULL;
+    double seconds = 0;
+    int i;
+
+    if (argc == 4 && strcmp(argv[1], "--record") == 0)
+    {
+        return Record(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc == 4 && strcmp(argv[1], "--diff") == 0)
+    {
+        return Diff(argv[2], argv[3]);
+    }
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            seconds = strtod(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "--trajectory") == 0 && i + 1 < argc)
+        {
+            trajectoryFileName = argv[++i];
+        }
+        else if (argv[i][0] != '-' && logFileName == NULL)
+        {
+            logFileName = argv[i];
+        }
+        else
+        {
+            logFileName = NULL;
+            break;
+        }
+    }
+
+    if (logFileName == NULL)
+    {
+        fprintf(stderr, "usage: %s <flight log> [--seconds <s>] [--trajectory <file.csv>]\n", argv[0]);
+        fprintf(stderr, "       %s --record <telemetry capture> <flight log>\n", argv[0]);
+        fprintf(stderr, "       %s --diff <a.csv> <b.csv>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return Replay(logFileName, seconds, trajectoryFileName) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,470 @@
+/*
+ * File:    host_simulator_driver.c
+ * Author:  Zachary Downum
+ */
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PWM.h"
+#include "InputCapture.h"
+#include "Cycle_Counter.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+
+//50Hz, the frame rate of the wireless controller's receiver
+#define RECEIVER_FRAME_CYCLES (20000 * CYCLES_PER_MICROSECOND)
+#define DEFAULT_NUMBER_OF_FRAMES 50
+//6kHz, the fastest signal IC6 is tested at (120 periods per receiver frame)
+#define SPARE_INPUT_PERIOD_CYCLES (FCY / 6000)
+
+//--slow-spare:  a 25% duty cycle signal on IC6 at each of these frequencies (0.5Hz, the
+//slowest advertised signal, can only be measured with IC_32_BIT_TIMESTAMPS), for this many
+//periods, with the same signal on IC1 to compare it to, and how far off either can be
+#ifdef IC_32_BIT_TIMESTAMPS
+static const double SlowSpareFrequencies[] = { 0.5, 5, 25, 50 };
+#else
+static const double SlowSpareFrequencies[] = { 25, 50 };
+#endif
+#define SLOW_SPARE_DUTY_CYCLE_PERCENTAGE 25.0
+#define SLOW_SPARE_PERIODS 4
+#define SLOW_SPARE_DUTY_CYCLE_TOLERANCE 0.1
+#define SLOW_SPARE_FREQUENCY_TOLERANCE 0.001
+
+//the same pins main_driver.c and InputCapture.c use
+#define KILL_SWITCH_PIN 4
+#define THROTTLE_PIN 5
+#define STEERING_PIN 6
+#define STEPPER_COUNT_PIN 7
+#define BRAKE_PIN 8
+#define SPARE_INPUT_PIN 11
+
+typedef struct
+{
+    IC_Module module;
+    void (*Update)(IC_Module*);
+    int updateSite;
+} Measured_Input;
+
+static const char* EdgeFileName = NULL;
+static unsigned int NumberOfFrames = DEFAULT_NUMBER_OF_FRAMES;
+
+static int InterruptSites[PIC24_SIM_NUMBER_OF_VECTORS];
+
+static Measured_Input Inputs[5];
+static Count_Monitor Stepper_Counter;
+#define NUMBER_OF_OUTPUTS 6
+
+static PWM_Module Outputs[NUMBER_OF_OUTPUTS] =
+{
+    PWM_MODULE(1), PWM_MODULE(2), PWM_MODULE(3), PWM_MODULE(4), PWM_MODULE(5), PWM_MODULE(6)
+};
+//the same OC modules driven through PWM_Fixed_Module and then PWM_Output right after
+//each PWM_Module update, to compare them (the PWM_Output's values are the ones left in
+//the registers)
+static PWM_Fixed_Module Fixed_Outputs[NUMBER_OF_OUTPUTS] =
+{
+    PWM_FIXED_MODULE(1), PWM_FIXED_MODULE(2), PWM_FIXED_MODULE(3), PWM_FIXED_MODULE(4), PWM_FIXED_MODULE(5), PWM_FIXED_MODULE(6)
+};
+static PWM_Output Handle_Outputs[NUMBER_OF_OUTPUTS];
+//the largest difference between the OCxR values the two set for the same duty cycle
+static unsigned int LargestHighTicksDifference;
+//the number of times a PWM_Output set a different OCxR than its PWM_Fixed_Module
+static unsigned int HandleMismatches;
+
+static int StepperUpdateSite;
+static int DutyCycleUpdateSite[NUMBER_OF_OUTPUTS];
+static int FrequencyUpdateSite[NUMBER_OF_OUTPUTS];
+static int FixedDutyCycleUpdateSite[NUMBER_OF_OUTPUTS];
+static int FixedFrequencyUpdateSite[NUMBER_OF_OUTPUTS];
+//every PWM_Output runs the same code, so they share one site for each function
+static int HandleDutyCycleUpdateSite;
+static int HandleFrequencyUpdateSite;
+
+static void Interrupt_Entry(unsigned int vector)
+{
+    if (InterruptSites[vector] >= 0)
+    {
+        CYCLE_COUNTER_BEGIN(InterruptSites[vector]);
+    }
+}
+
+static void Interrupt_Exit(unsigned int vector)
+{
+    if (InterruptSites[vector] >= 0)
+    {
+        CYCLE_COUNTER_END(InterruptSites[vector]);
+    }
+}
+
+static void Register_Sites(void)
+{
+    static const char* const dutyCycleNames[NUMBER_OF_OUTPUTS] =
+    {
+        "PWM_Update_OC1_DutyCycle", "PWM_Update_OC2_DutyCycle", "PWM_Update_OC3_DutyCycle",
+        "PWM_Update_OC4_DutyCycle", "PWM_Update_OC5_DutyCycle", "PWM_Update_OC6_DutyCycle"
+    };
+    static const char* const frequencyNames[NUMBER_OF_OUTPUTS] =
+    {
+        "PWM_Update_OC1_Frequency", "PWM_Update_OC2_Frequency", "PWM_Update_OC3_Frequency",
+        "PWM_Update_OC4_Frequency", "PWM_Update_OC5_Frequency", "PWM_Update_OC6_Frequency"
+    };
+    static const char* const fixedDutyCycleNames[NUMBER_OF_OUTPUTS] =
+    {
+        "PWM_Update_OC1_Fixed_DutyCycle", "PWM_Update_OC2_Fixed_DutyCycle", "PWM_Update_OC3_Fixed_DutyCycle",
+        "PWM_Update_OC4_Fixed_DutyCycle", "PWM_Update_OC5_Fixed_DutyCycle", "PWM_Update_OC6_Fixed_DutyCycle"
+    };
+    static const char* const fixedFrequencyNames[NUMBER_OF_OUTPUTS] =
+    {
+        "PWM_Update_OC1_Fixed_Frequency", "PWM_Update_OC2_Fixed_Frequency", "PWM_Update_OC3_Fixed_Frequency",
+        "PWM_Update_OC4_Fixed_Frequency", "PWM_Update_OC5_Fixed_Frequency", "PWM_Update_OC6_Fixed_Frequency"
+    };
+    int i;
+
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_VECTORS; ++i)
+    {
+        InterruptSites[i] = -1;
+    }
+
+    InterruptSites[PIC24_SIM_VECTOR_IC1] = Cycle_Counter_Register_Site("_IC1Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC2] = Cycle_Counter_Register_Site("_IC2Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC3] = Cycle_Counter_Register_Site("_IC3Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC4] = Cycle_Counter_Register_Site("_IC4Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC5] = Cycle_Counter_Register_Site("_IC5Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC6] = Cycle_Counter_Register_Site("_IC6Interrupt", true);
+
+    Inputs[0].Update = IC1_Update;
+    Inputs[0].updateSite = Cycle_Counter_Register_Site("IC1_Update", false);
+    Inputs[1].Update = IC2_Update;
+    Inputs[1].updateSite = Cycle_Counter_Register_Site("IC2_Update", false);
+    Inputs[2].Update = IC3_Update;
+    Inputs[2].updateSite = Cycle_Counter_Register_Site("IC3_Update", false);
+    StepperUpdateSite = Cycle_Counter_Register_Site("IC4_Update", false);
+    Inputs[3].Update = IC5_Update;
+    Inputs[3].updateSite = Cycle_Counter_Register_Site("IC5_Update", false);
+    Inputs[4].Update = IC6_Update;
+    Inputs[4].updateSite = Cycle_Counter_Register_Site("IC6_Update", false);
+
+    for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+    {
+        DutyCycleUpdateSite[i] = Cycle_Counter_Register_Site(dutyCycleNames[i], false);
+        FrequencyUpdateSite[i] = Cycle_Counter_Register_Site(frequencyNames[i], false);
+    }
+    for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+    {
+        FixedDutyCycleUpdateSite[i] = Cycle_Counter_Register_Site(fixedDutyCycleNames[i], false);
+        FixedFrequencyUpdateSite[i] = Cycle_Counter_Register_Site(fixedFrequencyNames[i], false);
+    }
+    HandleDutyCycleUpdateSite = Cycle_Counter_Register_Site("PWM_Output_Set_DutyCycle", false);
+    HandleFrequencyUpdateSite = Cycle_Counter_Register_Site("PWM_Output_Set_Frequency", false);
+}
+
+//OCxR for outputs 0 - 5
+static unsigned int Output_High_Ticks(int output)
+{
+    return PIC24_Sim_Registers.OC[output].R;
+}
+
+static void Compare_High_Ticks(unsigned int moduleHighTicks, unsigned int fixedHighTicks)
+{
+    unsigned int difference = (moduleHighTicks > fixedHighTicks) ? moduleHighTicks - fixedHighTicks : fixedHighTicks - moduleHighTicks;
+
+    if (difference > LargestHighTicksDifference)
+    {
+        LargestHighTicksDifference = difference;
+    }
+}
+
+//edge files have one edge per line:  <time in microseconds> <RP pin> <0 or 1>
+//lines starting with # are comments
+static int Schedule_Edge_File(const char* fileName)
+{
+    FILE* file = fopen(fileName, "r");
+    char line[128];
+    unsigned long lineNumber = 0;
+
+    if (file == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        double microseconds;
+        unsigned int pin;
+        int level;
+
+        ++lineNumber;
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+
+        if (sscanf(line, "%lf %u %d", &microseconds, &pin, &level) != 3 || pin >= PIC24_SIM_NUMBER_OF_RP_PINS)
+        {
+            fprintf(stderr, "%s:%lu: expected <microseconds> <pin> <level>\n", fileName, lineNumber);
+            fclose(file);
+            return -1;
+        }
+
+        PIC24_Sim_Schedule_Edge(pin, (unsigned long long)(microseconds * CYCLES_PER_MICROSECOND), level);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+//typical receiver output: 1-2ms pulses every 20ms, plus the 400Hz stepper count signal
+//and a 6kHz signal on the spare input (the fastest input the framework supports)
+static void Schedule_Default_Inputs(void)
+{
+    unsigned int frame;
+
+    PIC24_Sim_Schedule_Pulse_Train(KILL_SWITCH_PIN, 100, 1900 * CYCLES_PER_MICROSECOND, RECEIVER_FRAME_CYCLES, NumberOfFrames + 1);
+    PIC24_Sim_Schedule_Pulse_Train(STEERING_PIN, 300, 1500 * CYCLES_PER_MICROSECOND, RECEIVER_FRAME_CYCLES, NumberOfFrames + 1);
+    PIC24_Sim_Schedule_Pulse_Train(BRAKE_PIN, 500, 1100 * CYCLES_PER_MICROSECOND, RECEIVER_FRAME_CYCLES, NumberOfFrames + 1);
+    PIC24_Sim_Schedule_Pulse_Train(STEPPER_COUNT_PIN, 0, 500 * CYCLES_PER_MICROSECOND, 2500 * CYCLES_PER_MICROSECOND, (NumberOfFrames + 1) * 8);
+    PIC24_Sim_Schedule_Pulse_Train(SPARE_INPUT_PIN, 0, 83 * CYCLES_PER_MICROSECOND, SPARE_INPUT_PERIOD_CYCLES, (NumberOfFrames + 1) * 120);
+
+    //the throttle sweeps from 1ms to 2ms
+    for (frame = 0; frame <= NumberOfFrames; ++frame)
+    {
+        unsigned long highCycles = (1000 + 1000UL * frame / NumberOfFrames) * CYCLES_PER_MICROSECOND;
+
+        PIC24_Sim_Schedule_Pulse_Train(THROTTLE_PIN, 200 + (unsigned long long)frame * RECEIVER_FRAME_CYCLES, highCycles, RECEIVER_FRAME_CYCLES, 1);
+    }
+}
+
+static void Benchmark_Workload(void)
+{
+    unsigned int frame;
+    int i;
+
+    PIC24_Sim_Reset();
+    SYSTEM_Initialize();
+
+    //changes all pins to digital, the Initialize functions set their own directions
+    ANSA = 0x0000;
+    ANSB = 0x0000;
+    TRISA = 0x0000;
+
+    IC1_Initialize(&Inputs[0].module);
+    IC2_Initialize(&Inputs[1].module);
+    IC3_Initialize(&Inputs[2].module);
+    IC4_Initialize(&Stepper_Counter);
+    IC5_Initialize(&Inputs[3].module);
+    IC6_Initialize(&Inputs[4].module);
+
+    for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+    {
+        Outputs[i].Initialize(&Outputs[i]);
+        Fixed_Outputs[i].Initialize(&Fixed_Outputs[i]);
+        PWM_Output_Initialize(&Handle_Outputs[i], i + 1, Fixed_Outputs[i].frequency);
+    }
+    LargestHighTicksDifference = 0;
+    HandleMismatches = 0;
+
+    if (EdgeFileName == NULL)
+    {
+        Schedule_Default_Inputs();
+    }
+    else if (Schedule_Edge_File(EdgeFileName) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    PIC24_Sim_Interrupt_Entry_Hook = Interrupt_Entry;
+    PIC24_Sim_Interrupt_Exit_Hook = Interrupt_Exit;
+
+    for (frame = 1; frame <= NumberOfFrames; ++frame)
+    {
+        PIC24_Sim_Run_Until((unsigned long long)frame * RECEIVER_FRAME_CYCLES);
+
+        for (i = 0; i < 5; ++i)
+        {
+            CYCLE_COUNTER_BEGIN(Inputs[i].updateSite);
+            Inputs[i].Update(&Inputs[i].module);
+            CYCLE_COUNTER_END(Inputs[i].updateSite);
+        }
+
+        CYCLE_COUNTER_BEGIN(StepperUpdateSite);
+        IC4_Update(&Stepper_Counter);
+        CYCLE_COUNTER_END(StepperUpdateSite);
+
+        //every output follows the throttle input, the way main_driver.c drives its servo
+        for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+        {
+            unsigned int moduleHighTicks;
+
+            Outputs[i].dutyCyclePercentage = Inputs[1].module.dutyCyclePercentage;
+            CYCLE_COUNTER_BEGIN(DutyCycleUpdateSite[i]);
+            Outputs[i].UpdateDutyCycle(&Outputs[i]);
+            CYCLE_COUNTER_END(DutyCycleUpdateSite[i]);
+            moduleHighTicks = Output_High_Ticks(i);
+
+            Fixed_Outputs[i].dutyCycle = (Q15)(Inputs[1].module.dutyCyclePercentage * (Q15_ONE / 100.0) + 0.5);
+            CYCLE_COUNTER_BEGIN(FixedDutyCycleUpdateSite[i]);
+            Fixed_Outputs[i].UpdateDutyCycle(&Fixed_Outputs[i]);
+            CYCLE_COUNTER_END(FixedDutyCycleUpdateSite[i]);
+            Compare_High_Ticks(moduleHighTicks, Output_High_Ticks(i));
+
+            CYCLE_COUNTER_BEGIN(HandleDutyCycleUpdateSite);
+            PWM_Output_Set_DutyCycle(&Handle_Outputs[i], Fixed_Outputs[i].dutyCycle);
+            CYCLE_COUNTER_END(HandleDutyCycleUpdateSite);
+            if (Output_High_Ticks(i) != Fixed_Outputs[i].highTicks)
+            {
+                ++HandleMismatches;
+            }
+        }
+
+        //the frequency is changed much less often, once every 10 frames is plenty
+        if (frame % 10 == 0)
+        {
+            for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+            {
+                Outputs[i].frequency = (i < 2) ? 50 : 15000;
+                CYCLE_COUNTER_BEGIN(FrequencyUpdateSite[i]);
+                Outputs[i].UpdateFrequency(&Outputs[i]);
+                CYCLE_COUNTER_END(FrequencyUpdateSite[i]);
+
+                Fixed_Outputs[i].frequency = Outputs[i].frequency;
+                CYCLE_COUNTER_BEGIN(FixedFrequencyUpdateSite[i]);
+                Fixed_Outputs[i].UpdateFrequency(&Fixed_Outputs[i]);
+                CYCLE_COUNTER_END(FixedFrequencyUpdateSite[i]);
+
+                CYCLE_COUNTER_BEGIN(HandleFrequencyUpdateSite);
+                PWM_Output_Set_Frequency(&Handle_Outputs[i], Fixed_Outputs[i].frequency);
+                CYCLE_COUNTER_END(HandleFrequencyUpdateSite);
+            }
+        }
+    }
+
+    PIC24_Sim_Interrupt_Entry_Hook = NULL;
+    PIC24_Sim_Interrupt_Exit_Hook = NULL;
+
+    printf("after %u frames (%.1f ms simulated):\n", NumberOfFrames, (double)PIC24_Sim_Now() / CYCLES_PER_MICROSECOND / 1000);
+    for (i = 0; i < 5; ++i)
+    {
+        printf("    input %d: %7.3f%% duty cycle, %9.3f Hz, %u periods lost\n", i + 1, Inputs[i].module.dutyCyclePercentage, Inputs[i].module.frequency, Inputs[i].module.overruns);
+    }
+    printf("    stepper counts: %d\n", Stepper_Counter.numberOfCounts);
+    printf("    OC1R = %u, OC1RS = %u\n", (unsigned int)OC1R, (unsigned int)OC1RS);
+    printf("    largest OCxR difference between PWM_Module and PWM_Fixed_Module:  %u ticks\n", LargestHighTicksDifference);
+    printf("    PWM_Output updates that set a different OCxR than PWM_Fixed_Module:  %u\n\n", HandleMismatches);
+}
+
+//whether a measured input is within the tolerances of the --slow-spare signal
+static int Slow_Spare_Is_Measured(const IC_Module* module, double frequency)
+{
+    double dutyCycleError = module->dutyCyclePercentage - SLOW_SPARE_DUTY_CYCLE_PERCENTAGE;
+    double frequencyError = (module->frequency - frequency) / frequency;
+
+    return dutyCycleError < SLOW_SPARE_DUTY_CYCLE_TOLERANCE && dutyCycleError > -SLOW_SPARE_DUTY_CYCLE_TOLERANCE
+        && frequencyError < SLOW_SPARE_FREQUENCY_TOLERANCE && frequencyError > -SLOW_SPARE_FREQUENCY_TOLERANCE;
+}
+
+//Measures the --slow-spare signals with IC6 (which reads several captures per interrupt
+//when it can) and IC1, updating both every receiver frame the way a program would.
+//returns the number of signals either one measured wrong
+static int Run_Slow_Spare(void)
+{
+    unsigned int test;
+    int failures = 0;
+
+    for (test = 0; test < sizeof(SlowSpareFrequencies) / sizeof(SlowSpareFrequencies[0]); ++test)
+    {
+        double frequency = SlowSpareFrequencies[test];
+        unsigned long long periodCycles = (unsigned long long)(FCY / frequency + 0.5);
+        unsigned long long endCycle = periodCycles * SLOW_SPARE_PERIODS + RECEIVER_FRAME_CYCLES;
+        IC_Module spare;
+        IC_Module reference;
+        int passed;
+
+        PIC24_Sim_Reset();
+        SYSTEM_Initialize();
+        ANSB = 0x0000;
+
+        IC1_Initialize(&reference);
+        IC6_Initialize(&spare);
+
+        PIC24_Sim_Schedule_Pulse_Train(KILL_SWITCH_PIN, 100, (unsigned long)(periodCycles / 4), (unsigned long)periodCycles, SLOW_SPARE_PERIODS + 1);
+        PIC24_Sim_Schedule_Pulse_Train(SPARE_INPUT_PIN, 100, (unsigned long)(periodCycles / 4), (unsigned long)periodCycles, SLOW_SPARE_PERIODS + 1);
+
+        while (PIC24_Sim_Now() < endCycle)
+        {
+            PIC24_Sim_Run_For(RECEIVER_FRAME_CYCLES);
+            IC1_Update(&reference);
+            IC6_Update(&spare);
+        }
+
+        passed = Slow_Spare_Is_Measured(&spare, frequency) && Slow_Spare_Is_Measured(&reference, frequency);
+        printf("    %6.1f Hz:  IC6 %7.3f%% %9.3f Hz, IC1 %7.3f%% %9.3f Hz  %s\n", frequency, spare.dutyCyclePercentage, spare.frequency, reference.dutyCyclePercentage, reference.frequency, passed ? "ok" : "FAILED");
+        if (!passed)
+        {
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+static void Print_Usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [--edges <file>] [--frames <n>] [--no-cycles] [--slow-spare]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    int countCycles = true;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--edges") == 0 && i + 1 < argc)
+        {
+            EdgeFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            NumberOfFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--no-cycles") == 0)
+        {
+            countCycles = false;
+        }
+        else if (strcmp(argv[i], "--slow-spare") == 0)
+        {
+            printf("a %.0f%% duty cycle signal on IC6 and IC1:\n", SLOW_SPARE_DUTY_CYCLE_PERCENTAGE);
+            return Run_Slow_Spare() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else
+        {
+            Print_Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Register_Sites();
+
+    if (!countCycles)
+    {
+        Benchmark_Workload();
+        return EXIT_SUCCESS;
+    }
+
+    if (Cycle_Counter_Run(Benchmark_Workload) != 0)
+    {
+        fprintf(stderr, "cycle counting is not available on this host\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("estimated PIC24 instruction cycles (Fcy = %lu Hz):\n", (unsigned long)FCY);
+    Cycle_Counter_Print_Report(stdout);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,15 @@
+/*
+ * File:    libpic30.h
+ * Author:  Zachary Downum
+ */
+
+//Host stand-in for the XC16 delay library.  Just like the real one, FCY has to be
+//defined before this header is included.  A delay lets simulated time pass, so edges
+//and interrupts that are due during the delay are processed by the simulator.
+
+#pragma once
+
+#include "PIC24_Simulator.h"
+
+#define __delay_ms(d) PIC24_Sim_Run_For((unsigned long long)((d) * ((double)(FCY) / 1000)))
+#define __delay_us(d) PIC24_Sim_Run_For((unsigned long long)((d) * ((double)(FCY) / 1000000)))
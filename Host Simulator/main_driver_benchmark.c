@@ -0,0 +1,415 @@
+/*
+ * File:    main_driver_benchmark.c
+ * Author:  Zachary Downum
+ */
+
+//Runs the Finalized Design's main_driver.c in the simulator and measures how many
+//PIC24 instruction cycles its scheduler takes on each tick.  main_driver.c is
+//compiled with its main() renamed (see the Makefile), and this file calls its
+//initialization function and Scheduler_Run_Pending directly.
+//--signal-loss turns the receiver off partway through instead, and measures how long
+//main_driver.c's failsafe takes to turn off the engines' relays and idle the throttle
+//servo, with the receiver's frames at every phase of the scheduler's ticks.
+//--kill-switch flips the kill switch on partway through instead, at every phase of the
+//receiver's frames, and measures how long it takes the relays to turn off.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Cycle_Counter.h"
+#include "Scheduler.h"
+#include "StepperMotion.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+
+//50Hz, the frame rate of the wireless controller's receiver
+#define RECEIVER_FRAME_CYCLES (20000 * CYCLES_PER_MICROSECOND)
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+#define TICKS_PER_FRAME (RECEIVER_FRAME_CYCLES / SCHEDULER_TICK_CYCLES)
+#define DEFAULT_NUMBER_OF_FRAMES 100
+#define CYCLES_PER_MILLISECOND (FCY / 1000)
+
+//--signal-loss:  the receiver's last frame, how many frames are run in all, and how
+//far apart the phases of the receiver's frames that are tried are
+#define SIGNAL_LOSS_LAST_FRAME 10
+#define SIGNAL_LOSS_FRAMES 20
+#define SIGNAL_LOSS_PHASE_STEP_CYCLES (250 * CYCLES_PER_MICROSECOND)
+//the worst cases stated in main_driver.c
+#define SIGNAL_LOSS_RELAY_LIMIT_MILLISECONDS 91
+#define SIGNAL_LOSS_SERVO_LIMIT_MILLISECONDS 111
+
+//--kill-switch:  the frame (after startup) the switch is flipped on in, how many frames
+//are run in all, how far apart the times in that frame it is flipped at are, and how
+//often the relays are checked between scheduler ticks (IC1's interrupt can turn them off
+//at any time).  The switch's pulse is 2.4ms while it is on.
+#define KILL_SWITCH_FLIP_FRAME 5
+#define KILL_SWITCH_FRAMES 12
+#define KILL_SWITCH_PHASE_STEP_CYCLES (250 * CYCLES_PER_MICROSECOND)
+#define KILL_SWITCH_CHECK_CYCLES (16 * CYCLES_PER_MICROSECOND)
+#define KILL_SWITCH_ENGAGED_PULSE_CYCLES (2400 * CYCLES_PER_MICROSECOND)
+//the worst case stated in main_driver.c (see KILL_SWITCH_DEBOUNCE_FRAMES)
+#define KILL_SWITCH_RELAY_LIMIT_MILLISECONDS 43
+
+//main_driver.c waits 1 second after initializing before the control loop starts
+#define STARTUP_FRAMES 50
+
+//the pins main_driver.c uses (see InputCapture.c)
+#define KILL_SWITCH_PIN 4
+#define THROTTLE_PIN 5
+#define STEERING_PIN 6
+#define BRAKE_PIN 8
+
+//from main_driver.c
+void Hovercraft_Initialize(void);
+extern Scheduler_Task receiver_input_task;
+extern Scheduler_Task kill_switch_task;
+extern Scheduler_Task mixing_task;
+extern Scheduler_Task stepper_task;
+extern Stepper_Motion stepper_motion;
+
+static unsigned int NumberOfFrames = DEFAULT_NUMBER_OF_FRAMES;
+static int SchedulerSite;
+
+//--signal-loss:  the number of frames (after startup) the receiver sends before it stops
+//(0 means it never stops), and how far the frames are shifted from their usual times
+static unsigned int SignalLossFrame;
+static unsigned long long ReceiverPhaseCycles;
+//when the last pulse of the first input to go quiet ended, and when the relays turned
+//off and the throttle servo's pulse width last changed
+static unsigned long long SignalLostCycle;
+static unsigned long long RelaysOffCycle;
+static unsigned long long ServoChangeCycle;
+//--kill-switch:  when the switch is flipped on (0 means it never is), and whether the
+//relays were on right before then
+static unsigned long long KillSwitchFlipCycle;
+static unsigned long long RelaysOnAtFlip;
+
+//the pins' pulse start times within a frame, and their pulse widths (the throttle's
+//sweeps from 1ms to 2ms over the run)
+#define KILL_SWITCH_START 100
+#define THROTTLE_START 200
+#define STEERING_START 300
+#define BRAKE_START 500
+#define SWITCH_PULSE_CYCLES (1100 * CYCLES_PER_MICROSECOND)
+#define STEERING_PULSE_CYCLES (2128 * CYCLES_PER_MICROSECOND)
+
+static unsigned long Throttle_Pulse_Cycles(unsigned int frame, unsigned int totalFrames)
+{
+    return (1000 + 1000UL * frame / totalFrames) * CYCLES_PER_MICROSECOND;
+}
+
+//kill switch off (engines allowed to run), brake off, steering centered (so the
+//stepper motor stays where it is) and the throttle sweeping from 1ms to 2ms
+static void Schedule_Receiver_Inputs(void)
+{
+    unsigned int totalFrames = STARTUP_FRAMES + NumberOfFrames + 1;
+    unsigned int sentFrames = SignalLossFrame ? STARTUP_FRAMES + SignalLossFrame : totalFrames;
+    unsigned long long lastFrameStart = ReceiverPhaseCycles + (unsigned long long)(sentFrames - 1) * RECEIVER_FRAME_CYCLES;
+    unsigned long long lastEdge;
+    unsigned int frame;
+    unsigned int engagedFrame = sentFrames;
+
+    //every pulse that starts once the kill switch has been flipped is the engaged one
+    if (KillSwitchFlipCycle != 0)
+    {
+        engagedFrame = (unsigned int)((KillSwitchFlipCycle - (ReceiverPhaseCycles + KILL_SWITCH_START) + RECEIVER_FRAME_CYCLES - 1) / RECEIVER_FRAME_CYCLES);
+        PIC24_Sim_Schedule_Pulse_Train(KILL_SWITCH_PIN, ReceiverPhaseCycles + KILL_SWITCH_START + (unsigned long long)engagedFrame * RECEIVER_FRAME_CYCLES, KILL_SWITCH_ENGAGED_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, sentFrames - engagedFrame);
+    }
+
+    PIC24_Sim_Schedule_Pulse_Train(KILL_SWITCH_PIN, ReceiverPhaseCycles + KILL_SWITCH_START, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, engagedFrame);
+    PIC24_Sim_Schedule_Pulse_Train(STEERING_PIN, ReceiverPhaseCycles + STEERING_START, STEERING_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, sentFrames);
+    PIC24_Sim_Schedule_Pulse_Train(BRAKE_PIN, ReceiverPhaseCycles + BRAKE_START, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, sentFrames);
+
+    for (frame = 0; frame < sentFrames; ++frame)
+    {
+        PIC24_Sim_Schedule_Pulse_Train(THROTTLE_PIN, ReceiverPhaseCycles + THROTTLE_START + (unsigned long long)frame * RECEIVER_FRAME_CYCLES, Throttle_Pulse_Cycles(frame, totalFrames), RECEIVER_FRAME_CYCLES, 1);
+    }
+
+    //the failsafe starts counting from the first input that stops, which is whichever
+    //pulse in the last frame ended first
+    lastEdge = lastFrameStart + KILL_SWITCH_START + SWITCH_PULSE_CYCLES;
+    if (lastFrameStart + THROTTLE_START + Throttle_Pulse_Cycles(sentFrames - 1, totalFrames) < lastEdge)
+    {
+        lastEdge = lastFrameStart + THROTTLE_START + Throttle_Pulse_Cycles(sentFrames - 1, totalFrames);
+    }
+    SignalLostCycle = lastEdge;
+}
+
+static void Print_Task(const char* name, const Scheduler_Task* task)
+{
+    printf("    %-20s %6lu runs, %u missed deadlines\n", name, (unsigned long)task->runs, task->missedDeadlines);
+}
+
+//--kill-switch:  notes when the relays turn off after the switch is flipped, and whether
+//they were on right before
+static void Check_Kill_Switch_Relays(void)
+{
+    int relaysOff = LATAbits.LATA0 == 0 && LATAbits.LATA1 == 0;
+
+    if (PIC24_Sim_Now() < KillSwitchFlipCycle)
+    {
+        RelaysOnAtFlip = !relaysOff;
+    }
+    else if (RelaysOffCycle == 0 && relaysOff)
+    {
+        RelaysOffCycle = PIC24_Sim_Now();
+    }
+}
+
+static void Benchmark_Workload(void)
+{
+    unsigned long tick;
+    unsigned int lastServoPulse = 0;
+
+    PIC24_Sim_Reset();
+    RelaysOffCycle = 0;
+    ServoChangeCycle = 0;
+    RelaysOnAtFlip = false;
+    Schedule_Receiver_Inputs();
+
+    Hovercraft_Initialize();
+
+    //the firmware takes no simulated time, so the scheduler is run once right after
+    //every timer2 tick instead of over and over like Scheduler_Run does
+    for (tick = 0; tick < (unsigned long)NumberOfFrames * TICKS_PER_FRAME; ++tick)
+    {
+        if (KillSwitchFlipCycle != 0)
+        {
+            unsigned long step;
+
+            for (step = 0; step < SCHEDULER_TICK_CYCLES; step += KILL_SWITCH_CHECK_CYCLES)
+            {
+                PIC24_Sim_Run_For(KILL_SWITCH_CHECK_CYCLES);
+                Check_Kill_Switch_Relays();
+            }
+        }
+        else
+        {
+            PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+        }
+
+        CYCLE_COUNTER_BEGIN(SchedulerSite);
+        Scheduler_Run_Pending();
+        CYCLE_COUNTER_END(SchedulerSite);
+
+        if (KillSwitchFlipCycle != 0)
+        {
+            Check_Kill_Switch_Relays();
+            continue;
+        }
+
+        if (PIC24_Sim_Now() > SignalLostCycle)
+        {
+            if (RelaysOffCycle == 0 && LATAbits.LATA0 == 0 && LATAbits.LATA1 == 0)
+            {
+                RelaysOffCycle = PIC24_Sim_Now();
+            }
+            if (OC1R != lastServoPulse)
+            {
+                ServoChangeCycle = PIC24_Sim_Now();
+            }
+        }
+        lastServoPulse = OC1R;
+    }
+
+    if (SignalLossFrame || KillSwitchFlipCycle)
+    {
+        return;
+    }
+
+    printf("after %u receiver frames (%lu scheduler ticks):\n", NumberOfFrames, tick);
+    Print_Task("receiver input task", &receiver_input_task);
+    Print_Task("kill switch task", &kill_switch_task);
+    Print_Task("mixing task", &mixing_task);
+    Print_Task("stepper task", &stepper_task);
+    printf("    throttle servo:  OC1R = %u, OC1RS = %u\n", (unsigned int)OC1R, (unsigned int)OC1RS);
+    printf("    engine relays (LATA0/LATA1):  %u/%u\n", (unsigned int)LATAbits.LATA0, (unsigned int)LATAbits.LATA1);
+    printf("    stepper motor:  OC2R = %u, direction (LATA2) = %u\n\n", (unsigned int)OC2R, (unsigned int)LATAbits.LATA2);
+}
+
+//main_driver.c's variables are only set when the program starts, so every run has to
+//start from a fresh copy of the program:  Run is called in a child process, which sends
+//back when the signal was lost, the relays turned off and the throttle servo changed (and
+//whether the relays were on when the kill switch was flipped)
+static int Run_In_Child(void (*Run)(void))
+{
+    unsigned long long results[4];
+    int pipeEnds[2];
+    pid_t child;
+    int status;
+
+    if (pipe(pipeEnds) != 0 || (child = fork()) < 0)
+    {
+        perror("fork");
+        return false;
+    }
+
+    if (child == 0)
+    {
+        close(pipeEnds[0]);
+        Run();
+        results[0] = SignalLostCycle;
+        results[1] = RelaysOffCycle;
+        results[2] = ServoChangeCycle;
+        results[3] = RelaysOnAtFlip;
+        _exit(write(pipeEnds[1], results, sizeof(results)) == sizeof(results) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(pipeEnds[1]);
+    status = read(pipeEnds[0], results, sizeof(results)) == sizeof(results);
+    close(pipeEnds[0]);
+    waitpid(child, NULL, 0);
+
+    SignalLostCycle = results[0];
+    RelaysOffCycle = results[1];
+    ServoChangeCycle = results[2];
+    RelaysOnAtFlip = results[3];
+
+    return status;
+}
+
+//runs the receiver losing its signal with the frames shifted by every step of
+//SIGNAL_LOSS_PHASE_STEP_CYCLES across one frame, and reports the best and worst time
+//from the end of the last pulse to the relays turning off and the throttle servo's
+//idle pulse width being written (PWM_Group writes OC1R as the servo's next period starts)
+static int Run_Signal_Loss(void)
+{
+    double relaysBest = 1e9, relaysWorst = 0, servoBest = 1e9, servoWorst = 0;
+    unsigned int phases = 0;
+    int allRelaysOff = true;
+
+    NumberOfFrames = SIGNAL_LOSS_FRAMES;
+    SignalLossFrame = SIGNAL_LOSS_LAST_FRAME;
+
+    for (ReceiverPhaseCycles = 0; ReceiverPhaseCycles < RECEIVER_FRAME_CYCLES; ReceiverPhaseCycles += SIGNAL_LOSS_PHASE_STEP_CYCLES)
+    {
+        double relays;
+        double servo;
+
+        if (!Run_In_Child(Benchmark_Workload))
+        {
+            return false;
+        }
+        ++phases;
+
+        if (RelaysOffCycle == 0 || ServoChangeCycle == 0)
+        {
+            printf("    phase %.2f ms:  the failsafe never turned the outputs off\n", (double)ReceiverPhaseCycles / CYCLES_PER_MILLISECOND);
+            allRelaysOff = false;
+            continue;
+        }
+
+        relays = (double)(RelaysOffCycle - SignalLostCycle) / CYCLES_PER_MILLISECOND;
+        servo = (double)(ServoChangeCycle - SignalLostCycle) / CYCLES_PER_MILLISECOND;
+
+        if (relays < relaysBest) relaysBest = relays;
+        if (relays > relaysWorst) relaysWorst = relays;
+        if (servo < servoBest) servoBest = servo;
+        if (servo > servoWorst) servoWorst = servo;
+    }
+
+    printf("receiver signal lost after %u frames, %u phases of the receiver's frames:\n", SIGNAL_LOSS_LAST_FRAME, phases);
+    printf("    engine relays off:            %6.2f - %6.2f ms after the last pulse (limit %d ms)\n", relaysBest, relaysWorst, SIGNAL_LOSS_RELAY_LIMIT_MILLISECONDS);
+    printf("    throttle servo set to idle:   %6.2f - %6.2f ms (limit %d ms)\n", servoBest, servoWorst, SIGNAL_LOSS_SERVO_LIMIT_MILLISECONDS);
+    printf("    stepper motor target:  %d\n", stepper_motion.targetPosition);
+
+    return allRelaysOff && relaysWorst <= SIGNAL_LOSS_RELAY_LIMIT_MILLISECONDS && servoWorst <= SIGNAL_LOSS_SERVO_LIMIT_MILLISECONDS;
+}
+
+//flips the kill switch on at every step of KILL_SWITCH_PHASE_STEP_CYCLES across one
+//frame, and reports the best and worst time from the flip to the relays turning off
+static int Run_Kill_Switch(void)
+{
+    unsigned long long flipFrameStart = (unsigned long long)(STARTUP_FRAMES + KILL_SWITCH_FLIP_FRAME) * RECEIVER_FRAME_CYCLES;
+    unsigned long long phase;
+    double relaysBest = 1e9, relaysWorst = 0;
+    unsigned int phases = 0;
+    int allRelaysOff = true;
+
+    NumberOfFrames = KILL_SWITCH_FRAMES;
+
+    for (phase = 0; phase < RECEIVER_FRAME_CYCLES; phase += KILL_SWITCH_PHASE_STEP_CYCLES)
+    {
+        double relays;
+
+        KillSwitchFlipCycle = flipFrameStart + phase;
+        if (!Run_In_Child(Benchmark_Workload))
+        {
+            return false;
+        }
+        ++phases;
+
+        if (!RelaysOnAtFlip || RelaysOffCycle == 0)
+        {
+            printf("    flipped %.2f ms into the frame:  the relays %s\n", (double)phase / CYCLES_PER_MILLISECOND, RelaysOnAtFlip ? "never turned off" : "were already off");
+            allRelaysOff = false;
+            continue;
+        }
+
+        relays = (double)(RelaysOffCycle - KillSwitchFlipCycle) / CYCLES_PER_MILLISECOND;
+
+        if (relays < relaysBest) relaysBest = relays;
+        if (relays > relaysWorst) relaysWorst = relays;
+    }
+
+    printf("kill switch flipped on at %u times across a receiver frame:\n", phases);
+    printf("    engine relays off:  %6.2f - %6.2f ms after the flip (limit %d ms)\n", relaysBest, relaysWorst, KILL_SWITCH_RELAY_LIMIT_MILLISECONDS);
+
+    return allRelaysOff && relaysWorst <= KILL_SWITCH_RELAY_LIMIT_MILLISECONDS;
+}
+
+int main(int argc, char** argv)
+{
+    int countCycles = true;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            NumberOfFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--no-cycles") == 0)
+        {
+            countCycles = false;
+        }
+        else if (strcmp(argv[i], "--signal-loss") == 0)
+        {
+            return Run_Signal_Loss() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else if (strcmp(argv[i], "--kill-switch") == 0)
+        {
+            return Run_Kill_Switch() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--frames <n>] [--no-cycles] [--signal-loss] [--kill-switch]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    SchedulerSite = Cycle_Counter_Register_Site("Scheduler_Run_Pending", false);
+
+    if (!countCycles)
+    {
+        Benchmark_Workload();
+        return EXIT_SUCCESS;
+    }
+
+    if (Cycle_Counter_Run(Benchmark_Workload) != 0)
+    {
+        fprintf(stderr, "cycle counting is not available on this host\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("estimated PIC24 instruction cycles (Fcy = %lu Hz):\n", (unsigned long)FCY);
+    Cycle_Counter_Print_Report(stdout);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,22 @@
+/*
+ * File:    mcc.h
+ * Author:  Zachary Downum
+ */
+
+//Host stand-in for the MPLAB Code Configurator header that every firmware file
+//includes first.  On the PIC this pulls in the device registers and the system
+//configuration, here it pulls in the register model from PIC24_Simulator.h.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../PIC24_Simulator.h"
+
+//matches the internal oscillator setting in system_configuration.h (Fosc = 8MHz), which
+//is only the clock the PIC starts on:  the firmware's clock constants come from
+//ClockConfiguration.h, since Clock_Initialize may switch to the PLL
+#define _XTAL_FREQ 8000000UL
+
+void SYSTEM_Initialize(void);
@@ -0,0 +1,543 @@
+/*
+ * File:    plant_simulator.c
+ * Author:  Zachary Downum
+ */
+
+//Runs the Finalized Design's main_driver.c in a closed loop with a model of the
+//hovercraft (see Hovercraft_Plant.h).  A script of stick and switch positions is turned
+//into the receiver's pulses, the firmware's scheduler runs every 1ms tick the way it does
+//on the PIC, and the throttle servo's pulse width, the engines' relays and the stepper
+//motor's steps drive the model.  It runs many times faster than real time, so settings like
+//the steering hysteresis, the dead band and the input filters can be compared over minutes
+//of driving (main_driver.c is rebuilt with them, see MAIN_DRIVER_TUNING in the Makefile).
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Hovercraft_Plant.h"
+#include "Scheduler.h"
+#include "StepperMotion.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+#define SCHEDULER_TICK_SECONDS (1.0 / SCHEDULER_TICK_HZ)
+
+//50Hz, the frame rate of the wireless controller's receiver
+#define RECEIVER_FRAME_CYCLES (20000UL * CYCLES_PER_MICROSECOND)
+#define RECEIVER_FRAME_MICROSECONDS 20000.0
+
+//main_driver.c waits 1 second after initializing before the control loop starts, so the
+//receiver's frames for that second are sent before Hovercraft_Initialize is called
+#define STARTUP_MILLISECONDS 1000
+
+//the pins main_driver.c uses (see InputCapture.c), the stepper motor's step count input,
+//and each pin's pulse start time within a frame
+#define KILL_SWITCH_PIN 4
+#define THROTTLE_PIN 5
+#define STEERING_PIN 6
+#define STEPPER_COUNT_PIN 7
+#define BRAKE_PIN 8
+#define KILL_SWITCH_START 100
+#define THROTTLE_START 200
+#define STEERING_START 300
+#define BRAKE_START 500
+
+//the receiver's pulse widths at each end of the sticks and switches (the duty cycle ranges
+//in main_driver.c, of a 20ms frame)
+#define SWITCH_OFF_MICROSECONDS 1113.0
+#define SWITCH_ON_MICROSECONDS 2491.0
+#define STEERING_LEFT_MICROSECONDS 1492.0
+#define STEERING_RIGHT_MICROSECONDS 2763.0
+
+//the trace has one line every this many scheduler ticks (one receiver frame)
+#define TRACE_TICKS 20
+
+//a change of the steering stick that has not moved the stepper motor after this long is
+//not counted as a response (it was inside the dead band or the hysteresis)
+#define RESPONSE_TIMEOUT_SECONDS 1.0
+//steps and direction reversals once the script has not changed for this long are counted
+//as hunting (the longest move, a 180 degree turn for the brake, takes about 1s)
+#define SETTLED_SECONDS 1.5
+
+#define MAXIMUM_SCRIPT_STEPS 256
+
+//the settings main_driver.c was compiled with (see the Makefile)
+#ifndef MAIN_DRIVER_TUNING
+#define MAIN_DRIVER_TUNING ""
+#endif
+
+//from main_driver.c
+void Hovercraft_Initialize(void);
+extern Stepper_Motion stepper_motion;
+
+typedef struct Plant_Script_Step Plant_Script_Step;
+
+//the sticks and switches from time on, until the next step's time
+struct Plant_Script_Step
+{
+    double time;
+    //0 - 100%
+    double throttle;
+    //-100 (left) - 100 (right)
+    double steering;
+    //1 if the kill switch is on (engines off) or the brake switch is on
+    int kill;
+    int brake;
+    //0 if the receiver sends nothing
+    int receiverOn;
+};
+
+typedef struct Plant_Scenario Plant_Scenario;
+
+struct Plant_Scenario
+{
+    const char* name;
+    const char* description;
+    double seconds;
+    const Plant_Script_Step* steps;
+    unsigned int numberOfSteps;
+};
+
+static const Plant_Script_Step Straight_Script[] =
+{
+    { 0, 0, 0, 0, 0, 1 },
+    { 3, 60, 0, 0, 0, 1 },
+};
+
+static const Plant_Script_Step Slalom_Script[] =
+{
+    { 0, 0, 0, 0, 0, 1 },
+    { 3, 60, 0, 0, 0, 1 },
+    { 8, 60, 60, 0, 0, 1 },
+    { 11, 60, -60, 0, 0, 1 },
+    { 14, 60, 60, 0, 0, 1 },
+    { 17, 60, -60, 0, 0, 1 },
+    { 20, 60, 60, 0, 0, 1 },
+    { 23, 60, -60, 0, 0, 1 },
+    { 26, 60, 0, 0, 0, 1 },
+};
+
+//the steering stick creeping out from center in 2% steps, to see where the dead band and
+//the hysteresis let the stepper motor start moving
+static const Plant_Script_Step Dead_Band_Script[] =
+{
+    { 0, 0, 0, 0, 0, 1 },
+    { 3, 40, 0, 0, 0, 1 },
+    { 5, 40, 2, 0, 0, 1 },
+    { 7, 40, 4, 0, 0, 1 },
+    { 9, 40, 6, 0, 0, 1 },
+    { 11, 40, 8, 0, 0, 1 },
+    { 13, 40, 10, 0, 0, 1 },
+    { 15, 40, 12, 0, 0, 1 },
+    { 17, 40, 0, 0, 0, 1 },
+    { 19, 40, -2, 0, 0, 1 },
+    { 21, 40, -4, 0, 0, 1 },
+    { 23, 40, -6, 0, 0, 1 },
+    { 25, 40, -8, 0, 0, 1 },
+    { 27, 40, -10, 0, 0, 1 },
+    { 29, 40, -12, 0, 0, 1 },
+    { 31, 40, 0, 0, 0, 1 },
+};
+
+static const Plant_Script_Step Brake_Script[] =
+{
+    { 0, 0, 0, 0, 0, 1 },
+    { 3, 70, 0, 0, 0, 1 },
+    { 10, 70, 0, 0, 1, 1 },
+    { 15, 70, 0, 0, 0, 1 },
+    { 20, 0, 0, 1, 0, 1 },
+};
+
+static const Plant_Script_Step Signal_Loss_Script[] =
+{
+    { 0, 0, 0, 0, 0, 1 },
+    { 3, 60, 40, 0, 0, 1 },
+    { 10, 60, 40, 0, 0, 0 },
+    { 13, 60, 40, 0, 0, 1 },
+};
+
+#define SCENARIO(name, description, seconds, script) { name, description, seconds, script, sizeof(script) / sizeof(script[0]) }
+
+static const Plant_Scenario Scenarios[] =
+{
+    SCENARIO("straight", "60% throttle with the steering stick centered", 60, Straight_Script),
+    SCENARIO("slalom", "60% throttle, steering 60% right and left every 3s", 35, Slalom_Script),
+    SCENARIO("dead-band", "the steering stick creeping out from center", 33, Dead_Band_Script),
+    SCENARIO("brake", "70% throttle, then the brake switch for 5s, then the kill switch", 25, Brake_Script),
+    SCENARIO("signal-loss", "turning when the receiver stops sending for 3s", 20, Signal_Loss_Script),
+};
+#define NUMBER_OF_SCENARIOS (sizeof(Scenarios) / sizeof(Scenarios[0]))
+
+static Plant_Script_Step FileSteps[MAXIMUM_SCRIPT_STEPS];
+static Plant_Scenario FileScenario = { "script", NULL, 0, FileSteps, 0 };
+
+static Hovercraft_Plant Plant;
+static double JitterMicroseconds = 8;
+static double RunSeconds;
+static FILE* TraceFile;
+
+//the receiver's frames are sent one at a time, a frame ahead of the simulated time
+static unsigned long long NextFrameCycle;
+static unsigned long JitterState = 1;
+
+//hunting and response time
+static unsigned long SettledSteps;
+static unsigned long SettledReversals;
+static double LastSteeringChange;
+static int WaitingForResponse;
+static double ResponseTotal;
+static double ResponseWorst;
+static unsigned int Responses;
+static unsigned int Timeouts;
+
+static double Seconds_Now(void)
+{
+    return (double)PIC24_Sim_Now() / FCY;
+}
+
+//the script step in effect at time (seconds from power on)
+static const Plant_Script_Step* Script_At(const Plant_Scenario* scenario, double time)
+{
+    unsigned int i;
+
+    for (i = 1; i < scenario->numberOfSteps && scenario->steps[i].time <= time; ++i)
+    {
+    }
+
+    return &scenario->steps[i - 1];
+}
+
+//how long since the script last changed
+static double Script_Age(const Plant_Scenario* scenario, double time)
+{
+    return time - Script_At(scenario, time)->time;
+}
+
+//a repeatable -JitterMicroseconds - +JitterMicroseconds, so every run of a scenario sees the
+//same noise on the receiver's pulses
+static double Jitter(void)
+{
+    JitterState = JitterState * 1103515245UL + 12345UL;
+
+    return JitterMicroseconds * ((double)((JitterState >> 16) & 0x7FFF) / 0x3FFF - 1.0);
+}
+
+static void Schedule_Pulse(unsigned int pin, unsigned long long frameCycle, unsigned long startCycle, double microseconds)
+{
+    unsigned long highCycles = (unsigned long)((microseconds + Jitter()) * CYCLES_PER_MICROSECOND + 0.5);
+
+    PIC24_Sim_Schedule_Pulse_Train(pin, frameCycle + startCycle, highCycles, RECEIVER_FRAME_CYCLES, 1);
+}
+
+//sends every receiver frame that starts before cycle
+static void Schedule_Frames_Until(const Plant_Scenario* scenario, unsigned long long cycle)
+{
+    while (NextFrameCycle < cycle)
+    {
+        const Plant_Script_Step* step = Script_At(scenario, (double)NextFrameCycle / FCY);
+
+        if (step->receiverOn)
+        {
+            Schedule_Pulse(KILL_SWITCH_PIN, NextFrameCycle, KILL_SWITCH_START, step->kill ? SWITCH_ON_MICROSECONDS : SWITCH_OFF_MICROSECONDS);
+            Schedule_Pulse(THROTTLE_PIN, NextFrameCycle, THROTTLE_START, SWITCH_OFF_MICROSECONDS + (SWITCH_ON_MICROSECONDS - SWITCH_OFF_MICROSECONDS) * step->throttle / 100);
+            Schedule_Pulse(STEERING_PIN, NextFrameCycle, STEERING_START, (STEERING_LEFT_MICROSECONDS + STEERING_RIGHT_MICROSECONDS) / 2 + (STEERING_RIGHT_MICROSECONDS - STEERING_LEFT_MICROSECONDS) * step->steering / 200);
+            Schedule_Pulse(BRAKE_PIN, NextFrameCycle, BRAKE_START, step->brake ? SWITCH_ON_MICROSECONDS : SWITCH_OFF_MICROSECONDS);
+        }
+
+        NextFrameCycle += RECEIVER_FRAME_CYCLES;
+    }
+}
+
+//every rising edge of the step signal is one step, in the direction LATA2 sets
+static void Count_Step(unsigned int rpPin, int level)
+{
+    if (rpPin == PLANT_STEP_PIN && level)
+    {
+        Hovercraft_Plant_Step_Motor(&Plant, LATAbits.LATA2);
+    }
+}
+
+static void Write_Trace(const Plant_Scenario* scenario, double time)
+{
+    const Plant_Script_Step* step = Script_At(scenario, time);
+
+    fprintf(TraceFile, "%.3f,%s,%.1f,%.1f,%d,%d,%d,%.1f,%d,%d,%d,%.2f,%.3f,%.3f,%.3f,%.3f,%.2f,%.2f,%.2f,%.2f\n",
+            time, scenario->name, step->throttle, step->steering, step->kill, step->brake, step->receiverOn,
+            Plant.servoPulseMicroseconds, Plant.liftRelayOn, stepper_motion.targetPosition, (int)Plant.engineCounts,
+            Hovercraft_Plant_Engine_Angle(&Plant), Plant.servoAngle / 180.0, Plant.engineSpeed, Plant.lift,
+            Plant.speed, Plant.yawRate, Plant.heading, Plant.x, Plant.y);
+}
+
+static void Run_Scenario(const Plant_Scenario* scenario)
+{
+    double seconds = RunSeconds > 0 ? RunSeconds : scenario->seconds;
+    unsigned long ticks;
+    unsigned long tick;
+    double lastSteering = 0;
+    double maximumYawRate = 0;
+    double wallSeconds;
+    struct timespec wallStart;
+    struct timespec wallEnd;
+
+    PIC24_Sim_Reset();
+    PIC24_Sim_Connect_Pins(PLANT_STEP_PIN, STEPPER_COUNT_PIN);
+    PIC24_Sim_Output_Edge_Hook = Count_Step;
+    Hovercraft_Plant_Initialize(&Plant);
+    NextFrameCycle = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    Schedule_Frames_Until(scenario, (unsigned long long)STARTUP_MILLISECONDS * (FCY / 1000) + RECEIVER_FRAME_CYCLES);
+    Hovercraft_Initialize();
+
+    ticks = (unsigned long)((seconds - Seconds_Now()) * SCHEDULER_TICK_HZ);
+    for (tick = 0; tick < ticks; ++tick)
+    {
+        const Plant_Script_Step* step;
+        unsigned long steps = Plant.totalSteps;
+        unsigned long reversals = Plant.directionReversals;
+        double now;
+
+        Schedule_Frames_Until(scenario, PIC24_Sim_Now() + SCHEDULER_TICK_CYCLES + RECEIVER_FRAME_CYCLES);
+
+        //the firmware takes no simulated time, so the scheduler is run once right after
+        //every timer2 tick (see main_driver_benchmark.c)
+        PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+        Scheduler_Run_Pending();
+
+        //OC1 is the throttle servo at 50Hz (OC1RS + 1 ticks per frame)
+        Plant.servoPulseMicroseconds = OC1RS ? (double)OC1R * RECEIVER_FRAME_MICROSECONDS / ((double)OC1RS + 1) : PLANT_SERVO_CLOSED_MICROSECONDS;
+        Plant.liftRelayOn = LATAbits.LATA0;
+        Plant.propulsionRelayOn = LATAbits.LATA1;
+        Hovercraft_Plant_Step(&Plant, SCHEDULER_TICK_SECONDS);
+
+        now = Seconds_Now();
+        step = Script_At(scenario, now);
+
+        if (step->steering != lastSteering)
+        {
+            if (WaitingForResponse)
+            {
+                ++Timeouts;
+            }
+            lastSteering = step->steering;
+            LastSteeringChange = now;
+            WaitingForResponse = true;
+        }
+
+        if (Plant.totalSteps != steps)
+        {
+            if (WaitingForResponse)
+            {
+                ResponseTotal += now - LastSteeringChange;
+                if (now - LastSteeringChange > ResponseWorst)
+                {
+                    ResponseWorst = now - LastSteeringChange;
+                }
+                ++Responses;
+                WaitingForResponse = false;
+            }
+            if (Script_Age(scenario, now) > SETTLED_SECONDS)
+            {
+                SettledSteps += Plant.totalSteps - steps;
+                SettledReversals += Plant.directionReversals - reversals;
+            }
+        }
+        else if (WaitingForResponse && now - LastSteeringChange > RESPONSE_TIMEOUT_SECONDS)
+        {
+            ++Timeouts;
+            WaitingForResponse = false;
+        }
+
+        if (fabs(Plant.yawRate) > maximumYawRate)
+        {
+            maximumYawRate = fabs(Plant.yawRate);
+        }
+
+        if (TraceFile != NULL && tick % TRACE_TICKS == 0)
+        {
+            Write_Trace(scenario, now);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    wallSeconds = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+
+    printf("%s (%.0fs", scenario->name, Seconds_Now());
+    if (scenario->description != NULL)
+    {
+        printf(", %s", scenario->description);
+    }
+    printf("):\n");
+    printf("    heading %.1f degrees, %.1fm from the start, %.2fm/s at the end (yaw rate at most %.1f degrees/s)\n", Plant.heading, sqrt(Plant.x * Plant.x + Plant.y * Plant.y), Plant.speed, maximumYawRate);
+    printf("    stepper motor:  %lu steps, %lu direction reversals\n", Plant.totalSteps, Plant.directionReversals);
+    printf("    hunting:  %lu steps and %lu reversals with the sticks still\n", SettledSteps, SettledReversals);
+    if (Responses > 0)
+    {
+        printf("    steering response:  %u changes moved the motor after %.0fms on average (%.0fms at most), %u did not\n", Responses, ResponseTotal / Responses * 1000, ResponseWorst * 1000, Timeouts);
+    }
+    else
+    {
+        printf("    steering response:  %u changes, none of them moved the motor\n", Timeouts);
+    }
+    printf("    engine at %.1f degrees, engine relays %u/%u\n", Hovercraft_Plant_Engine_Angle(&Plant), (unsigned int)LATAbits.LATA0, (unsigned int)LATAbits.LATA1);
+    printf("    %.0fs simulated in %.3fs (%.0fx real time)\n\n", Seconds_Now(), wallSeconds, Seconds_Now() / wallSeconds);
+}
+
+//main_driver.c's variables are only set when the program starts, so each scenario is run
+//in its own child process (like main_driver_benchmark --signal-loss)
+static int Run_In_Child(const Plant_Scenario* scenario)
+{
+    pid_t child;
+    int status;
+
+    fflush(stdout);
+    if (TraceFile != NULL)
+    {
+        fflush(TraceFile);
+    }
+    child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        return false;
+    }
+
+    if (child == 0)
+    {
+        Run_Scenario(scenario);
+        fflush(stdout);
+        if (TraceFile != NULL)
+        {
+            fflush(TraceFile);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    return waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+//one step per line:  <seconds> <throttle %> <steering -100 - 100> <kill 0/1> <brake 0/1> <receiver 0/1>
+//Lines starting with # are comments.
+static int Read_Script(const char* fileName)
+{
+    char line[256];
+    FILE* file = fopen(fileName, "r");
+
+    if (file == NULL)
+    {
+        perror(fileName);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL && FileScenario.numberOfSteps < MAXIMUM_SCRIPT_STEPS)
+    {
+        Plant_Script_Step* step = &FileSteps[FileScenario.numberOfSteps];
+
+        if (line[0] == '#')
+        {
+            continue;
+        }
+        if (sscanf(line, "%lf %lf %lf %d %d %d", &step->time, &step->throttle, &step->steering, &step->kill, &step->brake, &step->receiverOn) == 6)
+        {
+            ++FileScenario.numberOfSteps;
+            FileScenario.seconds = step->time + 5;
+        }
+    }
+
+    fclose(file);
+
+    if (FileScenario.numberOfSteps == 0)
+    {
+        fprintf(stderr, "%s has no script steps\n", fileName);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* scenarioName = NULL;
+    int ok = true;
+    unsigned int i;
+
+    for (i = 1; i < (unsigned int)argc; ++i)
+    {
+        if (strcmp(argv[i], "--scenario") == 0 && i + 1 < (unsigned int)argc)
+        {
+            scenarioName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--script") == 0 && i + 1 < (unsigned int)argc)
+        {
+            if (!Read_Script(argv[++i]))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < (unsigned int)argc)
+        {
+            RunSeconds = strtod(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < (unsigned int)argc)
+        {
+            JitterMicroseconds = strtod(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < (unsigned int)argc)
+        {
+            TraceFile = fopen(argv[++i], "w");
+            if (TraceFile == NULL)
+            {
+                perror(argv[i]);
+                return EXIT_FAILURE;
+            }
+            fprintf(TraceFile, "time,scenario,throttle,steering,kill,brake,receiver,servo_us,relays,target_counts,engine_counts,engine_degrees,throttle_open,engine_speed,lift,speed,yaw_rate,heading,x,y\n");
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--scenario <name>] [--script file.txt] [--seconds <s>] [--jitter <us>] [--trace file.csv]\n", argv[0]);
+            fprintf(stderr, "scenarios:");
+            for (i = 0; i < NUMBER_OF_SCENARIOS; ++i)
+            {
+                fprintf(stderr, " %s", Scenarios[i].name);
+            }
+            fprintf(stderr, "\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("main_driver.c built with:  %s (Fcy = %lu Hz, %.0fus of jitter on the receiver's pulses)\n\n", MAIN_DRIVER_TUNING[0] ? MAIN_DRIVER_TUNING : "its own settings", (unsigned long)FCY, JitterMicroseconds);
+
+    if (FileScenario.numberOfSteps > 0)
+    {
+        return Run_In_Child(&FileScenario) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (i = 0; i < NUMBER_OF_SCENARIOS; ++i)
+    {
+        if (scenarioName == NULL || strcmp(scenarioName, Scenarios[i].name) == 0)
+        {
+            ok = Run_In_Child(&Scenarios[i]) && ok;
+            if (scenarioName != NULL)
+            {
+                return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (scenarioName != NULL)
+    {
+        fprintf(stderr, "no scenario named %s\n", scenarioName);
+        return EXIT_FAILURE;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,681 @@
+/*
+ * File:    ppm_decoder.c
+ * Author:  Zachary Downum
+ */
+
+//Checks the Input Capture dependency's PPM decoder (built on IC1 here, see the Makefile)
+//with simulated PPM frames, and compares what it costs with the separate PWM inputs it
+//replaces:
+//    sweep:           8 channels that change every frame, each decoded to within 1 tick
+//    glitches:        6 channel frames, some with an extra pulse that splits a channel in
+//                     two or is too short to be one, which are thrown out without ever
+//                     shifting the channels
+//    signal loss:     the signal stops in the middle of a frame and comes back in the
+//                     middle of another one
+//    channel change:  the receiver goes from 8 channels to 6
+//    interrupts:      the PPM module's interrupts and instruction cycles against IC2, IC3,
+//                     IC5 and IC6 measuring 4 separate PWM inputs
+//    main_driver.c:   main_driver.c built with RECEIVER_PPM, flying on PPM frames until
+//                     the signal is lost
+//Every published frame has to match a whole frame that was sent.  Exits with a failure if
+//any of the checks fail.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Cycle_Counter.h"
+#include "InputCapture.h"
+#include "Scheduler.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+#define CYCLES_PER_MILLISECOND (FCY / 1000)
+
+//the PPM module is IC1, on RP4 (see InputCapture.c)
+#define PPM_PIN 4
+//a typical PPM receiver's frame, and the pulse that starts each channel
+#define PPM_FRAME_MICROSECONDS 22500
+#define PPM_PULSE_MICROSECONDS 300
+#define PPM_FRAME_CYCLES ((unsigned long long)PPM_FRAME_MICROSECONDS * CYCLES_PER_MICROSECOND)
+
+//IC_PPM_Update is called every millisecond, the same as the scheduler's tick
+#define UPDATE_CYCLES CYCLES_PER_MILLISECOND
+//the same signal timeout as main_driver.c's
+#define SIGNAL_TIMEOUT_MILLISECONDS 70
+
+#define MAX_FRAMES 400
+
+//the extra pulses the glitches test adds to a channel
+#define GLITCH_NONE 0
+//a short pulse 400us into the channel (too short to be a channel)
+#define GLITCH_SHORT 1
+//a pulse in the middle of the channel (two channels that are each long enough)
+#define GLITCH_SPLIT 2
+#define GLITCH_SHORT_OFFSET_MICROSECONDS 400
+#define GLITCH_PULSE_MICROSECONDS 50
+#define SPLIT_CHANNEL_MICROSECONDS 1800
+
+//the PWM inputs the interrupts test measures, on their own pins (see InputCapture.c)
+#define NUMBER_OF_PWM_INPUTS 4
+#define PWM_FRAME_CYCLES (20000UL * CYCLES_PER_MICROSECOND)
+#define PWM_PULSE_CYCLES (1500UL * CYCLES_PER_MICROSECOND)
+#define INTERRUPT_TEST_MILLISECONDS 2000
+
+//main_driver.c's default channels (see RECEIVER_PPM in main_driver.c) and the pulse widths
+//main_driver_benchmark uses
+#define DRIVER_THROTTLE_CHANNEL 2
+#define DRIVER_STEERING_CHANNEL 3
+#define DRIVER_KILL_SWITCH_CHANNEL 4
+#define DRIVER_BRAKE_CHANNEL 5
+#define DRIVER_SWITCH_MICROSECONDS 1100
+#define DRIVER_STEERING_MICROSECONDS 2128
+#define DRIVER_FRAMES 150
+//main_driver.c's worst case from the last pulse to the relays turning off
+#define DRIVER_RELAY_LIMIT_MILLISECONDS 91
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+
+typedef struct Sent_Frame Sent_Frame;
+typedef struct Decode_Results Decode_Results;
+
+struct Sent_Frame
+{
+    unsigned int numberOfChannels;
+    unsigned int channelMicroseconds[IC_PPM_MAX_CHANNELS];
+    //when the rising edge that ends its last channel is
+    unsigned long long endCycle;
+    //0 if any of its edges were left out or it had a glitch
+    int whole;
+};
+
+struct Decode_Results
+{
+    //the Updates that had a new frame, and the ones where that frame was not one that was
+    //sent whole (or was older than the last one)
+    unsigned int published;
+    unsigned int wrong;
+    int lastMatchedFrame;
+    //the largest difference between a channel and its pulse width, and the longest time
+    //from a frame's end to the Update that first had it
+    double worstErrorTicks;
+    unsigned long long worstLatencyCycles;
+    //when signalValid first went from 1 to 0, and back to 1 after that
+    unsigned long long lostCycle;
+    unsigned long long recoveredCycle;
+};
+
+//from main_driver.c (built with RECEIVER_PPM, see the Makefile)
+void Hovercraft_Initialize(void);
+
+static IC_PPM_Module Receiver;
+static Sent_Frame Frames[MAX_FRAMES];
+static unsigned int NumberOfFrames;
+static unsigned long long NextFrameCycle;
+static int Failures;
+
+static int InterruptSites[PIC24_SIM_NUMBER_OF_VECTORS];
+static int PPMUpdateSite;
+static int PWMUpdateSite;
+
+static void Interrupt_Entry(unsigned int vector)
+{
+    if (InterruptSites[vector] >= 0)
+    {
+        CYCLE_COUNTER_BEGIN(InterruptSites[vector]);
+    }
+}
+
+static void Interrupt_Exit(unsigned int vector)
+{
+    if (InterruptSites[vector] >= 0)
+    {
+        CYCLE_COUNTER_END(InterruptSites[vector]);
+    }
+}
+
+static void Check(const char* name, int passed)
+{
+    printf("    %-60s %s\n", name, passed ? "ok" : "FAILED");
+    if (!passed)
+    {
+        ++Failures;
+    }
+}
+
+//the pulse widths of a frame that changes every frame, from 1000us to 2000us
+static void Sweep_Channels(unsigned int frame, unsigned int numberOfChannels, unsigned int* channelMicroseconds)
+{
+    unsigned int i;
+
+    for (i = 0; i < numberOfChannels; ++i)
+    {
+        channelMicroseconds[i] = 1000 + (frame * 53 + i * 131) % 1001;
+    }
+}
+
+static void Schedule_Pulse(unsigned long long cycle, unsigned int widthMicroseconds)
+{
+    PIC24_Sim_Schedule_Edge(PPM_PIN, cycle, 1);
+    PIC24_Sim_Schedule_Edge(PPM_PIN, cycle + (unsigned long long)widthMicroseconds * CYCLES_PER_MICROSECOND, 0);
+}
+
+//Queues the next frame, but only its rising edges from firstEdge to lastEdge (edge n starts
+//channel n, and edge numberOfChannels ends the last one), with a glitch in one channel.
+static void Schedule_Frame(const unsigned int* channelMicroseconds, unsigned int numberOfChannels, unsigned int firstEdge, unsigned int lastEdge, int glitch, unsigned int glitchChannel)
+{
+    Sent_Frame* frame = &Frames[NumberOfFrames++];
+    unsigned long long edgeCycle = NextFrameCycle;
+    unsigned int edge;
+
+    frame->numberOfChannels = numberOfChannels;
+    memcpy(frame->channelMicroseconds, channelMicroseconds, numberOfChannels * sizeof(channelMicroseconds[0]));
+    frame->whole = (firstEdge == 0 && lastEdge == numberOfChannels && glitch == GLITCH_NONE);
+
+    for (edge = 0; edge <= numberOfChannels; ++edge)
+    {
+        if (edge >= firstEdge && edge <= lastEdge)
+        {
+            Schedule_Pulse(edgeCycle, PPM_PULSE_MICROSECONDS);
+        }
+
+        if (edge == glitchChannel && glitch == GLITCH_SHORT)
+        {
+            Schedule_Pulse(edgeCycle + GLITCH_SHORT_OFFSET_MICROSECONDS * CYCLES_PER_MICROSECOND, GLITCH_PULSE_MICROSECONDS);
+        }
+        else if (edge == glitchChannel && glitch == GLITCH_SPLIT)
+        {
+            Schedule_Pulse(edgeCycle + (unsigned long long)channelMicroseconds[edge] / 2 * CYCLES_PER_MICROSECOND, GLITCH_PULSE_MICROSECONDS);
+        }
+
+        if (edge < numberOfChannels)
+        {
+            edgeCycle += (unsigned long long)channelMicroseconds[edge] * CYCLES_PER_MICROSECOND;
+        }
+    }
+
+    frame->endCycle = edgeCycle;
+    NextFrameCycle += PPM_FRAME_CYCLES;
+}
+
+static void Schedule_Whole_Frame(const unsigned int* channelMicroseconds, unsigned int numberOfChannels)
+{
+    Schedule_Frame(channelMicroseconds, numberOfChannels, 0, numberOfChannels, GLITCH_NONE, 0);
+}
+
+static void Reset_Receiver(void)
+{
+    PIC24_Sim_Reset();
+    ANSB = 0x0000;
+    IC_PPM_Initialize(&Receiver);
+    Receiver.signalTimeoutTicks = IC_MILLISECONDS_TO_TICKS(SIGNAL_TIMEOUT_MILLISECONDS);
+
+    NumberOfFrames = 0;
+    //the first frame starts a little after the module is turned on
+    NextFrameCycle = CYCLES_PER_MILLISECOND;
+}
+
+static void Start_Test(const char* name)
+{
+    printf("%s:\n", name);
+    Reset_Receiver();
+}
+
+//returns 1 if the frame Update last copied is the sent one, and the largest difference of
+//its channels
+static int Frame_Matches(const Sent_Frame* frame, double* errorTicks)
+{
+    unsigned int i;
+
+    *errorTicks = 0;
+    if (Receiver.numberOfChannels != frame->numberOfChannels)
+    {
+        return false;
+    }
+
+    for (i = 0; i < frame->numberOfChannels; ++i)
+    {
+        double expected = (double)frame->channelMicroseconds[i] * IC_TICKS_PER_SECOND / 1000000;
+        double error = Receiver.channelTicks[i] > expected ? Receiver.channelTicks[i] - expected : expected - Receiver.channelTicks[i];
+
+        //each edge is captured on the tick it lands in, so a channel can be off by 1
+        if (error > 1.0)
+        {
+            return false;
+        }
+        if (error > *errorTicks)
+        {
+            *errorTicks = error;
+        }
+    }
+
+    return true;
+}
+
+static void Check_Published(Decode_Results* results)
+{
+    unsigned long long now = PIC24_Sim_Now();
+    double errorTicks;
+    int i;
+
+    if (Receiver.framesMeasured == 0)
+    {
+        return;
+    }
+    ++results->published;
+
+    //the newest whole frame that has ended and has these channels
+    for (i = (int)NumberOfFrames - 1; i >= 0; --i)
+    {
+        if (Frames[i].whole && Frames[i].endCycle <= now && Frame_Matches(&Frames[i], &errorTicks))
+        {
+            break;
+        }
+    }
+
+    if (i < 0 || i <= results->lastMatchedFrame)
+    {
+        ++results->wrong;
+        return;
+    }
+
+    results->lastMatchedFrame = i;
+    if (errorTicks > results->worstErrorTicks)
+    {
+        results->worstErrorTicks = errorTicks;
+    }
+    if (now - Frames[i].endCycle > results->worstLatencyCycles)
+    {
+        results->worstLatencyCycles = now - Frames[i].endCycle;
+    }
+}
+
+//runs the simulator to the end of the last frame, calling IC_PPM_Update every millisecond
+static void Run_Frames(Decode_Results* results)
+{
+    int wasValid = false;
+
+    memset(results, 0, sizeof(*results));
+    results->lastMatchedFrame = -1;
+
+    while (PIC24_Sim_Now() < NextFrameCycle)
+    {
+        PIC24_Sim_Run_For(UPDATE_CYCLES);
+        IC_PPM_Update(&Receiver);
+        Check_Published(results);
+
+        if (wasValid && !Receiver.signalValid && results->lostCycle == 0)
+        {
+            results->lostCycle = PIC24_Sim_Now();
+        }
+        else if (!wasValid && Receiver.signalValid && results->lostCycle != 0 && results->recoveredCycle == 0)
+        {
+            results->recoveredCycle = PIC24_Sim_Now();
+        }
+        wasValid = Receiver.signalValid;
+    }
+}
+
+static void Print_Results(const Decode_Results* results)
+{
+    printf("    %u frames sent, %u published, %u thrown out, %u overruns\n", NumberOfFrames, results->published, Receiver.badFrames, Receiver.overruns);
+    printf("    worst channel error %.2f ticks, worst latency from a frame's end to IC_PPM_Update %.1f ms\n",
+        results->worstErrorTicks, (double)results->worstLatencyCycles / CYCLES_PER_MILLISECOND);
+}
+
+static void Test_Sweep(void)
+{
+    unsigned int channelMicroseconds[IC_PPM_MAX_CHANNELS];
+    unsigned int frame;
+    Decode_Results results;
+    IC_Fixed_Module channel;
+    long expectedDutyCycle;
+
+    Start_Test("sweep (8 channels)");
+    for (frame = 0; frame < 200; ++frame)
+    {
+        Sweep_Channels(frame, IC_PPM_MAX_CHANNELS, channelMicroseconds);
+        Schedule_Whole_Frame(channelMicroseconds, IC_PPM_MAX_CHANNELS);
+    }
+    Run_Frames(&results);
+    Print_Results(&results);
+
+    //the last frame read as a PWM input, the same duty cycle (to within a tick) that a
+    //separate output of the receiver would give
+    IC_PPM_Read_Channel(&Receiver, 0, &channel);
+    expectedDutyCycle = (long)Frames[results.lastMatchedFrame].channelMicroseconds[0] * Q15_ONE / (IC_PPM_CHANNEL_PERIOD_MILLISECONDS * 1000);
+    printf("    channel 0 as an IC_Fixed_Module:  dutyCycle %u (a %uus pulse in 20ms is %ld)\n", channel.dutyCycle, Frames[results.lastMatchedFrame].channelMicroseconds[0], expectedDutyCycle);
+
+    Check("every published frame was a sent frame", results.wrong == 0);
+    //the first whole frame starts the module and the second gives the channel count, and
+    //the last one has no sync gap after it
+    Check("every other frame was published", results.published == NumberOfFrames - 3);
+    Check("no frames thrown out", Receiver.badFrames == 0 && Receiver.overruns == 0);
+    Check("IC_PPM_Read_Channel's duty cycle", labs((long)channel.dutyCycle - expectedDutyCycle) <= Q15_ONE / (IC_TICKS_PER_SECOND / 50) + 1);
+    printf("\n");
+}
+
+static void Test_Glitches(void)
+{
+    unsigned int channelMicroseconds[IC_PPM_MAX_CHANNELS];
+    unsigned int frame;
+    unsigned int glitches = 0;
+    Decode_Results results;
+    IC_Fixed_Module lastChannel;
+    IC_Fixed_Module missingChannel;
+
+    Start_Test("glitches (6 channels)");
+    for (frame = 0; frame < 200; ++frame)
+    {
+        Sweep_Channels(frame, 6, channelMicroseconds);
+
+        if (frame % 10 == 5)
+        {
+            int glitch = (frame % 20 == 5) ? GLITCH_SHORT : GLITCH_SPLIT;
+            unsigned int glitchChannel = frame % 6;
+
+            if (glitch == GLITCH_SPLIT)
+            {
+                channelMicroseconds[glitchChannel] = SPLIT_CHANNEL_MICROSECONDS;
+            }
+            Schedule_Frame(channelMicroseconds, 6, 0, 6, glitch, glitchChannel);
+            ++glitches;
+        }
+        else
+        {
+            Schedule_Whole_Frame(channelMicroseconds, 6);
+        }
+    }
+    Run_Frames(&results);
+    Print_Results(&results);
+
+    IC_PPM_Read_Channel(&Receiver, 5, &lastChannel);
+    IC_PPM_Read_Channel(&Receiver, 6, &missingChannel);
+
+    Check("every published frame was a sent frame", results.wrong == 0);
+    Check("every glitch threw out its frame", Receiver.badFrames == glitches);
+    Check("every other frame was published", results.published == NumberOfFrames - 3 - glitches);
+    Check("channel 5 is valid and channel 6 is not", lastChannel.signalValid && !missingChannel.signalValid);
+    printf("\n");
+}
+
+static void Test_Signal_Loss(void)
+{
+    unsigned int channelMicroseconds[IC_PPM_MAX_CHANNELS];
+    unsigned int frame;
+    unsigned long long lastEdgeCycle;
+    unsigned long long resumeCycle;
+    Decode_Results results;
+
+    Start_Test("signal loss (8 channels)");
+    for (frame = 0; frame < 60; ++frame)
+    {
+        Sweep_Channels(frame, IC_PPM_MAX_CHANNELS, channelMicroseconds);
+        Schedule_Whole_Frame(channelMicroseconds, IC_PPM_MAX_CHANNELS);
+    }
+
+    //stops after the 3rd channel starts, and comes back 300ms later at the 5th
+    Sweep_Channels(frame++, IC_PPM_MAX_CHANNELS, channelMicroseconds);
+    Schedule_Frame(channelMicroseconds, IC_PPM_MAX_CHANNELS, 0, 3, GLITCH_NONE, 0);
+    lastEdgeCycle = Frames[NumberOfFrames - 1].endCycle;
+    lastEdgeCycle -= (unsigned long long)(channelMicroseconds[3] + channelMicroseconds[4] + channelMicroseconds[5] + channelMicroseconds[6] + channelMicroseconds[7]) * CYCLES_PER_MICROSECOND;
+    NextFrameCycle += 300ULL * CYCLES_PER_MILLISECOND;
+
+    Sweep_Channels(frame++, IC_PPM_MAX_CHANNELS, channelMicroseconds);
+    resumeCycle = NextFrameCycle + (unsigned long long)(channelMicroseconds[0] + channelMicroseconds[1] + channelMicroseconds[2] + channelMicroseconds[3] + channelMicroseconds[4]) * CYCLES_PER_MICROSECOND;
+    Schedule_Frame(channelMicroseconds, IC_PPM_MAX_CHANNELS, 5, IC_PPM_MAX_CHANNELS, GLITCH_NONE, 0);
+
+    for (; frame < 120; ++frame)
+    {
+        Sweep_Channels(frame, IC_PPM_MAX_CHANNELS, channelMicroseconds);
+        Schedule_Whole_Frame(channelMicroseconds, IC_PPM_MAX_CHANNELS);
+    }
+    Run_Frames(&results);
+    Print_Results(&results);
+
+    if (results.lostCycle != 0 && results.recoveredCycle != 0)
+    {
+        printf("    signal lost %.1f ms after its last edge, and valid again %.1f ms after it came back\n",
+            (double)(results.lostCycle - lastEdgeCycle) / CYCLES_PER_MILLISECOND, (double)(results.recoveredCycle - resumeCycle) / CYCLES_PER_MILLISECOND);
+    }
+
+    Check("every published frame was a sent frame", results.wrong == 0);
+    Check("signalValid went to 0 within the timeout and 1 frame", results.lostCycle != 0 && results.lostCycle <= lastEdgeCycle + (SIGNAL_TIMEOUT_MILLISECONDS + 1) * CYCLES_PER_MILLISECOND + PPM_FRAME_CYCLES);
+    Check("signalValid came back within 3 frames", results.recoveredCycle != 0 && results.recoveredCycle <= resumeCycle + 3 * PPM_FRAME_CYCLES);
+    printf("\n");
+}
+
+static void Test_Channel_Change(void)
+{
+    unsigned int channelMicroseconds[IC_PPM_MAX_CHANNELS];
+    unsigned int frame;
+    Decode_Results results;
+
+    Start_Test("channel change (8 channels, then 6)");
+    for (frame = 0; frame < 80; ++frame)
+    {
+        unsigned int numberOfChannels = (frame < 40) ? IC_PPM_MAX_CHANNELS : 6;
+
+        Sweep_Channels(frame, numberOfChannels, channelMicroseconds);
+        Schedule_Whole_Frame(channelMicroseconds, numberOfChannels);
+    }
+    Run_Frames(&results);
+    Print_Results(&results);
+
+    Check("every published frame was a sent frame", results.wrong == 0);
+    //the first 6 channel frame is not published until the next one also has 6
+    Check("only the first frame after the change thrown out", Receiver.badFrames == 1 && Receiver.numberOfChannels == 6);
+    printf("\n");
+}
+
+//(traced by the cycle counter)
+static void Interrupt_Workload(void)
+{
+    static void (* const Initialize[NUMBER_OF_PWM_INPUTS])(IC_Fixed_Module*) = { IC2_Fixed_Initialize, IC3_Fixed_Initialize, IC5_Fixed_Initialize, IC6_Fixed_Initialize };
+    static void (* const Update[NUMBER_OF_PWM_INPUTS])(IC_Fixed_Module*) = { IC2_Fixed_Update, IC3_Fixed_Update, IC5_Fixed_Update, IC6_Fixed_Update };
+    static const unsigned int pins[NUMBER_OF_PWM_INPUTS] = { 5, 6, 8, 11 };
+    unsigned int channelMicroseconds[IC_PPM_MAX_CHANNELS];
+    IC_Fixed_Module inputs[NUMBER_OF_PWM_INPUTS];
+    unsigned int frame;
+    unsigned int i;
+
+    //the PPM receiver, with IC_PPM_Update and 4 channels read every 20ms
+    Reset_Receiver();
+    for (frame = 0; frame * PPM_FRAME_CYCLES < INTERRUPT_TEST_MILLISECONDS * (unsigned long long)CYCLES_PER_MILLISECOND; ++frame)
+    {
+        Sweep_Channels(frame, IC_PPM_MAX_CHANNELS, channelMicroseconds);
+        Schedule_Whole_Frame(channelMicroseconds, IC_PPM_MAX_CHANNELS);
+    }
+
+    PIC24_Sim_Interrupt_Entry_Hook = Interrupt_Entry;
+    PIC24_Sim_Interrupt_Exit_Hook = Interrupt_Exit;
+    while (PIC24_Sim_Now() < INTERRUPT_TEST_MILLISECONDS * (unsigned long long)CYCLES_PER_MILLISECOND)
+    {
+        PIC24_Sim_Run_For(PWM_FRAME_CYCLES);
+
+        CYCLE_COUNTER_BEGIN(PPMUpdateSite);
+        IC_PPM_Update(&Receiver);
+        for (i = 0; i < NUMBER_OF_PWM_INPUTS; ++i)
+        {
+            IC_PPM_Read_Channel(&Receiver, i, &inputs[i]);
+        }
+        CYCLE_COUNTER_END(PPMUpdateSite);
+    }
+    PIC24_Sim_Interrupt_Entry_Hook = NULL;
+    PIC24_Sim_Interrupt_Exit_Hook = NULL;
+
+    //the same receiver with 4 separate PWM outputs
+    PIC24_Sim_Reset();
+    ANSB = 0x0000;
+    for (i = 0; i < NUMBER_OF_PWM_INPUTS; ++i)
+    {
+        Initialize[i](&inputs[i]);
+        PIC24_Sim_Schedule_Pulse_Train(pins[i], CYCLES_PER_MILLISECOND + i * 2000UL * CYCLES_PER_MICROSECOND, PWM_PULSE_CYCLES, PWM_FRAME_CYCLES, INTERRUPT_TEST_MILLISECONDS * CYCLES_PER_MILLISECOND / PWM_FRAME_CYCLES);
+    }
+
+    PIC24_Sim_Interrupt_Entry_Hook = Interrupt_Entry;
+    PIC24_Sim_Interrupt_Exit_Hook = Interrupt_Exit;
+    while (PIC24_Sim_Now() < INTERRUPT_TEST_MILLISECONDS * (unsigned long long)CYCLES_PER_MILLISECOND)
+    {
+        PIC24_Sim_Run_For(PWM_FRAME_CYCLES);
+
+        CYCLE_COUNTER_BEGIN(PWMUpdateSite);
+        for (i = 0; i < NUMBER_OF_PWM_INPUTS; ++i)
+        {
+            Update[i](&inputs[i]);
+        }
+        CYCLE_COUNTER_END(PWMUpdateSite);
+    }
+    PIC24_Sim_Interrupt_Entry_Hook = NULL;
+    PIC24_Sim_Interrupt_Exit_Hook = NULL;
+}
+
+static void Print_Interrupt_Cost(const char* name, unsigned long interrupts, unsigned long long cycles)
+{
+    double seconds = INTERRUPT_TEST_MILLISECONDS / 1000.0;
+
+    printf("    %-30s %6.1f interrupts/s, %8.0f cycles/s (%.2f%% of the CPU)\n", name, interrupts / seconds, cycles / seconds, 100.0 * cycles / seconds / FCY);
+}
+
+static void Test_Interrupts(void)
+{
+    static const unsigned int pwmVectors[NUMBER_OF_PWM_INPUTS] = { PIC24_SIM_VECTOR_IC2, PIC24_SIM_VECTOR_IC3, PIC24_SIM_VECTOR_IC5, PIC24_SIM_VECTOR_IC6 };
+    const Cycle_Counter_Site* site;
+    const Cycle_Counter_Site* ppmUpdate;
+    const Cycle_Counter_Site* pwmUpdate;
+    unsigned long pwmInterrupts = 0;
+    unsigned long long pwmCycles = 0;
+    int i;
+
+    printf("interrupts:\n");
+    for (i = 0; i < PIC24_SIM_NUMBER_OF_VECTORS; ++i)
+    {
+        InterruptSites[i] = -1;
+    }
+    InterruptSites[PIC24_SIM_VECTOR_IC1] = Cycle_Counter_Register_Site("_IC1Interrupt (PPM)", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC2] = Cycle_Counter_Register_Site("_IC2Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC3] = Cycle_Counter_Register_Site("_IC3Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC5] = Cycle_Counter_Register_Site("_IC5Interrupt", true);
+    InterruptSites[PIC24_SIM_VECTOR_IC6] = Cycle_Counter_Register_Site("_IC6Interrupt", true);
+    PPMUpdateSite = Cycle_Counter_Register_Site("IC_PPM_Update + 4 IC_PPM_Read_Channel", false);
+    PWMUpdateSite = Cycle_Counter_Register_Site("4 ICx_Fixed_Update", false);
+
+    if (Cycle_Counter_Run(Interrupt_Workload) != 0)
+    {
+        printf("    (instruction cycles cannot be counted on this host)\n\n");
+        return;
+    }
+
+    site = Cycle_Counter_Get_Site(InterruptSites[PIC24_SIM_VECTOR_IC1]);
+    for (i = 0; i < NUMBER_OF_PWM_INPUTS; ++i)
+    {
+        const Cycle_Counter_Site* pwmSite = Cycle_Counter_Get_Site(InterruptSites[pwmVectors[i]]);
+
+        pwmInterrupts += pwmSite->calls;
+        pwmCycles += pwmSite->totalCycles;
+    }
+    ppmUpdate = Cycle_Counter_Get_Site(PPMUpdateSite);
+    pwmUpdate = Cycle_Counter_Get_Site(PWMUpdateSite);
+
+    printf("    %.1f s of 8 channel PPM frames, and of 4 separate 50Hz PWM inputs\n", INTERRUPT_TEST_MILLISECONDS / 1000.0);
+    Print_Interrupt_Cost("PPM (IC1)", site->calls, site->totalCycles);
+    Print_Interrupt_Cost("4 PWM inputs (IC2/3/5/6)", pwmInterrupts, pwmCycles);
+    printf("    %-30s %6.0f cycles (worst %lu) every 20ms\n", "PPM update", ppmUpdate->calls ? (double)ppmUpdate->totalCycles / ppmUpdate->calls : 0.0, ppmUpdate->maximumCycles);
+    printf("    %-30s %6.0f cycles (worst %lu) every 20ms\n", "PWM update", pwmUpdate->calls ? (double)pwmUpdate->totalCycles / pwmUpdate->calls : 0.0, pwmUpdate->maximumCycles);
+
+#ifdef IC_32_BIT_TIMESTAMPS
+    //the PPM module interrupts on every edge with 32 bit timestamps (see InputCapture.c)
+    printf("    (the PPM module interrupts on every edge with IC_32_BIT_TIMESTAMPS)\n");
+#else
+    Check("fewer interrupts than the separate PWM inputs", site->calls < pwmInterrupts);
+#endif
+    printf("\n");
+}
+
+static void Test_Main_Driver(void)
+{
+    unsigned int channelMicroseconds[IC_PPM_MAX_CHANNELS];
+    unsigned int frame;
+    unsigned long long lastEdgeCycle;
+    unsigned long long relaysOffCycle = 0;
+    unsigned int firstServoPulse = 0;
+    unsigned int lastServoPulse = 0;
+    int relaysWereOn = false;
+    unsigned int i;
+
+    printf("main_driver.c with RECEIVER_PPM:\n");
+    PIC24_Sim_Reset();
+    NumberOfFrames = 0;
+    NextFrameCycle = CYCLES_PER_MILLISECOND;
+
+    //the kill switch and brake off, the steering centered and the throttle going from 1ms
+    //to 2ms, after the 1 second main_driver.c waits before it starts
+    for (frame = 0; frame < DRIVER_FRAMES; ++frame)
+    {
+        for (i = 0; i < IC_PPM_MAX_CHANNELS; ++i)
+        {
+            channelMicroseconds[i] = 1500;
+        }
+        channelMicroseconds[DRIVER_THROTTLE_CHANNEL] = 1000 + 1000 * frame / DRIVER_FRAMES;
+        channelMicroseconds[DRIVER_STEERING_CHANNEL] = DRIVER_STEERING_MICROSECONDS;
+        channelMicroseconds[DRIVER_KILL_SWITCH_CHANNEL] = DRIVER_SWITCH_MICROSECONDS;
+        channelMicroseconds[DRIVER_BRAKE_CHANNEL] = DRIVER_SWITCH_MICROSECONDS;
+        Schedule_Whole_Frame(channelMicroseconds, IC_PPM_MAX_CHANNELS);
+    }
+    lastEdgeCycle = Frames[NumberOfFrames - 1].endCycle;
+
+    Hovercraft_Initialize();
+
+    while (PIC24_Sim_Now() < lastEdgeCycle + 200ULL * CYCLES_PER_MILLISECOND)
+    {
+        PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+        Scheduler_Run_Pending();
+
+        if (PIC24_Sim_Now() < lastEdgeCycle)
+        {
+            if (LATAbits.LATA0 && LATAbits.LATA1)
+            {
+                if (!relaysWereOn)
+                {
+                    firstServoPulse = OC1R;
+                }
+                relaysWereOn = true;
+                lastServoPulse = OC1R;
+            }
+        }
+        else if (relaysOffCycle == 0 && !LATAbits.LATA0 && !LATAbits.LATA1)
+        {
+            relaysOffCycle = PIC24_Sim_Now();
+        }
+    }
+
+    printf("    throttle servo:  OC1R = %u when the relays turned on, %u at the last frame\n", firstServoPulse, lastServoPulse);
+    if (relaysOffCycle != 0)
+    {
+        printf("    relays off %.1f ms after the last edge\n", (double)(relaysOffCycle - lastEdgeCycle) / CYCLES_PER_MILLISECOND);
+    }
+
+    Check("the relays turned on", relaysWereOn);
+    Check("the throttle servo followed the throttle channel", lastServoPulse > firstServoPulse);
+    Check("the failsafe turned the relays off in time", relaysOffCycle != 0 && relaysOffCycle <= lastEdgeCycle + DRIVER_RELAY_LIMIT_MILLISECONDS * (unsigned long long)CYCLES_PER_MILLISECOND);
+    printf("\n");
+}
+
+int main(void)
+{
+    Test_Sweep();
+    Test_Glitches();
+    Test_Signal_Loss();
+    Test_Channel_Change();
+    Test_Interrupts();
+    Test_Main_Driver();
+
+    if (Failures != 0)
+    {
+        printf("%d checks FAILED\n", Failures);
+        return EXIT_FAILURE;
+    }
+    printf("every check passed\n");
+    return EXIT_SUCCESS;
+}
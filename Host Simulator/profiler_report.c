@@ -0,0 +1,183 @@
+/*
+ * File:    profiler_report.c
+ * Author:  Zachary Downum
+ */
+
+//Runs main_driver.c built with PROFILER_ENABLED (see Profiler.h) the same way
+//main_driver_benchmark does, then types a 'p' into the simulated serial port and prints the
+//profiler's table as main_driver.c sends it back, along with how long it took on the wire.
+//The simulated firmware takes no time, so every site's cycles are 0 here (only the counts
+//mean anything), but the whole path from the PROFILER_BEGIN/END sites to the serial port
+//is the one that runs on the PIC.  The cycle counter's report is main_driver_benchmark's
+//with the profiler compiled in, so the two show what the profiler costs.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Cycle_Counter.h"
+#include "Scheduler.h"
+#include "SerialPort.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+#define CYCLES_PER_MILLISECOND (FCY / 1000)
+
+//50Hz, the frame rate of the wireless controller's receiver
+#define RECEIVER_FRAME_CYCLES (20000 * CYCLES_PER_MICROSECOND)
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+#define TICKS_PER_FRAME (RECEIVER_FRAME_CYCLES / SCHEDULER_TICK_CYCLES)
+#define DEFAULT_NUMBER_OF_FRAMES 100
+
+//main_driver.c waits 1 second after initializing before the control loop starts
+#define STARTUP_FRAMES 50
+
+//the longest the dump is waited for
+#define DUMP_TIMEOUT_TICKS 2000
+
+//the same receiver inputs as main_driver_benchmark:  kill switch and brake off, steering
+//centered and the throttle at 1.5ms
+#define KILL_SWITCH_PIN 4
+#define THROTTLE_PIN 5
+#define STEERING_PIN 6
+#define BRAKE_PIN 8
+#define KILL_SWITCH_START 100
+#define THROTTLE_START 200
+#define STEERING_START 300
+#define BRAKE_START 500
+#define SWITCH_PULSE_CYCLES (1100 * CYCLES_PER_MICROSECOND)
+#define THROTTLE_PULSE_CYCLES (1500 * CYCLES_PER_MICROSECOND)
+#define STEERING_PULSE_CYCLES (2128 * CYCLES_PER_MICROSECOND)
+
+//from main_driver.c
+void Hovercraft_Initialize(void);
+extern Scheduler_Task receiver_input_task;
+extern Scheduler_Task stepper_task;
+
+static unsigned int NumberOfFrames = DEFAULT_NUMBER_OF_FRAMES;
+static int SchedulerSite;
+
+//what main_driver.c has sent back, and when its first and last bytes arrived
+static char Received[2048];
+static unsigned int ReceivedLength;
+static unsigned long long FirstByteCycle;
+static unsigned long long LastByteCycle;
+
+static void Receive_Byte(uint8_t byte)
+{
+    if (ReceivedLength == 0)
+    {
+        FirstByteCycle = PIC24_Sim_Now();
+    }
+    if (ReceivedLength < sizeof(Received) - 1)
+    {
+        Received[ReceivedLength++] = (char)byte;
+        Received[ReceivedLength] = '\0';
+    }
+    LastByteCycle = PIC24_Sim_Now();
+}
+
+//the dump ends with an empty line
+static int Dump_Received(void)
+{
+    return ReceivedLength >= 2 && Received[ReceivedLength - 1] == '\n' && Received[ReceivedLength - 2] == '\n';
+}
+
+static void Run_Tick(void)
+{
+    PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+
+    CYCLE_COUNTER_BEGIN(SchedulerSite);
+    Scheduler_Run_Pending();
+    CYCLE_COUNTER_END(SchedulerSite);
+}
+
+static void Profiler_Workload(void)
+{
+    unsigned int totalFrames = STARTUP_FRAMES + NumberOfFrames + 1;
+    unsigned long long requestCycle;
+    unsigned long receiverRuns;
+    unsigned long stepperRuns;
+    unsigned long tick;
+
+    PIC24_Sim_Reset();
+    PIC24_Sim_UART_Transmit_Hook = Receive_Byte;
+    ReceivedLength = 0;
+
+    PIC24_Sim_Schedule_Pulse_Train(KILL_SWITCH_PIN, KILL_SWITCH_START, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    PIC24_Sim_Schedule_Pulse_Train(THROTTLE_PIN, THROTTLE_START, THROTTLE_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    PIC24_Sim_Schedule_Pulse_Train(STEERING_PIN, STEERING_START, STEERING_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    PIC24_Sim_Schedule_Pulse_Train(BRAKE_PIN, BRAKE_START, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+
+    Hovercraft_Initialize();
+
+    for (tick = 0; tick < (unsigned long)NumberOfFrames * TICKS_PER_FRAME; ++tick)
+    {
+        Run_Tick();
+    }
+
+    //the dump itself is not counted (the cycle counter only measures the control loop above)
+    requestCycle = PIC24_Sim_Now();
+    receiverRuns = receiver_input_task.runs;
+    stepperRuns = stepper_task.runs;
+    PIC24_Sim_UART_Receive('p');
+    for (tick = 0; tick < DUMP_TIMEOUT_TICKS && !Dump_Received(); ++tick)
+    {
+        PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+        Scheduler_Run_Pending();
+    }
+
+    printf("after %u receiver frames (receiver input task %lu runs, stepper task %lu runs),\n", NumberOfFrames, receiverRuns, stepperRuns);
+    if (!Dump_Received())
+    {
+        printf("no dump was received in %d ms (%u bytes)\n", DUMP_TIMEOUT_TICKS, ReceivedLength);
+        return;
+    }
+
+    printf("the dump took %.1f ms to start and %.1f ms to send (%u bytes at %d baud):\n\n", (double)(FirstByteCycle - requestCycle) / CYCLES_PER_MILLISECOND, (double)(LastByteCycle - FirstByteCycle) / CYCLES_PER_MILLISECOND, ReceivedLength, SERIAL_PORT_BAUD_RATE);
+    fputs(Received, stdout);
+}
+
+int main(int argc, char** argv)
+{
+    int countCycles = true;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            NumberOfFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--no-cycles") == 0)
+        {
+            countCycles = false;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--frames <n>] [--no-cycles]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    SchedulerSite = Cycle_Counter_Register_Site("Scheduler_Run_Pending", false);
+
+    if (!countCycles)
+    {
+        Profiler_Workload();
+        return EXIT_SUCCESS;
+    }
+
+    if (Cycle_Counter_Run(Profiler_Workload) != 0)
+    {
+        fprintf(stderr, "cycle counting is not available on this host\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("\nestimated PIC24 instruction cycles with the profiler compiled in (Fcy = %lu Hz):\n", (unsigned long)FCY);
+    Cycle_Counter_Print_Report(stdout);
+
+    return EXIT_SUCCESS;
+}
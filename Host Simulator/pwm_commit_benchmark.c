@@ -0,0 +1,365 @@
+/*
+ * File:    pwm_commit_benchmark.c
+ * Author:  Zachary Downum
+ */
+
+//Drives two 50Hz servo-style outputs (OC1 and OC2, like a left and right motor) and
+//gives them new pulse widths at a random point in every period, first with separate
+//UpdateDutyCycle calls and then through a PWM_Group.  Every pulse on both outputs is
+//timed, and the program reports:
+//    glitched pulses:  pulses that were neither an old nor a new width (an update that
+//                      lands after the new width has already passed holds the output
+//                      high into the next period)
+//    mismatched periods:  periods where one output already had its new width and the
+//                         other still had its old one
+//and exits with a failure if the PWM_Group run had any of either.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PWM.h"
+#include "Cycle_Counter.h"
+
+//OC1 and OC2 count timer1 ticks
+#define CYCLES_PER_TICK CLOCK_TIMER1_PRESCALER
+#define SERVO_FREQUENCY 50
+#define PERIOD_CYCLES ((unsigned long long)FCY / SERVO_FREQUENCY)
+#define DEFAULT_NUMBER_OF_PERIODS 1000
+
+//OC1 drives RB0 and OC2 drives RB1, which are wired to two pins that nothing reads, just
+//so that the simulator reports their edges
+#define LEFT_OUTPUT_PIN 0
+#define RIGHT_OUTPUT_PIN 1
+#define LEFT_LOOPBACK_PIN 12
+#define RIGHT_LOOPBACK_PIN 13
+
+//the code between the two outputs' updates (e.g. the rest of a mixing calculation)
+#define CYCLES_BETWEEN_UPDATES 200
+
+//the widths are 1 - 2ms (62 - 125 ticks), and consecutive updates always use different
+//widths, so every pulse can be matched to the update it came from
+#define MINIMUM_WIDTH_TICKS 62
+#define WIDTH_STEPS 64
+//how many of the most recent updates a pulse is allowed to come from
+#define UPDATES_TO_SEARCH 4
+
+#define NUMBER_OF_OUTPUTS 2
+
+typedef struct
+{
+    unsigned long long start;
+    unsigned long widthTicks;
+    //the newest update that had been made when the pulse ended
+    unsigned long newestUpdate;
+} Pulse;
+
+static unsigned int NumberOfPeriods = DEFAULT_NUMBER_OF_PERIODS;
+static int PrintResults = true;
+
+static PWM_Fixed_Module Outputs[NUMBER_OF_OUTPUTS];
+static PWM_Group Group;
+
+static Pulse* Pulses[NUMBER_OF_OUTPUTS];
+static unsigned long NumberOfPulses[NUMBER_OF_OUTPUTS];
+static unsigned long long RiseCycle[NUMBER_OF_OUTPUTS];
+static unsigned long UpdateNumber;
+
+static int SeparateUpdateSite;
+static int GroupUpdateSite;
+static int GroupInterruptSite;
+
+static int Output_For_Pin(unsigned int rpPin)
+{
+    return (rpPin == LEFT_OUTPUT_PIN) ? 0 : 1;
+}
+
+static void Record_Edge(unsigned int rpPin, int level)
+{
+    int output = Output_For_Pin(rpPin);
+
+    if (level)
+    {
+        RiseCycle[output] = PIC24_Sim_Now();
+    }
+    else if (RiseCycle[output] != 0)
+    {
+        Pulse* pulse = &Pulses[output][NumberOfPulses[output]++];
+
+        pulse->start = RiseCycle[output];
+        pulse->widthTicks = (unsigned long)((PIC24_Sim_Now() - RiseCycle[output]) / CYCLES_PER_TICK);
+        pulse->newestUpdate = UpdateNumber;
+        RiseCycle[output] = 0;
+    }
+}
+
+static void Interrupt_Entry(unsigned int vector)
+{
+    if (vector == PIC24_SIM_VECTOR_OC1)
+    {
+        CYCLE_COUNTER_BEGIN(GroupInterruptSite);
+    }
+}
+
+static void Interrupt_Exit(unsigned int vector)
+{
+    if (vector == PIC24_SIM_VECTOR_OC1)
+    {
+        CYCLE_COUNTER_END(GroupInterruptSite);
+    }
+}
+
+static unsigned long Width_Ticks(int output, unsigned long update)
+{
+    return MINIMUM_WIDTH_TICKS + (update * 37 + (unsigned long)output * 20) % WIDTH_STEPS;
+}
+
+//the width as the Q15 duty cycle that gives it on a 1250 tick period
+static Q15 Width_Duty_Cycle(int output, unsigned long update)
+{
+    return (Q15)(((uint32_t)Width_Ticks(output, update) << 15) / Outputs[0].periodTicks);
+}
+
+//the update a pulse came from, or -1 if its width does not match any recent update
+static long Find_Update(int output, const Pulse* pulse)
+{
+    unsigned long i;
+
+    for (i = 0; i < UPDATES_TO_SEARCH && i <= pulse->newestUpdate; ++i)
+    {
+        unsigned long update = pulse->newestUpdate - i;
+
+        if (pulse->widthTicks == Width_Ticks(output, update))
+        {
+            return (long)update;
+        }
+    }
+
+    return -1;
+}
+
+//a simple linear congruential generator, so every run writes at the same times
+static unsigned long Next_Random(void)
+{
+    static unsigned long state = 12345;
+
+    state = state * 1103515245UL + 12345UL;
+    return (state >> 8) & 0xFFFFFF;
+}
+
+static void Setup_Outputs(int useGroup)
+{
+    int i;
+
+    PIC24_Sim_Reset();
+    ANSB = 0x0000;
+    TRISB = 0x0000;
+
+    Outputs[0].Initialize = PWM_OC1_Fixed_Initialize;
+    Outputs[0].UpdateDutyCycle = PWM_Update_OC1_Fixed_DutyCycle;
+    Outputs[0].UpdateFrequency = PWM_Update_OC1_Fixed_Frequency;
+    Outputs[0].SetHighTicks = PWM_Set_OC1_High_Ticks;
+
+    Outputs[1].Initialize = PWM_OC2_Fixed_Initialize;
+    Outputs[1].UpdateDutyCycle = PWM_Update_OC2_Fixed_DutyCycle;
+    Outputs[1].UpdateFrequency = PWM_Update_OC2_Fixed_Frequency;
+    Outputs[1].SetHighTicks = PWM_Set_OC2_High_Ticks;
+
+    for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+    {
+        Outputs[i].Initialize(&Outputs[i]);
+        Outputs[i].frequency = SERVO_FREQUENCY;
+        Outputs[i].UpdateFrequency(&Outputs[i]);
+        NumberOfPulses[i] = 0;
+        RiseCycle[i] = 0;
+    }
+
+    UpdateNumber = 0;
+    for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+    {
+        Outputs[i].dutyCycle = Width_Duty_Cycle(i, 0);
+        Outputs[i].UpdateDutyCycle(&Outputs[i]);
+    }
+
+    if (useGroup)
+    {
+        Group.modules[0] = &Outputs[0];
+        Group.modules[1] = &Outputs[1];
+        Group.numberOfModules = NUMBER_OF_OUTPUTS;
+        PWM_Group_Initialize(&Group);
+    }
+
+    PIC24_Sim_Connect_Pins(LEFT_OUTPUT_PIN, LEFT_LOOPBACK_PIN);
+    PIC24_Sim_Connect_Pins(RIGHT_OUTPUT_PIN, RIGHT_LOOPBACK_PIN);
+}
+
+//returns the number of glitched pulses and mismatched periods
+static unsigned long Run_Test(const char* name, int useGroup)
+{
+    unsigned long glitches = 0;
+    unsigned long mismatches = 0;
+    unsigned long leftPulse;
+    unsigned long rightPulse = 0;
+    unsigned int period;
+
+    Setup_Outputs(useGroup);
+    PIC24_Sim_Output_Edge_Hook = Record_Edge;
+
+    for (period = 1; period <= NumberOfPeriods; ++period)
+    {
+        //somewhere in the period, away from the very start and end of it
+        PIC24_Sim_Run_Until(period * PERIOD_CYCLES + 100 + Next_Random() % (PERIOD_CYCLES - 2 * CYCLES_BETWEEN_UPDATES - 200));
+
+        ++UpdateNumber;
+        if (useGroup)
+        {
+            CYCLE_COUNTER_BEGIN(GroupUpdateSite);
+            PWM_Group_Stage_DutyCycle(&Group, 0, Width_Duty_Cycle(0, UpdateNumber));
+            CYCLE_COUNTER_END(GroupUpdateSite);
+            PIC24_Sim_Run_For(CYCLES_BETWEEN_UPDATES);
+            CYCLE_COUNTER_BEGIN(GroupUpdateSite);
+            PWM_Group_Stage_DutyCycle(&Group, 1, Width_Duty_Cycle(1, UpdateNumber));
+            PWM_Group_Commit(&Group);
+            CYCLE_COUNTER_END(GroupUpdateSite);
+        }
+        else
+        {
+            Outputs[0].dutyCycle = Width_Duty_Cycle(0, UpdateNumber);
+            CYCLE_COUNTER_BEGIN(SeparateUpdateSite);
+            Outputs[0].UpdateDutyCycle(&Outputs[0]);
+            CYCLE_COUNTER_END(SeparateUpdateSite);
+            PIC24_Sim_Run_For(CYCLES_BETWEEN_UPDATES);
+            Outputs[1].dutyCycle = Width_Duty_Cycle(1, UpdateNumber);
+            CYCLE_COUNTER_BEGIN(SeparateUpdateSite);
+            Outputs[1].UpdateDutyCycle(&Outputs[1]);
+            CYCLE_COUNTER_END(SeparateUpdateSite);
+        }
+    }
+    PIC24_Sim_Run_Until((NumberOfPeriods + 2) * PERIOD_CYCLES);
+    PIC24_Sim_Output_Edge_Hook = NULL;
+
+    for (leftPulse = 0; leftPulse < NumberOfPulses[0]; ++leftPulse)
+    {
+        const Pulse* left = &Pulses[0][leftPulse];
+        long leftUpdate = Find_Update(0, left);
+
+        if (leftUpdate < 0)
+        {
+            ++glitches;
+            continue;
+        }
+
+        //the two outputs start their periods together, so the right pulse for this
+        //period starts at the same time
+        while (rightPulse < NumberOfPulses[1] && Pulses[1][rightPulse].start < left->start)
+        {
+            ++rightPulse;
+        }
+        if (rightPulse < NumberOfPulses[1] && Pulses[1][rightPulse].start == left->start)
+        {
+            long rightUpdate = Find_Update(1, &Pulses[1][rightPulse]);
+
+            if (rightUpdate >= 0 && rightUpdate != leftUpdate)
+            {
+                ++mismatches;
+            }
+        }
+    }
+    for (rightPulse = 0; rightPulse < NumberOfPulses[1]; ++rightPulse)
+    {
+        if (Find_Update(1, &Pulses[1][rightPulse]) < 0)
+        {
+            ++glitches;
+        }
+    }
+
+    if (!PrintResults)
+    {
+        return glitches + mismatches;
+    }
+
+    printf("    %-16s %6lu pulses, %5lu glitched, %5lu mismatched periods\n", name, NumberOfPulses[0] + NumberOfPulses[1], glitches, mismatches);
+    if (useGroup)
+    {
+        printf("                     (%u commits applied by _OC1Interrupt)\n", Group.commitsApplied);
+    }
+
+    return glitches + mismatches;
+}
+
+//Cycle_Counter_Run runs the workload in a child process, so the pulse counts come from
+//a run without it and the cycle counting run is kept quiet
+static void Benchmark_Workload(void)
+{
+    PIC24_Sim_Interrupt_Entry_Hook = Interrupt_Entry;
+    PIC24_Sim_Interrupt_Exit_Hook = Interrupt_Exit;
+
+    Run_Test("UpdateDutyCycle", false);
+    Run_Test("PWM_Group", true);
+
+    PIC24_Sim_Interrupt_Entry_Hook = NULL;
+    PIC24_Sim_Interrupt_Exit_Hook = NULL;
+}
+
+int main(int argc, char** argv)
+{
+    int countCycles = true;
+    unsigned long groupFailures;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--periods") == 0 && i + 1 < argc)
+        {
+            NumberOfPeriods = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--no-cycles") == 0)
+        {
+            countCycles = false;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--periods <n>] [--no-cycles]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    //at most two pulses per output per period (one of them cut off by an update)
+    for (i = 0; i < NUMBER_OF_OUTPUTS; ++i)
+    {
+        Pulses[i] = malloc(sizeof(Pulse) * (NumberOfPeriods + 3) * 2);
+    }
+
+    SeparateUpdateSite = Cycle_Counter_Register_Site("UpdateDutyCycle (each output)", false);
+    GroupUpdateSite = Cycle_Counter_Register_Site("PWM_Group stage (+ commit)", false);
+    GroupInterruptSite = Cycle_Counter_Register_Site("_OC1Interrupt (group commit)", true);
+
+    printf("two %dHz outputs (OC1 and OC2) given new 1-2ms pulse widths at a random point in each of %u periods:\n", SERVO_FREQUENCY, NumberOfPeriods);
+    Run_Test("UpdateDutyCycle", false);
+    groupFailures = Run_Test("PWM_Group", true);
+
+    if (countCycles)
+    {
+        PrintResults = false;
+        if (Cycle_Counter_Run(Benchmark_Workload) != 0)
+        {
+            fprintf(stderr, "cycle counting is not available on this host\n");
+        }
+        else
+        {
+            printf("\nestimated PIC24 instruction cycles (Fcy = %lu Hz):\n", (unsigned long)FCY);
+            Cycle_Counter_Print_Report(stdout);
+        }
+    }
+
+    if (groupFailures != 0)
+    {
+        fprintf(stderr, "the PWM_Group outputs had %lu glitched pulses or mismatched periods\n", groupFailures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,972 @@
+/*
+ * File:    sbus_receiver.c
+ * Author:  Zachary Downum
+ */
+
+//Checks the Serial Receiver dependency by playing recorded SBUS byte streams into the
+//simulated UART1 (see "SBUS Streams"):
+//    sweep:           16 channels that change every frame, every 14ms
+//    noise:           the receiver turned on in the middle of a frame, garbage bytes, a
+//                     frame missing a byte, a frame with a bad end byte, an SBUS2 frame and
+//                     a frame flagged as lost
+//    failsafe:        the receiver's own failsafe, and then the wire cut in the middle of
+//                     a frame
+//    fast mode:       frames every 7ms, with nothing lost out of the ring buffer
+//    interrupts:      the U1RX interrupts and instruction cycles for the sweep
+//    main_driver.c:   main_driver.c built with RECEIVER_SBUS, flying on an SBUS stream until
+//                     it stops
+//Every published frame has to match a whole frame in the stream (decoded here again, one
+//bit at a time), and every Update that comes after a new whole frame has to publish it.
+//Exits with a failure if any of the checks fail.
+//
+//A stream is one burst of bytes per line, sent back to back from the time at its start:
+//    <microseconds> <byte> <byte> ...
+//with the bytes in hex, and lines starting with # ignored.
+//    ./sbus_receiver --stream <file>      decodes any stream (e.g. one recorded from a real
+//                                         receiver) and prints every frame
+//    ./sbus_receiver --generate <folder>  writes the test streams again
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Cycle_Counter.h"
+#include "Scheduler.h"
+#include "SerialReceiver.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+#define CYCLES_PER_MILLISECOND (FCY / 1000)
+
+#define STREAM_FOLDER "SBUS Streams"
+
+//a start bit, 8 data bits, parity and 2 stop bits at 100000 baud
+#define BYTE_MICROSECONDS 120
+#define BYTE_CYCLES ((unsigned long long)BYTE_MICROSECONDS * CYCLES_PER_MICROSECOND)
+#define FRAME_MICROSECONDS 14000
+#define FAST_FRAME_MICROSECONDS 7000
+
+//Serial_Receiver_Update is called at main_driver.c's RECEIVER_TASK_HZ
+#define UPDATE_MILLISECONDS 20
+#define UPDATE_CYCLES ((unsigned long long)UPDATE_MILLISECONDS * CYCLES_PER_MILLISECOND)
+//the same signal timeout as main_driver.c's
+#define SIGNAL_TIMEOUT_MILLISECONDS 70
+//how long the tests keep running after the last byte
+#define AFTER_STREAM_MILLISECONDS 200
+
+#define MAX_LINES 1000
+#define MAX_LINE_BYTES 64
+
+//the end byte of an SBUS2 frame (its telemetry slots follow it)
+#define SBUS2_END 0x14
+//a channel's pulse width is channel * 5 / 8 + 880us
+#define MICROSECONDS_TO_CHANNEL(us) (((us) - 880) * 8 / 5)
+#define CHANNEL_MINIMUM 172
+#define CHANNEL_MAXIMUM 1811
+#define CHANNEL_CENTER 992
+
+//main_driver.c's default channels (see RECEIVER_SBUS in main_driver.c) and the pulse widths
+//main_driver_benchmark uses, after the 1 second main_driver.c waits before it starts
+#define DRIVER_THROTTLE_CHANNEL 2
+#define DRIVER_STEERING_CHANNEL 3
+#define DRIVER_KILL_SWITCH_CHANNEL 4
+#define DRIVER_BRAKE_CHANNEL 5
+#define DRIVER_SWITCH_MICROSECONDS 1100
+#define DRIVER_STEERING_MICROSECONDS 2128
+#define DRIVER_START_MICROSECONDS 1100000UL
+#define DRIVER_FRAMES 150
+//main_driver.c's worst case from the last frame to the relays turning off
+#define DRIVER_RELAY_LIMIT_MILLISECONDS 91
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+
+typedef struct Stream_Line Stream_Line;
+typedef struct Decode_Results Decode_Results;
+
+struct Stream_Line
+{
+    unsigned long long startCycle;
+    unsigned int numberOfBytes;
+    uint8_t bytes[MAX_LINE_BYTES];
+};
+
+struct Decode_Results
+{
+    //the Updates that had a new frame, the ones where that frame was not a whole frame in
+    //the stream (or was older than the last one), and the ones that had no new frame even
+    //though a whole frame had ended since the last Update
+    unsigned int published;
+    unsigned int wrong;
+    unsigned int missed;
+    int lastMatchedLine;
+    unsigned long long lastUpdateCycle;
+    //the longest time from a frame's last byte to the Update that first had it
+    unsigned long long worstLatencyCycles;
+    //when signalValid went from 1 to 0 (the first 2 times), and back to 1 the first time
+    unsigned long long lostCycles[2];
+    unsigned int numberOfLosses;
+    unsigned long long recoveredCycle;
+    int wasValid;
+};
+
+//from main_driver.c (built with RECEIVER_SBUS, see the Makefile)
+void Hovercraft_Initialize(void);
+
+static Stream_Line Lines[MAX_LINES];
+static unsigned int NumberOfLines;
+//whether each line was published by an Update
+static int LinePublished[MAX_LINES];
+
+static Serial_Receiver Receiver;
+static Decode_Results Results;
+static int Failures;
+
+static int U1RXSite;
+static int UpdateSite;
+
+static void Interrupt_Entry(unsigned int vector)
+{
+    if (vector == PIC24_SIM_VECTOR_U1RX)
+    {
+        CYCLE_COUNTER_BEGIN(U1RXSite);
+    }
+}
+
+static void Interrupt_Exit(unsigned int vector)
+{
+    if (vector == PIC24_SIM_VECTOR_U1RX)
+    {
+        CYCLE_COUNTER_END(U1RXSite);
+    }
+}
+
+static void Check(const char* name, int passed)
+{
+    printf("    %-60s %s\n", name, passed ? "ok" : "FAILED");
+    if (!passed)
+    {
+        ++Failures;
+    }
+}
+
+//Frames
+
+//a frame's channels, read one bit at a time (nothing shared with SerialReceiver.c)
+static unsigned int Reference_Channel(const uint8_t* frame, unsigned int channel)
+{
+    unsigned int value = 0;
+    unsigned int bit;
+
+    for (bit = 0; bit < 11; ++bit)
+    {
+        unsigned int position = channel * 11 + bit;
+
+        if (frame[1 + position / 8] & (1 << (position % 8)))
+        {
+            value |= 1 << bit;
+        }
+    }
+    return value;
+}
+
+static void Pack_Frame(const unsigned int* channels, unsigned int flags, unsigned int end, uint8_t* frame)
+{
+    unsigned int channel;
+    unsigned int bit;
+
+    memset(frame, 0, SERIAL_RECEIVER_FRAME_SIZE);
+    frame[0] = SERIAL_RECEIVER_HEADER;
+    for (channel = 0; channel < SERIAL_RECEIVER_CHANNELS; ++channel)
+    {
+        for (bit = 0; bit < 11; ++bit)
+        {
+            unsigned int position = channel * 11 + bit;
+
+            if (channels[channel] & (1 << bit))
+            {
+                frame[1 + position / 8] |= 1 << (position % 8);
+            }
+        }
+    }
+    frame[23] = flags;
+    frame[24] = end;
+}
+
+//whether a line is exactly one frame that a receiver would send
+static int Line_Is_Frame(const Stream_Line* line)
+{
+    const uint8_t* frame = line->bytes;
+
+    return line->numberOfBytes == SERIAL_RECEIVER_FRAME_SIZE && frame[0] == SERIAL_RECEIVER_HEADER
+        && (frame[23] & 0xF0) == 0 && (frame[24] == 0x00 || (frame[24] & 0x0F) == 0x04);
+}
+
+static unsigned long long Byte_Cycle(const Stream_Line* line, unsigned int byte)
+{
+    return line->startCycle + (byte + 1) * BYTE_CYCLES;
+}
+
+static unsigned long long Line_End_Cycle(const Stream_Line* line)
+{
+    return Byte_Cycle(line, line->numberOfBytes - 1);
+}
+
+//returns 1 if the frame Update last decoded is this line's
+static int Line_Matches(const Stream_Line* line)
+{
+    unsigned int i;
+
+    for (i = 0; i < SERIAL_RECEIVER_CHANNELS; ++i)
+    {
+        if (Receiver.channels[i] != Reference_Channel(line->bytes, i))
+        {
+            return false;
+        }
+    }
+    return Receiver.flags == line->bytes[23];
+}
+
+//Streams
+
+static int Load_Stream(const char* fileName)
+{
+    FILE* file = fopen(fileName, "r");
+    char text[512];
+    unsigned long lineNumber = 0;
+    unsigned long long previousEndCycle = 0;
+
+    NumberOfLines = 0;
+    memset(LinePublished, 0, sizeof(LinePublished));
+    if (file == NULL)
+    {
+        perror(fileName);
+        return false;
+    }
+
+    while (fgets(text, sizeof(text), file) != NULL)
+    {
+        Stream_Line* line = &Lines[NumberOfLines];
+        unsigned long microseconds;
+        unsigned int byte;
+        char* next;
+        char* end;
+
+        ++lineNumber;
+        if (text[0] == '#' || text[0] == '\n')
+        {
+            continue;
+        }
+
+        microseconds = strtoul(text, &next, 10);
+        line->startCycle = (unsigned long long)microseconds * CYCLES_PER_MICROSECOND;
+        line->numberOfBytes = 0;
+        while ((byte = strtoul(next, &end, 16)), end != next && line->numberOfBytes < MAX_LINE_BYTES && byte <= 0xFF)
+        {
+            line->bytes[line->numberOfBytes++] = byte;
+            next = end;
+        }
+
+        if (next == text || line->numberOfBytes == 0 || *next != '\n' || line->startCycle < previousEndCycle || NumberOfLines == MAX_LINES - 1)
+        {
+            fprintf(stderr, "%s:%lu: expected <microseconds> <byte> <byte> ... (up to %d bytes, after the line before)\n", fileName, lineNumber, MAX_LINE_BYTES);
+            fclose(file);
+            return false;
+        }
+        previousEndCycle = Line_End_Cycle(line);
+        ++NumberOfLines;
+    }
+
+    fclose(file);
+    return true;
+}
+
+static unsigned long long Stream_End_Cycle(void)
+{
+    return NumberOfLines > 0 ? Line_End_Cycle(&Lines[NumberOfLines - 1]) : 0;
+}
+
+//Runs the simulator until endCycle, giving every byte to UART1 when its last stop bit ends
+//and calling Step every stepCycles.
+static void Play_Stream(void (*Step)(void), unsigned long long stepCycles, unsigned long long endCycle)
+{
+    unsigned long long nextStepCycle = PIC24_Sim_Now() + stepCycles;
+    unsigned int line = 0;
+    unsigned int byte = 0;
+
+    while (nextStepCycle <= endCycle)
+    {
+        if (line < NumberOfLines && Byte_Cycle(&Lines[line], byte) <= nextStepCycle)
+        {
+            PIC24_Sim_Run_Until(Byte_Cycle(&Lines[line], byte));
+            PIC24_Sim_UART_Receive(Lines[line].bytes[byte]);
+            if (++byte == Lines[line].numberOfBytes)
+            {
+                ++line;
+                byte = 0;
+            }
+        }
+        else
+        {
+            PIC24_Sim_Run_Until(nextStepCycle);
+            Step();
+            nextStepCycle += stepCycles;
+        }
+    }
+}
+
+//Decoding
+
+static void Reset_Receiver(void)
+{
+    PIC24_Sim_Reset();
+    Serial_Receiver_Initialize(&Receiver);
+    Receiver.signalTimeoutTicks = SERIAL_RECEIVER_MILLISECONDS_TO_TICKS(SIGNAL_TIMEOUT_MILLISECONDS);
+
+    memset(&Results, 0, sizeof(Results));
+    Results.lastMatchedLine = -1;
+}
+
+static void Check_Published(void)
+{
+    unsigned long long now = PIC24_Sim_Now();
+    int newFrame = false;
+    int i;
+
+    for (i = 0; i < (int)NumberOfLines; ++i)
+    {
+        unsigned long long endCycle = Line_End_Cycle(&Lines[i]);
+
+        if (Line_Is_Frame(&Lines[i]) && endCycle > Results.lastUpdateCycle && endCycle <= now)
+        {
+            newFrame = true;
+        }
+    }
+    Results.lastUpdateCycle = now;
+
+    if (Receiver.framesMeasured == 0)
+    {
+        if (newFrame)
+        {
+            ++Results.missed;
+        }
+        return;
+    }
+    ++Results.published;
+
+    //the newest whole frame that has ended and has these channels
+    for (i = (int)NumberOfLines - 1; i >= 0; --i)
+    {
+        if (Line_Is_Frame(&Lines[i]) && Line_End_Cycle(&Lines[i]) <= now && Line_Matches(&Lines[i]))
+        {
+            break;
+        }
+    }
+
+    if (i < 0 || i <= Results.lastMatchedLine)
+    {
+        ++Results.wrong;
+        return;
+    }
+
+    Results.lastMatchedLine = i;
+    LinePublished[i] = true;
+    if (now - Line_End_Cycle(&Lines[i]) > Results.worstLatencyCycles)
+    {
+        Results.worstLatencyCycles = now - Line_End_Cycle(&Lines[i]);
+    }
+}
+
+static void Receiver_Step(void)
+{
+    Serial_Receiver_Update(&Receiver);
+    Check_Published();
+
+    if (Results.wasValid && !Receiver.signalValid && Results.numberOfLosses < 2)
+    {
+        Results.lostCycles[Results.numberOfLosses++] = PIC24_Sim_Now();
+    }
+    else if (!Results.wasValid && Receiver.signalValid && Results.numberOfLosses > 0 && Results.recoveredCycle == 0)
+    {
+        Results.recoveredCycle = PIC24_Sim_Now();
+    }
+    Results.wasValid = Receiver.signalValid;
+}
+
+//plays a stream from STREAM_FOLDER, calling Serial_Receiver_Update every UPDATE_MILLISECONDS
+static int Run_Stream(const char* name)
+{
+    char fileName[256];
+
+    printf("%s:\n", name);
+    snprintf(fileName, sizeof(fileName), "%s/%s", STREAM_FOLDER, name);
+    if (!Load_Stream(fileName))
+    {
+        Check("the stream was read", false);
+        printf("\n");
+        return false;
+    }
+
+    Reset_Receiver();
+    Play_Stream(Receiver_Step, UPDATE_CYCLES, Stream_End_Cycle() + AFTER_STREAM_MILLISECONDS * (unsigned long long)CYCLES_PER_MILLISECOND);
+    return true;
+}
+
+static unsigned int Whole_Frames(void)
+{
+    unsigned int frames = 0;
+    unsigned int i;
+
+    for (i = 0; i < NumberOfLines; ++i)
+    {
+        frames += Line_Is_Frame(&Lines[i]);
+    }
+    return frames;
+}
+
+static void Print_Results(void)
+{
+    printf("    %u lines (%u whole frames), %u published, %u bytes skipped, %u overruns, %u frames flagged lost\n",
+        NumberOfLines, Whole_Frames(), Results.published, Receiver.skippedBytes, Receiver.overruns, Receiver.lostFrames);
+    printf("    worst latency from a frame's last byte to Serial_Receiver_Update %.1f ms\n", (double)Results.worstLatencyCycles / CYCLES_PER_MILLISECOND);
+}
+
+//Tests
+
+static void Test_Sweep(void)
+{
+    Serial_Receiver steps;
+    IC_Fixed_Module channel;
+    unsigned int value;
+    unsigned int distinctSteps = 0;
+    Q15 previousDutyCycle = 0;
+    double pulseMicroseconds;
+    double expectedDutyCycle;
+
+    if (!Run_Stream("sbus_sweep.txt"))
+    {
+        return;
+    }
+    Print_Results();
+
+    //the last frame read as a PWM input, the duty cycle its pulse width has in a 20ms frame
+    Serial_Receiver_Read_Channel(&Receiver, 0, &channel);
+    pulseMicroseconds = 880 + Receiver.channels[0] * 0.625;
+    expectedDutyCycle = pulseMicroseconds * Q15_ONE / (SERIAL_RECEIVER_CHANNEL_PERIOD_MILLISECONDS * 1000);
+    printf("    channel 0 as an IC_Fixed_Module:  dutyCycle %u (a %.3fus pulse in 20ms is %.2f)\n", channel.dutyCycle, pulseMicroseconds, expectedDutyCycle);
+
+    //every step from 988us to 2012us, which a 16us capture tick only has 64 of
+    steps = Receiver;
+    steps.signalValid = true;
+    for (value = CHANNEL_MINIMUM; value <= CHANNEL_MAXIMUM; ++value)
+    {
+        steps.channels[0] = value;
+        Serial_Receiver_Read_Channel(&steps, 0, &channel);
+        if (value == CHANNEL_MINIMUM || channel.dutyCycle > previousDutyCycle)
+        {
+            ++distinctSteps;
+        }
+        previousDutyCycle = channel.dutyCycle;
+    }
+    printf("    %u different duty cycles from %d to %d (%d SBUS steps)\n", distinctSteps, CHANNEL_MINIMUM, CHANNEL_MAXIMUM, CHANNEL_MAXIMUM - CHANNEL_MINIMUM + 1);
+
+    Serial_Receiver_Read_Channel(&Receiver, 0, &channel);
+    Check("every published frame was a whole frame in the stream", Results.wrong == 0);
+    Check("every Update after a new frame published it", Results.missed == 0);
+    Check("nothing skipped or lost", Receiver.skippedBytes == 0 && Receiver.overruns == 0 && Receiver.lostFrames == 0);
+    Check("a frame is published within 1 Update of its last byte", Results.worstLatencyCycles <= UPDATE_CYCLES);
+    Check("Serial_Receiver_Read_Channel's duty cycle", channel.dutyCycle >= expectedDutyCycle - 0.5 && channel.dutyCycle <= expectedDutyCycle + 0.5);
+    Check("every SBUS step is a different duty cycle", distinctSteps == CHANNEL_MAXIMUM - CHANNEL_MINIMUM + 1);
+    printf("\n");
+}
+
+static void Test_Noise(void)
+{
+    unsigned int expectedSkippedBytes = 0;
+    unsigned int expectedLostFrames = 0;
+    int sbus2Published = false;
+    unsigned int i;
+
+    if (!Run_Stream("sbus_noise.txt"))
+    {
+        return;
+    }
+    Print_Results();
+
+    //every byte that is not part of a whole frame (the stream ends on a whole frame)
+    for (i = 0; i < NumberOfLines; ++i)
+    {
+        if (!Line_Is_Frame(&Lines[i]))
+        {
+            expectedSkippedBytes += Lines[i].numberOfBytes;
+        }
+        else if (Lines[i].bytes[23] & SERIAL_RECEIVER_FLAG_FRAME_LOST)
+        {
+            ++expectedLostFrames;
+        }
+        else if (Lines[i].bytes[24] == SBUS2_END && LinePublished[i])
+        {
+            sbus2Published = true;
+        }
+    }
+
+    Check("every published frame was a whole frame in the stream", Results.wrong == 0);
+    Check("every Update after a new frame published it", Results.missed == 0);
+    Check("every byte outside a whole frame was skipped", Receiver.skippedBytes == expectedSkippedBytes);
+    Check("the frame flagged lost was counted", Receiver.lostFrames == expectedLostFrames);
+    Check("the SBUS2 frame was published", sbus2Published);
+    printf("\n");
+}
+
+static void Test_Failsafe(void)
+{
+    unsigned long long failsafeCycle = 0;
+    unsigned long long clearedCycle = 0;
+    unsigned long long lastByteCycle;
+    unsigned int i;
+
+    if (!Run_Stream("sbus_failsafe.txt"))
+    {
+        return;
+    }
+    Print_Results();
+
+    //the first frame with the failsafe flag, and the first one after those without it
+    for (i = 0; i < NumberOfLines; ++i)
+    {
+        if (!Line_Is_Frame(&Lines[i]))
+        {
+            continue;
+        }
+        if ((Lines[i].bytes[23] & SERIAL_RECEIVER_FLAG_FAILSAFE) && failsafeCycle == 0)
+        {
+            failsafeCycle = Line_End_Cycle(&Lines[i]);
+        }
+        else if (!(Lines[i].bytes[23] & SERIAL_RECEIVER_FLAG_FAILSAFE) && failsafeCycle != 0 && clearedCycle == 0)
+        {
+            clearedCycle = Line_End_Cycle(&Lines[i]);
+        }
+    }
+    lastByteCycle = Stream_End_Cycle();
+
+    if (Results.numberOfLosses == 2 && Results.recoveredCycle != 0)
+    {
+        printf("    signal lost %.1f ms after the failsafe flag, valid again %.1f ms after it cleared, and lost %.1f ms after the last byte\n",
+            (double)(Results.lostCycles[0] - failsafeCycle) / CYCLES_PER_MILLISECOND, (double)(Results.recoveredCycle - clearedCycle) / CYCLES_PER_MILLISECOND,
+            (double)(Results.lostCycles[1] - lastByteCycle) / CYCLES_PER_MILLISECOND);
+    }
+
+    Check("every published frame was a whole frame in the stream", Results.wrong == 0);
+    Check("signalValid went to 0 within 1 Update of the failsafe flag", Results.numberOfLosses > 0 && Results.lostCycles[0] <= failsafeCycle + UPDATE_CYCLES);
+    Check("signalValid came back within 1 Update of the flag clearing", Results.recoveredCycle != 0 && Results.recoveredCycle <= clearedCycle + UPDATE_CYCLES);
+    Check("signalValid went to 0 within the timeout and 1 Update", Results.numberOfLosses == 2 && Results.lostCycles[1] <= lastByteCycle + (SIGNAL_TIMEOUT_MILLISECONDS + 1) * (unsigned long long)CYCLES_PER_MILLISECOND + UPDATE_CYCLES);
+    printf("\n");
+}
+
+static void Test_Fast_Mode(void)
+{
+    if (!Run_Stream("sbus_fast.txt"))
+    {
+        return;
+    }
+    Print_Results();
+
+    Check("every published frame was a whole frame in the stream", Results.wrong == 0);
+    Check("every Update after a new frame published it", Results.missed == 0);
+    Check("nothing skipped or lost", Receiver.skippedBytes == 0 && Receiver.overruns == 0);
+    printf("\n");
+}
+
+static void Cost_Step(void)
+{
+    static IC_Fixed_Module inputs[4];
+    unsigned int i;
+
+    CYCLE_COUNTER_BEGIN(UpdateSite);
+    Serial_Receiver_Update(&Receiver);
+    for (i = 0; i < 4; ++i)
+    {
+        Serial_Receiver_Read_Channel(&Receiver, i, &inputs[i]);
+    }
+    CYCLE_COUNTER_END(UpdateSite);
+}
+
+//(traced by the cycle counter)
+static void Interrupt_Workload(void)
+{
+    Reset_Receiver();
+
+    PIC24_Sim_Interrupt_Entry_Hook = Interrupt_Entry;
+    PIC24_Sim_Interrupt_Exit_Hook = Interrupt_Exit;
+    Play_Stream(Cost_Step, UPDATE_CYCLES, Stream_End_Cycle());
+    PIC24_Sim_Interrupt_Entry_Hook = NULL;
+    PIC24_Sim_Interrupt_Exit_Hook = NULL;
+}
+
+static void Test_Interrupts(void)
+{
+    char fileName[256];
+    const Cycle_Counter_Site* interrupt;
+    const Cycle_Counter_Site* update;
+    double seconds;
+    unsigned int frames;
+
+    printf("interrupts:\n");
+    snprintf(fileName, sizeof(fileName), "%s/%s", STREAM_FOLDER, "sbus_sweep.txt");
+    if (!Load_Stream(fileName))
+    {
+        Check("the stream was read", false);
+        printf("\n");
+        return;
+    }
+    seconds = (double)Stream_End_Cycle() / FCY;
+    frames = Whole_Frames();
+
+    U1RXSite = Cycle_Counter_Register_Site("_U1RXInterrupt", true);
+    UpdateSite = Cycle_Counter_Register_Site("Serial_Receiver_Update + 4 Serial_Receiver_Read_Channel", false);
+    if (Cycle_Counter_Run(Interrupt_Workload) != 0)
+    {
+        printf("    (instruction cycles cannot be counted on this host)\n\n");
+        return;
+    }
+    interrupt = Cycle_Counter_Get_Site(U1RXSite);
+    update = Cycle_Counter_Get_Site(UpdateSite);
+
+    printf("    %.1f s of SBUS frames every 14ms\n", seconds);
+    printf("    %-30s %6.1f interrupts/s (%.1f a frame), %8.0f cycles/s (%.2f%% of the CPU), worst %lu cycles\n", "U1RX",
+        interrupt->calls / seconds, (double)interrupt->calls / frames, interrupt->totalCycles / seconds, 100.0 * interrupt->totalCycles / seconds / FCY, interrupt->maximumCycles);
+    printf("    %-30s %6.0f cycles (worst %lu) every 20ms\n", "update", update->calls ? (double)update->totalCycles / update->calls : 0.0, update->maximumCycles);
+
+    //3 bytes an interrupt, and 1 more when what one frame left in the FIFO for Update is
+    //read along with the next frame instead
+    Check("at most 9 interrupts a frame", interrupt->calls <= frames * (SERIAL_RECEIVER_FRAME_SIZE / 3 + 1));
+    printf("\n");
+}
+
+//what main_driver.c's outputs did, watched every scheduler tick
+static unsigned long long DriverLastByteCycle;
+static unsigned long long RelaysOffCycle;
+static unsigned int FirstServoPulse;
+static unsigned int LastServoPulse;
+static int RelaysWereOn;
+
+static void Driver_Step(void)
+{
+    Scheduler_Run_Pending();
+
+    if (PIC24_Sim_Now() < DriverLastByteCycle)
+    {
+        if (LATAbits.LATA0 && LATAbits.LATA1)
+        {
+            if (!RelaysWereOn)
+            {
+                FirstServoPulse = OC1R;
+            }
+            RelaysWereOn = true;
+            LastServoPulse = OC1R;
+        }
+    }
+    else if (RelaysOffCycle == 0 && !LATAbits.LATA0 && !LATAbits.LATA1)
+    {
+        RelaysOffCycle = PIC24_Sim_Now();
+    }
+}
+
+static void Test_Main_Driver(void)
+{
+    char fileName[256];
+
+    printf("main_driver.c with RECEIVER_SBUS:\n");
+    snprintf(fileName, sizeof(fileName), "%s/%s", STREAM_FOLDER, "sbus_flight.txt");
+    if (!Load_Stream(fileName))
+    {
+        Check("the stream was read", false);
+        printf("\n");
+        return;
+    }
+    DriverLastByteCycle = Stream_End_Cycle();
+
+    //the stream starts after the 1 second main_driver.c waits before it starts
+    PIC24_Sim_Reset();
+    Hovercraft_Initialize();
+    Play_Stream(Driver_Step, SCHEDULER_TICK_CYCLES, DriverLastByteCycle + AFTER_STREAM_MILLISECONDS * (unsigned long long)CYCLES_PER_MILLISECOND);
+
+    printf("    throttle servo:  OC1R = %u when the relays turned on, %u at the last frame\n", FirstServoPulse, LastServoPulse);
+    if (RelaysOffCycle != 0)
+    {
+        printf("    relays off %.1f ms after the last byte\n", (double)(RelaysOffCycle - DriverLastByteCycle) / CYCLES_PER_MILLISECOND);
+    }
+
+    Check("the relays turned on", RelaysWereOn);
+    Check("the throttle servo followed the throttle channel", LastServoPulse > FirstServoPulse);
+    Check("the failsafe turned the relays off in time", RelaysOffCycle != 0 && RelaysOffCycle <= DriverLastByteCycle + DRIVER_RELAY_LIMIT_MILLISECONDS * (unsigned long long)CYCLES_PER_MILLISECOND);
+    printf("\n");
+}
+
+//Printing a stream
+
+static void Print_Step(void)
+{
+    unsigned int i;
+
+    Serial_Receiver_Update(&Receiver);
+    if (Receiver.framesMeasured == 0)
+    {
+        return;
+    }
+
+    printf("%10.1f", (double)PIC24_Sim_Now() / CYCLES_PER_MILLISECOND);
+    for (i = 0; i < SERIAL_RECEIVER_CHANNELS; ++i)
+    {
+        printf(" %4u", Receiver.channels[i]);
+    }
+    printf("  %02X%s\n", Receiver.flags, Receiver.signalValid ? "" : "  (signal lost)");
+}
+
+static int Print_Stream(const char* fileName)
+{
+    if (!Load_Stream(fileName))
+    {
+        return false;
+    }
+
+    printf("#  time ms  channels 0 - 15 of the newest frame at every Update, and its flags\n");
+    Reset_Receiver();
+    Play_Stream(Print_Step, UPDATE_CYCLES, Stream_End_Cycle() + UPDATE_CYCLES);
+    printf("# %u whole frames, %u bytes skipped, %u overruns, %u frames flagged lost\n", Whole_Frames(), Receiver.skippedBytes, Receiver.overruns, Receiver.lostFrames);
+    return true;
+}
+
+//Generating the test streams
+
+static void Write_Line(FILE* file, unsigned long microseconds, const uint8_t* bytes, unsigned int numberOfBytes)
+{
+    unsigned int i;
+
+    fprintf(file, "%lu", microseconds);
+    for (i = 0; i < numberOfBytes; ++i)
+    {
+        fprintf(file, " %02X", bytes[i]);
+    }
+    fprintf(file, "\n");
+}
+
+static void Write_Frame(FILE* file, unsigned long microseconds, const unsigned int* channels, unsigned int flags, unsigned int end)
+{
+    uint8_t frame[SERIAL_RECEIVER_FRAME_SIZE];
+
+    Pack_Frame(channels, flags, end, frame);
+    Write_Line(file, microseconds, frame, SERIAL_RECEIVER_FRAME_SIZE);
+}
+
+//the channels of a frame that changes every frame, over the whole range
+static void Sweep_Channels(unsigned int frame, unsigned int* channels)
+{
+    unsigned int i;
+
+    for (i = 0; i < SERIAL_RECEIVER_CHANNELS; ++i)
+    {
+        channels[i] = CHANNEL_MINIMUM + (frame * 37 + i * 211) % (CHANNEL_MAXIMUM - CHANNEL_MINIMUM + 1);
+    }
+}
+
+//writes frames from firstFrame up to lastFrame, every frameMicroseconds from *microseconds
+static void Write_Sweep(FILE* file, unsigned long* microseconds, unsigned int firstFrame, unsigned int lastFrame, unsigned long frameMicroseconds)
+{
+    unsigned int channels[SERIAL_RECEIVER_CHANNELS];
+    unsigned int frame;
+
+    for (frame = firstFrame; frame < lastFrame; ++frame)
+    {
+        Sweep_Channels(frame, channels);
+        //channel 17 switched on and off every 5 frames
+        Write_Frame(file, *microseconds, channels, (frame / 5) % 2 ? SERIAL_RECEIVER_FLAG_CHANNEL_17 : 0, 0x00);
+        *microseconds += frameMicroseconds;
+    }
+}
+
+static void Generate_Sweep(FILE* file)
+{
+    unsigned long microseconds = 1000;
+
+    fprintf(file, "# 200 frames every 14ms, with all 16 channels changing every frame\n");
+    Write_Sweep(file, &microseconds, 0, 200, FRAME_MICROSECONDS);
+}
+
+static void Generate_Noise(FILE* file)
+{
+    static const uint8_t garbage[] = { 0x0F, 0x00, 0x0F, 0x55, 0xF0, 0x0F, 0x04, 0x00, 0x23, 0x0F };
+    unsigned int channels[SERIAL_RECEIVER_CHANNELS];
+    uint8_t frame[SERIAL_RECEIVER_FRAME_SIZE];
+    unsigned long microseconds = 1000;
+
+    fprintf(file, "# the receiver turned on in the middle of a frame\n");
+    Sweep_Channels(0, channels);
+    Pack_Frame(channels, 0, 0x00, frame);
+    Write_Line(file, microseconds, frame + 13, SERIAL_RECEIVER_FRAME_SIZE - 13);
+    microseconds += FRAME_MICROSECONDS;
+    Write_Sweep(file, &microseconds, 1, 21, FRAME_MICROSECONDS);
+
+    fprintf(file, "# noise on the wire\n");
+    Write_Line(file, microseconds, garbage, sizeof(garbage));
+    microseconds += FRAME_MICROSECONDS;
+    Write_Sweep(file, &microseconds, 21, 41, FRAME_MICROSECONDS);
+
+    fprintf(file, "# a frame missing a byte (one the UART threw out for a parity error)\n");
+    Sweep_Channels(41, channels);
+    Pack_Frame(channels, 0, 0x00, frame);
+    memmove(frame + 7, frame + 8, SERIAL_RECEIVER_FRAME_SIZE - 8);
+    Write_Line(file, microseconds, frame, SERIAL_RECEIVER_FRAME_SIZE - 1);
+    microseconds += FRAME_MICROSECONDS;
+    Write_Sweep(file, &microseconds, 42, 52, FRAME_MICROSECONDS);
+
+    fprintf(file, "# a frame with a bad end byte\n");
+    Sweep_Channels(52, channels);
+    Write_Frame(file, microseconds, channels, 0, 0x01);
+    microseconds += FRAME_MICROSECONDS;
+    Write_Sweep(file, &microseconds, 53, 63, FRAME_MICROSECONDS);
+
+    //each with a gap after it, so it is the only frame its Update gets
+    fprintf(file, "# an SBUS2 frame\n");
+    Sweep_Channels(63, channels);
+    Write_Frame(file, microseconds, channels, 0, SBUS2_END);
+    microseconds += 3 * FRAME_MICROSECONDS;
+    fprintf(file, "# a frame the receiver did not get from the transmitter\n");
+    Sweep_Channels(64, channels);
+    Write_Frame(file, microseconds, channels, SERIAL_RECEIVER_FLAG_FRAME_LOST, 0x00);
+    microseconds += 3 * FRAME_MICROSECONDS;
+    Write_Sweep(file, &microseconds, 65, 85, FRAME_MICROSECONDS);
+}
+
+static void Generate_Failsafe(FILE* file)
+{
+    unsigned int channels[SERIAL_RECEIVER_CHANNELS];
+    uint8_t frame[SERIAL_RECEIVER_FRAME_SIZE];
+    unsigned long microseconds = 1000;
+    unsigned int i;
+
+    Write_Sweep(file, &microseconds, 0, 40, FRAME_MICROSECONDS);
+
+    fprintf(file, "# the receiver lost the transmitter, and sends its failsafe positions\n");
+    for (i = 0; i < SERIAL_RECEIVER_CHANNELS; ++i)
+    {
+        channels[i] = CHANNEL_CENTER;
+    }
+    for (i = 0; i < 20; ++i)
+    {
+        Write_Frame(file, microseconds, channels, SERIAL_RECEIVER_FLAG_FRAME_LOST | SERIAL_RECEIVER_FLAG_FAILSAFE, 0x00);
+        microseconds += FRAME_MICROSECONDS;
+    }
+
+    fprintf(file, "# the transmitter is back\n");
+    Write_Sweep(file, &microseconds, 60, 100, FRAME_MICROSECONDS);
+
+    fprintf(file, "# the wire cut in the middle of a frame\n");
+    Sweep_Channels(100, channels);
+    Pack_Frame(channels, 0, 0x00, frame);
+    Write_Line(file, microseconds, frame, 10);
+}
+
+static void Generate_Fast(FILE* file)
+{
+    unsigned long microseconds = 1000;
+
+    fprintf(file, "# 300 frames every 7ms (a receiver's fast mode)\n");
+    Write_Sweep(file, &microseconds, 0, 300, FAST_FRAME_MICROSECONDS);
+}
+
+static void Generate_Flight(FILE* file)
+{
+    unsigned int channels[SERIAL_RECEIVER_CHANNELS];
+    unsigned long microseconds = DRIVER_START_MICROSECONDS;
+    unsigned int frame;
+    unsigned int i;
+
+    fprintf(file, "# main_driver.c's kill switch and brake off, the steering centered and the throttle\n");
+    fprintf(file, "# going from 1ms to 2ms, starting after the 1 second it waits before it starts\n");
+    for (frame = 0; frame < DRIVER_FRAMES; ++frame)
+    {
+        for (i = 0; i < SERIAL_RECEIVER_CHANNELS; ++i)
+        {
+            channels[i] = CHANNEL_CENTER;
+        }
+        channels[DRIVER_THROTTLE_CHANNEL] = MICROSECONDS_TO_CHANNEL(1000 + 1000 * frame / DRIVER_FRAMES);
+        channels[DRIVER_STEERING_CHANNEL] = MICROSECONDS_TO_CHANNEL(DRIVER_STEERING_MICROSECONDS);
+        channels[DRIVER_KILL_SWITCH_CHANNEL] = MICROSECONDS_TO_CHANNEL(DRIVER_SWITCH_MICROSECONDS);
+        channels[DRIVER_BRAKE_CHANNEL] = MICROSECONDS_TO_CHANNEL(DRIVER_SWITCH_MICROSECONDS);
+        Write_Frame(file, microseconds, channels, 0, 0x00);
+        microseconds += FRAME_MICROSECONDS;
+    }
+}
+
+static const struct
+{
+    const char* name;
+    void (*Generate)(FILE* file);
+} Streams[] =
+{
+    { "sbus_sweep.txt", Generate_Sweep },
+    { "sbus_noise.txt", Generate_Noise },
+    { "sbus_failsafe.txt", Generate_Failsafe },
+    { "sbus_fast.txt", Generate_Fast },
+    { "sbus_flight.txt", Generate_Flight },
+};
+
+static int Generate_Streams(const char* folder)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(Streams) / sizeof(Streams[0]); ++i)
+    {
+        char fileName[256];
+        FILE* file;
+
+        snprintf(fileName, sizeof(fileName), "%s/%s", folder, Streams[i].name);
+        file = fopen(fileName, "w");
+        if (file == NULL)
+        {
+            perror(fileName);
+            return false;
+        }
+
+        fprintf(file, "# SBUS byte stream (see sbus_receiver.c):  <microseconds> <byte> <byte> ...\n");
+        Streams[i].Generate(file);
+        fclose(file);
+        printf("wrote %s\n", fileName);
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--stream") == 0)
+    {
+        return Print_Stream(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc == 3 && strcmp(argv[1], "--generate") == 0)
+    {
+        return Generate_Streams(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        fprintf(stderr, "       %s --stream <file>\n", argv[0]);
+        fprintf(stderr, "       %s --generate <folder>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Test_Sweep();
+    Test_Noise();
+    Test_Failsafe();
+    Test_Fast_Mode();
+    Test_Interrupts();
+    Test_Main_Driver();
+
+    if (Failures != 0)
+    {
+        printf("%d checks FAILED\n", Failures);
+        return EXIT_FAILURE;
+    }
+    printf("every check passed\n");
+    return EXIT_SUCCESS;
+}
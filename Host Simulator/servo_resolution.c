@@ -0,0 +1,175 @@
+/*
+ * File:    servo_resolution.c
+ * Author:  Zachary Downum
+ */
+
+//Shows which clock PWM_Servo picks for each frame rate, and how many steps a 1 - 2ms servo
+//pulse gets compared to timer1's clock.  Every pulse width from 1000us to 2000us (in
+//7us steps) is set and timed on OC1's output, and the program exits with a failure if one
+//is off by more than half a tick.  It also counts the different OC1R values main_driver.c's
+//throttle servo range (1.8% - 11.8% of a 50Hz frame) can give, before and after the
+//servo is moved onto PWM_Servo's clock, and fails if that is under 10x as many.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PWM.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+
+//OC1 drives RB0, which is wired to a pin that nothing reads so that its edges are reported
+#define SERVO_OUTPUT_PIN 0
+#define SERVO_LOOPBACK_PIN 12
+
+#define SHORTEST_PULSE_MICROSECONDS 1000
+#define LONGEST_PULSE_MICROSECONDS 2000
+#define PULSE_STEP_MICROSECONDS 7
+
+//main_driver.c's throttle servo range (PROPULSION_THROTTLE_SERVO_OFFSET, plus
+//THROTTLE_INCREMENT_ADJUSTMENT_FACTOR percent)
+#define THROTTLE_SERVO_MINIMUM Q15_FROM_PERCENTAGE(1.8)
+#define THROTTLE_SERVO_MAXIMUM Q15_FROM_PERCENTAGE(11.8)
+//how many times timer1's steps the throttle servo has to get, at the profile the Finalized
+//Design is built with (CLOCK_PROFILE_FRC_PLL_32MHZ, the Makefile's default)
+#define THROTTLE_SERVO_MINIMUM_GAIN 10
+
+static PWM_Fixed_Module Servo_Output = PWM_FIXED_MODULE(1);
+static PWM_Servo Servo;
+
+static unsigned long long RiseCycle;
+static unsigned long long LastPulseCycles;
+
+static void Record_Edge(unsigned int rpPin, int level)
+{
+    if (rpPin != SERVO_OUTPUT_PIN)
+    {
+        return;
+    }
+
+    if (level)
+    {
+        RiseCycle = PIC24_Sim_Now();
+    }
+    else
+    {
+        LastPulseCycles = PIC24_Sim_Now() - RiseCycle;
+    }
+}
+
+static void Setup_Servo(uint16_t frameRate)
+{
+    PIC24_Sim_Reset();
+    ANSB = 0x0000;
+    TRISB = 0x0000;
+
+    Servo_Output.Initialize(&Servo_Output);
+    Servo_Output.frequency = frameRate;
+    Servo_Output.UpdateFrequency(&Servo_Output);
+
+    PIC24_Sim_Connect_Pins(SERVO_OUTPUT_PIN, SERVO_LOOPBACK_PIN);
+}
+
+//the number of different OC1R values UpdateDutyCycle gives across the throttle servo's range
+static unsigned int Count_Throttle_Steps(void)
+{
+    unsigned int steps = 0;
+    unsigned int previous = 0xFFFFFFFF;
+    Q15 dutyCycle;
+
+    for (dutyCycle = THROTTLE_SERVO_MINIMUM; dutyCycle <= THROTTLE_SERVO_MAXIMUM; ++dutyCycle)
+    {
+        Servo_Output.dutyCycle = dutyCycle;
+        Servo_Output.UpdateDutyCycle(&Servo_Output);
+        if (OC1R != previous)
+        {
+            ++steps;
+            previous = OC1R;
+        }
+    }
+
+    return steps;
+}
+
+//returns the largest difference between a set and a measured pulse width, in ticks
+static double Measure_Pulse_Widths(void)
+{
+    double largestError = 0;
+    unsigned long long frameCycles = (unsigned long long)FCY / Servo.frameRate;
+    unsigned int microseconds;
+
+    PIC24_Sim_Output_Edge_Hook = Record_Edge;
+    for (microseconds = SHORTEST_PULSE_MICROSECONDS; microseconds <= LONGEST_PULSE_MICROSECONDS; microseconds += PULSE_STEP_MICROSECONDS)
+    {
+        double errorTicks;
+
+        PWM_Servo_Set_Pulse_Width(&Servo, microseconds);
+        //the pulse after the next frame starts is the first one that is all new
+        PIC24_Sim_Run_For(2 * frameCycles);
+
+        errorTicks = ((double)LastPulseCycles / CYCLES_PER_MICROSECOND - microseconds) * CYCLES_PER_MICROSECOND / (1UL << Servo.clockShift);
+        if (errorTicks < 0)
+        {
+            errorTicks = -errorTicks;
+        }
+        if (errorTicks > largestError)
+        {
+            largestError = errorTicks;
+        }
+    }
+    PIC24_Sim_Output_Edge_Hook = NULL;
+
+    return largestError;
+}
+
+int main(void)
+{
+    static const uint16_t frameRates[] = { 50, 200, 333 };
+    int allWithinHalfTick = true;
+    unsigned int throttleStepsBefore;
+    unsigned int throttleStepsAfter;
+    unsigned int i;
+
+    printf("PWM_Servo on OC1, Fcy = %lu Hz:\n", (unsigned long)FCY);
+    printf("    %-9s %-10s %8s %10s %16s %14s\n", "frame", "clock", "ticks", "us/tick", "1-2ms steps", "largest error");
+
+    for (i = 0; i < sizeof(frameRates) / sizeof(frameRates[0]); ++i)
+    {
+        unsigned int timer1Steps;
+        unsigned int servoSteps;
+        double largestError;
+        char clockName[16];
+
+        Setup_Servo(frameRates[i]);
+        timer1Steps = Servo_Output.periodTicks * (LONGEST_PULSE_MICROSECONDS - SHORTEST_PULSE_MICROSECONDS) / (1000000UL / frameRates[i]);
+
+        Servo.output = &Servo_Output;
+        Servo.frameRate = frameRates[i];
+        PWM_Servo_Initialize(&Servo);
+        servoSteps = PWM_Servo_Microseconds_To_Ticks(&Servo, LONGEST_PULSE_MICROSECONDS) - PWM_Servo_Microseconds_To_Ticks(&Servo, SHORTEST_PULSE_MICROSECONDS);
+        largestError = Measure_Pulse_Widths();
+
+        snprintf(clockName, sizeof(clockName), (Servo.clockShift == 0) ? "Fcy" : "Fcy / %lu", 1UL << Servo.clockShift);
+        printf("    %3u Hz    %-10s %8u %10.3f %7u (%3ux) %10.2f ticks\n", Servo.frameRate, clockName, Servo_Output.periodTicks, (double)(1UL << Servo.clockShift) / CYCLES_PER_MICROSECOND,
+            servoSteps, servoSteps / timer1Steps, largestError);
+
+        if (largestError > 0.5)
+        {
+            allWithinHalfTick = false;
+        }
+    }
+
+    //main_driver.c's throttle servo, on timer1 and then on its PWM_Servo clock
+    Setup_Servo(50);
+    throttleStepsBefore = Count_Throttle_Steps();
+    Servo.output = &Servo_Output;
+    Servo.frameRate = 50;
+    PWM_Servo_Initialize(&Servo);
+    throttleStepsAfter = Count_Throttle_Steps();
+
+    printf("main_driver.c's throttle servo range:  %u steps on timer1 (1:%u), %u steps with PWM_Servo (%.1fx, at least %ux needed)\n", throttleStepsBefore, CLOCK_TIMER1_PRESCALER, throttleStepsAfter, (double)throttleStepsAfter / throttleStepsBefore, THROTTLE_SERVO_MINIMUM_GAIN);
+
+    return allWithinHalfTick && throttleStepsAfter >= THROTTLE_SERVO_MINIMUM_GAIN * throttleStepsBefore ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,155 @@
+/*
+ * File:    stepper_motion_benchmark.c
+ * Author:  Zachary Downum
+ */
+
+//Drives the propulsion direction stepper motor through the Stepper Motion dependency
+//in the simulator, with OC2's step signal wired back into IC4 (the way the step count
+//is measured on the hovercraft), and reports how long each 90 and 180 degree move
+//takes and where the motor stopped.
+//--constant runs every move at the 400Hz that main_driver.c's old loop used.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PWM.h"
+#include "InputCapture.h"
+#include "StepperMotion.h"
+
+#define CYCLES_PER_MILLISECOND (FCY / 1000)
+
+//the same values main_driver.c uses
+#define STEPPER_START_STEP_RATE 400
+#define STEPPER_MAXIMUM_STEP_RATE 1600
+#define STEPPER_ACCELERATION 4000
+#define STEPPER_UPDATE_RATE 500
+
+#define COUNTS_FOR_90_DEGREE_TURN 706
+#define COUNTS_FOR_180_DEGREE_TURN 1412
+
+//OC2 drives RB1, IC4 listens on RP7
+#define STEP_OUTPUT_PIN 1
+#define STEP_COUNT_PIN 7
+
+//a move that takes longer than this is reported as not finishing
+#define MOVE_TIMEOUT_MILLISECONDS 10000
+
+static PWM_Fixed_Module Step_Output;
+static Count_Monitor Step_Counter;
+static Stepper_Motion Motion;
+
+//the biggest change in step rate (steps/s) seen between two Updates, used to check that
+//the step rate never changes faster than STEPPER_ACCELERATION allows
+static unsigned int LargestRateChange;
+
+//moves to firstTargetPosition, but changes the target to targetPosition after
+//changeAfterMilliseconds (pass the same target twice for a plain move)
+static int Run_Move(const char* name, int firstTargetPosition, int targetPosition, unsigned long changeAfterMilliseconds)
+{
+    int startPosition = Motion.position;
+    unsigned long milliseconds = 0;
+    unsigned int previousRate = 0;
+
+    Stepper_Motion_Set_Target(&Motion, firstTargetPosition);
+
+    do
+    {
+        if (milliseconds == changeAfterMilliseconds)
+        {
+            Stepper_Motion_Set_Target(&Motion, targetPosition);
+        }
+
+
+        PIC24_Sim_Run_For(CYCLES_PER_MILLISECOND * 1000 / STEPPER_UPDATE_RATE);
+        milliseconds += 1000 / STEPPER_UPDATE_RATE;
+
+        Stepper_Motion_Update(&Motion);
+
+        if (previousRate != 0 && Motion.stepRate != 0)
+        {
+            unsigned int change = (Motion.stepRate > previousRate) ? Motion.stepRate - previousRate : previousRate - Motion.stepRate;
+
+            if (change > LargestRateChange)
+            {
+                LargestRateChange = change;
+            }
+        }
+        previousRate = Motion.stepRate;
+    } while ((Stepper_Motion_Is_Moving(&Motion) || Motion.position != targetPosition) && milliseconds < MOVE_TIMEOUT_MILLISECONDS);
+
+    //lets any step that was still on its way out finish, so an overshoot would show up
+    PIC24_Sim_Run_For(10 * CYCLES_PER_MILLISECOND);
+    Step_Counter.Update(&Step_Counter);
+
+    printf("    %-22s %5d -> %5d:  %5lu ms, stopped at %5d%s\n", name, startPosition, targetPosition, milliseconds, Step_Counter.numberOfCounts,
+        (Step_Counter.numberOfCounts == targetPosition) ? "" : "  (MISSED THE TARGET)");
+
+    Motion.position = Step_Counter.numberOfCounts;
+
+    return Step_Counter.numberOfCounts == targetPosition;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int maximumStepRate = STEPPER_MAXIMUM_STEP_RATE;
+    int allMovesStopped = true;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--constant") == 0)
+        {
+            maximumStepRate = STEPPER_START_STEP_RATE;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--constant]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    PIC24_Sim_Reset();
+    PIC24_Sim_Connect_Pins(STEP_OUTPUT_PIN, STEP_COUNT_PIN);
+
+    //every pin starts as a digital output, like PIC_Initialization in main_driver.c
+    ANSA = 0x0000;
+    ANSB = 0x0000;
+    TRISA = 0x0000;
+    TRISB = 0x0000;
+
+    Step_Output.Initialize = PWM_OC2_Fixed_Initialize;
+    Step_Output.UpdateDutyCycle = PWM_Update_OC2_Fixed_DutyCycle;
+    Step_Output.UpdateFrequency = PWM_Update_OC2_Fixed_Frequency;
+    Step_Output.SetHighTicks = PWM_Set_OC2_High_Ticks;
+    Step_Output.Initialize(&Step_Output);
+
+    Step_Counter.Initialize = IC4_Initialize;
+    Step_Counter.Update = IC4_Update;
+    Step_Counter.Initialize(&Step_Counter);
+
+    Motion.stepOutput = &Step_Output;
+    Motion.counter = &Step_Counter;
+    Motion.startStepRate = STEPPER_START_STEP_RATE;
+    Motion.maximumStepRate = maximumStepRate;
+    Motion.acceleration = STEPPER_ACCELERATION;
+    Motion.updateRate = STEPPER_UPDATE_RATE;
+    Stepper_Motion_Initialize(&Motion);
+
+    printf("step rate %u-%u steps/s, %u steps/s^2:\n", STEPPER_START_STEP_RATE, maximumStepRate, STEPPER_ACCELERATION);
+
+    allMovesStopped &= Run_Move("90 degree turn", COUNTS_FOR_90_DEGREE_TURN, COUNTS_FOR_90_DEGREE_TURN, 0);
+    allMovesStopped &= Run_Move("180 degree turn", -COUNTS_FOR_90_DEGREE_TURN, -COUNTS_FOR_90_DEGREE_TURN, 0);
+    allMovesStopped &= Run_Move("270 degree turn", COUNTS_FOR_180_DEGREE_TURN, COUNTS_FOR_180_DEGREE_TURN, 0);
+    allMovesStopped &= Run_Move("180 degree turn", 0, 0, 0);
+    allMovesStopped &= Run_Move("1 step", -1, -1, 0);
+    //the steering is turned back the other way halfway through a move
+    allMovesStopped &= Run_Move("turned around", COUNTS_FOR_90_DEGREE_TURN, -COUNTS_FOR_90_DEGREE_TURN, 300);
+
+    printf("    largest step rate change between updates:  %u steps/s (at most %u allowed)\n", LargestRateChange, STEPPER_ACCELERATION / STEPPER_UPDATE_RATE);
+
+    return allMovesStopped ? EXIT_SUCCESS : EXIT_FAILURE;
+}
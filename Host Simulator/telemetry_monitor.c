@@ -0,0 +1,313 @@
+/*
+ * File:    telemetry_monitor.c
+ * Author:  Zachary Downum
+ */
+
+//Runs main_driver.c built with TELEMETRY_ENABLED (see Telemetry.h) with the steering going
+//from side to side every second, and decodes every byte it sends on the simulated UART with
+//a Telemetry_Receiver, the way a PC on the other end of the serial cable would.  It prints
+//one frame a second, how many frames came through (and how many were bad, lost or dropped),
+//and how much of the serial port they used, and can write every frame to a CSV file, or every
+//byte as it was sent (like a capture from the craft, for flight_replay --record).
+//Under the cycle counter, the telemetry task and the U1TX interrupt are measured on their
+//own, so their share of the PIC's time can be checked against the rest of the loop.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Cycle_Counter.h"
+#include "Scheduler.h"
+#include "SerialPort.h"
+#include "Telemetry.h"
+
+#define CYCLES_PER_MICROSECOND (FCY / 1000000)
+
+//50Hz, the frame rate of the wireless controller's receiver
+#define RECEIVER_FRAME_CYCLES (20000 * CYCLES_PER_MICROSECOND)
+#define SCHEDULER_TICK_CYCLES (FCY / SCHEDULER_TICK_HZ)
+#define TICKS_PER_FRAME (RECEIVER_FRAME_CYCLES / SCHEDULER_TICK_CYCLES)
+#define DEFAULT_NUMBER_OF_FRAMES 250
+
+//main_driver.c waits 1 second after initializing before the control loop starts
+#define STARTUP_FRAMES 50
+
+//the same receiver inputs as firmware_benchmark:  kill switch and brake off, the throttle at
+//1.5ms, and the steering from one side to the other every second
+#define KILL_SWITCH_PIN 4
+#define THROTTLE_PIN 5
+#define STEERING_PIN 6
+#define BRAKE_PIN 8
+//the stepper motor's step signal (RB1) is looped back into its count input (RP7)
+#define STEP_OUTPUT_PIN 1
+#define STEPPER_COUNT_PIN 7
+#define INPUT_START_CYCLES 100
+#define SWITCH_PULSE_CYCLES (1100 * CYCLES_PER_MICROSECOND)
+#define THROTTLE_PULSE_CYCLES (1500 * CYCLES_PER_MICROSECOND)
+#define STEERING_LEFT_PULSE_CYCLES (1700 * CYCLES_PER_MICROSECOND)
+#define STEERING_RIGHT_PULSE_CYCLES (2500 * CYCLES_PER_MICROSECOND)
+#define STEERING_FRAMES_PER_SIDE 50
+
+//main_driver.c is built with the same TELEMETRY_HZ (see the Makefile), and one frame a
+//second is printed
+#define PRINTED_FRAME_INTERVAL TELEMETRY_HZ
+
+//from main_driver.c
+void Hovercraft_Initialize(void);
+extern Scheduler_Task telemetry_task;
+
+static unsigned int NumberOfFrames = DEFAULT_NUMBER_OF_FRAMES;
+static const char* CSV_File_Name;
+static FILE* CSV_File;
+static const char* Raw_File_Name;
+static FILE* Raw_File;
+static int TaskSite;
+static int InterruptSite;
+
+static Telemetry_Receiver Receiver;
+static Telemetry_Frame Last_Frame;
+static unsigned long Bytes_Received;
+static unsigned long Bad_Ticks;
+static void (*Telemetry_Task)(void);
+
+static const char* const Input_Names[TELEMETRY_NUMBER_OF_INPUTS] = { "kill_switch", "throttle", "steering", "brake" };
+static const char* const Task_Names[TELEMETRY_NUMBER_OF_TASKS] = { "receiver_input", "kill_switch", "mixing", "stepper" };
+
+static double Percentage(uint16_t q15)
+{
+    return q15 * 100.0 / 32768.0;
+}
+
+static void Write_CSV_Header(void)
+{
+    unsigned int i;
+
+    fprintf(CSV_File, "sequence,tick,flags");
+    for (i = 0; i < TELEMETRY_NUMBER_OF_INPUTS; ++i)
+    {
+        fprintf(CSV_File, ",%s_duty_cycle,%s_period_ticks", Input_Names[i], Input_Names[i]);
+    }
+    fprintf(CSV_File, ",stepper_counts,stepper_target,step_rate,throttle_servo_duty_cycle,step_output_duty_cycle");
+    for (i = 0; i < TELEMETRY_NUMBER_OF_TASKS; ++i)
+    {
+        fprintf(CSV_File, ",%s_last_cycles,%s_worst_cycles,%s_missed_deadlines", Task_Names[i], Task_Names[i], Task_Names[i]);
+    }
+    fprintf(CSV_File, ",dropped_frames\n");
+}
+
+static void Write_CSV_Frame(const Telemetry_Frame* frame)
+{
+    unsigned int i;
+
+    fprintf(CSV_File, "%u,%u,%u", frame->sequence, frame->tick, frame->flags);
+    for (i = 0; i < TELEMETRY_NUMBER_OF_INPUTS; ++i)
+    {
+        fprintf(CSV_File, ",%u,%lu", frame->inputs[i].dutyCycle, (unsigned long)frame->inputs[i].periodTicks);
+    }
+    fprintf(CSV_File, ",%d,%d,%u,%u,%u", frame->stepperCounts, frame->stepperTarget, frame->stepRate, frame->throttleServoDutyCycle, frame->stepOutputDutyCycle);
+    for (i = 0; i < TELEMETRY_NUMBER_OF_TASKS; ++i)
+    {
+        fprintf(CSV_File, ",%u,%u,%u", frame->tasks[i].lastExecutionCycles, frame->tasks[i].worstExecutionCycles, frame->tasks[i].missedDeadlines);
+    }
+    fprintf(CSV_File, ",%u\n", frame->droppedFrames);
+}
+
+static void Print_Frame(const Telemetry_Frame* frame)
+{
+    printf("%5u %6u   %c%c%c   %5.2f%% %5.2f%% %5.2f%% %5.2f%%  %6d %6d %5u   %5.2f%%\n", frame->sequence, frame->tick,
+           (frame->flags & TELEMETRY_FLAG_LIFT_RELAY) ? 'L' : '-', (frame->flags & TELEMETRY_FLAG_PROPULSION_RELAY) ? 'P' : '-', (frame->flags & TELEMETRY_FLAG_SIGNAL_LOST) ? 'X' : '-',
+           Percentage(frame->inputs[TELEMETRY_INPUT_KILL_SWITCH].dutyCycle), Percentage(frame->inputs[TELEMETRY_INPUT_THROTTLE].dutyCycle),
+           Percentage(frame->inputs[TELEMETRY_INPUT_STEERING].dutyCycle), Percentage(frame->inputs[TELEMETRY_INPUT_BRAKE].dutyCycle),
+           frame->stepperCounts, frame->stepperTarget, frame->stepRate, Percentage(frame->throttleServoDutyCycle));
+}
+
+static void Receive_Byte(uint8_t byte)
+{
+    Telemetry_Frame frame;
+
+    ++Bytes_Received;
+    if (Raw_File != NULL)
+    {
+        fputc(byte, Raw_File);
+    }
+    if (!Telemetry_Receive(&Receiver, byte, &frame))
+    {
+        return;
+    }
+
+    //every frame should be one telemetry task period after the one before
+    if (Receiver.goodFrames > 1 && (uint16_t)(frame.tick - Last_Frame.tick) != SCHEDULER_HZ_TO_TICKS(TELEMETRY_HZ))
+    {
+        ++Bad_Ticks;
+    }
+    Last_Frame = frame;
+
+    if ((Receiver.goodFrames - 1) % PRINTED_FRAME_INTERVAL == 0)
+    {
+        Print_Frame(&frame);
+    }
+    if (CSV_File != NULL)
+    {
+        Write_CSV_Frame(&frame);
+    }
+}
+
+static void Interrupt_Entry(unsigned int vector)
+{
+    if (vector == PIC24_SIM_VECTOR_U1TX)
+    {
+        CYCLE_COUNTER_BEGIN(InterruptSite);
+    }
+}
+
+static void Interrupt_Exit(unsigned int vector)
+{
+    if (vector == PIC24_SIM_VECTOR_U1TX)
+    {
+        CYCLE_COUNTER_END(InterruptSite);
+    }
+}
+
+static void Measured_Telemetry_Task(void)
+{
+    CYCLE_COUNTER_BEGIN(TaskSite);
+    Telemetry_Task();
+    CYCLE_COUNTER_END(TaskSite);
+}
+
+static void Telemetry_Workload(void)
+{
+    unsigned int totalFrames = STARTUP_FRAMES + NumberOfFrames + 1;
+    unsigned long tick;
+    unsigned int frame;
+    double seconds = (double)NumberOfFrames * RECEIVER_FRAME_CYCLES / FCY;
+
+    if (CSV_File_Name != NULL)
+    {
+        CSV_File = fopen(CSV_File_Name, "w");
+        if (CSV_File == NULL)
+        {
+            fprintf(stderr, "could not open %s\n", CSV_File_Name);
+            exit(EXIT_FAILURE);
+        }
+        Write_CSV_Header();
+    }
+    if (Raw_File_Name != NULL)
+    {
+        Raw_File = fopen(Raw_File_Name, "wb");
+        if (Raw_File == NULL)
+        {
+            fprintf(stderr, "could not open %s\n", Raw_File_Name);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    PIC24_Sim_Reset();
+    PIC24_Sim_Connect_Pins(STEP_OUTPUT_PIN, STEPPER_COUNT_PIN);
+    PIC24_Sim_UART_Transmit_Hook = Receive_Byte;
+    PIC24_Sim_Interrupt_Entry_Hook = Interrupt_Entry;
+    PIC24_Sim_Interrupt_Exit_Hook = Interrupt_Exit;
+    Telemetry_Receiver_Initialize(&Receiver);
+
+    PIC24_Sim_Schedule_Pulse_Train(KILL_SWITCH_PIN, INPUT_START_CYCLES, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    PIC24_Sim_Schedule_Pulse_Train(THROTTLE_PIN, 2 * INPUT_START_CYCLES, THROTTLE_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    PIC24_Sim_Schedule_Pulse_Train(BRAKE_PIN, 5 * INPUT_START_CYCLES, SWITCH_PULSE_CYCLES, RECEIVER_FRAME_CYCLES, totalFrames);
+    for (frame = 0; frame < totalFrames; ++frame)
+    {
+        unsigned long steering = (frame / STEERING_FRAMES_PER_SIDE) % 2 ? STEERING_RIGHT_PULSE_CYCLES : STEERING_LEFT_PULSE_CYCLES;
+
+        PIC24_Sim_Schedule_Pulse_Train(STEERING_PIN, 3 * INPUT_START_CYCLES + (unsigned long long)frame * RECEIVER_FRAME_CYCLES, steering, RECEIVER_FRAME_CYCLES, 1);
+    }
+
+    Hovercraft_Initialize();
+    Telemetry_Task = telemetry_task.Run;
+    telemetry_task.Run = Measured_Telemetry_Task;
+
+    printf("telemetry at %dHz, %d bytes a frame, %d baud\n\n", TELEMETRY_HZ, TELEMETRY_ENCODED_SIZE, SERIAL_PORT_BAUD_RATE);
+    printf("  seq   tick  relays kill   throttle steering brake   counts target  rate  throttle servo\n");
+
+    for (tick = 0; tick < (unsigned long)NumberOfFrames * TICKS_PER_FRAME; ++tick)
+    {
+        PIC24_Sim_Run_For(SCHEDULER_TICK_CYCLES);
+        Scheduler_Run_Pending();
+    }
+
+    printf("\n%lu frames decoded in %.1f seconds (%lu bad, %lu lost, %u dropped by the PIC, %lu with the wrong tick)\n",
+           (unsigned long)Receiver.goodFrames, seconds, (unsigned long)Receiver.badFrames, (unsigned long)Receiver.lostFrames, Last_Frame.droppedFrames, Bad_Ticks);
+    //10 bits a byte (start, 8 data and stop)
+    printf("%lu bytes, %.1f%% of the serial port\n", Bytes_Received, 100.0 * Bytes_Received * 10 / (seconds * SERIAL_PORT_BAUD_RATE));
+
+    if (CSV_File != NULL)
+    {
+        fclose(CSV_File);
+    }
+    if (Raw_File != NULL)
+    {
+        fclose(Raw_File);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    int countCycles = true;
+    const Cycle_Counter_Site* task;
+    const Cycle_Counter_Site* interrupt;
+    double totalCycles;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            NumberOfFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            CSV_File_Name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--raw") == 0 && i + 1 < argc)
+        {
+            Raw_File_Name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-cycles") == 0)
+        {
+            countCycles = false;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--frames <n>] [--csv <file>] [--raw <file>] [--no-cycles]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    TaskSite = Cycle_Counter_Register_Site("Telemetry_Task_Run", false);
+    InterruptSite = Cycle_Counter_Register_Site("_U1TXInterrupt", true);
+
+    if (!countCycles)
+    {
+        Telemetry_Workload();
+        return EXIT_SUCCESS;
+    }
+
+    if (Cycle_Counter_Run(Telemetry_Workload) != 0)
+    {
+        fprintf(stderr, "cycle counting is not available on this host\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("\nestimated PIC24 instruction cycles (Fcy = %lu Hz):\n", (unsigned long)FCY);
+    Cycle_Counter_Print_Report(stdout);
+
+    //the share of every instruction cycle over the run
+    task = Cycle_Counter_Get_Site(TaskSite);
+    interrupt = Cycle_Counter_Get_Site(InterruptSite);
+    totalCycles = (double)NumberOfFrames * RECEIVER_FRAME_CYCLES;
+    printf("\ntelemetry's share of the PIC:  %.2f%% (the task %.2f%%, the U1TX interrupt %.2f%%)\n",
+           100.0 * (task->totalCycles + interrupt->totalCycles) / totalCycles, 100.0 * task->totalCycles / totalCycles, 100.0 * interrupt->totalCycles / totalCycles);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*
+ * File:    torn_read_benchmark.c
+ * Author:  Zachary Downum
+ */
+
+//Measures how often reading a module's last period gives a mix of two periods (a torn
+//read) when the capture interrupt runs in the middle of the read.
+//
+//The simulated firmware normally runs in zero simulated time, so an interrupt can never
+//land inside of a read.  Here a POSIX interval timer sends a signal every few
+//microseconds of real time, and its handler advances the simulator, which runs
+//_IC1Interrupt whenever a period finishes.  The signal stops the main loop at whatever
+//instruction it is on, just like a real interrupt, while the main loop reads IC1's
+//last period over and over:
+//    unprotected:  the rising, falling and prior rising times are read straight out of
+//                  IC1_Ring.latest, the same way IC1_Update used to read IC1_Buffer
+//    snapshot:     IC1_Read_Latest_Period (which checks latestSequence)
+//The input signal has a fixed period and pulse width, so any read where they do not
+//match is torn.
+
+#include "mcc_generated_files/mcc.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "InputCapture.h"
+
+//IC1 is on RP4 (see InputCapture.c)
+#define INPUT_PIN 4
+
+//timer1 ticks are 64 instruction cycles at Fcy = 4MHz, and 256 at 16MHz
+#define CYCLES_PER_TICK CLOCK_TIMER1_PRESCALER
+#define PERIOD_TICKS 1024
+#define HIGH_TICKS 100
+#define PERIOD_CYCLES ((unsigned long long)PERIOD_TICKS * CYCLES_PER_TICK)
+
+//the signal handler advances the simulator by half a period, so IC1 interrupts on
+//about every second signal
+#define CYCLES_PER_SIGNAL (PERIOD_CYCLES / 2)
+#define SIGNAL_INTERVAL_MICROSECONDS 20
+//periods scheduled ahead of the simulated time at once
+#define PERIODS_PER_BATCH 64
+
+#define DEFAULT_SECONDS_PER_TEST 2
+
+extern IC_Ring IC1_Ring;
+
+static IC_Fixed_Module Module;
+static unsigned long long NextPeriodCycle;
+
+static void Schedule_Input(void)
+{
+    while (NextPeriodCycle < PIC24_Sim_Now() + 2 * PERIODS_PER_BATCH * PERIOD_CYCLES)
+    {
+        PIC24_Sim_Schedule_Pulse_Train(INPUT_PIN, NextPeriodCycle, HIGH_TICKS * CYCLES_PER_TICK, PERIOD_CYCLES, PERIODS_PER_BATCH);
+        NextPeriodCycle += PERIODS_PER_BATCH * PERIOD_CYCLES;
+    }
+}
+
+//plays the part of the hardware:  the main loop is never inside of the simulator when
+//this runs, so the simulator can be called from here
+static void Signal_Handler(int signalNumber)
+{
+    (void)signalNumber;
+
+    Schedule_Input();
+    PIC24_Sim_Run_For(CYCLES_PER_SIGNAL);
+}
+
+static void Start_Signals(void)
+{
+    struct itimerval interval;
+
+    memset(&interval, 0, sizeof(interval));
+    interval.it_interval.tv_usec = SIGNAL_INTERVAL_MICROSECONDS;
+    interval.it_value.tv_usec = SIGNAL_INTERVAL_MICROSECONDS;
+    setitimer(ITIMER_REAL, &interval, NULL);
+}
+
+static void Stop_Signals(void)
+{
+    struct itimerval interval;
+
+    memset(&interval, 0, sizeof(interval));
+    setitimer(ITIMER_REAL, &interval, NULL);
+}
+
+static double Seconds_Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+//whether the three times can all be from the same period of the input signal
+static int Is_Consistent(IC_Ticks risingTime, IC_Ticks fallingTime, IC_Ticks priorRisingTime)
+{
+    return (IC_Ticks)(fallingTime - risingTime) == HIGH_TICKS && (IC_Ticks)(risingTime - priorRisingTime) == PERIOD_TICKS;
+}
+
+//the old way, three separate loads with nothing to tell if the interrupt ran in between
+static int Read_Unprotected(void)
+{
+    IC_Ticks fallingTime = IC1_Ring.latest.fallingTime;
+    IC_Ticks risingTime = IC1_Ring.latest.risingTime;
+    IC_Ticks priorRisingTime = IC1_Ring.latest.priorRisingTime;
+
+    return Is_Consistent(risingTime, fallingTime, priorRisingTime);
+}
+
+static int Read_Snapshot(void)
+{
+    IC_Latest_Period period;
+
+    IC1_Read_Latest_Period(&period);
+
+    return Is_Consistent(period.risingTime, period.fallingTime, period.priorRisingTime);
+}
+
+//returns the number of torn reads
+static unsigned long Run_Test(const char* name, int (*Read)(void), double seconds)
+{
+    unsigned long reads = 0;
+    unsigned long tornReads = 0;
+    unsigned int periodsBefore;
+    unsigned int interrupts;
+    IC_Latest_Period period;
+    double endTime;
+
+    PIC24_Sim_Reset();
+    ANSB = 0x0000;
+    TRISB = 0x0000;
+    IC1_Fixed_Initialize(&Module);
+
+    //waits for two whole periods, so that every read has a prior rising time
+    NextPeriodCycle = 1000;
+    Schedule_Input();
+    PIC24_Sim_Run_For(NextPeriodCycle / 2);
+    while (IC1_Read_Latest_Period(&period) != 0 || !period.hasPriorRisingTime)
+    {
+        PIC24_Sim_Run_For(PERIOD_CYCLES);
+    }
+
+    periodsBefore = period.periodNumber;
+    endTime = Seconds_Now() + seconds;
+
+    Start_Signals();
+    //the clock is only checked every so often, to keep the loop mostly reads
+    while ((reads & 0xFFFF) != 0 || Seconds_Now() < endTime)
+    {
+        if (!Read())
+        {
+            ++tornReads;
+        }
+        ++reads;
+    }
+    Stop_Signals();
+
+    IC1_Read_Latest_Period(&period);
+    interrupts = period.periodNumber - periodsBefore;
+
+    printf("    %-12s %11lu reads, %7u interrupts, %7lu torn reads (%.2f per 1000 interrupts)\n", name, reads, interrupts, tornReads,
+        interrupts ? 1000.0 * tornReads / interrupts : 0.0);
+
+    return tornReads;
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = DEFAULT_SECONDS_PER_TEST;
+    struct sigaction action;
+    unsigned long snapshotTornReads;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            seconds = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--seconds N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = Signal_Handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGALRM, &action, NULL);
+
+    printf("IC1 last period reads with _IC1Interrupt landing in the middle of them (%.1f s each):\n", seconds);
+    Run_Test("unprotected", Read_Unprotected, seconds);
+    snapshotTornReads = Run_Test("snapshot", Read_Snapshot, seconds);
+
+    return (snapshotTornReads == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,10 @@
+/*
+ * File:    xc.h
+ * Author:  Zachary Downum
+ */
+
+//Host stand-in for the XC16 device header (the registers come from PIC24_Simulator.h)
+
+#pragma once
+
+#include "PIC24_Simulator.h"
@@ -0,0 +1,299 @@
+/*
+ * File:    firmware_benchmark_driver.c
+ * Author:  Zachary Downum
+ */
+
+//Runs the Benchmark dependency's firmware cases (see FirmwareBenchmark.h) on the PIC, timed
+//with timer5, and leaves the results as CSV (or JSON) in Benchmark_Output, to be read out with
+//the debugger (there is no UART yet).  The Host Simulator's firmware_benchmark runs the same
+//cases, so the two can be compared.
+//
+//The inputs are made by the PIC itself, so the pins have to be jumpered:
+//    RP0 to RP11 (IC6)
+//    RP1 to RP7 (IC4)
+//    RP2 to RP4 (IC1)
+//    RP3 to RP5 (IC2)
+//    RP9 to RP6 (IC3)
+//    RP10 to RP8 (IC5)
+//For the input cases, OC1's 50Hz 1.5ms pulses go out on RP1, RP2 and RP3 (to IC4, IC1 and
+//IC2) and OC2's 6kHz square wave on RP0 (to IC6).
+//The control loop cases run main_driver.c (built with -Dmain=main_driver_main, as the Host
+//Simulator does), which takes OC1 and OC2 back for the throttle servo (RP0, into the unused
+//IC6) and the step signal (RP1, which IC4 counts the steps of).  Its four receiver inputs come
+//from OC3 - OC6 instead, which main_driver.c does not use:  OC3 (RP2) is the kill switch,
+//OC4 (RP3) the throttle, OC5 (RP9) the steering and OC6 (RP10) the brake.
+
+#include "mcc_generated_files/mcc.h"
+#include "ClockConfiguration.h"
+
+#include <stdlib.h>
+#include <libpic30.h>
+#include <xc.h>
+
+#include "PWM.h"
+#include "Scheduler.h"
+#include "Benchmark.h"
+#include "FirmwareBenchmark.h"
+
+//how many 20ms frames the input cases and the control loop cases run for
+#define NUMBER_OF_FRAMES 100
+//how many times each of the PWM cases is run
+#define REPEATED_RUNS 256
+//how long each half of an interrupt measurement is (see Benchmark_Measure_Interrupt)
+#define INTERRUPT_WINDOW_CYCLES (FCY / 2)
+
+//CSV takes about 2KB, JSON about 4KB
+#define BENCHMARK_OUTPUT_JSON false
+#define BENCHMARK_OUTPUT_SIZE 4096
+
+//the revision label in the results, so saved results can be told apart
+#define BENCHMARK_REVISION "working"
+
+//from main_driver.c
+void Hovercraft_Initialize(void);
+extern Scheduler_Task receiver_input_task;
+extern Scheduler_Task stepper_task;
+extern int receiverSignalLost;
+
+//the remappable pin codes for OC1 and OC2 (see Table 11-4 in the PIC24FJ128GA202 documentation)
+#define OC1_REMAPPABLE_PIN_REFERENCE 13
+#define OC2_REMAPPABLE_PIN_REFERENCE 14
+
+//the receiver signals for the control loop cases (the same as the Host Simulator's
+//firmware_benchmark), with the steering going from one side to the other every second so
+//the stepper task has moves to make
+#define SWITCH_PULSE_MICROSECONDS 1100
+#define THROTTLE_PULSE_MICROSECONDS 1800
+#define STEERING_LEFT_PULSE_MICROSECONDS 1700
+#define STEERING_RIGHT_PULSE_MICROSECONDS 2500
+#define STEERING_FRAMES_PER_SIDE 50
+//how many 20ms frames main_driver.c gets to see every receiver input before the control
+//loop cases give up on measuring anything
+#define RECEIVER_SIGNAL_WAIT_FRAMES 50
+
+//the results, as text (READ-ONLY, from the debugger)
+char Benchmark_Output[BENCHMARK_OUTPUT_SIZE];
+unsigned int Benchmark_Output_Length = 0;
+//1 once the results have been written
+volatile int Benchmark_Done = false;
+
+PWM_Fixed_Module receiver_signal_output = PWM_FIXED_MODULE(1);
+PWM_Fixed_Module fast_signal_output = PWM_FIXED_MODULE(2);
+
+PWM_Fixed_Module kill_switch_signal_output = PWM_FIXED_MODULE(3);
+PWM_Fixed_Module throttle_signal_output = PWM_FIXED_MODULE(4);
+PWM_Fixed_Module steering_signal_output = PWM_FIXED_MODULE(5);
+PWM_Fixed_Module brake_signal_output = PWM_FIXED_MODULE(6);
+PWM_Servo kill_switch_signal;
+PWM_Servo throttle_signal;
+PWM_Servo steering_signal;
+PWM_Servo brake_signal;
+
+//basic initialization for all pins (main_driver.c's PIC_Initialization turns every pin into an
+//output, so this is run again after Hovercraft_Initialize)
+void Jumper_Pin_Initialization(void)
+{
+    //changes all pins to digital
+    ANSA = 0x0000;
+    ANSB = 0x0000;
+    Nop();
+    
+    //changes all pins to output (except for the jumpered inputs)
+    TRISA = 0x0000;
+    TRISB = (1 << 4) | (1 << 5) | (1 << 6) | (1 << 7) | (1 << 8) | (1 << 11);
+    Nop();
+}
+
+void Benchmark_Output_Put(char character)
+{
+    //the last character is always left as the end of the string
+    if (Benchmark_Output_Length < BENCHMARK_OUTPUT_SIZE - 1)
+    {
+        Benchmark_Output[Benchmark_Output_Length++] = character;
+    }
+}
+
+//the inputs the IC cases read (see the jumpers above)
+void Signal_Initialize(void)
+{
+    receiver_signal_output.Initialize(&receiver_signal_output);
+    receiver_signal_output.frequency = FIRMWARE_BENCHMARK_RECEIVER_HZ;
+    receiver_signal_output.UpdateFrequency(&receiver_signal_output);
+    receiver_signal_output.dutyCycle = Q15_FROM_PERCENTAGE(7.5);
+    receiver_signal_output.UpdateDutyCycle(&receiver_signal_output);
+    
+    fast_signal_output.Initialize(&fast_signal_output);
+    fast_signal_output.frequency = FIRMWARE_BENCHMARK_FAST_INPUT_HZ;
+    fast_signal_output.UpdateFrequency(&fast_signal_output);
+    (void)PWM_Fixed_Request_Clock(&fast_signal_output, FIRMWARE_BENCHMARK_FAST_INPUT_HZ);
+    fast_signal_output.dutyCycle = Q15_FROM_PERCENTAGE(50);
+    fast_signal_output.UpdateDutyCycle(&fast_signal_output);
+    
+    //OC1 and OC2 start out on RP0 and RP1, and Firmware_Benchmark_Initialize has put OC3 and OC4
+    //on RP2 and RP3, so the pins are moved over to where the jumpers need them (OC3 and OC4 are
+    //still timed the same without a pin)
+    RPOR0bits.RP0R = OC2_REMAPPABLE_PIN_REFERENCE;
+    RPOR0bits.RP1R = OC1_REMAPPABLE_PIN_REFERENCE;
+    RPOR1bits.RP2R = OC1_REMAPPABLE_PIN_REFERENCE;
+    RPOR1bits.RP3R = OC1_REMAPPABLE_PIN_REFERENCE;
+}
+
+//one of main_driver.c's receiver inputs, as a 50Hz servo signal
+void Receiver_Signal_Initialize(PWM_Servo* signal, PWM_Fixed_Module* output, uint16_t microseconds)
+{
+    output->Initialize(output);
+    output->frequency = FIRMWARE_BENCHMARK_RECEIVER_HZ;
+    output->UpdateFrequency(output);
+    signal->output = output;
+    signal->frameRate = FIRMWARE_BENCHMARK_RECEIVER_HZ;
+    PWM_Servo_Initialize(signal);
+    PWM_Servo_Set_Pulse_Width(signal, microseconds);
+}
+
+void Run_Firmware_Cases(void)
+{
+    unsigned int frame;
+    unsigned int i;
+    
+    Firmware_Benchmark_Initialize();
+    Signal_Initialize();
+    
+    for (frame = 0; frame < NUMBER_OF_FRAMES; ++frame)
+    {
+        __delay_ms(20);
+        
+        for (i = 0; i < FIRMWARE_BENCHMARK_FRAME_CASES; ++i)
+        {
+            Benchmark_Run_Case(&Firmware_Benchmark_Cases[i], 1);
+        }
+        Firmware_Benchmark_Drain_Fast_Input();
+    }
+    
+    for (i = FIRMWARE_BENCHMARK_FIRST_REPEATED_CASE; i < FIRMWARE_BENCHMARK_FIRST_REPEATED_CASE + FIRMWARE_BENCHMARK_REPEATED_CASES; ++i)
+    {
+        Benchmark_Run_Case(&Firmware_Benchmark_Cases[i], REPEATED_RUNS);
+    }
+    
+    //IC1 interrupts on every 2nd capture (once per pulse, see IC_RECEIVER_CAPTURES_PER_INTERRUPT)
+    //and IC6 on every 4th, so these are counted per edge, not per interrupt
+    Benchmark_Measure_Interrupt(&Firmware_Benchmark_Cases[FIRMWARE_BENCHMARK_IC1_INTERRUPT_50HZ], &IEC0, 1 << 1, 2 * FIRMWARE_BENCHMARK_RECEIVER_HZ, INTERRUPT_WINDOW_CYCLES);
+    Firmware_Benchmark_Drain_Fast_Input();
+    Benchmark_Measure_Interrupt(&Firmware_Benchmark_Cases[FIRMWARE_BENCHMARK_IC6_INTERRUPT_6KHZ], &IEC2, 1 << 8, 2 * FIRMWARE_BENCHMARK_FAST_INPUT_HZ, INTERRUPT_WINDOW_CYCLES);
+}
+
+//waits for the scheduler's next tick, so it is timed right when its tasks become due
+unsigned int Wait_For_Next_Tick(unsigned int lastTick)
+{
+    unsigned int now;
+    
+    do
+    {
+        now = Scheduler_Get_Ticks();
+    } while (now == lastTick);
+    
+    return now;
+}
+
+//main_driver.c's scheduler, one tick at a time, with every tick that runs a task timed as
+//either a control iteration or a stepper tick
+//Only the ticks with every receiver input present are timed, since the failsafe path
+//main_driver.c takes without them is not the control loop.
+void Run_Control_Loop(void)
+{
+    Benchmark_Case* control_iteration = &Firmware_Benchmark_Cases[FIRMWARE_BENCHMARK_CONTROL_ITERATION];
+    Benchmark_Case* stepper_tick = &Firmware_Benchmark_Cases[FIRMWARE_BENCHMARK_STEPPER_TICK];
+    unsigned int lastTick;
+    unsigned int tick;
+    unsigned int frame = 0;
+    
+    Hovercraft_Initialize();
+    Jumper_Pin_Initialization();
+    
+    Receiver_Signal_Initialize(&kill_switch_signal, &kill_switch_signal_output, SWITCH_PULSE_MICROSECONDS);
+    Receiver_Signal_Initialize(&throttle_signal, &throttle_signal_output, THROTTLE_PULSE_MICROSECONDS);
+    Receiver_Signal_Initialize(&steering_signal, &steering_signal_output, STEERING_LEFT_PULSE_MICROSECONDS);
+    Receiver_Signal_Initialize(&brake_signal, &brake_signal_output, SWITCH_PULSE_MICROSECONDS);
+    
+    control_iteration->Run = Scheduler_Run_Pending;
+    stepper_tick->Run = Scheduler_Run_Pending;
+    
+    //the inputs only count as present once they have each sent their first pulses, so the
+    //scheduler runs untimed until then (if they never show up, nothing is recorded and the
+    //jumpers need checking)
+    lastTick = Scheduler_Get_Ticks();
+    for (tick = 0; receiverSignalLost && tick < RECEIVER_SIGNAL_WAIT_FRAMES * (SCHEDULER_TICK_HZ / FIRMWARE_BENCHMARK_RECEIVER_HZ); ++tick)
+    {
+        lastTick = Wait_For_Next_Tick(lastTick);
+        Scheduler_Run_Pending();
+    }
+    
+    for (tick = 0; tick < NUMBER_OF_FRAMES * (SCHEDULER_TICK_HZ / FIRMWARE_BENCHMARK_RECEIVER_HZ); ++tick)
+    {
+        lastTick = Wait_For_Next_Tick(lastTick);
+        
+        if (receiverSignalLost)
+        {
+            Scheduler_Run_Pending();
+        }
+        //(nextRunTick is only for the scheduler, but it says which tasks are due)
+        else if ((int)(lastTick - receiver_input_task.nextRunTick) >= 0)
+        {
+            Benchmark_Run_Case(control_iteration, 1);
+            
+            ++frame;
+            if (frame % STEERING_FRAMES_PER_SIDE == 0)
+            {
+                PWM_Servo_Set_Pulse_Width(&steering_signal, (frame / STEERING_FRAMES_PER_SIDE) % 2 ? STEERING_RIGHT_PULSE_MICROSECONDS : STEERING_LEFT_PULSE_MICROSECONDS);
+            }
+        }
+        else if ((int)(lastTick - stepper_task.nextRunTick) >= 0)
+        {
+            Benchmark_Run_Case(stepper_tick, 1);
+        }
+        else
+        {
+            Scheduler_Run_Pending();
+        }
+    }
+}
+
+int main(void)
+{
+    SYSTEM_Initialize();
+    if (!Clock_Initialize())
+    {
+        while (1)
+        {
+        }
+    }
+    Jumper_Pin_Initialization();
+    
+    //timer5 has to be free for the timing (see Benchmark.h)
+    if (!Benchmark_Initialize())
+    {
+        while (1)
+        {
+        }
+    }
+    
+    Run_Firmware_Cases();
+    Run_Control_Loop();
+    
+    if (BENCHMARK_OUTPUT_JSON)
+    {
+        Benchmark_Write_JSON(Firmware_Benchmark_Cases, FIRMWARE_BENCHMARK_NUMBER_OF_CASES, BENCHMARK_REVISION, "pic24", Benchmark_Output_Put);
+    }
+    else
+    {
+        Benchmark_Write_CSV(Firmware_Benchmark_Cases, FIRMWARE_BENCHMARK_NUMBER_OF_CASES, BENCHMARK_REVISION, "pic24", Benchmark_Output_Put);
+    }
+    Benchmark_Output[Benchmark_Output_Length] = '\0';
+    Benchmark_Done = true;
+    
+    //a breakpoint here, then read Benchmark_Output
+    while (true)
+    {
+    }
+    
+    return -1;
+}